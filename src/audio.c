@@ -27,6 +27,7 @@ int SoundBufferSize = 1024 / 4;			/* Size of sound buffer (in samples) */
 int SdlAudioBufferSize = 0;			/* in ms (0 = use default) */
 int pulse_swallowing_count = 0;			/* Sound disciplined emulation rate controlled by  */
 						/*  window comparator and pulse swallowing counter */
+static SDL_atomic_t nBufferUnderruns;		/* Callbacks without enough generated samples */
 
 /*-----------------------------------------------------------------------*/
 /**
@@ -35,7 +36,7 @@ int pulse_swallowing_count = 0;			/* Sound disciplined emulation rate controlled
 static void Audio_CallBack(void *userdata, Uint8 *stream, int len)
 {
 	Sint16 *pBuffer;
-	int i, window, nSamplesPerFrame;
+	int window, nSamplesPerFrame, nQueued, nCopied;
 
 	pBuffer = (Sint16 *)stream;
 	len = len / 4;  // Use length in samples (16 bit stereo), not in bytes
@@ -51,7 +52,8 @@ static void Audio_CallBack(void *userdata, Uint8 *stream, int len)
 	 * See: main.c - Main_WaitOnVbl()
 	 */
 
-//fprintf ( stderr , "audio cb in len=%d gensmpl=%d idx=%d\n" , len , nGeneratedSamples , AudioMixBuffer_pos_read );
+	nQueued = Sound_GetQueuedSamples();
+//fprintf ( stderr , "audio cb in len=%d queued=%d\n" , len , nQueued );
 	pulse_swallowing_count = 0;	/* 0 = Unaltered emulation rate */
 
 	if (ConfigureParams.Sound.bEnableSoundSync)
@@ -61,48 +63,27 @@ static void Audio_CallBack(void *userdata, Uint8 *stream, int len)
 		window = (nSamplesPerFrame > SoundBufferSize) ? nSamplesPerFrame : SoundBufferSize;
 
 		/* Window Comparator for SoundBufferSize */
-		if (nGeneratedSamples < window + (window >> 1))
+		if (nQueued < window + (window >> 1))
 		/* Increase emulation rate to maintain sound synchronization */
 			pulse_swallowing_count = -5793 / nScreenRefreshRate;
 		else
-		if (nGeneratedSamples > (window << 1) + (window >> 2))
+		if (nQueued > (window << 1) + (window >> 2))
 		/* Decrease emulation rate to maintain sound synchronization */
 			pulse_swallowing_count = 5793 / nScreenRefreshRate;
 
 		/* Otherwise emulation rate is unaltered. */
 	}
 
-	if (nGeneratedSamples >= len)
+	/* Pass generated samples to audio system */
+	nCopied = Sound_ReadSamples(pBuffer, len);
+	if (nCopied < len)
 	{
-		/* Enough samples available: Pass completed buffer to audio system
-		 * by write samples into sound buffer and by converting them from
-		 * 'signed' to 'unsigned' */
-		for (i = 0; i < len; i++)
-		{
-			*pBuffer++ = AudioMixBuffer[(AudioMixBuffer_pos_read + i) & AUDIOMIXBUFFER_SIZE_MASK][0];
-			*pBuffer++ = AudioMixBuffer[(AudioMixBuffer_pos_read + i) & AUDIOMIXBUFFER_SIZE_MASK][1];
-		}
-		AudioMixBuffer_pos_read += len;
-		nGeneratedSamples -= len;
+		/* Not enough samples available: clear rest of the buffer to
+		 * ensure we don't play random bytes instead of missing samples */
+		memset(pBuffer + 2 * nCopied, 0, (len - nCopied) * 4);
+		SDL_AtomicAdd(&nBufferUnderruns, 1);
 	}
-	else  /* Not enough samples available: */
-	{
-		for (i = 0; i < nGeneratedSamples; i++)
-		{
-			*pBuffer++ = AudioMixBuffer[(AudioMixBuffer_pos_read + i) & AUDIOMIXBUFFER_SIZE_MASK][0];
-			*pBuffer++ = AudioMixBuffer[(AudioMixBuffer_pos_read + i) & AUDIOMIXBUFFER_SIZE_MASK][1];
-		}
-		/* Clear rest of the buffer to ensure we don't play random bytes instead */
-		/* of missing samples */
-		memset(pBuffer, 0, (len - nGeneratedSamples) * 4);
-
-		AudioMixBuffer_pos_read += nGeneratedSamples;
-		nGeneratedSamples = 0;
-		
-	}
-
-	AudioMixBuffer_pos_read = AudioMixBuffer_pos_read & AUDIOMIXBUFFER_SIZE_MASK;
-//fprintf ( stderr , "audio cb out len=%d gensmpl=%d idx=%d\n" , len , nGeneratedSamples , AudioMixBuffer_pos_read );
+//fprintf ( stderr , "audio cb out len=%d copied=%d\n" , len , nCopied );
 }
 
 
@@ -283,3 +264,26 @@ void Audio_EnableAudio(bool bEnable)
 		bPlayingBuffer = false;
 	}
 }
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Show audio ring buffer state and under/overrun counts (for debugger)
+ */
+void Audio_Info(FILE *fp, uint32_t dummy)
+{
+	if (!bSoundWorking)
+	{
+		fprintf(fp, "Sound output is disabled.\n");
+		return;
+	}
+	fprintf(fp, "Output: %d Hz, SDL buffer %d samples\n",
+		nAudioFrequency, SoundBufferSize);
+	fprintf(fp, "Ring buffer: %d / %d samples queued\n",
+		Sound_GetQueuedSamples(), AUDIOMIXBUFFER_SIZE);
+	fprintf(fp, "Underruns: %d (audio callback without enough samples)\n",
+		SDL_AtomicGet(&nBufferUnderruns));
+	fprintf(fp, "Overruns: %d (generated samples not fitting to ring)\n",
+		Sound_BufferOverruns);
+	fprintf(fp, "Emulation rate adjustment: %d\n", pulse_swallowing_count);
+}
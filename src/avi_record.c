@@ -21,8 +21,24 @@
      tradeoff between cpu usage and file size and should not slow down Hatari
      with recent computers.
 
+   - ZMBV : lossless "Zip Motion Blocks Video" codec (as used by DOSBox and
+     supported by ffmpeg). Frames are cut into 16x16 blocks and only the blocks
+     that changed since the previous frame are stored, compressed with zlib.
+     A complete frame (keyframe) is stored every N frames. Frames using only
+     colours of the ST palette are stored in 8 bits with their palette, else
+     in 32 bits.
+
   PNG compression will often give a x20 ratio when compared to BMP and should
-  be used if you have a powerful enough cpu.
+  be used if you have a powerful enough cpu. As most Atari programs only update
+  a small part of the screen between 2 frames, ZMBV is usually even smaller
+  and needs much less cpu than PNG.
+
+  The emulation thread only copies/converts each video and audio frame and adds
+  it to a bounded queue. PNG compression is then done in parallel by some worker
+  threads, and frames are written sequentially to the file in the order they
+  were queued. As each ZMBV frame depends on the previous one, ZMBV frames are
+  compressed by the writer thread, just before being written. If the queue is
+  full, emulation waits for the oldest frame to be written.
 
   Sound is saved as 16 bits pcm stereo, using the current Hatari sound output
   frequency. For best accuracy, sound frequency should be a multiple of the
@@ -92,6 +108,7 @@ const char AVIRecord_fileid[] = "Hatari avi_record.c";
 #include "file.h"
 #include "log.h"
 #include "screen.h"
+#include "screenConvert.h"
 #include "screenSnapShot.h"
 #include "sound.h"
 #include "statusbar.h"
@@ -101,6 +118,9 @@ const char AVIRecord_fileid[] = "Hatari avi_record.c";
 #if HAVE_LIBPNG
 #include <png.h>
 #endif
+#if HAVE_ZLIB_H
+#include <zlib.h>
+#endif
 
 #include "pixel_convert.h"				/* inline functions */
 
@@ -152,6 +172,8 @@ typedef struct
 #define AVI_INDEX_OF_INDEXES	0x00			/* Possibles values for index_type */
 #define AVI_INDEX_OF_CHUNKS	0x01
 
+#define	AVI_INDEX_DELTA_FRAME	0x80000000		/* Set in an index entry's size if the frame is not a keyframe */
+
 typedef struct
 {
 	uint8_t			offset[8];		/* 64 bit offset in avi file */
@@ -354,6 +376,7 @@ typedef struct {
 
 #define	VIDEO_STREAM_RGB			0x00000000		/* fourcc for BMP video frames */
 #define	VIDEO_STREAM_PNG			"MPNG"			/* fourcc for PNG video frames */
+#define	VIDEO_STREAM_ZMBV			"ZMBV"			/* fourcc for ZMBV video frames */
 
 #define	AVIF_HASINDEX				0x00000010		/* index at the end of the file */
 #define	AVIF_ISINTERLEAVED			0x00000100		/* data are interleaved */
@@ -374,7 +397,8 @@ typedef struct {
 typedef struct {
   /* Input params to start recording */
   int		VideoCodec;
-  int		VideoCodecCompressionLevel;					/* 0-9 for png compression */
+  int		VideoCodecCompressionLevel;					/* 0-9 for png/zmbv compression */
+  int		VideoCodecKeyframeInterval;					/* a zmbv keyframe every n frames */
 
   SDL_Surface	*Surface;
 
@@ -397,6 +421,8 @@ typedef struct {
   int		TotalVideoFrames;			/* number of recorded video frames */
   int		TotalAudioFrames;			/* number of recorded audio frames */
   int		TotalAudioSamples;			/* number of recorded audio samples */
+  int		QueuedVideoFrames;			/* number of video frames given to the writer thread */
+  SDL_threadID	MainThreadId;				/* thread calling Avi_Record*Stream() */
 
   off_t		RiffChunkPosStart;			/* as returned by ftello() */
   off_t		MoviChunkPosStart;
@@ -421,6 +447,79 @@ typedef struct {
 
 
 
+/* Video/audio frames are converted by the emulation thread and put in a queue ; */
+/* png compression and file writes are then done by some worker threads */
+#define	AVI_QUEUE_SIZE				16			/* Max number of frames waiting to be written */
+#define	AVI_QUEUE_THREADS_MAX			4			/* Max number of threads to compress png frames */
+#define	AVI_FILE_BUFFER_SIZE			( 4 * 1024 * 1024 )	/* stdio buffer to write the file in large blocks */
+
+#define	AVI_JOB_VIDEO				0
+#define	AVI_JOB_AUDIO				1
+
+#define	AVI_JOB_FREE				0
+#define	AVI_JOB_READY				1			/* waiting for compression */
+#define	AVI_JOB_ENCODING			2
+#define	AVI_JOB_DONE				3			/* waiting to be written */
+
+typedef struct {
+  int		Type;					/* AVI_JOB_VIDEO or AVI_JOB_AUDIO */
+  int		State;
+  SCREENSNAPSHOT_BUFFER	Data;				/* chunk as written to the file (header + data) */
+  int		DataSize;				/* <= 0 if compression failed */
+  int		SampleLength;				/* number of audio samples */
+  bool		KeyFrame;				/* false if video frame depends on the previous one */
+#if HAVE_LIBPNG || HAVE_LIBZ
+  SCREENSNAPSHOT_IMAGE	Image;				/* video frame to compress */
+#endif
+} RECORD_AVI_JOB;
+
+static struct {
+  RECORD_AVI_JOB	Jobs[ AVI_QUEUE_SIZE ];
+  int		Head;					/* oldest job, next one to be written */
+  int		Count;					/* number of jobs in the queue */
+  bool		Writing;				/* a thread is writing jobs to the file */
+  bool		Quit;
+  bool		Error;
+  const char	*pErrorMsg;				/* 1st error in a worker thread */
+
+  SDL_mutex	*Lock;
+  SDL_cond	*CondWork;				/* new job queued or quit requested */
+  SDL_cond	*CondFree;				/* a job was written */
+  SDL_Thread	*Threads[ AVI_QUEUE_THREADS_MAX ];
+  int		NbThreads;
+
+  /* Back-pressure statistics */
+  int		Waits;					/* number of times the queue was full */
+  int		WaitTicks;				/* total time waited by the emulation, in ms */
+  int		MaxCount;				/* max number of jobs in the queue */
+} AviQueue;
+
+
+#if HAVE_LIBZ
+/* ZMBV frame header and formats (see DOSBox's zmbv.cpp) */
+#define	ZMBV_BLOCK_SIZE				16			/* blocks of 16x16 pixels */
+#define	ZMBV_FLAG_KEYFRAME			0x01
+#define	ZMBV_FLAG_DELTA_PALETTE			0x02
+#define	ZMBV_VERSION_HI				0
+#define	ZMBV_VERSION_LO				1
+#define	ZMBV_COMPRESSION_ZLIB			1
+#define	ZMBV_FORMAT_8BPP			4
+#define	ZMBV_FORMAT_32BPP			8
+
+/* ZMBV encoder state, only used by the writer thread */
+static struct {
+  z_stream	Stream;					/* 1 zlib stream, restarted at each keyframe */
+  bool		StreamInit;
+  int		Format;					/* ZMBV_FORMAT_xxx since last keyframe */
+  int		FramesToKey;				/* number of frames before next keyframe */
+  uint8_t	Palette[256][3];			/* palette of the previous frame */
+  SCREENSNAPSHOT_BUFFER	CurFrame;			/* current frame, in the zmbv format */
+  SCREENSNAPSHOT_BUFFER	PrevFrame;			/* previous frame, in the zmbv format */
+  SCREENSNAPSHOT_BUFFER	Work;				/* frame data before compression */
+} AviZmbv;
+#endif
+
+
 bool		bRecordingAvi = false;
 
 
@@ -438,7 +537,7 @@ static void	Avi_Store4cc ( uint8_t *p , const char *text );
 
 static bool	Avi_FrameIndex_GrowIfNeeded ( RECORD_AVI_PARAMS *pAviParams );
 static bool	Avi_FrameIndex_Free ( RECORD_AVI_PARAMS *pAviParams );
-static bool	Avi_FrameIndex_Add ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER *pAviFileHeader , int type , off_t Frame_Pos , int Frame_Length );
+static bool	Avi_FrameIndex_Add ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER *pAviFileHeader , int type , off_t Frame_Pos , uint32_t Frame_Length );
 
 static bool	Avi_WriteMoviIndex ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER *pAviFileHeader ,
 				     int type , off_t *pPosition , int *pSize , int *pDuration );
@@ -449,11 +548,26 @@ static bool	Avi_CreateNewMoviChunk ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HE
 
 static int	Avi_GetBmpSize ( int Width , int Height , int BitCount );
 
-static bool	Avi_RecordVideoStream_BMP ( RECORD_AVI_PARAMS *pAviParams );
+static void	Avi_ReportError ( RECORD_AVI_PARAMS *pAviParams , const char *pMsg );
+static bool	Avi_Queue_WriteJob ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob );
+static int	Avi_Queue_Thread ( void *data );
+static bool	Avi_Queue_Start ( RECORD_AVI_PARAMS *pAviParams );
+static bool	Avi_Queue_Stop ( void );
+static RECORD_AVI_JOB	*Avi_Queue_GetFreeJob ( void );
+static void	Avi_Queue_Push ( RECORD_AVI_JOB *pJob , int State );
+
+static bool	Avi_RecordVideoStream_BMP ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob );
 #if HAVE_LIBPNG
-static bool	Avi_RecordVideoStream_PNG ( RECORD_AVI_PARAMS *pAviParams );
+static bool	Avi_RecordVideoStream_PNG ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob );
 #endif
-static bool	Avi_RecordAudioStream_PCM ( RECORD_AVI_PARAMS *pAviParams , int16_t pSamples[][2], int SampleIndex, int SampleLength );
+#if HAVE_LIBZ
+static bool	Avi_ZMBV_Init ( RECORD_AVI_PARAMS *pAviParams );
+static void	Avi_ZMBV_Free ( void );
+static int	Avi_ZMBV_Encode ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob );
+static bool	Avi_RecordVideoStream_ZMBV ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob );
+#endif
+static bool	Avi_RecordAudioStream_PCM ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob ,
+					    int16_t pSamples[][2], int SampleIndex, int SampleLength );
 
 static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER *pAviFileHeader );
 
@@ -571,10 +685,11 @@ static	bool	Avi_FrameIndex_Free ( RECORD_AVI_PARAMS *pAviParams )
 /**
  * Store the position / length of a frame in our internal index array
  * If 'type' = 0, we store a video frame, else we store an audio frame
+ * (for video frames, length has AVI_INDEX_DELTA_FRAME set if it's not a keyframe)
  * If the last video frame exceed AVI_MOVI_CHUNK_MAX_SIZE, we create a new
  * 'movi' chunk to handle avi files > 4GB
  */
-static	bool	Avi_FrameIndex_Add ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER *pAviFileHeader , int type , off_t Frame_Pos , int Frame_Length )
+static	bool	Avi_FrameIndex_Add ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER *pAviFileHeader , int type , off_t Frame_Pos , uint32_t Frame_Length )
 {
 //fprintf ( stderr , "avi_add type=%d pos=%ld length=%d count=%d %d %d\n" , type , Frame_Pos , Frame_Length , pAviParams->AviFrameIndex_Count , pAviParams->TotalVideoFrames , pAviParams->TotalAudioFrames );
 	if ( Avi_FrameIndex_GrowIfNeeded ( pAviParams ) == false )
@@ -641,7 +756,8 @@ static	bool	Avi_WriteMoviIndex ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER
 		Avi_Store4cc ( IndexChunk.ChunkName , "ix00" );
 		if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_BMP )
 			Avi_Store4cc ( IndexChunk.chunk_id , "00db" );
-		else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
+		else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG
+		       || pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
 			Avi_Store4cc ( IndexChunk.chunk_id , "00dc" );
 		Avi_StoreU64 ( IndexChunk.base_offset , pAviParams->VideoFrames_Base_Offset );
 		*pDuration = pAviParams->AviFrameIndex_Count;			/* For video super index, duration=entries_in_use */
@@ -668,7 +784,7 @@ static	bool	Avi_WriteMoviIndex ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER
 	if ( fwrite ( &IndexChunk , sizeof ( AVI_STREAM_INDEX ) , 1 , pAviParams->FileOut ) != 1 )
 	{
 		perror ( "Avi_WriteMoviIndex" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write index header" );
+		Avi_ReportError ( pAviParams , "AVI recording : failed to write index header" );
 		return false;
 	}
 
@@ -690,7 +806,7 @@ static	bool	Avi_WriteMoviIndex ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER
 		if ( fwrite ( &IndexEntry , sizeof ( IndexEntry ) , 1 , pAviParams->FileOut ) != 1 )
 		{
 			perror ( "Avi_WriteMoviIndex" );
-			Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write index entry" );
+			Avi_ReportError ( pAviParams , "AVI recording : failed to write index entry" );
 			return false;
 		}
 	}
@@ -764,13 +880,13 @@ static	bool	Avi_CloseMoviChunk ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER
 	if ( fseeko ( pAviParams->FileOut , pAviParams->MoviChunkPosStart+4 , SEEK_SET ) != 0 )
 	{
 		perror ( "Avi_CloseMoviChunk" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to seek to movi start" );
+		Avi_ReportError ( pAviParams , "AVI recording : failed to seek to movi start" );
 		return false;
 	}
 	if ( fwrite ( TempSize , sizeof ( TempSize ) , 1 , pAviParams->FileOut ) != 1 )
 	{
 		perror ( "Avi_CloseMoviChunk" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write movi size" );
+		Avi_ReportError ( pAviParams , "AVI recording : failed to write movi size" );
 		return false;
 	}
 
@@ -794,13 +910,13 @@ static	bool	Avi_CloseMoviChunk ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER
 		if ( fseeko ( pAviParams->FileOut , pAviParams->RiffChunkPosStart+4 , SEEK_SET ) != 0 )
 		{
 			perror ( "Avi_CloseMoviChunk" );
-			Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to seek to riff start" );
+			Avi_ReportError ( pAviParams , "AVI recording : failed to seek to riff start" );
 			return false;
 		}
 		if ( fwrite ( TempSize , sizeof ( TempSize ) , 1 , pAviParams->FileOut ) != 1 )
 		{
 			perror ( "Avi_CloseMoviChunk" );
-			Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write riff size" );
+			Avi_ReportError ( pAviParams , "AVI recording : failed to write riff size" );
 			return false;
 		}
 	}
@@ -809,7 +925,7 @@ static	bool	Avi_CloseMoviChunk ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADER
 	if ( fseeko ( pAviParams->FileOut , 0 , SEEK_END ) != 0 )
 	{
 		perror ( "Avi_CloseMoviChunk" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to seek to end of file" );
+		Avi_ReportError ( pAviParams , "AVI recording : failed to seek to end of file" );
 		return false;
 	}
 
@@ -849,7 +965,7 @@ static	bool	Avi_CreateNewMoviChunk ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HE
 	if ( fwrite ( &RiffHeader , sizeof ( RiffHeader ) , 1 , pAviParams->FileOut ) != 1 )
 	{
 		perror ( "Avi_CreateNewMoviChunk" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write next riff header" );
+		Avi_ReportError ( pAviParams , "AVI recording : failed to write next riff header" );
 		return false;
 	}
 
@@ -861,7 +977,7 @@ static	bool	Avi_CreateNewMoviChunk ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HE
 	if ( fwrite ( &ListMovi , sizeof ( ListMovi ) , 1 , pAviParams->FileOut ) != 1 )
 	{
 		perror ( "Avi_CreateNewMoviChunk" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write next movi header" );
+		Avi_ReportError ( pAviParams , "AVI recording : failed to write next movi header" );
 		return false;
 	}
 
@@ -878,38 +994,322 @@ static int	Avi_GetBmpSize ( int Width , int Height , int BitCount )
 }
 
 
-static bool	Avi_RecordVideoStream_BMP ( RECORD_AVI_PARAMS *pAviParams )
+/*-----------------------------------------------------------------------*/
+/**
+ * Report an error when writing the avi file. If we're called from the
+ * emulation thread, an alert is shown immediately ; else the 1st error
+ * is kept and shown later by the emulation thread (see Avi_Queue_Stop)
+ */
+static void	Avi_ReportError ( RECORD_AVI_PARAMS *pAviParams , const char *pMsg )
+{
+	if ( SDL_ThreadID() == pAviParams->MainThreadId )
+	{
+		Log_AlertDlg ( LOG_ERROR, "%s", pMsg );
+		return;
+	}
+
+	SDL_LockMutex ( AviQueue.Lock );
+	if ( AviQueue.pErrorMsg == NULL )
+		AviQueue.pErrorMsg = pMsg;
+	SDL_UnlockMutex ( AviQueue.Lock );
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write a job's chunk at the end of the file and add it to the index
+ * (called by the writer thread, jobs are written in the order they were queued)
+ */
+static bool	Avi_Queue_WriteJob ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob )
+{
+	off_t		Pos_Start;
+	uint32_t	Length;
+
+#if HAVE_LIBZ
+	/* Each zmbv frame depends on the previous one, so it's compressed in the writing order */
+	if ( pJob->Type == AVI_JOB_VIDEO && pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+		pJob->DataSize = Avi_ZMBV_Encode ( pAviParams , pJob );
+#endif
+
+	if ( pJob->DataSize <= 0 )
+	{
+		Avi_ReportError ( pAviParams , "AVI recording : failed to encode frame" );
+		return false;
+	}
+
+	/* Whole chunk (header + data) is written at once */
+	Pos_Start = ftello ( pAviParams->FileOut );
+	if ( fwrite ( pJob->Data.pData , pJob->DataSize , 1 , pAviParams->FileOut ) != 1 )
+	{
+		perror ( "Avi_Queue_WriteJob" );
+		Avi_ReportError ( pAviParams , "AVI recording : failed to write frame" );
+		return false;
+	}
+
+	if ( pJob->Type == AVI_JOB_VIDEO )
+		pAviParams->TotalVideoFrames++;
+	else
+	{
+		pAviParams->TotalAudioFrames++;
+		pAviParams->TotalAudioSamples += pJob->SampleLength;
+	}
+
+	/* Store index for this frame */
+	Pos_Start += 8;								/* skip header */
+	Length = pJob->DataSize - 8;
+	if ( pJob->Type == AVI_JOB_VIDEO && !pJob->KeyFrame )
+		Length |= AVI_INDEX_DELTA_FRAME;
+	if ( Avi_FrameIndex_Add ( pAviParams , &AviFileHeader , pJob->Type == AVI_JOB_VIDEO ? 0 : 1 ,
+				  Pos_Start , Length ) == false )
+	{
+		Avi_ReportError ( pAviParams , "AVI recording : failed to update index" );
+		return false;
+	}
+
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Encoder/writer thread main loop. Video frames are compressed in parallel
+ * by all the threads, while only one thread at a time writes the completed
+ * jobs to the file, in the order they were queued.
+ */
+static int	Avi_Queue_Thread ( void *data )
+{
+	RECORD_AVI_PARAMS	*pAviParams = data;
+	RECORD_AVI_JOB		*pJob;
+	int			i;
+	bool			ok;
+
+	SDL_LockMutex ( AviQueue.Lock );
+	for (;;)
+	{
+		/* Is there a frame to encode ? */
+		pJob = NULL;
+		for ( i = 0 ; i < AviQueue.Count ; i++ )
+			if ( AviQueue.Jobs[ ( AviQueue.Head + i ) % AVI_QUEUE_SIZE ].State == AVI_JOB_READY )
+			{
+				pJob = &AviQueue.Jobs[ ( AviQueue.Head + i ) % AVI_QUEUE_SIZE ];
+				break;
+			}
+
+		if ( pJob )
+		{
+			pJob->State = AVI_JOB_ENCODING;
+			SDL_UnlockMutex ( AviQueue.Lock );
+#if HAVE_LIBPNG
+			/* Keep some room for the chunk header before the png data */
+			pJob->Data.Size = 8;
+			pJob->DataSize = ScreenSnapShot_EncodePNG ( &pJob->Image ,
+					pAviParams->VideoCodecCompressionLevel , PNG_FILTER_NONE , &pJob->Data );
+			if ( pJob->DataSize > 0 )
+			{
+				Avi_StoreU32 ( pJob->Data.pData + 4 , pJob->DataSize );	/* size of PNG image */
+				pJob->DataSize += 8;
+			}
+#endif
+			SDL_LockMutex ( AviQueue.Lock );
+			pJob->State = AVI_JOB_DONE;
+			continue;
+		}
+
+		/* Write all the completed jobs at the start of the queue */
+		if ( !AviQueue.Writing && AviQueue.Count > 0
+		  && AviQueue.Jobs[ AviQueue.Head ].State == AVI_JOB_DONE )
+		{
+			AviQueue.Writing = true;
+			while ( AviQueue.Count > 0 && AviQueue.Jobs[ AviQueue.Head ].State == AVI_JOB_DONE )
+			{
+				pJob = &AviQueue.Jobs[ AviQueue.Head ];
+				SDL_UnlockMutex ( AviQueue.Lock );
+
+				ok = AviQueue.Error ? false : Avi_Queue_WriteJob ( pAviParams , pJob );
+
+				SDL_LockMutex ( AviQueue.Lock );
+				if ( !ok )
+					AviQueue.Error = true;
+				pJob->State = AVI_JOB_FREE;
+				AviQueue.Head = ( AviQueue.Head + 1 ) % AVI_QUEUE_SIZE;
+				AviQueue.Count--;
+				SDL_CondBroadcast ( AviQueue.CondFree );
+			}
+			AviQueue.Writing = false;
+			continue;
+		}
+
+		if ( AviQueue.Quit && AviQueue.Count == 0 )
+		{
+			SDL_CondBroadcast ( AviQueue.CondWork );	/* wake up the other threads to quit too */
+			break;
+		}
+
+		SDL_CondWait ( AviQueue.CondWork , AviQueue.Lock );
+	}
+	SDL_UnlockMutex ( AviQueue.Lock );
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Create the queue and start the encoder/writer threads.
+ * Return false on failure.
+ */
+static bool	Avi_Queue_Start ( RECORD_AVI_PARAMS *pAviParams )
+{
+	int	i , nThreads;
+
+	memset ( &AviQueue , 0 , sizeof ( AviQueue ) );
+	AviQueue.Lock = SDL_CreateMutex();
+	AviQueue.CondWork = SDL_CreateCond();
+	AviQueue.CondFree = SDL_CreateCond();
+	if ( !AviQueue.Lock || !AviQueue.CondWork || !AviQueue.CondFree )
+		return false;
+
+	/* Only png frames need to be encoded, 1 thread is enough to write the file */
+	/* (zmbv frames must be encoded sequentially by the writer) */
+	nThreads = 1;
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
+	{
+		nThreads = SDL_GetCPUCount() - 1;
+		if ( nThreads < 1 )
+			nThreads = 1;
+		else if ( nThreads > AVI_QUEUE_THREADS_MAX )
+			nThreads = AVI_QUEUE_THREADS_MAX;
+	}
+
+	for ( i = 0 ; i < nThreads ; i++ )
+	{
+		AviQueue.Threads[ i ] = SDL_CreateThread ( Avi_Queue_Thread , "avirecord" , pAviParams );
+		if ( !AviQueue.Threads[ i ] )
+			break;
+		AviQueue.NbThreads++;
+	}
+	return AviQueue.NbThreads > 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Wait until all queued jobs are written, then stop the threads and free
+ * the queue. Return false if an error happened while writing the jobs.
+ */
+static bool	Avi_Queue_Stop ( void )
+{
+	int	i;
+	bool	ok;
+
+	if ( AviQueue.Lock )
+	{
+		SDL_LockMutex ( AviQueue.Lock );
+		AviQueue.Quit = true;
+		SDL_CondBroadcast ( AviQueue.CondWork );
+		SDL_UnlockMutex ( AviQueue.Lock );
+	}
+	for ( i = 0 ; i < AviQueue.NbThreads ; i++ )
+		SDL_WaitThread ( AviQueue.Threads[ i ] , NULL );
+	ok = !AviQueue.Error;
+
+	if ( AviQueue.pErrorMsg )
+		Log_AlertDlg ( LOG_ERROR, "%s", AviQueue.pErrorMsg );
+	if ( AviQueue.Waits > 0 )
+		Log_Printf ( LOG_INFO, "AVI recording : emulation waited %d times (%d ms in total) for the encoder, max queue %d/%d\n" ,
+			     AviQueue.Waits , AviQueue.WaitTicks , AviQueue.MaxCount , AVI_QUEUE_SIZE );
+
+	for ( i = 0 ; i < AVI_QUEUE_SIZE ; i++ )
+	{
+		ScreenSnapShot_BufferFree ( &AviQueue.Jobs[ i ].Data );
+#if HAVE_LIBPNG || HAVE_LIBZ
+		ScreenSnapShot_BufferFree ( &AviQueue.Jobs[ i ].Image.Pixels );
+#endif
+	}
+	if ( AviQueue.CondFree )
+		SDL_DestroyCond ( AviQueue.CondFree );
+	if ( AviQueue.CondWork )
+		SDL_DestroyCond ( AviQueue.CondWork );
+	if ( AviQueue.Lock )
+		SDL_DestroyMutex ( AviQueue.Lock );
+	memset ( &AviQueue , 0 , sizeof ( AviQueue ) );
+
+	return ok;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return a free job at the end of the queue, to be filled by the emulation
+ * thread. If the queue is full, we wait until the oldest job is written
+ * (back-pressure) and update the statistics.
+ * Return NULL if an error happened in the writer thread.
+ */
+static RECORD_AVI_JOB	*Avi_Queue_GetFreeJob ( void )
+{
+	RECORD_AVI_JOB	*pJob;
+	Uint32		Start;
+
+	SDL_LockMutex ( AviQueue.Lock );
+	if ( AviQueue.Count == AVI_QUEUE_SIZE )
+	{
+		AviQueue.Waits++;
+		Start = SDL_GetTicks();
+		while ( AviQueue.Count == AVI_QUEUE_SIZE && !AviQueue.Error )
+			SDL_CondWait ( AviQueue.CondFree , AviQueue.Lock );
+		AviQueue.WaitTicks += SDL_GetTicks() - Start;
+	}
+	/* Slot after the last queued job is not seen by the threads until it's pushed */
+	pJob = AviQueue.Error ? NULL : &AviQueue.Jobs[ ( AviQueue.Head + AviQueue.Count ) % AVI_QUEUE_SIZE ];
+	SDL_UnlockMutex ( AviQueue.Lock );
+	return pJob;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Add a job filled by Avi_Queue_GetFreeJob() to the queue
+ */
+static void	Avi_Queue_Push ( RECORD_AVI_JOB *pJob , int State )
+{
+	SDL_LockMutex ( AviQueue.Lock );
+	pJob->State = State;
+	AviQueue.Count++;
+	if ( AviQueue.Count > AviQueue.MaxCount )
+		AviQueue.MaxCount = AviQueue.Count;
+	SDL_CondBroadcast ( AviQueue.CondWork );
+	SDL_UnlockMutex ( AviQueue.Lock );
+}
+
+
+static bool	Avi_RecordVideoStream_BMP ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob )
 {
-	AVI_CHUNK	Chunk;
 	int		SizeImage;
 	uint8_t		*pBitmapIn , *pBitmapOut;
 	int		y, src_y;
 	int		NeedLock;
-	uint8_t		*LineBuf = alloca(3 * pAviParams->Width);		/* temp buffer to convert to 24-bit BGR format */
 
 	assert(pAviParams->Surface->format->BytesPerPixel == 4);
 
 	SizeImage = Avi_GetBmpSize ( pAviParams->Width , pAviParams->Height , pAviParams->BitCount );
-
-	/* Write the video frame header */
-	Avi_Store4cc ( Chunk.ChunkName , "00db" );				/* stream 0, uncompressed DIB bytes */
-	Avi_StoreU32 ( Chunk.ChunkSize , SizeImage );				/* max size of RGB image */
-	if ( fwrite ( &Chunk , sizeof ( Chunk ) , 1 , pAviParams->FileOut ) != 1 )
+	if ( !ScreenSnapShot_BufferReserve ( &pJob->Data , 8 + SizeImage ) )
 	{
-		perror ( "Avi_RecordVideoStream_BMP" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write bmp frame header" );
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to alloc bmp frame" );
 		return false;
 	}
 
+	/* Video frame header */
+	Avi_Store4cc ( pJob->Data.pData , "00db" );				/* stream 0, uncompressed DIB bytes */
+	Avi_StoreU32 ( pJob->Data.pData + 4 , SizeImage );			/* max size of RGB image */
+	pJob->DataSize = 8 + SizeImage;
 
-	/* Write the video frame data */
+	/* Video frame data */
 	NeedLock = SDL_MUSTLOCK( pAviParams->Surface );
+	if ( NeedLock )
+		SDL_LockSurface ( pAviParams->Surface );
 
+	pBitmapOut = pJob->Data.pData + 8;
 	for ( y=0 ; y<pAviParams->Height ; y++ )
 	{
-		if ( NeedLock )
-			SDL_LockSurface ( pAviParams->Surface );
-
 		/* Points to the top left pixel after cropping borders. For BMP
 		 * format, frame is stored from bottom to top (origin is in
 		 * bottom left corner) and bytes are in BGR order (not RGB) */
@@ -919,90 +1319,305 @@ static bool	Avi_RecordVideoStream_BMP ( RECORD_AVI_PARAMS *pAviParams )
 			+ pAviParams->Surface->pitch * src_y
 			+ pAviParams->CropLeft * pAviParams->Surface->format->BytesPerPixel;
 
-		pBitmapOut = LineBuf;
-		PixelConvert_32to24Bits_BGR(LineBuf, (uint32_t *)pBitmapIn, pAviParams->Width, pAviParams->Surface);
-
-		if ( NeedLock )
-			SDL_UnlockSurface ( pAviParams->Surface );
-
-		if ( (int)fwrite ( pBitmapOut , 1 , pAviParams->Width*3 , pAviParams->FileOut ) != pAviParams->Width*3 )
-		{
-			perror ( "Avi_RecordVideoStream_BMP" );
-			Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write bmp video frame" );
-			return false;
-		}
+		PixelConvert_32to24Bits_BGR(pBitmapOut, (uint32_t *)pBitmapIn, pAviParams->Width, pAviParams->Surface);
+		pBitmapOut += pAviParams->Width*3;
 	}
 
+	if ( NeedLock )
+		SDL_UnlockSurface ( pAviParams->Surface );
+
 	return true;
 }
 
 
 
 #if HAVE_LIBPNG
-static bool	Avi_RecordVideoStream_PNG ( RECORD_AVI_PARAMS *pAviParams )
+static bool	Avi_RecordVideoStream_PNG ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob )
 {
-	AVI_CHUNK	Chunk;
-	int		SizeImage;
-	off_t		ChunkPos;
-	uint8_t	TempSize[4];
-	
+	/* Only convert the frame here, compression is done by the encoder threads */
+	if ( !ScreenSnapShot_PrepareImage ( pAviParams->Surface , pAviParams->Width , pAviParams->Height ,
+		pAviParams->CropLeft , pAviParams->CropRight , pAviParams->CropTop , pAviParams->CropBottom ,
+		&pJob->Image )
+	  || !ScreenSnapShot_BufferReserve ( &pJob->Data , 8 ) )
+	{
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to alloc png frame" );
+		return false;
+	}
 
-	/* Write the video frame header */
-	ChunkPos = ftello ( pAviParams->FileOut );
-	Avi_Store4cc ( Chunk.ChunkName , "00dc" );				/* stream 0, compressed DIB bytes */
-	Avi_StoreU32 ( Chunk.ChunkSize , 0 );					/* size of PNG image (-> completed later) */
-	if ( fwrite ( &Chunk , sizeof ( Chunk ) , 1 , pAviParams->FileOut ) != 1 )
-		goto png_error;
-
-	/* Write the video frame data */
-	SizeImage = ScreenSnapShot_SavePNG_ToFile(pAviParams->Surface,
-		pAviParams->Width, pAviParams->Height, pAviParams->FileOut,
-		pAviParams->VideoCodecCompressionLevel , PNG_FILTER_NONE ,
-		pAviParams->CropLeft , pAviParams->CropRight , pAviParams->CropTop , pAviParams->CropBottom );
-	if ( SizeImage <= 0 )
-		goto png_error;
-
-	/* Update the size of the video chunk */
-	Avi_StoreU32 ( TempSize , SizeImage );
-	if ( fseeko ( pAviParams->FileOut , ChunkPos+4 , SEEK_SET ) != 0 )
-		goto png_error;
-	if ( fwrite ( TempSize , sizeof ( TempSize ) , 1 , pAviParams->FileOut ) != 1 )
-		goto png_error;
+	/* Video frame header, size of PNG image is completed after compression */
+	Avi_Store4cc ( pJob->Data.pData , "00dc" );				/* stream 0, compressed DIB bytes */
+	Avi_StoreU32 ( pJob->Data.pData + 4 , 0 );
+	return true;
+}
+#endif  /* HAVE_LIBPNG */
 
-	/* Go to the end of the video frame data */
-	if ( fseeko ( pAviParams->FileOut , 0 , SEEK_END ) != 0 )
-		goto png_error;
+
+
+#if HAVE_LIBZ
+/*-----------------------------------------------------------------------*/
+/**
+ * Init the zmbv encoder when recording starts
+ * (previous state is freed in case a previous start failed)
+ */
+static bool	Avi_ZMBV_Init ( RECORD_AVI_PARAMS *pAviParams )
+{
+	Avi_ZMBV_Free ();
+	if ( deflateInit ( &AviZmbv.Stream , pAviParams->VideoCodecCompressionLevel ) != Z_OK )
+		return false;
+	AviZmbv.StreamInit = true;
 	return true;
+}
 
-png_error:
-	perror ( "Avi_RecordVideoStream_PNG" );
-	Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write png frame" );
-	return false;
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Free the zmbv encoder when recording stops
+ */
+static void	Avi_ZMBV_Free ( void )
+{
+	if ( AviZmbv.StreamInit )
+		deflateEnd ( &AviZmbv.Stream );
+	ScreenSnapShot_BufferFree ( &AviZmbv.CurFrame );
+	ScreenSnapShot_BufferFree ( &AviZmbv.PrevFrame );
+	ScreenSnapShot_BufferFree ( &AviZmbv.Work );
+	memset ( &AviZmbv , 0 , sizeof ( AviZmbv ) );
 }
-#endif  /* HAVE_LIBPNG */
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Compress the image of a video job as a zmbv frame, after the 8 bytes of
+ * the chunk header. Only the 16x16 blocks that changed since the previous
+ * frame are stored (xor'ed with the previous frame), except for keyframes
+ * that contain the whole image.
+ * This must be called for each frame in the recording order.
+ * Return the size of the chunk (header + data) or -1 on failure.
+ */
+static int	Avi_ZMBV_Encode ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob )
+{
+	SCREENSNAPSHOT_IMAGE	*pImage = &pJob->Image;
+	SCREENSNAPSHOT_BUFFER	Temp;
+	uint8_t		Palette[256][3];
+	uint8_t		*pIn , *pCur , *pPrev , *pWork , *pBlocks , *pOut;
+	const uint8_t	*pRGB , *pBlockCur , *pBlockPrev;
+	int		Format , Bpp , Pitch , FrameSize , BlocksSize;
+	int		x , y , w , h , i , line , Block;
+	uint8_t		Flags;
+	int		ret;
+
+	/* Frames using the palette are stored in 8 bpp, else in 32 bpp. As the format */
+	/* can only change on a keyframe, we keep 32 bpp until the next keyframe */
+	pJob->KeyFrame = ( AviZmbv.FramesToKey <= 0 );
+	Format = AviZmbv.Format;
+	if ( pJob->KeyFrame )
+		Format = pImage->PaletteSize > 0 ? ZMBV_FORMAT_8BPP : ZMBV_FORMAT_32BPP;
+	else if ( Format == ZMBV_FORMAT_8BPP && pImage->PaletteSize == 0 )
+	{
+		pJob->KeyFrame = true;
+		Format = ZMBV_FORMAT_32BPP;
+	}
+	Bpp = ( Format == ZMBV_FORMAT_8BPP ) ? 1 : 4;
+	Pitch = pImage->Width * Bpp;
+	FrameSize = Pitch * pImage->Height;
+	BlocksSize = ( ( pImage->Width + ZMBV_BLOCK_SIZE - 1 ) / ZMBV_BLOCK_SIZE )
+		   * ( ( pImage->Height + ZMBV_BLOCK_SIZE - 1 ) / ZMBV_BLOCK_SIZE ) * 2;
+	BlocksSize = ( BlocksSize + 3 ) & ~3;				/* block table is padded to 4 bytes */
+
+	if ( !ScreenSnapShot_BufferReserve ( &AviZmbv.CurFrame , FrameSize )
+	  || !ScreenSnapShot_BufferReserve ( &AviZmbv.PrevFrame , FrameSize )
+	  || !ScreenSnapShot_BufferReserve ( &AviZmbv.Work , sizeof ( Palette ) + BlocksSize + FrameSize )
+	  || !ScreenSnapShot_BufferReserve ( &pJob->Data , 8 + 7 ) )
+		return -1;
+
+	/* Convert the image to the zmbv format : palette indexes or BGR0 pixels */
+	memset ( Palette , 0 , sizeof ( Palette ) );
+	pIn = pImage->Pixels.pData;
+	pCur = AviZmbv.CurFrame.pData;
+	if ( Format == ZMBV_FORMAT_8BPP )
+	{
+		memcpy ( Palette , pImage->Palette , pImage->PaletteSize * 3 );
+		memcpy ( pCur , pIn , FrameSize );
+	}
+	else
+	{
+		for ( i = 0 ; i < pImage->Width * pImage->Height ; i++ )
+		{
+			if ( pImage->PaletteSize > 0 )
+				pRGB = pImage->Palette[ *pIn++ ];
+			else
+			{
+				pRGB = pIn;
+				pIn += 3;
+			}
+			*pCur++ = pRGB[2];
+			*pCur++ = pRGB[1];
+			*pCur++ = pRGB[0];
+			*pCur++ = 0;
+		}
+	}
+
+	/* Build the uncompressed frame data */
+	pCur = AviZmbv.CurFrame.pData;
+	pPrev = AviZmbv.PrevFrame.pData;
+	pWork = AviZmbv.Work.pData;
+	if ( pJob->KeyFrame )
+	{
+		Flags = ZMBV_FLAG_KEYFRAME;
+		if ( Format == ZMBV_FORMAT_8BPP )
+		{
+			memcpy ( pWork , Palette , sizeof ( Palette ) );
+			pWork += sizeof ( Palette );
+		}
+		memcpy ( pWork , pCur , FrameSize );
+		pWork += FrameSize;
+	}
+	else
+	{
+		Flags = 0;
+		if ( Format == ZMBV_FORMAT_8BPP && memcmp ( Palette , AviZmbv.Palette , sizeof ( Palette ) ) != 0 )
+		{
+			Flags |= ZMBV_FLAG_DELTA_PALETTE;
+			for ( i = 0 ; i < (int)sizeof ( Palette ) ; i++ )
+				*pWork++ = Palette[ i / 3 ][ i % 3 ] ^ AviZmbv.Palette[ i / 3 ][ i % 3 ];
+		}
+
+		/* 2 bytes per block : motion vector (always 0 here) and a flag if xor data follow */
+		pBlocks = pWork;
+		memset ( pBlocks , 0 , BlocksSize );
+		pWork += BlocksSize;
+		Block = 0;
+		for ( y = 0 ; y < pImage->Height ; y += ZMBV_BLOCK_SIZE )
+		{
+			h = pImage->Height - y < ZMBV_BLOCK_SIZE ? pImage->Height - y : ZMBV_BLOCK_SIZE;
+			for ( x = 0 ; x < pImage->Width ; x += ZMBV_BLOCK_SIZE )
+			{
+				w = ( pImage->Width - x < ZMBV_BLOCK_SIZE ? pImage->Width - x : ZMBV_BLOCK_SIZE ) * Bpp;
+				pBlockCur = pCur + y * Pitch + x * Bpp;
+				pBlockPrev = pPrev + y * Pitch + x * Bpp;
+				for ( line = 0 ; line < h ; line++ )
+					if ( memcmp ( pBlockCur + line * Pitch , pBlockPrev + line * Pitch , w ) != 0 )
+						break;
+				if ( line < h )
+				{
+					pBlocks[ Block ] = 1;
+					for ( line = 0 ; line < h ; line++ )
+						for ( i = 0 ; i < w ; i++ )
+							*pWork++ = pBlockCur[ line * Pitch + i ] ^ pBlockPrev[ line * Pitch + i ];
+				}
+				Block += 2;
+			}
+		}
+	}
+
+	/* Frame header */
+	pOut = pJob->Data.pData + 8;
+	*pOut++ = Flags;
+	if ( pJob->KeyFrame )
+	{
+		*pOut++ = ZMBV_VERSION_HI;
+		*pOut++ = ZMBV_VERSION_LO;
+		*pOut++ = ZMBV_COMPRESSION_ZLIB;
+		*pOut++ = Format;
+		*pOut++ = ZMBV_BLOCK_SIZE;
+		*pOut++ = ZMBV_BLOCK_SIZE;
+		if ( deflateReset ( &AviZmbv.Stream ) != Z_OK )
+			return -1;
+	}
+	pJob->Data.Size = pOut - pJob->Data.pData;
+
+	/* Compress the frame data, flushing the stream at the end of each frame */
+	AviZmbv.Stream.next_in = AviZmbv.Work.pData;
+	AviZmbv.Stream.avail_in = pWork - AviZmbv.Work.pData;
+	do
+	{
+		if ( !ScreenSnapShot_BufferReserve ( &pJob->Data , pJob->Data.Size + AviZmbv.Stream.avail_in / 4 + 1024 ) )
+			return -1;
+		AviZmbv.Stream.next_out = pJob->Data.pData + pJob->Data.Size;
+		AviZmbv.Stream.avail_out = pJob->Data.AllocSize - pJob->Data.Size;
+		ret = deflate ( &AviZmbv.Stream , Z_SYNC_FLUSH );
+		if ( ret != Z_OK && ret != Z_BUF_ERROR )
+			return -1;
+		pJob->Data.Size = pJob->Data.AllocSize - AviZmbv.Stream.avail_out;
+	}
+	while ( AviZmbv.Stream.avail_out == 0 );
+
+	Avi_StoreU32 ( pJob->Data.pData + 4 , pJob->Data.Size - 8 );	/* size of ZMBV frame */
+
+	/* Current frame becomes the reference for the next one */
+	Temp = AviZmbv.PrevFrame;
+	AviZmbv.PrevFrame = AviZmbv.CurFrame;
+	AviZmbv.CurFrame = Temp;
+	memcpy ( AviZmbv.Palette , Palette , sizeof ( Palette ) );
+	AviZmbv.Format = Format;
+	if ( pJob->KeyFrame )
+		AviZmbv.FramesToKey = pAviParams->VideoCodecKeyframeInterval;
+	AviZmbv.FramesToKey--;
+
+	return pJob->Data.Size;
+}
+
+
+static bool	Avi_RecordVideoStream_ZMBV ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob )
+{
+	/* Only convert the frame here, compression is done by the writer thread */
+	if ( !ScreenSnapShot_PrepareImage ( pAviParams->Surface , pAviParams->Width , pAviParams->Height ,
+		pAviParams->CropLeft , pAviParams->CropRight , pAviParams->CropTop , pAviParams->CropBottom ,
+		&pJob->Image )
+	  || !ScreenSnapShot_BufferReserve ( &pJob->Data , 8 ) )
+	{
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to alloc zmbv frame" );
+		return false;
+	}
+
+	/* Video frame header, size of ZMBV frame is completed after compression */
+	Avi_Store4cc ( pJob->Data.pData , "00dc" );				/* stream 0, compressed DIB bytes */
+	Avi_StoreU32 ( pJob->Data.pData + 4 , 0 );
+	return true;
+}
+#endif  /* HAVE_LIBZ */
 
 
 
 bool	Avi_RecordVideoStream ( void )
 {
-	off_t		Pos_Start , Pos_End;
+	RECORD_AVI_JOB	*pJob;
+	int		State;
 
-	Pos_Start = ftello ( AviParams.FileOut );
+	/* Converter thread could still be drawing into the surface */
+	ScreenConv_Sync ( false );
+
+	pJob = Avi_Queue_GetFreeJob ();
+	if ( pJob == NULL )
+		return false;
+	pJob->Type = AVI_JOB_VIDEO;
+	pJob->KeyFrame = true;
 
 	if ( AviParams.VideoCodec == AVI_RECORD_VIDEO_CODEC_BMP )
 	{
-		if ( Avi_RecordVideoStream_BMP ( &AviParams ) == false )
+		if ( Avi_RecordVideoStream_BMP ( &AviParams , pJob ) == false )
 		{
 			return false;
 		}
+		State = AVI_JOB_DONE;
 	}
 #if HAVE_LIBPNG
 	else if ( AviParams.VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
 	{
-		if ( Avi_RecordVideoStream_PNG ( &AviParams ) == false )
+		if ( Avi_RecordVideoStream_PNG ( &AviParams , pJob ) == false )
 		{
 			return false;
 		}
+		State = AVI_JOB_READY;
+	}
+#endif
+#if HAVE_LIBZ
+	else if ( AviParams.VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+	{
+		if ( Avi_RecordVideoStream_ZMBV ( &AviParams , pJob ) == false )
+		{
+			return false;
+		}
+		State = AVI_JOB_DONE;						/* compressed when written */
 	}
 #endif
 	else
@@ -1010,20 +1625,15 @@ bool	Avi_RecordVideoStream ( void )
 		return false;
 	}
 
-	Pos_End = ftello ( AviParams.FileOut );
-	AviParams.TotalVideoFrames++;
+	Avi_Queue_Push ( pJob , State );
+	AviParams.QueuedVideoFrames++;
 
-	/* Store index for this video frame */
-	Pos_Start += 8;								/* skip header */
-	if ( Avi_FrameIndex_Add ( &AviParams , &AviFileHeader , 0 , Pos_Start , (uint32_t)( Pos_End - Pos_Start ) ) == false )
-		return false;
-
-	if (AviParams.TotalVideoFrames % ( AviParams.Fps / AviParams.Fps_scale ) == 0)
+	if (AviParams.QueuedVideoFrames % ( AviParams.Fps / AviParams.Fps_scale ) == 0)
 	{
 		char str[20];
 		int secs , hours , mins;
 
-		secs = AviParams.TotalVideoFrames / ( AviParams.Fps / AviParams.Fps_scale );
+		secs = AviParams.QueuedVideoFrames / ( AviParams.Fps / AviParams.Fps_scale );
 		hours = secs / 3600;
 		mins = ( secs % 3600 ) / 60;
 		secs = secs % 60;
@@ -1035,38 +1645,34 @@ bool	Avi_RecordVideoStream ( void )
 
 
 
-static bool	Avi_RecordAudioStream_PCM ( RECORD_AVI_PARAMS *pAviParams , int16_t pSamples[][2] , int SampleIndex , int SampleLength )
+static bool	Avi_RecordAudioStream_PCM ( RECORD_AVI_PARAMS *pAviParams , RECORD_AVI_JOB *pJob ,
+					    int16_t pSamples[][2] , int SampleIndex , int SampleLength )
 {
-	AVI_CHUNK	Chunk;
-	int16_t		sample[2];
+	int16_t		*pOut;
 	int		i;
 	int		idx;
 
-	/* Write the audio frame header */
-	Avi_Store4cc ( Chunk.ChunkName , "01wb" );				/* stream 1, wave bytes */
-	Avi_StoreU32 ( Chunk.ChunkSize , SampleLength * 4 );			/* 16 bits, stereo -> 4 bytes */
-	if ( fwrite ( &Chunk , sizeof ( Chunk ) , 1 , pAviParams->FileOut ) != 1 )
+	if ( !ScreenSnapShot_BufferReserve ( &pJob->Data , 8 + SampleLength * 4 ) )
 	{
-		perror ( "Avi_RecordAudioStream_PCM" );
-		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write pcm frame header" );
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to alloc pcm frame" );
 		return false;
 	}
 
-	/* Write the audio frame data */
+	/* Audio frame header */
+	Avi_Store4cc ( pJob->Data.pData , "01wb" );				/* stream 1, wave bytes */
+	Avi_StoreU32 ( pJob->Data.pData + 4 , SampleLength * 4 );		/* 16 bits, stereo -> 4 bytes */
+	pJob->DataSize = 8 + SampleLength * 4;
+	pJob->SampleLength = SampleLength;
+
+	/* Audio frame data */
+	pOut = (int16_t *)( pJob->Data.pData + 8 );
 	idx = SampleIndex & AUDIOMIXBUFFER_SIZE_MASK;
 	for ( i = 0 ; i < SampleLength; i++ )
 	{
 		/* Convert sample to little endian */
-		sample[0] = SDL_SwapLE16 ( pSamples[ idx ][0]);
-		sample[1] = SDL_SwapLE16 ( pSamples[ idx ][1]);
+		*pOut++ = SDL_SwapLE16 ( pSamples[ idx ][0]);
+		*pOut++ = SDL_SwapLE16 ( pSamples[ idx ][1]);
 		idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
-		/* And store */
-		if ( fwrite ( &sample , sizeof ( sample ) , 1 , pAviParams->FileOut ) != 1 )
-		{
-			perror ( "Avi_RecordAudioStream_PCM" );
-			Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to write pcm frame" );
-			return false;
-		}
 	}
 
 	return true;
@@ -1076,13 +1682,16 @@ static bool	Avi_RecordAudioStream_PCM ( RECORD_AVI_PARAMS *pAviParams , int16_t
 
 bool	Avi_RecordAudioStream ( int16_t pSamples[][2] , int SampleIndex , int SampleLength )
 {
-	off_t		Pos_Start , Pos_End;
+	RECORD_AVI_JOB	*pJob;
 
-	Pos_Start = ftello ( AviParams.FileOut );
+	pJob = Avi_Queue_GetFreeJob ();
+	if ( pJob == NULL )
+		return false;
+	pJob->Type = AVI_JOB_AUDIO;
 
 	if ( AviParams.AudioCodec == AVI_RECORD_AUDIO_CODEC_PCM )
 	{
-		if ( Avi_RecordAudioStream_PCM ( &AviParams , pSamples , SampleIndex , SampleLength ) == false )
+		if ( Avi_RecordAudioStream_PCM ( &AviParams , pJob , pSamples , SampleIndex , SampleLength ) == false )
 		{
 			return false;
 		}
@@ -1092,15 +1701,7 @@ bool	Avi_RecordAudioStream ( int16_t pSamples[][2] , int SampleIndex , int Sampl
 		return false;
 	}
 
-	Pos_End = ftello ( AviParams.FileOut );
-	AviParams.TotalAudioFrames++;
-	AviParams.TotalAudioSamples += SampleLength;
-
-	/* Store index for this audio frame */
-	Pos_Start += 8;								/* skip header */
-	if ( Avi_FrameIndex_Add ( &AviParams , &AviFileHeader , 1 , Pos_Start , (uint32_t)( Pos_End - Pos_Start ) ) == false )
-		return false;
-
+	Avi_Queue_Push ( pJob , AVI_JOB_DONE );
 	return true;
 }
 
@@ -1126,6 +1727,8 @@ static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADE
 		SizeImage = Avi_GetBmpSize ( Width , Height , BitCount );			/* size of a BMP image */
 	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
 		SizeImage = Avi_GetBmpSize ( Width , Height , BitCount );			/* max size of a PNG image */
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+		SizeImage = Avi_GetBmpSize ( Width , Height , BitCount );			/* max size of a ZMBV frame */
 
 
 	/* RIFF / AVI headers */
@@ -1169,6 +1772,8 @@ static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADE
 		Avi_StoreU32 ( pAviFileHeader->VideoStream.Header.stream_handler , VIDEO_STREAM_RGB );
 	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
 		Avi_Store4cc ( pAviFileHeader->VideoStream.Header.stream_handler , VIDEO_STREAM_PNG );
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+		Avi_Store4cc ( pAviFileHeader->VideoStream.Header.stream_handler , VIDEO_STREAM_ZMBV );
 	Avi_StoreU32 ( pAviFileHeader->VideoStream.Header.flags , 0 );
 	Avi_StoreU16 ( pAviFileHeader->VideoStream.Header.priority , 0 );
 	Avi_StoreU16 ( pAviFileHeader->VideoStream.Header.language , 0 );
@@ -1215,6 +1820,20 @@ static void	Avi_BuildFileHeader ( RECORD_AVI_PARAMS *pAviParams , AVI_FILE_HEADE
 		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.clr_used , 0 );		/* no color map */
 		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.clr_important , 0 );		/* no color map */
 	}
+	else if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+	{
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.size , sizeof ( AVI_STREAM_FORMAT_VIDS ) - 8 );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.width , Width );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.height , Height );
+		Avi_StoreU16 ( pAviFileHeader->VideoStream.Format.planes , 1 );			/* always 1 */
+		Avi_StoreU16 ( pAviFileHeader->VideoStream.Format.bit_count , BitCount );
+		Avi_Store4cc ( pAviFileHeader->VideoStream.Format.compression , VIDEO_STREAM_ZMBV );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.size_image , SizeImage );	/* max size if uncompressed */
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.xpels_meter , 0 );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.ypels_meter , 0 );
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.clr_used , 0 );		/* palette is in the frames */
+		Avi_StoreU32 ( pAviFileHeader->VideoStream.Format.clr_important , 0 );
+	}
 
 	Avi_Store4cc ( pAviFileHeader->VideoStream.SuperIndex.ChunkName , "indx" );
 	Avi_StoreU32 ( pAviFileHeader->VideoStream.SuperIndex.ChunkSize , sizeof ( AVI_STREAM_SUPER_INDEX ) - 8 );
@@ -1304,6 +1923,8 @@ static bool	Avi_StartRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams , char
 	pAviParams->Width = pAviParams->Surface->w - pAviParams->CropLeft - pAviParams->CropRight;
 	pAviParams->Height = pAviParams->Surface->h - pAviParams->CropTop - pAviParams->CropBottom;
 	pAviParams->BitCount = 24;
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+		pAviParams->BitCount = 32;					/* max, frames can also use 8 bits */
 	
 #if !HAVE_LIBPNG
 	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_PNG )
@@ -1313,6 +1934,21 @@ static bool	Avi_StartRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams , char
 		return false;
 	}
 #endif
+#if HAVE_LIBZ
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV
+	  && Avi_ZMBV_Init ( pAviParams ) == false )
+	{
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to init zmbv compression" );
+		return false;
+	}
+#else
+	if ( pAviParams->VideoCodec == AVI_RECORD_VIDEO_CODEC_ZMBV )
+	{
+		perror ( "AviStartRecording" );
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : Hatari was not built with zlib support" );
+		return false;
+	}
+#endif
 
 	/* Open the file */
 	pAviParams->FileOut = fopen ( AviFileName , "wb+" );
@@ -1322,6 +1958,8 @@ static bool	Avi_StartRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams , char
 		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to open file" );
 		return false;
 	}
+	/* Frames are appended sequentially, use a large buffer to write them by big blocks */
+	setvbuf ( pAviParams->FileOut , NULL , _IOFBF , AVI_FILE_BUFFER_SIZE );
 
 	/* Alloc memory to store frames' index */
 	if ( Avi_FrameIndex_GrowIfNeeded ( pAviParams ) == false )
@@ -1378,6 +2016,15 @@ static bool	Avi_StartRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams , char
 	}
 
 
+	/* Start the threads that will compress and write the frames */
+	pAviParams->MainThreadId = SDL_ThreadID();
+	if ( Avi_Queue_Start ( pAviParams ) == false )
+	{
+		Avi_Queue_Stop ();
+		Log_AlertDlg ( LOG_ERROR, "AVI recording : failed to start writer thread" );
+		return false;
+	}
+
 	/* We're ok to record */
 	Log_AlertDlg ( LOG_INFO, "AVI recording has been started");
 	bRecordingAvi = true;
@@ -1389,9 +2036,23 @@ static bool	Avi_StartRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams , char
 
 static bool	Avi_StopRecording_WithParams ( RECORD_AVI_PARAMS *pAviParams )
 {
+	bool	ok;
+
 	if ( bRecordingAvi == false )						/* no recording ? */
 		return true;
 
+	/* Write all the queued frames */
+	ok = Avi_Queue_Stop ();
+#if HAVE_LIBZ
+	Avi_ZMBV_Free ();
+#endif
+	if ( ok == false )
+	{
+		fclose ( pAviParams->FileOut );
+		Avi_FrameIndex_Free ( pAviParams );
+		bRecordingAvi = false;
+		return false;
+	}
 
 	/* Complete the current 'movi' chunk */
 	if ( Avi_CloseMoviChunk ( pAviParams , &AviFileHeader ) == false )
@@ -1453,12 +2114,33 @@ bool Avi_SetCompressionLevel(const char *str)
 }
 
 
+/* ZMBV keyframe interval, in frames */
+static int keyframe_interval = 250;
+
+/**
+ * Set ZMBV keyframe interval from given string
+ * return true for valid, false for invalid value
+ */
+bool Avi_SetKeyframeInterval(const char *str)
+{
+	char *end;
+	long interval = strtol(str, &end, 10);
+	if (*end)
+		return false;
+	if (interval < 1 || interval > 10000)
+		return false;
+	keyframe_interval = interval;
+	return true;
+}
+
+
 bool	Avi_StartRecording ( char *FileName , bool CropGui , uint32_t Fps , uint32_t Fps_scale , int VideoCodec )
 {
 	memset ( &AviParams , 0 , sizeof ( AviParams ) );
 
 	AviParams.VideoCodec = VideoCodec;
 	AviParams.VideoCodecCompressionLevel = compression_level;
+	AviParams.VideoCodecKeyframeInterval = keyframe_interval;
 	AviParams.AudioCodec = AVI_RECORD_AUDIO_CODEC_PCM;
 	AviParams.AudioFreq = ConfigureParams.Sound.nPlaybackFreq;
 	AviParams.Surface = sdlscrn;
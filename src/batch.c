@@ -0,0 +1,261 @@
+/*
+  Hatari - batch.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Batch mode
+
+  Hatari boots normally, and after given number of VBLs forks a worker
+  process for each debugger command script listed in the batch list
+  file.  Workers continue emulation from the booted state, sharing TOS,
+  RAM and disk image contents with the parent through copy-on-write
+  memory, so each of them doesn't need to load images and boot TOS
+  again.  Parent waits for all workers to exit, runs at most as many
+  of them at the same time as there are online CPUs, and then exits.
+
+  Workers reopen the hard disk image files, so that they don't share
+  file offsets, but the image contents are still shared: writes from
+  one worker are seen by the others.  Images should be write protected.
+*/
+const char Batch_fileid[] = "Hatari batch.c";
+
+#include "config.h"
+
+#if HAVE_FORK
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "audio.h"
+#include "avi_record.h"
+#include "batch.h"
+#include "capturePipe.h"
+#include "configuration.h"
+#include "debugui.h"
+#include "dsp.h"
+#include "hdc.h"
+#include "ide.h"
+#include "log.h"
+#include "ncr5380.h"
+#include "screenConvert.h"
+#include "str.h"
+
+#define BATCH_VBLS_DEFAULT 250		/* ~5s at 50Hz, enough for TOS boot */
+
+static struct {
+	char **scripts;			/* worker debugger command scripts */
+	pid_t *pids;			/* worker process IDs, 0 = not running */
+	int count;			/* number of workers, 0 = batch mode disabled */
+	uint32_t vbls;			/* fork workers at this VBL */
+	uint32_t vblcount;		/* VBLs since emulation start */
+} Batch;
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Read list of worker debugger command scripts from given file,
+ * one script path per line.  Empty lines and lines starting with
+ * '#' are ignored.
+ * Return NULL on success, error string on error
+ */
+const char* Batch_SetList(const char *listpath)
+{
+	char line[FILENAME_MAX], *path, **scripts;
+	FILE *fp;
+
+	if (!(fp = fopen(listpath, "r")))
+		return "Can't open batch list file";
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		path = Str_Trim(line);
+		if (!*path || *path == '#')
+			continue;
+
+		scripts = realloc(Batch.scripts, (Batch.count + 1) * sizeof(*scripts));
+		if (!scripts)
+		{
+			fclose(fp);
+			return "Batch list alloc failed";
+		}
+		Batch.scripts = scripts;
+		Batch.scripts[Batch.count++] = Str_Dup(path);
+	}
+	fclose(fp);
+
+	if (!Batch.count)
+		return "No worker scripts in batch list file";
+	if (!Batch.vbls)
+		Batch.vbls = BATCH_VBLS_DEFAULT;
+	return NULL;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Set after how many VBLs worker processes are forked
+ */
+void Batch_SetVBLs(uint32_t vbls)
+{
+	Batch.vbls = vbls;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Continue emulation as given worker
+ */
+static void Batch_Worker(int worker)
+{
+	uint32_t vbls;
+
+	/* workers don't fork further */
+	Batch.count = 0;
+
+	/* own file offsets for HD image accesses */
+	HDC_ReopenImages();
+	Ncr5380_ReopenImages();
+	Ide_ReopenImages();
+
+	/* --run-vbls counts from worker start */
+	vbls = Main_SetRunVBLs(0);
+	if (vbls)
+		Main_SetRunVBLs(vbls);
+
+	Log_Printf(LOG_INFO, "Batch worker %d (pid %d): '%s'\n",
+		   worker, (int)getpid(), Batch.scripts[worker]);
+	if (!DebugUI_ParseFile(Batch.scripts[worker], true, false))
+	{
+		Log_Printf(LOG_ERROR, "Batch worker %d script parsing failed\n", worker);
+		exit(1);
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Wait for any of the workers to exit.
+ * Return true if it failed, false otherwise
+ */
+static bool Batch_Wait(void)
+{
+	int i, status;
+	pid_t pid;
+
+	do
+		pid = wait(&status);
+	while (pid < 0 && errno == EINTR);
+
+	if (pid < 0)
+	{
+		perror("ERROR: batch worker wait failed");
+		return true;
+	}
+	for (i = 0; i < Batch.count; i++)
+	{
+		if (Batch.pids[i] == pid)
+			break;
+	}
+	if (i == Batch.count)
+		return false;
+	Batch.pids[i] = 0;
+
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return false;
+
+	if (WIFSIGNALED(status))
+		Log_Printf(LOG_WARN, "Batch worker %d ('%s') killed by signal %d\n",
+			   i, Batch.scripts[i], WTERMSIG(status));
+	else
+		Log_Printf(LOG_WARN, "Batch worker %d ('%s') exited with %d\n",
+			   i, Batch.scripts[i], WEXITSTATUS(status));
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Fork workers, and exit when they're all done.
+ * Returns only in workers.
+ */
+static void Batch_Run(void)
+{
+	int i, jobs, running = 0, failed = 0;
+	pid_t pid;
+
+	Batch.pids = calloc(Batch.count, sizeof(*Batch.pids));
+	if (!Batch.pids)
+	{
+		Main_ErrorExit("Batch worker table alloc failed", NULL, 1);
+	}
+	jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs < 1)
+		jobs = 1;
+
+	/* SDL audio thread would not be there in workers */
+	Audio_UnInit();
+	ConfigureParams.Sound.bEnableSound = false;
+	/* nor screen converter thread, workers restart it when needed */
+	ScreenConv_UnInit();
+	/* nor AVI writer threads, and workers can't share the AVI file */
+	Avi_StopRecording();
+	/* or capture stream, their blocks would interleave */
+	CapturePipe_Stop();
+#if ENABLE_DSP_EMU
+	/* nor DSP thread, it's started again lazily */
+	DSP_Thread_UnInit();
+#endif
+
+	Log_Printf(LOG_INFO, "Batch: forking %d workers (max %d at the same time) at VBL %u\n",
+		   Batch.count, jobs, Batch.vblcount);
+	/* not to have buffered output (incl. HD image writes)
+	 * duplicated in workers */
+	fflush(NULL);
+
+	for (i = 0; i < Batch.count; i++)
+	{
+		if (running >= jobs)
+		{
+			failed += Batch_Wait();
+			running--;
+		}
+		pid = fork();
+		if (pid < 0)
+		{
+			perror("ERROR: batch worker fork failed");
+			failed++;
+			continue;
+		}
+		if (pid == 0)
+		{
+			Batch_Worker(i);
+			return;
+		}
+		Batch.pids[i] = pid;
+		running++;
+	}
+	while (running-- > 0)
+		failed += Batch_Wait();
+
+	Log_Printf(LOG_INFO, "Batch: %d/%d workers succeeded\n",
+		   Batch.count - failed, Batch.count);
+	exit(failed ? 1 : 0);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Called on each VBL, fork workers when it's time for it
+ */
+void Batch_Vbl(void)
+{
+	if (!Batch.count || ++Batch.vblcount < Batch.vbls)
+		return;
+
+	Batch_Run();
+}
+
+#endif /* HAVE_FORK */
@@ -0,0 +1,205 @@
+/*
+  Hatari - benchmark.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Benchmark report
+
+  When a report file is given (with --bench-report), emulation speed,
+  executed CPU instructions, host time used by emulated subsystems,
+  host process CPU time and peak memory usage are measured from the
+  first emulated VBL, and written as JSON or CSV to the report file
+  when Hatari exits.
+
+  Host time is accounted to the subsystem that was entered last with
+  Benchmark_Enter(), so nested subsystems (e.g. DSP run from blitter)
+  are accounted correctly.  Everything not inside one of the
+  subsystems is accounted to the CPU core.
+*/
+const char Benchmark_fileid[] = "Hatari benchmark.c";
+
+#include <inttypes.h>
+#include <SDL.h>
+#if HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+#include "main.h"
+#include "benchmark.h"
+#include "configuration.h"
+#include "file.h"
+#include "log.h"
+#include "m68000.h"
+#include "str.h"
+#include "version.h"
+
+
+bool bBenchmarkTiming;			/* Host time is being accounted to subsystems */
+
+static const char *SubsystemNames[BENCHMARK_SUBSYSTEMS] = {
+	"cpu", "video", "sound", "dsp", "blitter"
+};
+
+static struct {
+	char *filename;			/* Report file, NULL when not reporting */
+	bool written;			/* Report has been written */
+	uint64_t start;			/* Performance counter at start */
+	uint64_t last;			/* Performance counter at last subsystem switch */
+	int current;			/* Subsystem host time is currently accounted to */
+	uint64_t time[BENCHMARK_SUBSYSTEMS];	/* Performance counter ticks per subsystem */
+	uint32_t vbls;			/* VBLs since start */
+	uint64_t instructions;		/* CPU instructions since start */
+	uint32_t instr_cnt;		/* regs.instruction_cnt on previous VBL */
+#if HAVE_GETRUSAGE
+	struct rusage usage;		/* Process resource usage at start */
+#endif
+} Bench;
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Set file to which benchmark report is written at exit.
+ * Format is CSV if file name has ".csv" extension, otherwise JSON.
+ */
+void Benchmark_SetReport(const char *filename)
+{
+	free(Bench.filename);
+	Bench.filename = Str_Dup(filename);
+
+#if HAVE_SETENV
+	/* Nobody's watching/listening, use SDL dummy drivers
+	 * unless user has explicitly asked for something else */
+	setenv("SDL_VIDEODRIVER", "dummy", 0);
+	setenv("SDL_AUDIODRIVER", "dummy", 0);
+#endif
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Account host time since previous switch to current subsystem,
+ * and switch to given one.  Return previous subsystem.
+ */
+int Benchmark_Switch(int subsystem)
+{
+	uint64_t now = SDL_GetPerformanceCounter();
+	int previous = Bench.current;
+
+	Bench.time[previous] += now - Bench.last;
+	Bench.last = now;
+	Bench.current = subsystem;
+	return previous;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Called on each VBL, start measurements on first one
+ * and update counters.
+ */
+void Benchmark_Vbl(void)
+{
+	if (!Bench.filename || Bench.written)
+		return;
+
+	if (!bBenchmarkTiming)
+	{
+		Bench.start = Bench.last = SDL_GetPerformanceCounter();
+		Bench.current = BENCHMARK_CPU;
+		Bench.instr_cnt = regs.instruction_cnt;
+#if HAVE_GETRUSAGE
+		getrusage(RUSAGE_SELF, &Bench.usage);
+#endif
+		bBenchmarkTiming = true;
+		return;
+	}
+	Bench.vbls++;
+	Bench.instructions += (uint32_t)regs.instruction_cnt - Bench.instr_cnt;
+	Bench.instr_cnt = regs.instruction_cnt;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Write benchmark report, if requested and not yet written.
+ */
+void Benchmark_WriteReport(void)
+{
+	double freq, wall, subsys[BENCHMARK_SUBSYSTEMS];
+	double user = 0.0, sys = 0.0;
+	long maxrss = 0;
+	bool csv;
+	FILE *fp;
+	int i;
+
+	if (!Bench.filename || Bench.written || !bBenchmarkTiming)
+		return;
+
+	Benchmark_Switch(Bench.current);
+	bBenchmarkTiming = false;
+	Bench.written = true;
+
+	freq = SDL_GetPerformanceFrequency();
+	wall = (Bench.last - Bench.start) / freq;
+	for (i = 0; i < BENCHMARK_SUBSYSTEMS; i++)
+		subsys[i] = Bench.time[i] / freq;
+
+#if HAVE_GETRUSAGE
+	{
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		user = (usage.ru_utime.tv_sec - Bench.usage.ru_utime.tv_sec)
+			+ (usage.ru_utime.tv_usec - Bench.usage.ru_utime.tv_usec) / 1e6;
+		sys = (usage.ru_stime.tv_sec - Bench.usage.ru_stime.tv_sec)
+			+ (usage.ru_stime.tv_usec - Bench.usage.ru_stime.tv_usec) / 1e6;
+		maxrss = usage.ru_maxrss;
+# ifdef __APPLE__
+		maxrss /= 1024;		/* bytes instead of kilobytes */
+# endif
+	}
+#endif
+
+	fp = fopen(Bench.filename, "w");
+	if (!fp)
+	{
+		Log_Printf(LOG_ERROR, "Failed to open benchmark report file '%s'\n", Bench.filename);
+		return;
+	}
+
+	csv = File_DoesFileExtensionMatch(Bench.filename, ".csv");
+	if (csv)
+	{
+		fprintf(fp, "machine,vbls,wall_seconds,vbls_per_second,cpu_instructions,"
+			"host_user_seconds,host_system_seconds,peak_rss_kb");
+		for (i = 0; i < BENCHMARK_SUBSYSTEMS; i++)
+			fprintf(fp, ",%s_seconds", SubsystemNames[i]);
+		fprintf(fp, "\n%d,%u,%.3f,%.2f,%"PRIu64",%.3f,%.3f,%ld",
+			ConfigureParams.System.nMachineType, Bench.vbls, wall,
+			wall > 0.0 ? Bench.vbls / wall : 0.0, Bench.instructions,
+			user, sys, maxrss);
+		for (i = 0; i < BENCHMARK_SUBSYSTEMS; i++)
+			fprintf(fp, ",%.3f", subsys[i]);
+		fprintf(fp, "\n");
+	}
+	else
+	{
+		fprintf(fp, "{\n");
+		fprintf(fp, "  \"version\": \"%s\",\n", PROG_NAME);
+		fprintf(fp, "  \"machine\": %d,\n", ConfigureParams.System.nMachineType);
+		fprintf(fp, "  \"vbls\": %u,\n", Bench.vbls);
+		fprintf(fp, "  \"wall_seconds\": %.3f,\n", wall);
+		fprintf(fp, "  \"vbls_per_second\": %.2f,\n", wall > 0.0 ? Bench.vbls / wall : 0.0);
+		fprintf(fp, "  \"cpu_instructions\": %"PRIu64",\n", Bench.instructions);
+		fprintf(fp, "  \"host_user_seconds\": %.3f,\n", user);
+		fprintf(fp, "  \"host_system_seconds\": %.3f,\n", sys);
+		fprintf(fp, "  \"peak_rss_kb\": %ld,\n", maxrss);
+		fprintf(fp, "  \"subsystem_seconds\": {");
+		for (i = 0; i < BENCHMARK_SUBSYSTEMS; i++)
+			fprintf(fp, "%s\n    \"%s\": %.3f", i ? "," : "", SubsystemNames[i], subsys[i]);
+		fprintf(fp, "\n  }\n}\n");
+	}
+	fclose(fp);
+
+	Log_Printf(LOG_INFO, "Benchmark report written to '%s'\n", Bench.filename);
+}
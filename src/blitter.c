@@ -120,6 +120,7 @@ const char Blitter_fileid[] = "Hatari blitter.c";
 #include "dmaSnd.h"
 #include "ioMem.h"
 #include "m68000.h"
+#include "benchmark.h"
 #include "mfp.h"
 #include "memorySnapShot.h"
 #include "stMemory.h"
@@ -871,6 +872,7 @@ static void Blitter_Step(void)
 static void Blitter_Start(void)
 {
 int FrameCycles, HblCounterVideo, LineCycles;
+int BenchPrev = Benchmark_Enter ( BENCHMARK_BLITTER );
 Video_GetPosition ( &FrameCycles , &HblCounterVideo , &LineCycles );
 
 //fprintf ( stderr , "blitter start %d video_cyc=%d %d@%d\n" , nCyclesMainCounter , FrameCycles , LineCycles, HblCounterVideo );
@@ -943,6 +945,8 @@ Video_GetPosition ( &FrameCycles , &HblCounterVideo , &LineCycles );
 			CycInt_AddRelativeInterrupt ( BLITTER_NONHOG_BUS_CPU*4, INT_CPU_CYCLE, INTERRUPT_BLITTER );
 		}
 	}
+
+	Benchmark_Leave ( BenchPrev );
 }
 
 
@@ -0,0 +1,267 @@
+/*
+  Hatari - capturePipe.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Raw video/audio capture stream
+
+  Each emulated frame and the audio samples generated during the same VBL
+  are written without any compression to a file or a named pipe (FIFO),
+  so that an external process (for example ffmpeg) can do the encoding
+  instead of the emulation thread. Writes are blocking : if the reader is
+  slower than the emulation, the emulation waits for it.
+
+  All values are little endian. The stream starts with a 32 bytes header :
+    0 - 7   "HATARCAP"
+    8 - 11  Version (1)
+    12 - 15 Size of each packet header (32)
+    16 - 19 Audio sample rate (in Hz)
+    20 - 23 Frequency of the cycle counter (emulated CPU clock, in Hz)
+    24 - 27 VBL frequency when capture started (in Hz << 16)
+    28 - 31 Reserved (0)
+
+  It's followed by packets, each with a 32 bytes header :
+    0 - 3   "VIDF" (video frame) or "AUDF" (audio block)
+    4 - 7   Size of the data following the header (in bytes)
+    8 - 11  VBL number
+    12 - 15 Reserved (0)
+    16 - 23 Cycle counter (CPU cycles since Hatari started)
+    24 - 25 Video : width / Audio : number of channels (2)
+    26 - 27 Video : height / Audio : bits per sample (16)
+    28 - 29 Video : bits per pixel (8 or 24) / Audio : 0
+    30 - 31 Video : number of palette entries (0 for 24 bits) / Audio : 0
+
+  Video data is the palette (3 bytes R,G,B per entry) followed by the pixels,
+  from top to bottom (1 byte per pixel with a palette, else 3 bytes R,G,B).
+  Frames using only colours of the current ST palette are sent with 8 bits
+  per pixel, other frames with 24 bits. Size can change between 2 frames
+  (when the resolution changes).
+  Audio data are signed 16 bits stereo samples.
+*/
+const char CapturePipe_fileid[] = "Hatari capturePipe.c";
+
+#include <SDL_endian.h>
+#include <signal.h>
+
+#include "main.h"
+#include "audio.h"
+#include "capturePipe.h"
+#include "configuration.h"
+#include "clocks_timings.h"
+#include "cycles.h"
+#include "log.h"
+#include "screen.h"
+#include "screenConvert.h"
+#include "screenSnapShot.h"
+#include "sound.h"
+#include "statusbar.h"
+#include "video.h"
+
+
+#define CAPTURE_PIPE_VERSION	1
+#define CAPTURE_PIPE_BUFFER_SIZE	(4 * 1024 * 1024)	/* write the stream by big blocks */
+
+typedef struct
+{
+	char	Id[4];			/* "VIDF" or "AUDF" */
+	Uint32	Size;			/* bytes following the header */
+	Uint32	Vbl;
+	Uint32	Reserved;
+	Uint64	Cycles;
+	Uint16	Param[4];		/* video or audio format */
+} CAPTURE_PIPE_HEADER;
+
+static char *CapturePipePath;		/* file given with --capture-pipe */
+static FILE *CapturePipeHndl;
+static SCREENSNAPSHOT_IMAGE CapturePipeImage;
+static int16_t (*CapturePipeSamples)[2];	/* little endian audio block */
+static int CapturePipeSamplesSize;
+#ifdef SIGPIPE
+static void (*CapturePipeOldSigPipe)(int);	/* restored when capture stops */
+#endif
+bool bCapturePipe = false;		/* Is the capture stream open? */
+
+
+/**
+ * Set the file or FIFO to stream to, capture is started with CapturePipe_Start()
+ */
+void CapturePipe_SetFile(const char *pszFileName)
+{
+	free(CapturePipePath);
+	CapturePipePath = strdup(pszFileName);
+}
+
+
+/**
+ * Write given data to the capture stream, stop capture on failure
+ * (for example if the reader closed the FIFO)
+ */
+static bool CapturePipe_Write(const void *pData, size_t nSize)
+{
+	if (nSize && fwrite(pData, nSize, 1, CapturePipeHndl) != 1)
+	{
+		perror("CapturePipe_Write");
+		CapturePipe_Stop();
+		Log_AlertDlg(LOG_ERROR, "Capture stream: failed to write, capture has been stopped.");
+		return false;
+	}
+	return true;
+}
+
+
+/**
+ * Write a packet header for the current VBL
+ */
+static bool CapturePipe_WriteHeader(const char *pszId, Uint32 nSize, int nParam0,
+                                    int nParam1, int nParam2, int nParam3)
+{
+	CAPTURE_PIPE_HEADER Header;
+
+	memcpy(Header.Id, pszId, 4);
+	Header.Size = SDL_SwapLE32(nSize);
+	Header.Vbl = SDL_SwapLE32(nVBLs);
+	Header.Reserved = 0;
+	Header.Cycles = SDL_SwapLE64(CyclesGlobalClockCounter);
+	Header.Param[0] = SDL_SwapLE16(nParam0);
+	Header.Param[1] = SDL_SwapLE16(nParam1);
+	Header.Param[2] = SDL_SwapLE16(nParam2);
+	Header.Param[3] = SDL_SwapLE16(nParam3);
+
+	return CapturePipe_Write(&Header, sizeof(Header));
+}
+
+
+/**
+ * Open the capture file/FIFO given with CapturePipe_SetFile() and write the
+ * stream header. Opening a FIFO waits until a reader opens it too.
+ */
+bool CapturePipe_Start(void)
+{
+	Uint32 StreamHeader[6];
+
+	if (bCapturePipe || !CapturePipePath)
+		return false;
+
+	CapturePipeHndl = fopen(CapturePipePath, "wb");
+	if (!CapturePipeHndl)
+	{
+		perror("CapturePipe_Start");
+		Log_AlertDlg(LOG_ERROR, "Capture stream: failed to open '%s'!", CapturePipePath);
+		return false;
+	}
+	setvbuf(CapturePipeHndl, NULL, _IOFBF, CAPTURE_PIPE_BUFFER_SIZE);
+#ifdef SIGPIPE
+	/* Report an error instead of being killed if the reader exits */
+	CapturePipeOldSigPipe = signal(SIGPIPE, SIG_IGN);
+#endif
+
+	StreamHeader[0] = SDL_SwapLE32(CAPTURE_PIPE_VERSION);
+	StreamHeader[1] = SDL_SwapLE32(sizeof(CAPTURE_PIPE_HEADER));
+	StreamHeader[2] = SDL_SwapLE32(ConfigureParams.Sound.nPlaybackFreq);
+	StreamHeader[3] = SDL_SwapLE32(MachineClocks.CPU_Freq_Emul);
+	StreamHeader[4] = SDL_SwapLE32(ClocksTimings_GetVBLPerSec(ConfigureParams.System.nMachineType,
+	                                   nScreenRefreshRate) >> (CLOCKS_TIMINGS_SHIFT_VBL - 16));
+	StreamHeader[5] = 0;
+
+	bCapturePipe = true;
+	if (!CapturePipe_Write("HATARCAP", 8)
+	    || !CapturePipe_Write(StreamHeader, sizeof(StreamHeader)))
+		return false;
+
+	Log_AlertDlg(LOG_INFO, "Capture stream has been started.");
+	return true;
+}
+
+
+/**
+ * Close the capture stream
+ */
+void CapturePipe_Stop(void)
+{
+	if (!bCapturePipe)
+		return;
+
+	bCapturePipe = false;
+	fclose(CapturePipeHndl);
+	CapturePipeHndl = NULL;
+#ifdef SIGPIPE
+	signal(SIGPIPE, CapturePipeOldSigPipe);
+#endif
+	ScreenSnapShot_BufferFree(&CapturePipeImage.Pixels);
+	free(CapturePipeSamples);
+	CapturePipeSamples = NULL;
+	CapturePipeSamplesSize = 0;
+
+	Log_Printf(LOG_INFO, "Capture stream has been stopped.\n");
+}
+
+
+/**
+ * Write the current frame (without the statusbar if cropping is enabled)
+ */
+void CapturePipe_VideoFrame(void)
+{
+	SCREENSNAPSHOT_IMAGE *pImage = &CapturePipeImage;
+	int nCropBottom, nBpp, nPaletteBytes;
+
+	if (!bCapturePipe)
+		return;
+
+	/* Converter thread could still be drawing into the surface */
+	ScreenConv_Sync(false);
+
+	nCropBottom = ConfigureParams.Screen.bCrop ? Statusbar_GetHeight() : 0;
+	if (!ScreenSnapShot_PrepareImage(sdlscrn, 0, 0, 0, 0, 0, nCropBottom, pImage))
+	{
+		CapturePipe_Stop();
+		Log_AlertDlg(LOG_ERROR, "Capture stream: failed to alloc frame, capture has been stopped.");
+		return;
+	}
+
+	nBpp = pImage->PaletteSize > 0 ? 8 : 24;
+	nPaletteBytes = pImage->PaletteSize * 3;
+	if (CapturePipe_WriteHeader("VIDF", nPaletteBytes + pImage->Pixels.Size,
+	                            pImage->Width, pImage->Height, nBpp, pImage->PaletteSize)
+	    && CapturePipe_Write(pImage->Palette, nPaletteBytes))
+		CapturePipe_Write(pImage->Pixels.pData, pImage->Pixels.Size);
+}
+
+
+/**
+ * Write the audio samples generated during the current VBL
+ */
+void CapturePipe_AudioBlock(int16_t pSamples[][2], int Index, int Length)
+{
+	int16_t (*pBlock)[2];
+	int i;
+	int idx;
+
+	if (!bCapturePipe)
+		return;
+
+	if (Length > CapturePipeSamplesSize)
+	{
+		pBlock = realloc(CapturePipeSamples, Length * sizeof(*pBlock));
+		if (!pBlock)
+		{
+			CapturePipe_Stop();
+			Log_AlertDlg(LOG_ERROR, "Capture stream: failed to alloc audio, capture has been stopped.");
+			return;
+		}
+		CapturePipeSamples = pBlock;
+		CapturePipeSamplesSize = Length;
+	}
+
+	/* Convert samples to little endian */
+	idx = Index & AUDIOMIXBUFFER_SIZE_MASK;
+	for (i = 0; i < Length; i++)
+	{
+		CapturePipeSamples[i][0] = SDL_SwapLE16(pSamples[idx][0]);
+		CapturePipeSamples[i][1] = SDL_SwapLE16(pSamples[idx][1]);
+		idx = (idx + 1) & AUDIOMIXBUFFER_SIZE_MASK;
+	}
+
+	if (CapturePipe_WriteHeader("AUDF", Length * sizeof(*CapturePipeSamples), 2, 16, 0, 0))
+		CapturePipe_Write(CapturePipeSamples, Length * sizeof(*CapturePipeSamples));
+}
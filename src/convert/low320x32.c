@@ -27,6 +27,13 @@ static void ConvertLowRes_320x32Bit(void)
 
 		update = AdjustLinePaletteRemap(y) & PALETTEMASK_UPDATEMASK;
 
+		/* Skip lines which didn't change */
+		if (!Convert_LineNeedsUpdate(y, update, esi, PCScreenBytesPerLine))
+		{
+			pPCScreenDest = (((Uint8 *)pPCScreenDest)+PCScreenBytesPerLine);
+			continue;
+		}
+
 		x = STScreenWidthBytes>>3; /* Amount to draw across in 16-pixels (8 bytes) */
 
 		do    /* x-loop */
@@ -13,7 +13,7 @@ static void ConvertMediumRes_640x32Bit(void)
 	Uint32 *edi, *ebp;
 	Uint32 *esi;
 	Uint32 eax;
-	int y;
+	int y, update;
 
 	Convert_StartFrame();            /* Start frame, track palettes */
 
@@ -25,7 +25,15 @@ static void ConvertMediumRes_640x32Bit(void)
 		ebp = (Uint32 *)((Uint8 *)pSTScreenCopy + eax);    /* Previous ST format screen */
 		esi = PCScreen;                                    /* PC format screen */
 
-		if (AdjustLinePaletteRemap(y) & 0x00030000)        /* Change palette table */
+		update = AdjustLinePaletteRemap(y);
+		/* Skip lines which didn't change, also their doubling */
+		if (!Convert_LineNeedsUpdate(y, update & PALETTEMASK_UPDATEMASK, esi, 2*PCScreenBytesPerLine))
+		{
+			PCScreen = (Uint32 *)((Uint8 *)PCScreen + 2*PCScreenBytesPerLine);
+			continue;
+		}
+
+		if (update & 0x00030000)                           /* Change palette table */
 			Line_ConvertMediumRes_640x32Bit(edi, ebp, esi, eax);
 		else
 			Line_ConvertLowRes_640x32Bit(edi, ebp, esi, eax);
@@ -28,6 +28,7 @@ const char Memory_fileid[] = "Hatari memory.c";
 #include "m68000.h"
 #include "configuration.h"
 #include "video.h"
+#include "memwatch.h"
 
 #include "newcpu.h"
 
@@ -2027,6 +2028,8 @@ uae_u32 memory_get_wordi(uaecptr addr)
 uae_u32 memory_get_long(uaecptr addr)
 {
 	addrbank *ab = &get_mem_bank(addr);
+	if (unlikely(MemWatch_ReadMap))
+		MemWatch_CheckRead(addr, 4);
 	if (!ab->baseaddr_direct_r) {
 		return call_mem_get_func(ab->lget, addr);
 	} else {
@@ -2040,6 +2043,8 @@ uae_u32 memory_get_long(uaecptr addr)
 uae_u32 memory_get_word(uaecptr addr)
 {
 	addrbank *ab = &get_mem_bank(addr);
+	if (unlikely(MemWatch_ReadMap))
+		MemWatch_CheckRead(addr, 2);
 	if (!ab->baseaddr_direct_r) {
 		return call_mem_get_func(ab->wget, addr);
 	} else {
@@ -2053,6 +2058,8 @@ uae_u32 memory_get_word(uaecptr addr)
 uae_u32 memory_get_byte(uaecptr addr)
 {
 	addrbank *ab = &get_mem_bank(addr);
+	if (unlikely(MemWatch_ReadMap))
+		MemWatch_CheckRead(addr, 1);
 	if (!ab->baseaddr_direct_r) {
 		return call_mem_get_func(ab->bget, addr);
 	} else {
@@ -2067,6 +2074,8 @@ uae_u32 memory_get_byte(uaecptr addr)
 void memory_put_long(uaecptr addr, uae_u32 v)
 {
 	addrbank *ab = &get_mem_bank(addr);
+	if (unlikely(MemWatch_WriteMap))
+		MemWatch_CheckWrite(addr, 4, v);
 	if (!ab->baseaddr_direct_w) {
 		call_mem_put_func(ab->lput, addr, v);
 	} else {
@@ -2080,6 +2089,8 @@ void memory_put_long(uaecptr addr, uae_u32 v)
 void memory_put_word(uaecptr addr, uae_u32 v)
 {
 	addrbank *ab = &get_mem_bank(addr);
+	if (unlikely(MemWatch_WriteMap))
+		MemWatch_CheckWrite(addr, 2, v);
 	if (!ab->baseaddr_direct_w) {
 		call_mem_put_func(ab->wput, addr, v);
 	} else {
@@ -2093,6 +2104,8 @@ void memory_put_word(uaecptr addr, uae_u32 v)
 void memory_put_byte(uaecptr addr, uae_u32 v)
 {
 	addrbank *ab = &get_mem_bank(addr);
+	if (unlikely(MemWatch_WriteMap))
+		MemWatch_CheckWrite(addr, 1, v);
 	if (!ab->baseaddr_direct_w) {
 		call_mem_put_func(ab->bput, addr, v);
 	} else {
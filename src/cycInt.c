@@ -6,11 +6,13 @@
 
   This code handles our table with callbacks for cycle accurate program
   interruption. We add any pending callback handler into a table so that we do
-  not need to test for every possible interrupt event. We then scan
-  the list if used entries in the table and copy the one with the least cycle
-  count into the global 'PendingInterruptCount' variable. This is then
-  decremented by the execution loop - rather than decrement each and every
-  entry (as the others cannot occur before this one).
+  not need to test for every possible interrupt event. Pending entries are
+  kept in a binary heap ordered by their cycle count, and the one with the
+  least cycle count is copied into the global 'CycInt_ActiveInt_Cycles'
+  variable. This is then compared to the clock by the execution loop - rather
+  than checking each and every entry (as the others cannot occur before this
+  one). Adding, modifying or removing an entry only needs to move it up or
+  down the heap, instead of walking a sorted list of all pending entries.
   We have two methods of adding interrupts; Absolute and Relative.
   Absolute will set values from the time of the previous interrupt (e.g., add
   HBL every 512 cycles), and Relative will add from the current cycle time.
@@ -50,6 +52,7 @@ const char CycInt_fileid[] = "Hatari cycInt.c";
 #include <stdint.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <SDL.h>
 
 #include "main.h"
 #include "configuration.h"
@@ -119,17 +122,64 @@ typedef struct
 	bool	Active;				/* Is interrupt active? */
 	uint64_t Cycles;
 	void	(*pFunction)(void);
-	int	IntList_Prev;		/* Number of previous interrupt sorted by 'Cycles' value (or -1 if none) */
-	int	IntList_Next;		/* Number of next interrupt sorted by 'Cycles' value (or -1 if none) */
-					/* NOTE : type should be 'int' not 'interrupt_id' else compiler might internally */
-					/* use 'unsigned int' which will fail when storing value '-1' */
+	uint32_t Seq;				/* Order in which pending interrupts were added */
+	int	HeapPos;			/* Position in CycInt_Heap[] (or -1 if not pending) */
 } INTERRUPTHANDLER;
 
 static INTERRUPTHANDLER InterruptHandlers[MAX_INTERRUPTS];
 static interrupt_id	CycInt_ActiveInt = 0;
 uint64_t			CycInt_ActiveInt_Cycles;
 
+/* Binary heap of pending interrupts, the one to occur first is CycInt_Heap[0] */
+/* (interrupt 0 is never in the heap, it's used when heap is empty) */
+static int		CycInt_Heap[MAX_INTERRUPTS];
+static int		CycInt_HeapCount;
+static uint32_t		CycInt_Seq;
+
+/* Optional statistics for the debugger "info cycint" command */
+static struct
+{
+	bool	 Enabled;
+	uint64_t Fires[MAX_INTERRUPTS];		/* How many times handler was called */
+	uint64_t Reschedules[MAX_INTERRUPTS];	/* How many times pending int was moved */
+	uint64_t HostTime[MAX_INTERRUPTS];	/* Host perf counter ticks spent in handler */
+} CycInt_Stats;
+
+static const char * const CycInt_Names[MAX_INTERRUPTS] =
+{
+	"null",
+	"video_vbl",
+	"video_hbl",
+	"video_endline",
+	"mfp_main_timera",
+	"mfp_main_timerb",
+	"mfp_main_timerc",
+	"mfp_main_timerd",
+	"mfp_tt_timera",
+	"mfp_tt_timerb",
+	"mfp_tt_timerc",
+	"mfp_tt_timerd",
+	"acia_ikbd",
+	"ikbd_resettimer",
+	"ikbd_autosend",
+	"dmasound_microwire",
+	"crossbar_25mhz",
+	"crossbar_32mhz",
+	"fdc",
+	"blitter",
+	"midi",
+	"scc_brg_a",
+	"scc_tx_rx_a",
+	"scc_rx_a",
+	"scc_brg_b",
+	"scc_tx_rx_b",
+	"scc_rx_b"
+};
+
+static void CycInt_HeapAdd ( int IntId );
+static inline void CycInt_UpdateActiveInt ( void );
 static void CycInt_InsertInt ( interrupt_id IntId );
+static void CycInt_RemoveInt ( interrupt_id IntId );
 
 /* TEMP : to update CYCLES_COUNTER_VIDEO during an opcode */
 /* This is a temporary case needed to handle updating CYCLES_COUNTER_VIDEO */
@@ -151,6 +201,8 @@ void CycInt_Reset(void)
 	/* Reset counts */
 	PendingInterruptCount = 0;
 	CycInt_DelayedCycles = 0;
+	CycInt_HeapCount = 0;
+	CycInt_Seq = 0;
 
 	/* Reset interrupt table */
 	for (i=0; i<MAX_INTERRUPTS; i++)
@@ -158,12 +210,12 @@ void CycInt_Reset(void)
 		InterruptHandlers[i].Active = false;
 		InterruptHandlers[i].Cycles = 0;
 		InterruptHandlers[i].pFunction = pIntHandlerFunctions[i];
-		InterruptHandlers[i].IntList_Prev = -1;
-		InterruptHandlers[i].IntList_Next = -1;
+		InterruptHandlers[i].Seq = 0;
+		InterruptHandlers[i].HeapPos = -1;
 	}
 
 	/* Interrupt 0 should always be active, but it will never trigger, */
-	/* it will always be the last of the list */
+	/* it's the active one only when no other interrupt is pending */
 	InterruptHandlers[ 0 ].Active = true;
 	InterruptHandlers[ 0 ].Cycles = UINT64_MAX;
 
@@ -220,8 +272,7 @@ void CycInt_MemorySnapShot_Capture(bool bSave)
 	{
 		MemorySnapShot_Store(&InterruptHandlers[i].Active, sizeof(InterruptHandlers[i].Active));
 		MemorySnapShot_Store(&InterruptHandlers[i].Cycles, sizeof(InterruptHandlers[i].Cycles));
-		MemorySnapShot_Store(&InterruptHandlers[i].IntList_Prev, sizeof(InterruptHandlers[i].IntList_Prev));
-		MemorySnapShot_Store(&InterruptHandlers[i].IntList_Next, sizeof(InterruptHandlers[i].IntList_Next));
+		MemorySnapShot_Store(&InterruptHandlers[i].Seq, sizeof(InterruptHandlers[i].Seq));
 		if (bSave)
 		{
 			/* Convert function to ID */
@@ -235,6 +286,7 @@ void CycInt_MemorySnapShot_Capture(bool bSave)
 			InterruptHandlers[i].pFunction = CycInt_IDToHandlerFunction(ID);
 		}
 	}
+	MemorySnapShot_Store(&CycInt_Seq, sizeof(CycInt_Seq));
 	MemorySnapShot_Store(&CycInt_DelayedCycles, sizeof(CycInt_DelayedCycles));
 	MemorySnapShot_Store(&CycInt_ActiveInt, sizeof(CycInt_ActiveInt));
 	MemorySnapShot_Store(&CycInt_ActiveInt_Cycles, sizeof(CycInt_ActiveInt_Cycles));
@@ -251,68 +303,169 @@ void CycInt_MemorySnapShot_Capture(bool bSave)
 		/* Convert ID to function */
 		MemorySnapShot_Store(&ID, sizeof(int));
 		PendingInterruptFunction = CycInt_IDToHandlerFunction(ID);
+
+		/* Rebuild heap of pending interrupts, their order is */
+		/* fully defined by Cycles and Seq values */
+		CycInt_HeapCount = 0;
+		for (i=0; i<MAX_INTERRUPTS; i++)
+			InterruptHandlers[i].HeapPos = -1;
+		for (i=1; i<MAX_INTERRUPTS; i++)
+			if (InterruptHandlers[i].Active)
+				CycInt_HeapAdd(i);
+		CycInt_UpdateActiveInt();
 	}
 }
 
 
 /*-----------------------------------------------------------------------*/
 /**
- * When the interrupt handler for IntId becomes active, we insert IntId
- * in the linked list of active interrupts sorted by Cycles values
+ * Return true if interrupt 'a' should be handled before interrupt 'b'.
+ * When both have the same Cycles value, the one added last comes first
+ * (this is the order in which the previous sorted list handled them)
  */
-static void CycInt_InsertInt ( interrupt_id IntId )
+static inline bool CycInt_Before ( int a , int b )
 {
-	int	n, prev;
+	if ( InterruptHandlers[ a ].Cycles != InterruptHandlers[ b ].Cycles )
+		return InterruptHandlers[ a ].Cycles < InterruptHandlers[ b ].Cycles;
+	return (int32_t)( InterruptHandlers[ a ].Seq - InterruptHandlers[ b ].Seq ) > 0;
+}
 
-#ifdef CYCINT_DEBUG
-	fprintf ( stderr , "int before active=%02d active_cyc=%"PRIu64" new=%02d cyc=%"PRIu64" clock=%"PRIu64"\n" , CycInt_ActiveInt , CycInt_ActiveInt_Cycles , IntId , InterruptHandlers[ IntId ].Cycles , Cycles_GetClockCounterImmediate() );
-	n = CycInt_ActiveInt;
-	do
-	{
-		fprintf ( stderr , "  int %02d prev=%02d next=%02d cyc=%"PRIu64"\n" , n , InterruptHandlers[ n ].IntList_Prev , InterruptHandlers[ n ].IntList_Next , InterruptHandlers[ n ].Cycles );
-		n = InterruptHandlers[ n ].IntList_Next;
-	} while ( n >= 0 );
-#endif
 
-	/* Search for the position to insert IntId in the linked list ; we insert just before interrupt 'n'  */
-	n = CycInt_ActiveInt;
-	prev = InterruptHandlers[ n ].IntList_Prev;
-	while (InterruptHandlers[ IntId ].Cycles > InterruptHandlers[ n ].Cycles)
+/*-----------------------------------------------------------------------*/
+/**
+ * Store interrupt IntId at position 'pos' of the heap
+ */
+static inline void CycInt_HeapSet ( int pos , int IntId )
+{
+	CycInt_Heap[ pos ] = IntId;
+	InterruptHandlers[ IntId ].HeapPos = pos;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Move heap entry at position 'pos' up / down until heap is ordered again
+ */
+static void CycInt_HeapUp ( int pos )
+{
+	int	IntId = CycInt_Heap[ pos ];
+	int	parent;
+
+	while ( pos > 0 )
 	{
-		n = InterruptHandlers[ n ].IntList_Next;
-		assert (n >= 0);
-		prev = InterruptHandlers[ n ].IntList_Prev;
+		parent = ( pos - 1 ) / 2;
+		if ( !CycInt_Before ( IntId , CycInt_Heap[ parent ] ) )
+			break;
+		CycInt_HeapSet ( pos , CycInt_Heap[ parent ] );
+		pos = parent;
 	}
+	CycInt_HeapSet ( pos , IntId );
+}
 
-	InterruptHandlers[ IntId ].IntList_Next = n;
-	InterruptHandlers[ n ].IntList_Prev = IntId;
+static void CycInt_HeapDown ( int pos )
+{
+	int	IntId = CycInt_Heap[ pos ];
+	int	child;
 
-	if ( n == (int)CycInt_ActiveInt )		/* Add as the first entry from list */
+	while ( ( child = 2 * pos + 1 ) < CycInt_HeapCount )
 	{
-		/* Set the new ActiveInt */
-		CycInt_ActiveInt = IntId;
-		CycInt_ActiveInt_Cycles = InterruptHandlers[ CycInt_ActiveInt ].Cycles;
-		/* New ActiveInt is first of the list */
-		InterruptHandlers[ CycInt_ActiveInt ].IntList_Prev = -1;
+		if ( child + 1 < CycInt_HeapCount && CycInt_Before ( CycInt_Heap[ child + 1 ] , CycInt_Heap[ child ] ) )
+			child++;
+		if ( !CycInt_Before ( CycInt_Heap[ child ] , IntId ) )
+			break;
+		CycInt_HeapSet ( pos , CycInt_Heap[ child ] );
+		pos = child;
 	}
-	else						/* Insert in middle of the list */
+	CycInt_HeapSet ( pos , IntId );
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Add interrupt IntId to the heap, using its current Cycles/Seq values
+ */
+static void CycInt_HeapAdd ( int IntId )
+{
+	CycInt_HeapSet ( CycInt_HeapCount++ , IntId );
+	CycInt_HeapUp ( InterruptHandlers[ IntId ].HeapPos );
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Set CycInt_ActiveInt to the first interrupt in the heap
+ * (or INTERRUPT_NULL (=0) if heap is empty)
+ */
+static inline void CycInt_UpdateActiveInt ( void )
+{
+	CycInt_ActiveInt = CycInt_HeapCount > 0 ? CycInt_Heap[ 0 ] : INTERRUPT_NULL;
+	CycInt_ActiveInt_Cycles = InterruptHandlers[ CycInt_ActiveInt ].Cycles;
+}
+
+
+#ifdef CYCINT_DEBUG
+static void CycInt_DebugHeap ( const char *what , uint64_t Clock )
+{
+	int	i, n;
+
+	fprintf ( stderr , "int %s active=%02d active_cyc=%"PRIu64" clock=%"PRIu64"\n" , what , CycInt_ActiveInt , CycInt_ActiveInt_Cycles , Clock );
+	for ( i = 0 ; i < CycInt_HeapCount ; i++ )
 	{
-		InterruptHandlers[ IntId ].IntList_Prev = prev;
-		InterruptHandlers[ prev ].IntList_Next = IntId;
+		n = CycInt_Heap[ i ];
+		fprintf ( stderr , "  int %02d pos=%02d seq=%u cyc=%"PRIu64"\n" , n , i , InterruptHandlers[ n ].Seq , InterruptHandlers[ n ].Cycles );
 	}
+}
+#endif
 
+
+/*-----------------------------------------------------------------------*/
+/**
+ * When the interrupt handler for IntId becomes active, we insert IntId
+ * in the heap of active interrupts ordered by Cycles values
+ */
+static void CycInt_InsertInt ( interrupt_id IntId )
+{
 #ifdef CYCINT_DEBUG
-	fprintf ( stderr , "int after active=%02d active_cyc=%"PRIu64" new=%02d cyc=%"PRIu64" clock=%"PRIu64"\n" , CycInt_ActiveInt , CycInt_ActiveInt_Cycles , IntId , InterruptHandlers[ IntId ].Cycles , Cycles_GetClockCounterImmediate() );
-	n = CycInt_ActiveInt;
-	do
-	{
-		fprintf ( stderr , "  int %02d prev=%02d next=%02d cyc=%"PRIu64"\n" , n , InterruptHandlers[ n ].IntList_Prev , InterruptHandlers[ n ].IntList_Next , InterruptHandlers[ n ].Cycles );
-		n = InterruptHandlers[ n ].IntList_Next;
-	} while ( n >= 0 );
+	CycInt_DebugHeap ( "insert before" , Cycles_GetClockCounterImmediate() );
+#endif
+	InterruptHandlers[ IntId ].Seq = ++CycInt_Seq;
+	CycInt_HeapAdd ( IntId );
+	CycInt_UpdateActiveInt ();
+
+#ifdef CYCINT_DEBUG
+	CycInt_DebugHeap ( "insert after" , Cycles_GetClockCounterImmediate() );
 #endif
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Remove IntId from the heap of active interrupts and set a new value
+ * for CycInt_ActiveInt
+ */
+static void CycInt_RemoveInt ( interrupt_id IntId )
+{
+	int	pos = InterruptHandlers[ IntId ].HeapPos;
+	int	last;
+
+	if ( pos < 0 )
+		return;
+	InterruptHandlers[ IntId ].HeapPos = -1;
+
+	/* Replace removed entry with the last one of the heap and re-order it */
+	last = CycInt_Heap[ --CycInt_HeapCount ];
+	if ( pos < CycInt_HeapCount )
+	{
+		CycInt_HeapSet ( pos , last );
+		if ( pos > 0 && CycInt_Before ( last , CycInt_Heap[ ( pos - 1 ) / 2 ] ) )
+			CycInt_HeapUp ( pos );
+		else
+			CycInt_HeapDown ( pos );
+	}
+	CycInt_UpdateActiveInt ();
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * As 'CycInt_ActiveInt' has occurred, we remove it from active list
@@ -323,11 +476,8 @@ void CycInt_AcknowledgeInterrupt(void)
 	/* Disable interrupt's entry which has just occurred */
 	InterruptHandlers[ CycInt_ActiveInt ].Active = false;
 
-	/* Set the new ActiveInt as the next in list (it can be INTERRUPT_NULL (=0) ) */
-	CycInt_ActiveInt = InterruptHandlers[ CycInt_ActiveInt ].IntList_Next;
-	CycInt_ActiveInt_Cycles = InterruptHandlers[ CycInt_ActiveInt ].Cycles;
-	/* New ActiveInt is first of the list */
-	InterruptHandlers[ CycInt_ActiveInt ].IntList_Prev = -1;
+	/* Set the new ActiveInt as the next in heap (it can be INTERRUPT_NULL (=0) ) */
+	CycInt_RemoveInt ( CycInt_ActiveInt );
 
 	LOG_TRACE(TRACE_INT, "int ack video_cyc=%d active_int=%d clock=%"PRIu64" active_cyc=%"PRIu64" pending_count=%d\n",
 			Video_GetCyclesSinceVbl(), CycInt_ActiveInt,
@@ -346,7 +496,10 @@ void CycInt_AddAbsoluteInterrupt(int CycleTime, int CycleType, interrupt_id Hand
 {
 	/* Check interrupt is not already enabled ; if so, remove it first */
 	if ( InterruptHandlers[ Handler ].Active == true )
+	{
 		CycInt_RemovePendingInterrupt ( Handler );
+		CycInt_Stats.Reschedules[ Handler ]++;
+	}
 
 	/* Enable interrupt with new Cycles value */
 	InterruptHandlers[ Handler ].Active = true;
@@ -385,7 +538,10 @@ void CycInt_AddRelativeInterruptWithOffset(int CycleTime, int CycleType, interru
 //fprintf ( stderr , "int add rel %d type %d handler %d offset %d\n" , CycleTime,CycleType,Handler,CycleOffset );
 	/* Check interrupt is not already enabled ; if so, remove it first */
 	if ( InterruptHandlers[ Handler ].Active == true )
+	{
 		CycInt_RemovePendingInterrupt ( Handler );
+		CycInt_Stats.Reschedules[ Handler ]++;
+	}
 
 	/* Enable interrupt with new Cycles value */
 	InterruptHandlers[ Handler ].Active = true;
@@ -409,8 +565,9 @@ void CycInt_AddRelativeInterruptWithOffset(int CycleTime, int CycleType, interru
  */
 void CycInt_ModifyInterrupt(int CycleTime, int CycleType, interrupt_id Handler)
 {
-	/* First, we remove the interrupt from the list */
+	/* First, we remove the interrupt from the heap */
 	CycInt_RemovePendingInterrupt ( Handler );
+	CycInt_Stats.Reschedules[ Handler ]++;
 
 	/* Enable interrupt with new Cycles value */
 	InterruptHandlers[ Handler ].Active = true;
@@ -443,33 +600,14 @@ void CycInt_RemovePendingInterrupt(interrupt_id Handler)
 	/* Disable interrupt's entry */
 	InterruptHandlers[Handler].Active = false;
 
-	if ( Handler == CycInt_ActiveInt )	/* Remove first entry from list */
-	{
-		/* Set the new ActiveInt as the next in list (it can be INTERRUPT_NULL) */
-		CycInt_ActiveInt = InterruptHandlers[ CycInt_ActiveInt ].IntList_Next;
-		CycInt_ActiveInt_Cycles = InterruptHandlers[ CycInt_ActiveInt ].Cycles;
-		/* New ActiveInt is first of the list */
-		InterruptHandlers[ CycInt_ActiveInt ].IntList_Prev = -1;
-	}
-
-	else					/* Remove an entry 'n' in middle of the list */
-	{
-		/* Update prev/next for the entries n-1 and n+1 */
-		InterruptHandlers[ InterruptHandlers[Handler].IntList_Prev ].IntList_Next = InterruptHandlers[ Handler ].IntList_Next;
-		InterruptHandlers[ InterruptHandlers[Handler].IntList_Next ].IntList_Prev = InterruptHandlers[ Handler ].IntList_Prev;
-	}
+	/* Set the new ActiveInt if Handler was the first entry in heap */
+	CycInt_RemoveInt ( Handler );
 
 	LOG_TRACE(TRACE_INT, "int remove pending video_cyc=%d handler=%d clock=%"PRIu64" handler_cyc=%"PRIu64" pending_count=%d\n",
 	          Video_GetCyclesSinceVbl(), Handler,
 	          Cycles_GetClockCounterImmediate() , InterruptHandlers[Handler].Cycles, PendingInterruptCount);
 #ifdef CYCINT_DEBUG
-	fprintf ( stderr , "int remove after active=%02d active_cyc=%"PRIu64" clock=%"PRIu64"\n" , CycInt_ActiveInt , CycInt_ActiveInt_Cycles , Cycles_GetClockCounterImmediate() );
-	int n = CycInt_ActiveInt;
-	do
-	{
-		fprintf ( stderr , "  int %02d prev=%02d next=%02d cyc=%"PRIu64"\n" , n , InterruptHandlers[ n ].IntList_Prev , InterruptHandlers[ n ].IntList_Next , InterruptHandlers[ n ].Cycles );
-		n = InterruptHandlers[ n ].IntList_Next;
-	} while ( n >= 0 );
+	CycInt_DebugHeap ( "remove after" , Cycles_GetClockCounterImmediate() );
 #endif
 }
 
@@ -529,13 +667,7 @@ int	CycInt_GetActiveInt(void)
 void	CycInt_CallActiveHandler(uint64_t Clock)
 {
 #ifdef CYCINT_DEBUG
-	fprintf ( stderr , "int remove after active=%02d active_cyc=%"PRIu64" clock=%"PRIu64"\n" , CycInt_ActiveInt , CycInt_ActiveInt_Cycles , Clock );
-	int n = CycInt_ActiveInt;
-	do
-	{
-		fprintf ( stderr , "  int %02d prev=%02d next=%02d cyc=%"PRIu64"\n" , n , InterruptHandlers[ n ].IntList_Prev , InterruptHandlers[ n ].IntList_Next , InterruptHandlers[ n ].Cycles );
-		n = InterruptHandlers[ n ].IntList_Next;
-	} while ( n >= 0 );
+	CycInt_DebugHeap ( "call" , Clock );
 #endif
 	/* For compatibility with old cycInt code, we compute a value of PendingInterruptCount */
 	/* at the time the interrupt happens. PendingInterruptCount will be <= 0 */
@@ -546,6 +678,98 @@ void	CycInt_CallActiveHandler(uint64_t Clock)
 	CycInt_DelayedCycles = PendingInterruptCount;
 //fprintf ( stderr , "int call handler pending=%d\n" , PendingInterruptCount );
 
+	if ( unlikely ( CycInt_Stats.Enabled ) )
+	{
+		int IntId = CycInt_ActiveInt;
+		uint64_t Start = SDL_GetPerformanceCounter();
+
+		CALL_VAR ( InterruptHandlers[IntId].pFunction );
+
+		CycInt_Stats.Fires[ IntId ]++;
+		CycInt_Stats.HostTime[ IntId ] += SDL_GetPerformanceCounter() - Start;
+		return;
+	}
 	CALL_VAR ( InterruptHandlers[CycInt_ActiveInt].pFunction );
 }
 
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Convert "info cycint" command arguments to CycInt_Info() argument
+ * Return zero on error
+ */
+uint32_t CycInt_InfoArgs(int argc, char *argv[])
+{
+	if (argc == 0)
+		return CYCINT_INFO_SHOW;
+	if (argc == 1)
+	{
+		if (strcmp(argv[0], "on") == 0)
+			return CYCINT_INFO_ON;
+		if (strcmp(argv[0], "off") == 0)
+			return CYCINT_INFO_OFF;
+	}
+	fprintf(stderr, "ERROR: cycint info accepts only 'on' or 'off' argument!\n");
+	return 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Show pending interrupts and handler statistics, or enable / disable
+ * statistics collection.  Enabling them resets the statistics.
+ */
+void CycInt_Info(FILE *fp, uint32_t arg)
+{
+	uint64_t Now, Fires = 0, Reschedules = 0, HostTime = 0;
+	double Freq;
+	int i;
+
+	if (arg == CYCINT_INFO_ON)
+	{
+		memset(&CycInt_Stats, 0, sizeof(CycInt_Stats));
+		CycInt_Stats.Enabled = true;
+		fprintf(fp, "Interrupt handler statistics enabled.\n");
+		return;
+	}
+	if (arg == CYCINT_INFO_OFF)
+	{
+		CycInt_Stats.Enabled = false;
+		fprintf(fp, "Interrupt handler statistics disabled.\n");
+		return;
+	}
+
+	Now = INT_CONVERT_TO_INTERNAL(Cycles_GetClockCounterImmediate(), INT_CPU_CYCLE);
+	fprintf(fp, "Pending interrupts (%d), in CPU cycles from now:\n", CycInt_HeapCount);
+	for (i = 0; i < MAX_INTERRUPTS; i++)
+	{
+		if (i == INTERRUPT_NULL || !InterruptHandlers[i].Active)
+			continue;
+		fprintf(fp, "- %-18s: %"PRId64"%s\n", CycInt_Names[i],
+			INT_CONVERT_FROM_INTERNAL((int64_t)(InterruptHandlers[i].Cycles - Now), INT_CPU_CYCLE),
+			i == (int)CycInt_ActiveInt ? " (next)" : "");
+	}
+
+	if (!CycInt_Stats.Enabled)
+	{
+		fprintf(fp, "Use 'info cycint on' to collect handler statistics.\n");
+		return;
+	}
+	Freq = SDL_GetPerformanceFrequency() / 1000.0;
+	fprintf(fp, "Handler statistics:\n");
+	fprintf(fp, "  %-18s %10s %10s %10s\n", "interrupt", "fires", "resched", "host ms");
+	for (i = 1; i < MAX_INTERRUPTS; i++)
+	{
+		if (!CycInt_Stats.Fires[i] && !CycInt_Stats.Reschedules[i])
+			continue;
+		fprintf(fp, "  %-18s %10"PRIu64" %10"PRIu64" %10.3f\n", CycInt_Names[i],
+			CycInt_Stats.Fires[i], CycInt_Stats.Reschedules[i],
+			CycInt_Stats.HostTime[i] / Freq);
+		Fires += CycInt_Stats.Fires[i];
+		Reschedules += CycInt_Stats.Reschedules[i];
+		HostTime += CycInt_Stats.HostTime[i];
+	}
+	fprintf(fp, "  %-18s %10"PRIu64" %10"PRIu64" %10.3f\n", "total",
+		Fires, Reschedules, HostTime / Freq);
+}
+
@@ -33,6 +33,7 @@ const char BreakCond_fileid[] = "Hatari breakcond.c";
 #include "debugui.h"
 #include "evaluate.h"
 #include "history.h"
+#include "memwatch.h"
 #include "symbols.h"
 #include "68kDisass.h"
 
@@ -45,8 +46,16 @@ const char BreakCond_fileid[] = "Hatari breakcond.c";
 
 #define BC_DEFAULT_DSP_SPACE 'P'
 
-typedef struct {
+typedef struct bc_value_s bc_value_t;
+typedef struct bc_condition_s bc_condition_t;
+
+/* value getter & condition predicate selected when condition is compiled */
+typedef uint32_t (*bc_getter_t)(const bc_value_t *bc_value);
+typedef bool (*bc_matcher_t)(const bc_condition_t *condition, uint32_t *lvalue);
+
+struct bc_value_s {
 	bool is_indirect;
+	bool is_pc;	/* (direct) CPU / DSP program counter register */
 	char dsp_space;	/* DSP has P, X, Y address spaces, zero if not DSP */
 	value_t valuetype;	/* Hatari value variable type */
 	union {
@@ -58,14 +67,17 @@ typedef struct {
 	} value;
 	uint32_t bits;	/* CPU has 8/16/32 bit address widths */
 	uint32_t mask;	/* <width mask> && <value mask> */
-} bc_value_t;
+	bc_getter_t get;	/* masked value getter for above */
+};
 
-typedef struct {
+struct bc_condition_s {
 	bc_value_t lvalue;
 	bc_value_t rvalue;
 	char comparison;
 	bool track;	/* track value changes */
-} bc_condition_t;
+	bc_matcher_t match;	/* compiled comparison of above */
+	uint32_t rconst;	/* pre-masked rvalue, if it's a plain number */
+};
 
 typedef struct {
 	info_func_t info;  /* pointer to specified ":info" function */
@@ -85,25 +97,47 @@ typedef struct {
 	bc_condition_t *conditions;
 	int ccount;	/* condition count */
 	int hits;	/* how many times breakpoint hit */
+	int watch_access;	/* MEMWATCH_* flags, zero if not a watchpoint */
+	uint32_t watch_start;	/* watched [start, end) address range */
+	uint32_t watch_end;
 } bc_breakpoint_t;
 
+typedef struct {
+	uint32_t pc;
+	int first;	/* first breakpoint index for this PC, -1 if slot unused */
+} bc_pc_slot_t;
+
 typedef struct {
 	bc_breakpoint_t *breakpoint;
 	bc_breakpoint_t *breakpoint2delete;	/* delayed delete of old alloc */
 	const char *name;
 	int count;
 	int allocated;
+	int watchcount;	/* how many of breakpoints are watchpoints */
 	bool delayed_change;
 	const debug_reason_t reason;
+	uint32_t (*get_pc)(void);
+	/* match index, rebuilt on first match after breakpoint changes */
+	bool reindex;
+	int *scan;	/* breakpoints needing full check, in index order */
+	int scancount;
+	bc_pc_slot_t *slots;	/* PC hash for 'pc = <addr> [&& ...]' breakpoints */
+	int *pcnext;	/* next breakpoint with same PC address, or -1 */
+	int slotbits;
 } bc_breakpoints_t;
 
+static uint32_t GetCpuPC(void);
+static uint32_t GetDspPC(void);
+
 static bc_breakpoints_t CpuBreakPoints = {
 	.name = "CPU",
-	.reason = REASON_CPU_BREAKPOINT
+	.reason = REASON_CPU_BREAKPOINT,
+	.get_pc = GetCpuPC
 };
 static bc_breakpoints_t DspBreakPoints = {
 	.name = "DSP",
-	.reason = REASON_DSP_BREAKPOINT
+	.reason = REASON_DSP_BREAKPOINT,
+	.get_pc = GetDspPC
 };
 
 
@@ -236,6 +270,162 @@ static uint32_t BreakCond_GetValue(const bc_value_t *bc_value)
 }
 
 
+/* Specialized getters for direct values, selected by BreakCond_Compile() */
+static uint32_t BreakCond_GetNumber(const bc_value_t *bc_value)
+{
+	return bc_value->value.number & bc_value->mask;
+}
+static uint32_t BreakCond_GetFunc32(const bc_value_t *bc_value)
+{
+	return bc_value->value.func32() & bc_value->mask;
+}
+static uint32_t BreakCond_GetReg16(const bc_value_t *bc_value)
+{
+	return *(bc_value->value.reg16) & bc_value->mask;
+}
+static uint32_t BreakCond_GetReg32(const bc_value_t *bc_value)
+{
+	return *(bc_value->value.reg32) & bc_value->mask;
+}
+
+
+/* Condition predicates for each comparison operator:
+ * - generic one going through value getters on both sides
+ * - ones for a plain (pre-masked) number on right side, with
+ *   left side read through getter / register pointer / function
+ */
+#define BC_MATCHERS(name, op) \
+static bool BreakCond_Match##name(const bc_condition_t *c, uint32_t *lvalue) \
+{ \
+	*lvalue = c->lvalue.get(&(c->lvalue)); \
+	return *lvalue op c->rvalue.get(&(c->rvalue)); \
+} \
+static bool BreakCond_Match##name##Const(const bc_condition_t *c, uint32_t *lvalue) \
+{ \
+	*lvalue = c->lvalue.get(&(c->lvalue)); \
+	return *lvalue op c->rconst; \
+} \
+static bool BreakCond_Match##name##Func32(const bc_condition_t *c, uint32_t *lvalue) \
+{ \
+	*lvalue = c->lvalue.value.func32() & c->lvalue.mask; \
+	return *lvalue op c->rconst; \
+} \
+static bool BreakCond_Match##name##Reg16(const bc_condition_t *c, uint32_t *lvalue) \
+{ \
+	*lvalue = *(c->lvalue.value.reg16) & c->lvalue.mask; \
+	return *lvalue op c->rconst; \
+} \
+static bool BreakCond_Match##name##Reg32(const bc_condition_t *c, uint32_t *lvalue) \
+{ \
+	*lvalue = *(c->lvalue.value.reg32) & c->lvalue.mask; \
+	return *lvalue op c->rconst; \
+}
+
+BC_MATCHERS(Less, <)
+BC_MATCHERS(Greater, >)
+BC_MATCHERS(Equal, ==)
+BC_MATCHERS(NotEqual, !=)
+
+enum {
+	BC_MATCH_GENERIC,
+	BC_MATCH_CONST,
+	BC_MATCH_FUNC32,
+	BC_MATCH_REG16,
+	BC_MATCH_REG32,
+	BC_MATCH_VARIANTS
+};
+
+#define BC_MATCHER_VARIANTS(name) { \
+	BreakCond_Match##name, \
+	BreakCond_Match##name##Const, \
+	BreakCond_Match##name##Func32, \
+	BreakCond_Match##name##Reg16, \
+	BreakCond_Match##name##Reg32 }
+
+static const struct {
+	char comparison;
+	bc_matcher_t match[BC_MATCH_VARIANTS];
+} BreakCond_Matchers[] = {
+	{ '<', BC_MATCHER_VARIANTS(Less) },
+	{ '>', BC_MATCHER_VARIANTS(Greater) },
+	{ '=', BC_MATCHER_VARIANTS(Equal) },
+	{ '!', BC_MATCHER_VARIANTS(NotEqual) }
+};
+
+
+/**
+ * Return getter for given value
+ */
+static bc_getter_t BreakCond_SelectGetter(const bc_value_t *bc_value)
+{
+	if (bc_value->is_indirect) {
+		return BreakCond_GetValue;
+	}
+	switch (bc_value->valuetype) {
+	case VALUE_TYPE_NUMBER:
+		return BreakCond_GetNumber;
+	case VALUE_TYPE_FUNCTION32:
+		return BreakCond_GetFunc32;
+	case VALUE_TYPE_REG16:
+		return BreakCond_GetReg16;
+	case VALUE_TYPE_VAR32:
+	case VALUE_TYPE_REG32:
+		return BreakCond_GetReg32;
+	default:
+		fprintf(stderr, "ERROR: unknown condition value size/type %d!\n", bc_value->valuetype);
+		abort();
+	}
+}
+
+/**
+ * Resolve value getters and comparison predicate for given condition,
+ * so that matching it doesn't need to switch on value types, register
+ * widths and comparison operators.
+ */
+static void BreakCond_Compile(bc_condition_t *condition)
+{
+	const bc_value_t *lvalue = &(condition->lvalue);
+	int i, variant;
+
+	condition->lvalue.get = BreakCond_SelectGetter(lvalue);
+	condition->rvalue.get = BreakCond_SelectGetter(&(condition->rvalue));
+
+	if (condition->rvalue.is_indirect ||
+	    condition->rvalue.valuetype != VALUE_TYPE_NUMBER) {
+		variant = BC_MATCH_GENERIC;
+	} else if (lvalue->is_indirect) {
+		variant = BC_MATCH_CONST;
+	} else {
+		switch (lvalue->valuetype) {
+		case VALUE_TYPE_FUNCTION32:
+			variant = BC_MATCH_FUNC32;
+			break;
+		case VALUE_TYPE_REG16:
+			variant = BC_MATCH_REG16;
+			break;
+		case VALUE_TYPE_VAR32:
+		case VALUE_TYPE_REG32:
+			variant = BC_MATCH_REG32;
+			break;
+		default:
+			variant = BC_MATCH_CONST;
+			break;
+		}
+	}
+	condition->rconst = BreakCond_GetNumber(&(condition->rvalue));
+
+	for (i = 0; i < ARRAY_SIZE(BreakCond_Matchers); i++) {
+		if (BreakCond_Matchers[i].comparison == condition->comparison) {
+			condition->match = BreakCond_Matchers[i].match[variant];
+			return;
+		}
+	}
+	fprintf(stderr, "ERROR: Unknown breakpoint value comparison operator '%c'!\n",
+		condition->comparison);
+	abort();
+}
+
+
 /**
  * Show & update rvalue for a tracked breakpoint condition to lvalue
  */
@@ -245,6 +435,7 @@ static void BreakCond_UpdateTracked(bc_condition_t *condition, uint32_t value)
 
 	/* next monitor changes to this new value */
 	condition->rvalue.value.number = value;
+	condition->rconst = BreakCond_GetNumber(&(condition->rvalue));
 
 	if (condition->lvalue.is_indirect &&
 	    condition->lvalue.valuetype == VALUE_TYPE_NUMBER) {
@@ -263,34 +454,11 @@ static void BreakCond_UpdateTracked(bc_condition_t *condition, uint32_t value)
  */
 static bool BreakCond_MatchConditions(bc_condition_t *condition, int count)
 {
-	uint32_t lvalue, rvalue;
-	bool hit = false;
+	uint32_t lvalue;
 	int i;
 
 	for (i = 0; i < count; condition++, i++) {
-
-		lvalue = BreakCond_GetValue(&(condition->lvalue));
-		rvalue = BreakCond_GetValue(&(condition->rvalue));
-
-		switch (condition->comparison) {
-		case '<':
-			hit = (lvalue < rvalue);
-			break;
-		case '>':
-			hit = (lvalue > rvalue);
-			break;
-		case '=':
-			hit = (lvalue == rvalue);
-			break;
-		case '!':
-			hit = (lvalue != rvalue);
-			break;
-		default:
-			fprintf(stderr, "ERROR: Unknown breakpoint value comparison operator '%c'!\n",
-				condition->comparison);
-			abort();
-		}
-		if (likely(!hit)) {
+		if (likely(!condition->match(condition, &lvalue))) {
 			return false;
 		}
 		if (condition->track) {
@@ -303,67 +471,336 @@ static bool BreakCond_MatchConditions(bc_condition_t *condition, int count)
 
 
 /**
- * Check and show which breakpoints' conditions matched
+ * Return PC hash slot index for given address
+ */
+static inline uint32_t BreakCond_PcSlot(const bc_breakpoints_t *bps, uint32_t pc)
+{
+	return (pc * 2654435761u) >> (32 - bps->slotbits);
+}
+
+/**
+ * Return true if given breakpoint first condition is a plain
+ * 'pc = <address>' one, which can be looked up from PC hash.
+ * Only first condition is checked because (tracked) conditions
+ * before it need to be evaluated whether PC matches or not.
+ */
+static bool BreakCond_IsPcBreakPoint(const bc_breakpoint_t *bp)
+{
+	const bc_condition_t *condition = bp->conditions;
+	const bc_value_t *pc = &(condition->lvalue);
+
+	if (!bp->ccount || bp->watch_access ||
+	    condition->comparison != '=' || condition->track) {
+		return false;
+	}
+	if (!pc->is_pc || pc->is_indirect ||
+	    condition->rvalue.is_indirect ||
+	    condition->rvalue.valuetype != VALUE_TYPE_NUMBER) {
+		return false;
+	}
+	/* mask needs to cover all PC bits (CPU 32, DSP 16) */
+	if (pc->dsp_space) {
+		return (pc->mask & BITMASK(16)) == BITMASK(16);
+	}
+	return pc->mask == BITMASK(32);
+}
+
+/**
+ * (Re-)build index used for matching breakpoints: list of breakpoints
+ * that need to be checked on every instruction, and PC address hash
+ * for the ones that need to be checked only at given address.
+ */
+static void BreakCond_BuildIndex(bc_breakpoints_t *bps)
+{
+	bc_breakpoint_t *bp;
+	int i, pcs, slots;
+	uint32_t pc, slot;
+
+	bps->reindex = false;
+	free(bps->scan);
+	free(bps->slots);
+	free(bps->pcnext);
+	bps->scan = NULL;
+	bps->slots = NULL;
+	bps->pcnext = NULL;
+	bps->scancount = 0;
+	bps->slotbits = 0;
+	if (!bps->count) {
+		return;
+	}
+
+	bps->scan = malloc(bps->count * sizeof(*bps->scan));
+	bps->pcnext = malloc(bps->count * sizeof(*bps->pcnext));
+	assert(bps->scan && bps->pcnext);
+
+	pcs = 0;
+	bp = bps->breakpoint;
+	for (i = 0; i < bps->count; bp++, i++) {
+		if (bp->watch_access) {
+			/* checked only on memory access */
+			continue;
+		}
+		if (BreakCond_IsPcBreakPoint(bp)) {
+			pcs++;
+		} else {
+			bps->scan[bps->scancount++] = i;
+		}
+	}
+	if (!pcs) {
+		return;
+	}
+
+	/* at most half full hash table */
+	for (bps->slotbits = 4; (1 << bps->slotbits) < 2 * pcs; bps->slotbits++)
+		;
+	slots = 1 << bps->slotbits;
+	bps->slots = malloc(slots * sizeof(*bps->slots));
+	assert(bps->slots);
+	for (i = 0; i < slots; i++) {
+		bps->slots[i].first = -1;
+	}
+
+	/* add in reverse order so that chains are in index order */
+	for (i = bps->count - 1; i >= 0; i--) {
+		bp = bps->breakpoint + i;
+		if (!BreakCond_IsPcBreakPoint(bp)) {
+			continue;
+		}
+		pc = bp->conditions[0].rconst;
+		slot = BreakCond_PcSlot(bps, pc);
+		while (bps->slots[slot].first >= 0 && bps->slots[slot].pc != pc) {
+			slot = (slot + 1) & (slots - 1);
+		}
+		bps->pcnext[i] = bps->slots[slot].first;
+		bps->slots[slot].first = i;
+		bps->slots[slot].pc = pc;
+	}
+}
+
+/**
+ * Return index of first breakpoint for given PC address in PC hash, or -1
+ */
+static int BreakCond_FindPc(const bc_breakpoints_t *bps, uint32_t pc)
+{
+	uint32_t slot, slotmask;
+
+	if (!bps->slots) {
+		return -1;
+	}
+	slotmask = (1 << bps->slotbits) - 1;
+	slot = BreakCond_PcSlot(bps, pc);
+	while (bps->slots[slot].first >= 0) {
+		if (bps->slots[slot].pc == pc) {
+			return bps->slots[slot].first;
+		}
+		slot = (slot + 1) & slotmask;
+	}
+	return -1;
+}
+
+
+/**
+ * Do actions for given breakpoint (at given index) which conditions
+ * matched, set 'changes' if breakpoints may have changed.
+ * @return	true if (non-tracing) breakpoint was hit, false otherwise
+ */
+static bool BreakCond_DoHit(bc_breakpoints_t *bps, bc_breakpoint_t *bp, int i, bool *changes)
+{
+	bp->hits++;
+	if (bp->options.skip) {
+		if (bp->hits % bp->options.skip) {
+			/* check next */
+			return false;
+		}
+	}
+	if (!bp->options.quiet) {
+		fprintf(stderr, "%d. %s breakpoint condition(s) matched %d times.\n",
+			i+1, bps->name, bp->hits);
+		BreakCond_Print(bp);
+	}
+	History_Mark(bps->reason);
+
+	if (bp->options.info || bp->options.lock || bp->options.filename) {
+		bool reinit = !bp->options.noinit;
+
+		if (reinit) {
+			DebugCpu_InitSession();
+			DebugDsp_InitSession();
+		}
+		if (bp->options.info) {
+			bp->options.info(stderr, 0);
+		}
+		if (bp->options.lock) {
+			DebugInfo_ShowSessionInfo();
+		}
+		if (bp->options.filename) {
+			bool verbose = !bp->options.quiet;
+			DebugUI_ParseFile(bp->options.filename, reinit, verbose);
+			*changes = true;
+		}
+	}
+	if (bp->options.once) {
+		BreakCond_Remove(bps, i+1);
+		*changes = true;
+	}
+	return !bp->options.trace;
+}
+
+
+/**
+ * Check and show which breakpoints' conditions matched.
+ * With 'dryrun', breakpoint actions (hit counting, output etc)
+ * are skipped and only the match result is returned.
  * @return	true if (non-tracing) breakpoint was hit,
  *		or false if none matched
  */
-static bool BreakCond_MatchBreakPoints(bc_breakpoints_t *bps)
+static bool BreakCond_MatchBreakPoints(bc_breakpoints_t *bps, bool dryrun)
 {
-	bc_breakpoint_t *bp;
+	bc_breakpoint_t *bp, *breakpoints;
 	bool changes = false;
 	bool hit = false;
-	int i;
+	int i, next, pcidx, scanidx, scancount;
+	const int *scan, *pcnext;
+
+	if (unlikely(bps->reindex)) {
+		BreakCond_BuildIndex(bps);
+	}
 
 	/* array should not be changed while it's being traversed */
 	assert(likely(!bps->delayed_change));
 	bps->delayed_change = true;
 
-	bp = bps->breakpoint;
-	for (i = 0; i < bps->count; bp++, i++) {
+	/* (delayed) changes get indexed only on next call */
+	breakpoints = bps->breakpoint;
+	scan = bps->scan;
+	scancount = bps->scancount;
+	pcnext = bps->pcnext;
+
+	/* merge PC hash chain for current PC with scanned breakpoints,
+	 * so that breakpoints get checked in their index order
+	 */
+	pcidx = BreakCond_FindPc(bps, bps->get_pc());
+	scanidx = 0;
+	for (;;) {
+		next = (scanidx < scancount) ? scan[scanidx] : -1;
+		if (pcidx >= 0 && (next < 0 || pcidx < next)) {
+			i = pcidx;
+			pcidx = pcnext[pcidx];
+		} else if (next >= 0) {
+			i = next;
+			scanidx++;
+		} else {
+			break;
+		}
+		bp = breakpoints + i;
 
 		if (BreakCond_MatchConditions(bp->conditions, bp->ccount)) {
-			bp->hits++;
-			if (bp->options.skip) {
-				if (bp->hits % bp->options.skip) {
-					/* check next */
-					continue;
-				}
+			if (dryrun) {
+				hit |= !bp->options.trace;
+				continue;
 			}
-			if (!bp->options.quiet) {
-				fprintf(stderr, "%d. %s breakpoint condition(s) matched %d times.\n",
-					i+1, bps->name, bp->hits);
-				BreakCond_Print(bp);
+			/* continue checking breakpoints to make sure all relevant actions get performed */
+			if (BreakCond_DoHit(bps, bp, i, &changes)) {
+				hit = true;
 			}
-			History_Mark(bps->reason);
+		}
+	}
+	bps->delayed_change = false;
+	if (unlikely(changes)) {
+		BreakCond_DoDelayedActions(bps);
+	}
+	return hit;
+}
 
-			if (bp->options.info || bp->options.lock || bp->options.filename) {
-				bool reinit = !bp->options.noinit;
 
-				if (reinit) {
-					DebugCpu_InitSession();
-					DebugDsp_InitSession();
-				}
-				if (bp->options.info) {
-					bp->options.info(stderr, 0);
-				}
-				if (bp->options.lock) {
-					DebugInfo_ShowSessionInfo();
-				}
-				if (bp->options.filename) {
-					bool verbose = !bp->options.quiet;
-					DebugUI_ParseFile(bp->options.filename, reinit, verbose);
-					changes = true;
-				}
-			}
-			if (bp->options.once) {
-				BreakCond_Remove(bps, i+1);
-				changes = true;
-			}
-			if (!bp->options.trace) {
-				/* index for current hit, they start from 1 */
-				hit = true;
+/**
+ * Re-register CPU watchpoint address ranges, with their
+ * breakpoint indexes, for memory access checks
+ */
+static void BreakCond_UpdateWatches(bc_breakpoints_t *bps)
+{
+	bc_breakpoint_t *bp;
+	int i;
+
+	MemWatch_Reset();
+	bps->watchcount = 0;
+	bp = bps->breakpoint;
+	for (i = 0; i < bps->count; bp++, i++) {
+		if (!bp->watch_access) {
+			continue;
+		}
+		if (!MemWatch_Add(bp->watch_start, bp->watch_end, bp->watch_access, i)) {
+			fprintf(stderr, "ERROR: failed to set watch for %s breakpoint %d!\n",
+				bps->name, i+1);
+		}
+		bps->watchcount++;
+	}
+}
+
+/**
+ * Show information about given watchpoint hit
+ */
+static void BreakCond_ShowWatchHit(const memwatch_hit_t *hit)
+{
+	static const char *accessors[] = { "CPU", "Blitter", "DMA", "Emulator" };
+
+	fprintf(stderr, "  %s %s %s $%x",
+		accessors[hit->accessor],
+		hit->access == MEMWATCH_WRITE ? "wrote" : "read",
+		hit->size == 4 ? "long" : (hit->size == 2 ? "word" : "byte"),
+		hit->addr);
+	if (hit->access == MEMWATCH_WRITE) {
+		fprintf(stderr, " = $%x", hit->value);
+	}
+	if (hit->accessor == MEMWATCH_BY_CPU) {
+		fprintf(stderr, " (instruction at $%x)", hit->pc);
+	}
+	fprintf(stderr, "\n");
+}
+
+/**
+ * Check which CPU watchpoints memory accesses have hit since previous
+ * call, and whether their (optional) conditions match.
+ * With 'dryrun', only the match result is returned.
+ * @return	true if (non-tracing) watchpoint was hit, false otherwise
+ */
+static bool BreakCond_MatchWatchPoints(bc_breakpoints_t *bps, bool dryrun)
+{
+	const memwatch_hit_t *hits;
+	bc_breakpoint_t *bp, *breakpoints;
+	bool changes = false;
+	bool hit = false;
+	int i, j, count;
+
+	count = MemWatch_GetHits(&hits);
+
+	assert(likely(!bps->delayed_change));
+	bps->delayed_change = true;
+	breakpoints = bps->breakpoint;
+
+	for (i = 0; i < count; i++) {
+		/* handle each watchpoint only once per instruction */
+		for (j = 0; j < i; j++) {
+			if (hits[j].id == hits[i].id) {
+				break;
 			}
-			/* continue checking breakpoints to make sure all relevant actions get performed */
+		}
+		if (j < i || hits[i].id >= bps->count) {
+			continue;
+		}
+		bp = breakpoints + hits[i].id;
+		if (!BreakCond_MatchConditions(bp->conditions, bp->ccount)) {
+			continue;
+		}
+		if (dryrun) {
+			hit |= !bp->options.trace;
+			continue;
+		}
+		if (!bp->options.quiet) {
+			BreakCond_ShowWatchHit(hits + i);
+		}
+		if (BreakCond_DoHit(bps, bp, hits[i].id, &changes)) {
+			hit = true;
 		}
 	}
 	bps->delayed_change = false;
@@ -380,7 +817,32 @@ static bool BreakCond_MatchBreakPoints(bc_breakpoints_t *bps)
  */
 bool BreakCond_MatchCpu(void)
 {
-	return BreakCond_MatchBreakPoints(&CpuBreakPoints);
+	return BreakCond_MatchBreakPoints(&CpuBreakPoints, false);
+}
+
+/**
+ * Return true if there were CPU watchpoint hits, false otherwise.
+ */
+bool BreakCond_MatchCpuWatch(void)
+{
+	return BreakCond_MatchWatchPoints(&CpuBreakPoints, false);
+}
+
+/**
+ * Return true if CPU breakpoint or watchpoint would be hit, without
+ * doing any breakpoint actions.  For replaying execution.
+ */
+bool BreakCond_CheckCpu(void)
+{
+	bool hit = false;
+
+	if (MemWatch_HitCount) {
+		hit = BreakCond_MatchWatchPoints(&CpuBreakPoints, true);
+	}
+	if (CpuBreakPoints.count > CpuBreakPoints.watchcount) {
+		hit |= BreakCond_MatchBreakPoints(&CpuBreakPoints, true);
+	}
+	return hit;
 }
 
 /**
@@ -388,7 +850,7 @@ bool BreakCond_MatchCpu(void)
  */
 bool BreakCond_MatchDsp(void)
 {
-	return BreakCond_MatchBreakPoints(&DspBreakPoints);
+	return BreakCond_MatchBreakPoints(&DspBreakPoints, false);
 }
 
 /**
@@ -399,6 +861,14 @@ int BreakCond_CpuBreakPointCount(void)
 	return CpuBreakPoints.count;
 }
 
+/**
+ * Return number of CPU watchpoints (included in above count)
+ */
+int BreakCond_CpuWatchPointCount(void)
+{
+	return CpuBreakPoints.watchcount;
+}
+
 /**
  * Return number of DSP condition breakpoints
  */
@@ -504,6 +974,13 @@ static uint32_t GetCpuSR(void)
 {
 	return M68000_GetSR();
 }
+/**
+ * Helper function to get DSP PC register value as uint32_t
+ */
+static uint32_t GetDspPC(void)
+{
+	return DSP_GetPC();
+}
 
 /**
  * If given string is register name (for DSP or CPU), set bc_value
@@ -527,6 +1004,7 @@ static bool BreakCond_ParseRegister(const char *regname, bc_value_t *bc_value)
 			/* all DSP memory values are 24-bits */
 			bc_value->bits = 24;
 			bc_value->valuetype = regsize;
+			bc_value->is_pc = (strcasecmp(regname, "PC") == 0);
 			EXITFUNC(("-> true (DSP)\n"));
 			return true;
 		}
@@ -548,6 +1026,7 @@ static bool BreakCond_ParseRegister(const char *regname, bc_value_t *bc_value)
 		bc_value->bits = 32;
 		bc_value->value.func32 = GetCpuPC;
 		bc_value->valuetype = VALUE_TYPE_FUNCTION32;
+		bc_value->is_pc = true;
 		EXITFUNC(("-> true (CPU)\n"));
 		return true;
 	}
@@ -1170,6 +1649,84 @@ static void BreakCond_CheckTracking(bc_breakpoint_t *bp)
 }
 
 
+/**
+ * Parse watchpoint specification at start of given string:
+ *	watch <address>[-<end address>] [r|w|rw] [&& <conditions>]
+ * and set 'bp' watch fields accordingly.  Set 'conditions' to
+ * the conditions part of the string (empty if there are none).
+ * Return normalized watchpoint string or NULL on error.
+ */
+static char *BreakCond_ParseWatch(const char *str, bc_breakpoint_t *bp, const char **conditions)
+{
+	char *copy, *range, *access, *extra, *normalized;
+	const char *end;
+	uint32_t lower, upper;
+	int ret;
+
+	end = strstr(str, "&&");
+	if (end) {
+		*conditions = end + 2;
+		while (isspace((unsigned char)**conditions)) {
+			(*conditions)++;
+		}
+		if (!**conditions) {
+			fprintf(stderr, "ERROR: conditions missing after '&&'!\n");
+			return NULL;
+		}
+	} else {
+		end = str + strlen(str);
+		*conditions = end;
+	}
+	copy = strndup(str, end - str);
+	assert(copy);
+
+	range = strtok(copy, " \t");
+	access = strtok(NULL, " \t");
+	extra = strtok(NULL, " \t");
+	if (!range || extra) {
+		fprintf(stderr, "ERROR: watchpoint needs an address (range) and optional access type!\n");
+		free(copy);
+		return NULL;
+	}
+	ret = Eval_Range(range, &lower, &upper, false);
+	if (ret < 0) {
+		free(copy);
+		return NULL;
+	}
+	if (ret == 0) {
+		/* single address watches a byte */
+		upper = lower + 1;
+	}
+	if (upper <= lower) {
+		fprintf(stderr, "ERROR: empty watchpoint address range!\n");
+		free(copy);
+		return NULL;
+	}
+
+	if (!access || strcmp(access, "w") == 0) {
+		bp->watch_access = MEMWATCH_WRITE;
+	} else if (strcmp(access, "r") == 0) {
+		bp->watch_access = MEMWATCH_READ;
+	} else if (strcmp(access, "rw") == 0 || strcmp(access, "wr") == 0) {
+		bp->watch_access = MEMWATCH_READ | MEMWATCH_WRITE;
+	} else {
+		fprintf(stderr, "ERROR: invalid watchpoint access type '%s' (not r/w/rw)!\n", access);
+		free(copy);
+		return NULL;
+	}
+	free(copy);
+
+	bp->watch_start = lower;
+	bp->watch_end = upper;
+	normalized = malloc(40);
+	assert(normalized);
+	snprintf(normalized, 40, "watch $%x-$%x %s%s", lower, upper,
+		 bp->watch_access & MEMWATCH_READ ? "r" : "",
+		 bp->watch_access & MEMWATCH_WRITE ? "w" : "");
+	return normalized;
+}
+
+
 /**
  * Parse given breakpoint expression and store it.
  * Return true for success and false for failure.
@@ -1179,39 +1736,73 @@ static bool BreakCond_Parse(const char *expression, bc_options_t *options, bool
 	parser_state_t pstate;
 	bc_breakpoints_t *bps;
 	bc_breakpoint_t *bp;
-	char *normalized;
-	int ccount;
+	char *normalized, *watch = NULL;
+	int i, ccount;
+	bool ok;
 
 	bps = BreakCond_GetListInfo(bForDsp);
 
 	bp = bps->breakpoint + bps->count;
 	memset(bp, 0, sizeof(bc_breakpoint_t));
 
-	normalized = BreakCond_TokenizeExpression(expression, &pstate);
-	if (normalized) {
-		bp->expression = normalized;
-		ccount = BreakCond_ParseCondition(&pstate, bForDsp, bp, 0);
-		/* fail? */
-		if (!ccount) {
-			bp->expression = NULL;
-			if (bp->conditions) {
-				/* free what was allocated by ParseCondition */
-				free(bp->conditions);
-				bp->conditions = NULL;
-			}
+	if (strncmp(expression, "watch", 5) == 0 &&
+	    (!expression[5] || isspace((unsigned char)expression[5]))) {
+		if (bForDsp) {
+			fprintf(stderr, "ERROR: watchpoints are supported only for CPU!\n");
+			return false;
+		}
+		watch = BreakCond_ParseWatch(expression + 5, bp, &expression);
+		if (!watch) {
+			return false;
 		}
-		bp->ccount = ccount;
+	}
+
+	memset(&pstate, 0, sizeof(pstate));
+	if (watch && !*expression) {
+		/* watchpoint without conditions */
+		bp->expression = watch;
+		normalized = NULL;
+		ccount = 0;
+		ok = true;
 	} else {
+		normalized = BreakCond_TokenizeExpression(expression, &pstate);
 		ccount = 0;
+		if (normalized) {
+			bp->expression = normalized;
+			ccount = BreakCond_ParseCondition(&pstate, bForDsp, bp, 0);
+			/* fail? */
+			if (!ccount) {
+				bp->expression = NULL;
+				if (bp->conditions) {
+					/* free what was allocated by ParseCondition */
+					free(bp->conditions);
+					bp->conditions = NULL;
+				}
+			}
+			bp->ccount = ccount;
+		}
+		ok = (ccount > 0);
+		if (ok && watch) {
+			/* watchpoint with conditions */
+			bp->expression = malloc(strlen(watch) + strlen(normalized) + 5);
+			assert(bp->expression);
+			sprintf(bp->expression, "%s && %s", watch, normalized);
+			free(normalized);
+			free(watch);
+		} else if (watch) {
+			free(watch);
+			bp->watch_access = 0;
+		}
 	}
 	if (pstate.argv) {
 		free(pstate.argv);
 	}
-	if (ccount > 0) {
+	if (ok) {
 		bps->count++;
 		if (!options->quiet) {
-			fprintf(stderr, "%s condition breakpoint %d with %d condition(s) added:\n\t%s\n",
-				bps->name, bps->count, ccount, bp->expression);
+			fprintf(stderr, "%s condition %s %d with %d condition(s) added:\n\t%s\n",
+				bps->name, bp->watch_access ? "watchpoint" : "breakpoint",
+				bps->count, ccount, bp->expression);
 			if (options->skip) {
 				fprintf(stderr, "-> Break only on every %d hit.\n", options->skip);
 			}
@@ -1236,6 +1827,13 @@ static bool BreakCond_Parse(const char *expression, bc_options_t *options, bool
 			}
 		}
 		BreakCond_CheckTracking(bp);
+		for (i = 0; i < ccount; i++) {
+			BreakCond_Compile(&(bp->conditions[i]));
+		}
+		bps->reindex = true;
+		if (bp->watch_access) {
+			BreakCond_UpdateWatches(bps);
+		}
 
 		bp->options.quiet = options->quiet;
 		bp->options.skip = options->skip;
@@ -1271,7 +1869,7 @@ static bool BreakCond_Parse(const char *expression, bc_options_t *options, bool
 				expression, pstate.arg+2, '^', pstate.error);
 		}
 	}
-	return (ccount > 0);
+	return ok;
 }
 
 
@@ -1369,6 +1967,10 @@ static bool BreakCond_Remove(bc_breakpoints_t *bps, int position)
 		memmove(bp, bp + 1, (bps->count - position) * sizeof(bc_breakpoint_t));
 	}
 	bps->count--;
+	bps->reindex = true;
+	if (bps->watchcount) {
+		BreakCond_UpdateWatches(bps);
+	}
 	return true;
 }
 
@@ -1459,6 +2061,18 @@ static const char BreakCond_Help[] =
 "       ($ffff9202).w ! ($ffff9202).w :trace\n"
 "  	(r0).x = 1 && (r0).y = 2\n"
 "\n"
+"  Watchpoint = watch <address>[-<end address>] [r|w|rw]\n"
+"\n"
+"  Watchpoint (CPU only) is checked only when given memory range\n"
+"  (single address = byte) is read (r), written (w, default) or\n"
+"  either (rw) by CPU or blitter, instead of after every instruction.\n"
+"  It can be followed by conditions ('&&' ...), which are then checked\n"
+"  after the accessing instruction.  End address is exclusive.\n"
+"\n"
+"  Examples:\n"
+"  	watch $4ce-$4d2 w\n"
+"  	watch $426-$42a rw && ($426).l = $31415926 :once\n"
+"\n"
 "  For breakpoint options, see 'help b'.\n";
 
 
@@ -1631,6 +2245,39 @@ const char BreakAddr_Description[] =
 	"\tUse conditional breakpoint commands to manage the created\n"
 	"\tbreakpoints.";
 
+const char BreakWatch_Description[] =
+	"<address>[-<end address>] [r|w|rw] [:<option>]\n"
+	"\tCreate conditional breakpoint for CPU memory accesses to given\n"
+	"\taddress range.  End address is exclusive, and single address\n"
+	"\tis watched as byte. Break on reads (r), writes (w, default)\n"
+	"\tor both (rw).  Watchpoints are checked only on memory access,\n"
+	"\tso they do not slow down emulation like polled conditions.\n"
+	"\n"
+	"\tBreakpoint action options are same as for 'address' command,\n"
+	"\tand conditional breakpoint commands are used to manage them.";
+
+/**
+ * Set CPU memory access watchpoint by converting it to a (watch)
+ * conditional breakpoint.
+ * Return true for success and false for failure.
+ */
+bool BreakWatch_Command(const char *args)
+{
+	char *command;
+	bool ret;
+
+	if (!args) {
+		DebugUI_PrintCmdHelp("watch");
+		return true;
+	}
+	command = malloc(strlen(args) + 7);
+	assert(command);
+	sprintf(command, "watch %s", args);
+	ret = BreakCond_Command(command, false);
+	free(command);
+	return ret;
+}
+
 /**
  * Set CPU & DSP program counter address breakpoints by converting
  * them to conditional breakpoints.
@@ -14,13 +14,18 @@ extern bool BreakCond_Save(const char *filename);
 /* for debugcpu.c & debugdsp.c */
 extern const char BreakCond_Description[];
 extern const char BreakAddr_Description[];
+extern const char BreakWatch_Description[];
 
 extern bool BreakCond_MatchCpu(void);
+extern bool BreakCond_MatchCpuWatch(void);
+extern bool BreakCond_CheckCpu(void);
 extern bool BreakCond_MatchDsp(void);
 extern int BreakCond_CpuBreakPointCount(void);
+extern int BreakCond_CpuWatchPointCount(void);
 extern int BreakCond_DspBreakPointCount(void);
 extern bool BreakCond_Command(const char *expression, bool bForDsp);
 extern bool BreakAddr_Command(char *expression, bool bforDsp);
+extern bool BreakWatch_Command(const char *expression);
 
 /* extra functions exported for the test code */
 extern int BreakCond_MatchCpuExpression(int position, const char *expression);
@@ -15,10 +15,13 @@ const char DebugInfo_fileid[] = "Hatari debuginfo.c";
 
 #include "main.h"
 #include "acia.h"
+#include "audio.h"
 #include "bios.h"
 #include "blitter.h"
 #include "configuration.h"
 #include "crossbar.h"
+#include "cycles.h"
+#include "cycInt.h"
 #include "debugInfo.h"
 #include "debugcpu.h"
 #include "debugdsp.h"
@@ -653,11 +656,13 @@ static const struct {
 } infotable[] = {
 	{ false,"acia",      ACIA_Info,            NULL, "Show ACIA register contents" },
 	{ false,"aes",       AES_Info,             NULL, "Show AES vector contents (with <value>, show opcodes)" },
+	{ false,"audio",     Audio_Info,           NULL, "Show audio ring buffer state and under/overrun counts" },
 	{ false,"basepage",  DebugInfo_Basepage,   NULL, "Show program basepage contents at given <address>" },
 	{ false,"bios",      Bios_Info,            NULL, "Show BIOS opcodes" },
 	{ false,"blitter",   Blitter_Info,         NULL, "Show Blitter register contents" },
 	{ false,"cookiejar", DebugInfo_Cookiejar,  NULL, "Show TOS Cookiejar contents" },
 	{ false,"crossbar",  Crossbar_Info,        NULL, "Show Falcon Crossbar register contents" },
+	{ false,"cycint",    CycInt_Info, CycInt_InfoArgs, "Show pending interrupts & handler statistics, or turn statistics <on|off>" },
 	{ true, "default",   DebugInfo_Default,    NULL, "Show default debugger entry information" },
 	{ true, "disasm",    DebugInfo_CpuDisAsm,  NULL, "Disasm CPU from PC or given <address>" },
 	{ false,"dmasnd",    DmaSnd_Info,          NULL, "Show Sound DMA / LMC register contents" },
@@ -689,7 +694,7 @@ static const struct {
 	{ false,"ym",        PSG_Info,             NULL, "Show YM-2149 register contents" },
 };
 
-static int LockedFunction = 7; /* index for the "default" function */
+static int LockedFunction = 9; /* index for the "default" function */
 static uint32_t LockedArgument;
 
 /**
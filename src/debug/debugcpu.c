@@ -26,8 +26,11 @@ const char DebugCpu_fileid[] = "Hatari debugcpu.c";
 #include "history.h"
 #include "log.h"
 #include "m68000.h"
+#include "memfind.h"
 #include "memorySnapShot.h"
+#include "memwatch.h"
 #include "profile.h"
+#include "rewind.h"
 #include "stMemory.h"
 #include "str.h"
 #include "symbols.h"
@@ -440,6 +443,15 @@ static int DebugCpu_BreakCond(int nArgc, char *psArgs[])
 	return DEBUGGER_CMDDONE;
 }
 
+/**
+ * CPU wrapper for BreakWatch_Command().
+ */
+static int DebugCpu_BreakWatch(int nArgc, char *psArgs[])
+{
+	BreakWatch_Command(psArgs[1]);
+	return DEBUGGER_CMDDONE;
+}
+
 /**
  * CPU wrapper for Profile_Command().
  */
@@ -1144,21 +1156,19 @@ static int DebugCpu_MemFind(int nArgc, char *psArgs[])
 	const int rows = DebugUI_GetPageLines(ConfigureParams.Debugger.nFindLines, 20);
 	const int count = nArgc - arg;
 	const int bytes = count*size;
+	uint8_t mask[sizeof(store.bytes)];
+	memfind_pattern_t pattern;
+
+	memset(mask, 0xff, bytes);
+	pattern.mask = mask;
+	pattern.value = store.bytes;
+	pattern.len = bytes;
+	pattern.align = size;
 
 	int row = 0, matches = 0;
-	while (find_addr < find_upper - bytes)
+	uint32_t next;
+	while (MemFind_Search(&pattern, find_addr, find_upper, &find_addr, 1, &next))
 	{
-		for (i = 0; i < bytes; i++)
-		{
-			if (STMemory_ReadByte(find_addr+i) != store.bytes[i])
-				break;
-		}
-		if (i < bytes)
-		{
-			find_addr += size;
-			continue;
-		}
-
 		/* print <addr>: <hex> <chars> */
 		fprintf(debugOutput, "%08X: ", find_addr);
 		print_mem_values(find_addr, count, size, 16);
@@ -1380,6 +1390,24 @@ uint32_t DebugCpu_InstrCount(void)
  */
 void DebugCpu_Check(void)
 {
+	if (RewindReplaying)
+	{
+		Rewind_Replay();
+		return;
+	}
+	if (MemWatch_HitCount)
+	{
+		if (BreakCond_MatchCpuWatch())
+		{
+			DebugUI(REASON_CPU_BREAKPOINT);
+			if (nCpuSteps)
+				nCpuSteps++;
+		}
+		/* watchpoint hits enable debugger checks only
+		 * for the instruction that accessed memory
+		 */
+		M68000_RestoreDebugger();
+	}
 	nCpuInstructions++;
 	if (bCpuProfiling)
 	{
@@ -1441,10 +1469,11 @@ void DebugCpu_Check(void)
 void DebugCpu_SetDebugging(void)
 {
 	bCpuProfiling = Profile_CpuStart();
-	nCpuActiveCBs = BreakCond_CpuBreakPointCount();
+	/* watchpoints are checked on memory access, not per instruction */
+	nCpuActiveCBs = BreakCond_CpuBreakPointCount() - BreakCond_CpuWatchPointCount();
 
 	if (nCpuActiveCBs || nCpuSteps || bCpuProfiling || History_TrackCpu()
-	    || LOG_TRACE_LEVEL((TRACE_CPU_DISASM|TRACE_CPU_SYMBOLS|TRACE_CPU_REGS))
+	    || RewindReplaying || LOG_TRACE_LEVEL((TRACE_CPU_DISASM|TRACE_CPU_SYMBOLS|TRACE_CPU_REGS))
 	    || ConOutDevices)
 	{
 		M68000_SetDebugger(true);
@@ -1469,6 +1498,11 @@ static const dbgcommand_t cpucommands[] =
 	  "set/remove/list conditional CPU breakpoints",
 	  BreakCond_Description,
 	  true },
+	{ DebugCpu_BreakWatch, Symbols_MatchCpuDataAddress,
+	  "watch", "",
+	  "set CPU memory access watchpoints",
+	  BreakWatch_Description,
+	  true },
 	{ DebugCpu_DisAsm, Symbols_MatchCpuCodeAddress,
 	  "disasm", "d",
 	  "disassemble from PC, or given address",
@@ -1489,6 +1523,11 @@ static const dbgcommand_t cpucommands[] =
 	  "profile CPU code",
 	  Profile_Description,
 	  false },
+	{ Rewind_Command, Rewind_Match,
+	  "rewind", "",
+	  "step CPU execution backwards",
+	  Rewind_Description,
+	  false },
 	{ DebugCpu_Register, DebugCpu_MatchRegister,
 	  "cpureg", "r",
 	  "dump register values or set register to value",
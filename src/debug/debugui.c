@@ -33,6 +33,7 @@ const char DebugUI_fileid[] = "Hatari debugui.c";
 #include "options.h"
 #include "reset.h"
 #include "screen.h"
+#include "screenConvert.h"
 #include "statusbar.h"
 #include "str.h"
 
@@ -1000,10 +1001,14 @@ static const dbgcommand_t uicommand[] =
 	{ History_Parse, History_Match,
 	  "history", "hi",
 	  "show last CPU and/or DSP PC values + instructions",
-	  "cpu|dsp|on|off|<count> [limit]|save <file>\n"
+	  "cpu|dsp|on|off [limit] [regs] [writes]|<count>|save <file>|dump <file>\n"
 	  "\t'cpu' and 'dsp' enable program counter history tracking for given\n"
 	  "\tprocessor, 'on' tracks them both, 'off' will disable history.\n"
 	  "\tOptional 'limit' will set how many past addresses are tracked.\n"
+	  "\tWith CPU-only history, 'regs' and 'writes' additionally trace\n"
+	  "\tregister changes and memory writes done by the instructions.\n"
+	  "\t'save' saves history as text, 'dump' in binary trace format\n"
+	  "\t(documented in history.c), with opcodes and cycle counts.\n"
 	  "\tGiving just count will show (at max) given number of last saved PC\n"
 	  "\tvalues and instructions currently at corresponding RAM addresses.",
 	  false },
@@ -1265,6 +1270,7 @@ void DebugUI(debug_reason_t reason)
 		* on how to continue in case he invoked the debugger by accident.
 		*/
 		Statusbar_AddMessage("Console Debugger", 100);
+		ScreenConv_Sync(true);
 		Statusbar_Update(sdlscrn, true);
 
 		cmdret = DEBUGGER_CMDDONE;
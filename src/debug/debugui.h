@@ -38,6 +38,7 @@ extern void DebugUI(debug_reason_t reason);
 extern void DebugUI_Exceptions(int nr, long pc);
 extern bool DebugUI_ParseLine(const char *input);
 extern bool DebugUI_AddParseFile(const char *input);
+extern bool DebugUI_ParseFile(const char *path, bool reinit, bool verbose);
 extern void DebugUI_MemorySnapShot_Capture(const char *path, bool bSave);
 extern void DebugUI_Trigger(void);
 
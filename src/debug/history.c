@@ -7,6 +7,14 @@
  * or at your option any later version. Read the file gpl.txt for details.
  *
  * history.c - functions for debugger entry & breakpoint history
+ *
+ * Besides PC, each history item records the instruction opcode and
+ * cycle counter value when instruction was reached.  For CPU, register
+ * changes and memory writes done by the instructions can additionally
+ * be traced into a separate ring-buffer of "extra" data words.
+ *
+ * Whole history can be dumped in a binary trace format (see below),
+ * to a file or for remote debugger.
  */
 const char History_fileid[] = "Hatari history.c";
 
@@ -22,22 +30,35 @@ const char History_fileid[] = "Hatari history.c";
 #include "file.h"
 #include "history.h"
 #include "m68000.h"
+#include "memwatch.h"
+#include "stMemory.h"
 #include "68kDisass.h"
 
 #define HISTORY_ITEMS_MIN 64
 
+/* extra data ring-buffer size in words per history item */
+#define HISTORY_EXTRA_PER_ITEM 4
+
+/* extra data record types, in the top byte of record header word */
+#define EXTRA_REGS	1	/* changed registers mask + their values */
+#define EXTRA_WRITE	2	/* memory write size + address & value */
+#define EXTRA_TYPE(word) ((word) >> 24)
+
+/* D0-D7, A0-A7 + SR */
+#define EXTRA_REG_COUNT	17
+
 history_type_t HistoryTracking;
 
+/* 16 bytes, so that 4 items fit into a cache line */
 typedef struct {
+	uint64_t cycles;   /* cycle counter when instruction was reached */
+	uint32_t pc;
+	uint32_t opcode:24;
 	bool shown:1;
 	bool valid:1;
 	bool for_dsp:1;
 	/* reason for debugger entry/breakpoint hit */
-	debug_reason_t reason:8;
-	union {
-		uint16_t dsp;
-		uint32_t cpu;
-	} pc;
+	debug_reason_t reason:4;
 } hist_item_t;
 
 static struct {
@@ -45,7 +66,14 @@ static struct {
 	unsigned count;    /* how many items of history are collected */
 	unsigned limit;    /* ring-buffer size */
 	unsigned repeats;  /* repeats for the last instruction */
+	unsigned flags;    /* HISTORY_TRACE_* extra data being traced */
 	hist_item_t *item; /* ring-buffer */
+	/* extra data, allocated only when traced */
+	uint32_t *extra_start;  /* extra_pos value for each item when it was added */
+	uint32_t *extra;        /* ring-buffer */
+	uint32_t extra_mask;    /* ring-buffer size - 1 */
+	uint32_t extra_pos;     /* how many extra words have been written */
+	uint32_t regs[EXTRA_REG_COUNT]; /* register values for delta */
 } History;
 
 
@@ -75,22 +103,91 @@ static const char* History_ReasonStr(debug_reason_t reason)
 }
 
 
+/**
+ * Read current CPU register values for register delta tracing
+ */
+static void History_GetRegs(uint32_t *values)
+{
+	int i;
+	for (i = 0; i < 16; i++) {
+		values[i] = regs.regs[i];
+	}
+	values[16] = M68000_GetSR();
+}
+
+/**
+ * Allocate extra data buffers for given number of history items.
+ * Return false on failure.
+ */
+static bool History_AllocExtra(unsigned limit)
+{
+	uint32_t size = 1;
+
+	while (size < limit * HISTORY_EXTRA_PER_ITEM) {
+		size <<= 1;
+	}
+	History.extra_start = calloc(limit, sizeof(History.extra_start[0]));
+	History.extra = malloc(size * sizeof(History.extra[0]));
+	if (!(History.extra_start && History.extra)) {
+		free(History.extra_start);
+		free(History.extra);
+		History.extra_start = History.extra = NULL;
+		return false;
+	}
+	History.extra_mask = size - 1;
+	History_GetRegs(History.regs);
+	return true;
+}
+
+/**
+ * Add word to extra data ring-buffer
+ */
+static inline void History_PutExtra(uint32_t value)
+{
+	History.extra[History.extra_pos++ & History.extra_mask] = value;
+}
+
+/**
+ * Memory write logging callback
+ */
+static void History_LogWrite(uint32_t addr, int size, uint32_t value)
+{
+	History_PutExtra(EXTRA_WRITE << 24 | size);
+	History_PutExtra(addr);
+	History_PutExtra(value);
+}
+
 /**
  * Set what kind of history is collected.
  * Clear history if tracking type changes as rest of
  * data wouldn't then be anymore valid.
  */
-static void History_Enable(history_type_t track, unsigned limit)
+static void History_Enable(history_type_t track, unsigned limit, unsigned flags)
 {
 	const char *msg;
-	if (track != HistoryTracking || limit != History.limit) {
+
+	if (flags && track != HISTORY_TRACK_CPU) {
+		fprintf(stderr, "Register & memory write tracing is supported only for CPU-only history.\n");
+		flags = 0;
+	}
+	if (track != HistoryTracking || limit != History.limit || flags != History.flags) {
 		fprintf(stderr, "Re-allocating & zeroing history due to type/limit change.\n");
 		if (History.item) {
 			free(History.item);
 		}
+		free(History.extra_start);
+		free(History.extra);
 		memset(&History, 0, sizeof(History));
 		History.item = calloc(limit, sizeof(History.item[0]));
 		History.limit = limit;
+		if (flags && !History_AllocExtra(limit)) {
+			fprintf(stderr, "ERROR: history extra data allocation failed.\n");
+			flags = 0;
+		}
+		History.flags = flags;
+	}
+	if (!MemWatch_SetWriteLog(flags & HISTORY_TRACE_WRITES ? History_LogWrite : NULL)) {
+		fprintf(stderr, "ERROR: memory write tracing setup failed.\n");
 	}
 	switch (track) {
 	case HISTORY_TRACK_NONE:
@@ -109,22 +206,60 @@ static void History_Enable(history_type_t track, unsigned limit)
 		msg = "error";
 	}
 	HistoryTracking = track;
-	fprintf(stderr, "History tracking %s (max. %d instructions).\n", msg, limit);
+	fprintf(stderr, "History tracking %s (max. %d instructions%s%s).\n", msg, limit,
+		flags & HISTORY_TRACE_REGS ? ", registers" : "",
+		flags & HISTORY_TRACE_WRITES ? ", memory writes" : "");
 }
 
 /**
  * Advance & initialize next history item in ring buffer
  */
-static void History_Advance(void)
+static void History_Advance(bool for_dsp, uint32_t pc, uint32_t opcode)
 {
+	hist_item_t *item;
+
 	History.idx++;
 	History.idx %= History.limit;
-	History.item[History.idx].valid = true;
-	History.item[History.idx].shown = false;
-	History.item[History.idx].reason = REASON_NONE;
+	item = &History.item[History.idx];
+	item->cycles = CyclesGlobalClockCounter;
+	item->pc = pc;
+	item->opcode = opcode;
+	item->valid = true;
+	item->shown = false;
+	item->for_dsp = for_dsp;
+	item->reason = REASON_NONE;
+	if (History.extra_start) {
+		History.extra_start[History.idx] = History.extra_pos;
+	}
 	History.count++;
 }
 
+/**
+ * Add record of registers changed by previous instruction
+ * to extra data
+ */
+static void History_AddRegs(void)
+{
+	uint32_t values[EXTRA_REG_COUNT], mask = 0;
+	int i, count = 0;
+
+	History_GetRegs(values);
+	for (i = 0; i < EXTRA_REG_COUNT; i++) {
+		if (values[i] != History.regs[i]) {
+			History.regs[i] = values[i];
+			values[count++] = values[i];
+			mask |= 1 << i;
+		}
+	}
+	if (!mask) {
+		return;
+	}
+	History_PutExtra(EXTRA_REGS << 24 | mask);
+	for (i = 0; i < count; i++) {
+		History_PutExtra(values[i]);
+	}
+}
+
 /**
  * Add CPU PC to history
  */
@@ -134,16 +269,17 @@ void History_AddCpu(void)
 	//if (pc < 0x12000 || pc > 0x70000)
 	//	return;
 
-	if (pc == History.item[History.idx].pc.cpu) {
+	if (History.flags & HISTORY_TRACE_REGS) {
+		History_AddRegs();
+	}
+	if (pc == History.item[History.idx].pc) {
 		History.repeats++;
 		return;
 	} else {
 		History.repeats = 0;
 	}
 
-	History_Advance();
-	History.item[History.idx].for_dsp = false;
-	History.item[History.idx].pc.cpu = pc;
+	History_Advance(false, pc, STMemory_ReadWord(pc));
 }
 
 /**
@@ -152,17 +288,16 @@ void History_AddCpu(void)
 void History_AddDsp(void)
 {
 	uint16_t pc = DSP_GetPC();
+	const char *dummy;
 
-	if (pc == History.item[History.idx].pc.dsp) {
+	if (pc == History.item[History.idx].pc) {
 		History.repeats++;
 		return;
 	} else {
 		History.repeats = 0;
 	}
 
-	History_Advance();
-	History.item[History.idx].for_dsp = true;
-	History.item[History.idx].pc.dsp = pc;
+	History_Advance(true, pc, DSP_ReadMemory(pc, 'P', &dummy));
 }
 
 /**
@@ -212,11 +347,7 @@ uint32_t History_DisasmAddr(uint32_t pc, uint32_t offset, bool for_dsp)
 		if (History.item[i].for_dsp != for_dsp) {
 			continue;
 		}
-		if (for_dsp) {
-			pc = History.item[i].pc.dsp;
-		} else {
-			pc = History.item[i].pc.cpu;
-		}
+		pc = History.item[i].pc;
 		if (pc >= limit && pc < first) {
 			first = pc;
 		}
@@ -224,6 +355,70 @@ uint32_t History_DisasmAddr(uint32_t pc, uint32_t offset, bool for_dsp)
 	return first;
 }
 
+/**
+ * Set 'start' to extra data position for given history item
+ * and return number of its extra data words.  Zero is returned
+ * also when they're already overwritten by newer data.
+ */
+static uint32_t History_GetExtra(unsigned i, uint32_t *start)
+{
+	uint32_t end;
+
+	if (!History.extra_start) {
+		return 0;
+	}
+	*start = History.extra_start[i];
+	if (i == History.idx) {
+		end = History.extra_pos;
+	} else {
+		end = History.extra_start[(i + 1) % History.limit];
+	}
+	if (History.extra_pos - *start > History.extra_mask + 1) {
+		return 0;
+	}
+	return end - *start;
+}
+
+/**
+ * Output register changes & memory writes for given history item
+ */
+static void History_OutputExtra(unsigned i, FILE *fp)
+{
+	static const char *names[EXTRA_REG_COUNT] = {
+		"D0", "D1", "D2", "D3", "D4", "D5", "D6", "D7",
+		"A0", "A1", "A2", "A3", "A4", "A5", "A6", "A7", "SR"
+	};
+	uint32_t pos, count, word, mask;
+	int r;
+
+	count = History_GetExtra(i, &pos);
+	while (count > 0) {
+		word = History.extra[pos++ & History.extra_mask];
+		count--;
+		if (EXTRA_TYPE(word) == EXTRA_WRITE && count >= 2) {
+			uint32_t addr = History.extra[pos++ & History.extra_mask];
+			uint32_t value = History.extra[pos++ & History.extra_mask];
+			count -= 2;
+			fprintf(fp, "\t-> write.%c $%06x = $%x\n",
+				(word & 0xff) == 4 ? 'l' : ((word & 0xff) == 2 ? 'w' : 'b'),
+				addr, value);
+			continue;
+		}
+		if (EXTRA_TYPE(word) != EXTRA_REGS) {
+			break;
+		}
+		fputs("\t->", fp);
+		mask = word & 0xffffff;
+		for (r = 0; r < EXTRA_REG_COUNT && count > 0; r++) {
+			if (mask & (1 << r)) {
+				fprintf(fp, " %s=$%x", names[r], History.extra[pos++ & History.extra_mask]);
+				count--;
+			}
+		}
+		fputc('\n', fp);
+	}
+}
+
 /**
  * Output collected CPU/DSP debugger/breakpoint history
  */
@@ -267,11 +462,12 @@ static uint32_t History_Output(uint32_t count, FILE *fp)
 		History.item[i].shown = true;
 
 		if (History.item[i].for_dsp) {
-			uint16_t pc = History.item[i].pc.dsp;
+			uint16_t pc = History.item[i].pc;
 			DSP_DisasmAddress(fp, pc, pc);
 		} else {
 			uint32_t dummy;
-			Disasm(fp, History.item[i].pc.cpu, &dummy, 1);
+			Disasm(fp, History.item[i].pc, &dummy, 1);
+			History_OutputExtra(i, fp);
 		}
 		if (History.item[i].reason != REASON_NONE) {
 			fprintf(fp, "Debugger: *%s*\n", History_ReasonStr(History.item[i].reason));
@@ -309,12 +505,177 @@ static void History_Save(const char *name)
 	}
 }
 
+
+/* ------------------ binary trace dump ----------------- */
+
+/* Trace format (multi-byte values are big-endian):
+ *   0: "HTRC" magic
+ *   4: format version
+ *   5: HISTORY_TRACE_* flags for traced extra data
+ *   6: number of items (4 bytes)
+ *  10: repeat count for the last item (4 bytes)
+ *  14: items, oldest first
+ *
+ * Each item has:
+ *   0: PC (4 bytes)
+ *   4: flags byte; bit 7 set for DSP, bits 0-3 debugger entry reason
+ *   5: opcode (3 bytes), first instruction word for CPU
+ *   8: cycle counter value when instruction was reached (8 bytes)
+ *  16: number of extra data words (2 bytes), zero if they
+ *      are already overwritten or there were too many of them
+ *  18: extra data words (4 bytes each)
+ *
+ * Extra data has records for changes done by the instruction.
+ * Record type is in the top byte of its first word:
+ * - 1: registers, bits 0-16 of the word are mask of changed
+ *      D0-D7, A0-A7 & SR registers, followed by their new values
+ * - 2: memory write, low byte of the word is write size,
+ *      followed by address & written value
+ */
+#define TRACE_VERSION		1
+#define TRACE_HEADER_SIZE	14
+#define TRACE_ITEM_SIZE		18
+
+static void dump_put_be16(uint8_t *p, uint16_t value)
+{
+	p[0] = value >> 8;
+	p[1] = value;
+}
+
+static void dump_put_be32(uint8_t *p, uint32_t value)
+{
+	p[0] = value >> 24;
+	p[1] = value >> 16;
+	p[2] = value >> 8;
+	p[3] = value;
+}
+
+/**
+ * Return number of valid history items
+ */
+static uint32_t History_ItemCount(void)
+{
+	if (!History.item) {
+		return 0;
+	}
+	return History.count < History.limit ? History.count : History.limit;
+}
+
+/**
+ * Dump 'count' history items starting from 'first' one (0 = oldest)
+ * into (possibly reused) buffer, in above binary format.
+ * Return false on allocation failure.
+ */
+bool History_Dump(history_dump_t *dump, uint32_t first, uint32_t count)
+{
+	uint32_t items, extra, pos, size, i, idx;
+	uint8_t *data, *p;
+
+	items = History_ItemCount();
+	if (first > items) {
+		first = items;
+	}
+	if (!count || count > items - first) {
+		count = items - first;
+	}
+	/* calculate size needed for the dump */
+	size = TRACE_HEADER_SIZE + count * TRACE_ITEM_SIZE;
+	idx = History.idx + History.limit - items + 1 + first;
+	for (i = 0; i < count; i++) {
+		extra = History_GetExtra((idx + i) % History.limit, &pos);
+		if (extra <= 0xffff) {
+			size += 4 * extra;
+		}
+	}
+	if (size > dump->alloc) {
+		data = realloc(dump->data, size);
+		if (!data) {
+			perror("ERROR, history dump buffer alloc failed");
+			return false;
+		}
+		dump->data = data;
+		dump->alloc = size;
+	}
+	p = dump->data;
+	memcpy(p, "HTRC", 4);
+	p[4] = TRACE_VERSION;
+	p[5] = History.flags;
+	dump_put_be32(p + 6, count);
+	dump_put_be32(p + 10, History.repeats);
+	p += TRACE_HEADER_SIZE;
+
+	for (i = 0; i < count; i++) {
+		unsigned n = (idx + i) % History.limit;
+		const hist_item_t *item = &History.item[n];
+
+		assert(item->valid);
+		dump_put_be32(p, item->pc);
+		dump_put_be32(p + 4, (item->for_dsp ? 0x80u : 0) << 24 |
+			      (uint32_t)item->reason << 24 | item->opcode);
+		dump_put_be32(p + 8, item->cycles >> 32);
+		dump_put_be32(p + 12, item->cycles);
+		extra = History_GetExtra(n, &pos);
+		if (extra > 0xffff) {
+			/* too many repeats for same item */
+			extra = 0;
+		}
+		dump_put_be16(p + 16, extra);
+		p += TRACE_ITEM_SIZE;
+		while (extra-- > 0) {
+			dump_put_be32(p, History.extra[pos++ & History.extra_mask]);
+			p += 4;
+		}
+	}
+	dump->size = size;
+	dump->entries = count;
+	return true;
+}
+
+/**
+ * Free dump buffer
+ */
+void History_DumpFree(history_dump_t *dump)
+{
+	free(dump->data);
+	memset(dump, 0, sizeof(*dump));
+}
+
+/*
+ * save all history to given file in binary trace format
+ */
+static void History_SaveBinary(const char *name)
+{
+	history_dump_t dump;
+	FILE *fp;
+
+	if (File_Exists(name)) {
+		fprintf(stderr, "ERROR: file '%s' already exists!\n", name);
+		return;
+	}
+	memset(&dump, 0, sizeof(dump));
+	if (!History_Dump(&dump, 0, 0)) {
+		return;
+	}
+	if ((fp = fopen(name, "wb"))) {
+		if (fwrite(dump.data, dump.size, 1, fp) == 1) {
+			fprintf(stderr, "%d history items (%d bytes) dumped to '%s'.\n",
+				dump.entries, dump.size, name);
+		} else {
+			fprintf(stderr, "ERROR: writing '%s' failed (%d).\n", name, errno);
+		}
+		fclose(fp);
+	} else {
+		fprintf(stderr, "ERROR: opening '%s' failed (%d).\n", name, errno);
+	}
+	History_DumpFree(&dump);
+}
+
 /*
  * Readline callback
  */
 char *History_Match(const char *text, int state)
 {
-	static const char* cmds[] = { "cpu", "dsp", "off", "save" };
+	static const char* cmds[] = { "cpu", "dsp", "dump", "off", "on", "save" };
 	return DebugUI_MatchHelper(cmds, ARRAY_SIZE(cmds), text, state);
 }
 
@@ -323,13 +684,20 @@ char *History_Match(const char *text, int state)
  */
 int History_Parse(int nArgc, char *psArgs[])
 {
-	int count, limit = 0;
+	int i, count, limit = 0;
+	unsigned flags = 0;
 
 	if (nArgc < 2) {
 		return DebugUI_PrintCmdHelp(psArgs[0]);
 	}
-	if (nArgc > 2) {
-		limit = atoi(psArgs[2]);
+	for (i = 2; i < nArgc; i++) {
+		if (strcmp(psArgs[i], "regs") == 0) {
+			flags |= HISTORY_TRACE_REGS;
+		} else if (strcmp(psArgs[i], "writes") == 0) {
+			flags |= HISTORY_TRACE_WRITES;
+		} else if (i == 2) {
+			limit = atoi(psArgs[i]);
+		}
 	}
 	/* make sure value is valid & positive */
 	if (!limit) {
@@ -343,25 +711,29 @@ int History_Parse(int nArgc, char *psArgs[])
 	if (count <= 0) {
 		/* no count -> enable or disable? */
 		if (strcmp(psArgs[1], "on") == 0) {
-			History_Enable(HISTORY_TRACK_ALL, limit);
+			History_Enable(HISTORY_TRACK_ALL, limit, flags);
 			return DEBUGGER_CMDDONE;
 		}
 		if (strcmp(psArgs[1], "off") == 0) {
-			History_Enable(HISTORY_TRACK_NONE, limit);
+			History_Enable(HISTORY_TRACK_NONE, limit, flags);
 			return DEBUGGER_CMDDONE;
 		}
 		if (strcmp(psArgs[1], "cpu") == 0) {
-			History_Enable(HISTORY_TRACK_CPU, limit);
+			History_Enable(HISTORY_TRACK_CPU, limit, flags);
 			return DEBUGGER_CMDDONE;
 		}
 		if (strcmp(psArgs[1], "dsp") == 0) {
-			History_Enable(HISTORY_TRACK_DSP, limit);
+			History_Enable(HISTORY_TRACK_DSP, limit, flags);
 			return DEBUGGER_CMDDONE;
 		}
 		if (nArgc == 3 && strcmp(psArgs[1], "save") == 0) {
 			History_Save(psArgs[2]);
 			return DEBUGGER_CMDDONE;
 		}
+		if (nArgc == 3 && strcmp(psArgs[1], "dump") == 0) {
+			History_SaveBinary(psArgs[2]);
+			return DEBUGGER_CMDDONE;
+		}
 		fprintf(stderr,  "History range is 1-<limit>\n");
 		return DebugUI_PrintCmdHelp(psArgs[0]);
 	}
@@ -370,9 +742,9 @@ int History_Parse(int nArgc, char *psArgs[])
 	return DEBUGGER_CMDDONE;
 }
 
-void History_Set(history_type_t track, unsigned limit)
+void History_Set(history_type_t track, unsigned limit, unsigned flags)
 {
-	History_Enable(track, limit);
+	History_Enable(track, limit, flags);
 }
 
 unsigned int History_GetCount()
@@ -392,9 +764,6 @@ void History_Get(unsigned int offset, history_entry_rdb* pEntry)
 		return;
 	pEntry->valid = true;
 	pEntry->for_dsp = History.item[i].for_dsp;
-	if (pEntry->for_dsp)
-		pEntry->pc = History.item[i].pc.dsp;
-	else
-		pEntry->pc = History.item[i].pc.cpu;
+	pEntry->pc = History.item[i].pc;
 }
 
@@ -18,6 +18,10 @@ typedef enum {
 
 extern history_type_t HistoryTracking;
 
+/* extra CPU data traced for history items */
+#define HISTORY_TRACE_REGS	0x01	/* register changes */
+#define HISTORY_TRACE_WRITES	0x02	/* memory writes */
+
 static inline bool History_TrackCpu(void)
 {
 	return HistoryTracking & HISTORY_TRACK_CPU;
@@ -47,9 +51,20 @@ typedef struct {
 	uint32_t pc;		// Either DSP or CPU
 } history_entry_rdb;
 
-extern void History_Set(history_type_t track, unsigned limit);
+extern void History_Set(history_type_t track, unsigned limit, unsigned flags);
 extern unsigned int History_GetCount(void);
 extern void History_Get(unsigned int offset, history_entry_rdb* pEntry);
 
+/* Binary trace dump, see history.c for the format */
+typedef struct {
+	uint8_t *data;
+	uint32_t size;
+	uint32_t alloc;
+	uint32_t entries;
+} history_dump_t;
+
+extern bool History_Dump(history_dump_t *dump, uint32_t first, uint32_t count);
+extern void History_DumpFree(history_dump_t *dump);
+
 
 #endif
@@ -0,0 +1,181 @@
+/*
+ * Hatari - memfind.c
+ *
+ * This file is distributed under the GNU General Public License, version 2
+ * or at your option any later version. Read the file gpl.txt for details.
+ *
+ * memfind.c - masked byte pattern search in emulated memory, shared by
+ * the debugger "find" command and the remote debugger "memfind" command.
+ *
+ * Plain RAM (ST-RAM & TT-RAM) is searched directly from host memory,
+ * using memchr() on the most selective pattern byte to skip quickly
+ * over non-matching areas.  Everything else (ROM, cartridge, IO),
+ * and candidates spanning RAM area end, go through STMemory_ReadByte().
+ */
+const char MemFind_fileid[] = "Hatari memfind.c";
+
+#include <string.h>
+#include "main.h"
+#include "stMemory.h"
+#include "debug_priv.h"
+#include "memfind.h"
+
+
+/**
+ * Return host pointer for given emulated RAM address and set 'blockend'
+ * to the end of that contiguous host memory area, or return NULL
+ * if address is not in a plain RAM area.
+ */
+static const uint8_t *MemFind_HostBlock(uint32_t addr, uint32_t *blockend)
+{
+	if (addr < STRamEnd)
+	{
+		*blockend = STRamEnd;
+		return STRam + addr;
+	}
+	if (TTmemory && addr >= TTRAM_START && addr - TTRAM_START < TTmem_size)
+	{
+		*blockend = TTRAM_START + TTmem_size;
+		return TTmemory + (addr - TTRAM_START);
+	}
+	return NULL;
+}
+
+/**
+ * Return true if pattern matches at given host memory pointer
+ */
+static bool MemFind_MatchHost(const memfind_pattern_t *pattern, const uint8_t *mem)
+{
+	uint32_t i;
+	for (i = 0; i < pattern->len; i++)
+	{
+		if ((mem[i] & pattern->mask[i]) != pattern->value[i])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Return true if pattern matches at given emulated memory address
+ */
+static bool MemFind_MatchSlow(const memfind_pattern_t *pattern, uint32_t addr)
+{
+	uint32_t i;
+	for (i = 0; i < pattern->len; i++)
+	{
+		uint8_t mem = STMemory_ReadByte(addr + i);
+		if ((mem & pattern->mask[i]) != pattern->value[i])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Return index of pattern byte best suited for memchr() scanning,
+ * i.e. first byte which needs to match exactly, preferably non-zero
+ * (zero bytes are common in memory).  Return -1 if there's none.
+ */
+static int MemFind_Anchor(const memfind_pattern_t *pattern)
+{
+	int anchor = -1;
+	uint32_t i;
+
+	for (i = 0; i < pattern->len; i++)
+	{
+		if (pattern->mask[i] != 0xff)
+			continue;
+		if (pattern->value[i])
+			return i;
+		if (anchor < 0)
+			anchor = i;
+	}
+	return anchor;
+}
+
+/**
+ * Search [start, end) memory range for 'pattern' matches, which need
+ * to be fully within the range.  Candidate addresses step by pattern
+ * alignment from 'start', i.e. alignment is relative to the search
+ * start, not absolute.  Store at most 'maxhits' match addresses to
+ * 'hits' and set 'next' to the address from which search should be
+ * continued to find further matches (== 'end' when whole range was
+ * searched).
+ *
+ * Return number of stored hits.
+ */
+int MemFind_Search(const memfind_pattern_t *pattern,
+		   uint32_t start, uint32_t end,
+		   uint32_t *hits, int maxhits, uint32_t *next)
+{
+	uint32_t align, addr, last, blockend, n, i;
+	const uint8_t *mem, *found;
+	int anchor, count = 0;
+
+	*next = end;
+	align = pattern->align ? pattern->align : 1;
+	if (!pattern->len || maxhits <= 0 || end < start ||
+	    end - start < pattern->len)
+		return 0;
+
+	anchor = MemFind_Anchor(pattern);
+	last = end - pattern->len;
+	addr = start;
+
+	while (addr <= last && count < maxhits)
+	{
+		mem = MemFind_HostBlock(addr, &blockend);
+		if (!mem || blockend - addr < pattern->len)
+		{
+			/* not (fully) in RAM, check just this address */
+			if (MemFind_MatchSlow(pattern, addr))
+				hits[count++] = addr;
+			addr += align;
+			if (addr < start)
+				break;	/* wrapped */
+			continue;
+		}
+
+		/* number of candidate addresses fully within host block */
+		n = blockend - pattern->len - addr + 1;
+		if (n > last - addr + 1)
+			n = last - addr + 1;
+
+		if (anchor >= 0)
+		{
+			i = 0;
+			while (i < n && count < maxhits)
+			{
+				found = memchr(mem + i + anchor, pattern->value[anchor], n - i);
+				if (!found)
+				{
+					i = n;
+					break;
+				}
+				i = found - mem - anchor;
+				if (!((addr + i - start) & (align - 1)) &&
+				    MemFind_MatchHost(pattern, mem + i))
+					hits[count++] = addr + i;
+				i++;
+			}
+		}
+		else
+		{
+			for (i = 0; i < n && count < maxhits; i += align)
+			{
+				if (MemFind_MatchHost(pattern, mem + i))
+					hits[count++] = addr + i;
+			}
+		}
+		if (count >= maxhits)
+			break;
+
+		addr += n;
+		addr += (start - addr) & (align - 1);
+		if (addr < start)
+			break;	/* wrapped */
+	}
+
+	if (count >= maxhits)
+		*next = hits[count - 1] + align;
+	return count;
+}
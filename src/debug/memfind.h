@@ -0,0 +1,24 @@
+/*
+  Hatari - memfind.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_MEMFIND_H
+#define HATARI_MEMFIND_H
+
+/* search pattern: memory byte matches when (mem & mask[i]) == value[i] */
+typedef struct {
+	const uint8_t *mask;
+	const uint8_t *value;
+	uint32_t len;		/* pattern length in bytes */
+	uint32_t align;		/* match address step from search start (power of 2) */
+} memfind_pattern_t;
+
+/* for debugcpu.c & remotedebug.c */
+extern int MemFind_Search(const memfind_pattern_t *pattern,
+			  uint32_t start, uint32_t end,
+			  uint32_t *hits, int maxhits, uint32_t *next);
+
+#endif
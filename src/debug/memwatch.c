@@ -0,0 +1,224 @@
+/*
+ * Hatari - memwatch.c
+ *
+ * This file is distributed under the GNU General Public License, version 2
+ * or at your option any later version. Read the file gpl.txt for details.
+ *
+ * memwatch.c - memory access watchpoints for the debugger.
+ *
+ * Watched address ranges are marked in per access type page bitmaps,
+ * which CPU core memory bank access functions check (only) when
+ * a bitmap exists.  Exact range check is done only for accesses to
+ * the marked pages.  Matching accesses are recorded and CPU core is
+ * asked to call debugger after the accessing instruction, where
+ * breakcond.c handles the hits, so there's no per-instruction
+ * polling for watchpoints.
+ *
+ * Write log callback can be set to get all CPU writes, in which case
+ * all pages are marked in the write bitmap.
+ */
+const char MemWatch_fileid[] = "Hatari memwatch.c";
+
+#include <stdlib.h>
+#include <string.h>
+#include "main.h"
+#include "m68000.h"
+#include "hatari-glue.h"
+#include "memwatch.h"
+
+#define MEMWATCH_MAP_SIZE	((1u << (32 - MEMWATCH_PAGE_SHIFT)) / 8)
+#define MEMWATCH_MAX_HITS	16
+
+typedef struct {
+	uint32_t start, end;	/* [start, end) */
+	int access;
+	int id;
+} memwatch_range_t;
+
+uint8_t *MemWatch_ReadMap;
+uint8_t *MemWatch_WriteMap;
+uint32_t MemWatch_AddrMask = 0xffffffff;
+int MemWatch_HitCount;
+int MemWatch_Accessor = MEMWATCH_BY_CPU;
+
+static memwatch_range_t *Ranges;
+static int RangeCount, RangesAllocated;
+
+static memwatch_hit_t Hits[MEMWATCH_MAX_HITS];
+
+static memwatch_log_t WriteLog;
+
+
+/**
+ * (Re-)create write bitmap for all pages when write log is enabled.
+ * Return false if allocation failed.
+ */
+static bool MemWatch_InitWriteMap(void)
+{
+	free(MemWatch_WriteMap);
+	MemWatch_WriteMap = NULL;
+	if (!WriteLog)
+		return true;
+	MemWatch_WriteMap = malloc(MEMWATCH_MAP_SIZE);
+	if (!MemWatch_WriteMap)
+		return false;
+	memset(MemWatch_WriteMap, 0xff, MEMWATCH_MAP_SIZE);
+	return true;
+}
+
+/**
+ * Remove all watched ranges and pending hits
+ */
+void MemWatch_Reset(void)
+{
+	free(MemWatch_ReadMap);
+	MemWatch_ReadMap = NULL;
+	MemWatch_InitWriteMap();
+	free(Ranges);
+	Ranges = NULL;
+	RangeCount = RangesAllocated = 0;
+	MemWatch_HitCount = 0;
+}
+
+/**
+ * Mark pages for [start, end) range to given bitmap, allocate it if needed.
+ * Return false if allocation failed.
+ */
+static bool MemWatch_MarkPages(uint8_t **map, uint32_t start, uint32_t end)
+{
+	uint32_t page, last;
+
+	if (!*map) {
+		*map = calloc(1, MEMWATCH_MAP_SIZE);
+		if (!*map)
+			return false;
+	}
+	last = (end - 1) >> MEMWATCH_PAGE_SHIFT;
+	for (page = start >> MEMWATCH_PAGE_SHIFT; page <= last; page++)
+		(*map)[page >> 3] |= 1 << (page & 7);
+	return true;
+}
+
+/**
+ * Add watch for given access type(s) to [start, end) address range.
+ * 'id' is given back in the hits for that range.
+ * Return false for error.
+ */
+bool MemWatch_Add(uint32_t start, uint32_t end, int access, int id)
+{
+	memwatch_range_t *range;
+
+	if (end <= start || !(access & (MEMWATCH_READ|MEMWATCH_WRITE)))
+		return false;
+
+	/* CPU core gives addresses with 24-bit address space mirrors as-is */
+	MemWatch_AddrMask = currprefs.address_space_24 ? 0xffffff : 0xffffffff;
+
+	if (RangeCount >= RangesAllocated) {
+		int count = RangesAllocated ? 2 * RangesAllocated : 8;
+		range = realloc(Ranges, count * sizeof(*range));
+		if (!range)
+			return false;
+		Ranges = range;
+		RangesAllocated = count;
+	}
+	if ((access & MEMWATCH_READ) && !MemWatch_MarkPages(&MemWatch_ReadMap, start, end))
+		return false;
+	if ((access & MEMWATCH_WRITE) && !WriteLog &&
+	    !MemWatch_MarkPages(&MemWatch_WriteMap, start, end))
+		return false;
+
+	range = Ranges + RangeCount++;
+	range->start = start;
+	range->end = end;
+	range->access = access;
+	range->id = id;
+	return true;
+}
+
+/**
+ * Called on access to a watched page, record the hit if access
+ * overlaps a watched range and ask CPU core to call debugger
+ * after current instruction.
+ */
+void MemWatch_Hit(uint32_t addr, int size, uint32_t value, int access)
+{
+	memwatch_hit_t *hit;
+	int i, accessor;
+
+	/* debugger's own accesses don't trigger watchpoints */
+	if (BusMode == BUS_MODE_DEBUGGER)
+		return;
+
+	if (BusMode == BUS_MODE_BLITTER)
+		accessor = MEMWATCH_BY_BLITTER;
+	else
+		accessor = MemWatch_Accessor;
+
+	addr &= MemWatch_AddrMask;
+	if (WriteLog && access == MEMWATCH_WRITE && accessor == MEMWATCH_BY_CPU)
+		WriteLog(addr, size, value);
+	for (i = 0; i < RangeCount; i++) {
+		const memwatch_range_t *range = Ranges + i;
+
+		if (!(range->access & access) ||
+		    addr >= range->end || addr + size <= range->start)
+			continue;
+
+		/* rest of the hits within same instruction are just counted */
+		if (MemWatch_HitCount < MEMWATCH_MAX_HITS) {
+			hit = Hits + MemWatch_HitCount;
+			hit->id = range->id;
+			hit->addr = addr;
+			hit->value = value;
+			hit->pc = M68000_InstrPC;
+			hit->size = size;
+			hit->access = access;
+			hit->accessor = accessor;
+		}
+		MemWatch_HitCount++;
+		M68000_SetSpecial(SPCFLAG_DEBUGGER);
+	}
+}
+
+/**
+ * Set 'hits' to recorded hits and return their count.
+ * Clears the hit count.
+ */
+int MemWatch_GetHits(const memwatch_hit_t **hits)
+{
+	int count = MemWatch_HitCount;
+
+	if (count > MEMWATCH_MAX_HITS)
+		count = MEMWATCH_MAX_HITS;
+	MemWatch_HitCount = 0;
+	*hits = Hits;
+	return count;
+}
+
+/**
+ * Set callback for logging all CPU writes, or disable it with NULL.
+ * Return false if write bitmap allocation failed.
+ */
+bool MemWatch_SetWriteLog(memwatch_log_t func)
+{
+	int i;
+
+	if (func == WriteLog)
+		return true;
+	WriteLog = func;
+	if (!MemWatch_InitWriteMap()) {
+		WriteLog = NULL;
+		return false;
+	}
+	if (WriteLog)
+		return true;
+
+	/* back to marking only watched pages */
+	for (i = 0; i < RangeCount; i++) {
+		if ((Ranges[i].access & MEMWATCH_WRITE) &&
+		    !MemWatch_MarkPages(&MemWatch_WriteMap, Ranges[i].start, Ranges[i].end))
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,76 @@
+/*
+  Hatari - memwatch.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_MEMWATCH_H
+#define HATARI_MEMWATCH_H
+
+/* watched access types */
+#define MEMWATCH_READ	1
+#define MEMWATCH_WRITE	2
+
+/* accessor doing the watched memory access */
+#define MEMWATCH_BY_CPU		0
+#define MEMWATCH_BY_BLITTER	1
+#define MEMWATCH_BY_DMA		2	/* DMA sound, crossbar... */
+#define MEMWATCH_BY_EMULATOR	3	/* Hatari itself, e.g. for GEMDOS HD */
+
+/* watch page bitmap granularity */
+#define MEMWATCH_PAGE_SHIFT 10
+
+/* watchpoint hit, recorded on memory access */
+typedef struct {
+	int id;		/* id given for the watched range */
+	uint32_t addr;	/* accessed address */
+	uint32_t value;	/* written value (zero for reads) */
+	uint32_t pc;	/* address of accessing CPU instruction */
+	int size;	/* access size in bytes */
+	int access;	/* MEMWATCH_READ or MEMWATCH_WRITE */
+	int accessor;	/* MEMWATCH_BY_* */
+} memwatch_hit_t;
+
+/* page bitmaps, NULL when there are no watchpoints of given type */
+extern uint8_t *MemWatch_ReadMap;
+extern uint8_t *MemWatch_WriteMap;
+extern uint32_t MemWatch_AddrMask;
+/* number of hits since last MemWatch_GetHits() call */
+extern int MemWatch_HitCount;
+/* set by non-CPU accessors for the duration of their accesses,
+ * MEMWATCH_BY_CPU otherwise (blitter is detected from BusMode) */
+extern int MemWatch_Accessor;
+
+extern void MemWatch_Hit(uint32_t addr, int size, uint32_t value, int access);
+
+static inline bool MemWatch_IsPage(const uint8_t *map, uint32_t addr)
+{
+	uint32_t page = (addr & MemWatch_AddrMask) >> MEMWATCH_PAGE_SHIFT;
+	return map[page >> 3] & (1 << (page & 7));
+}
+
+/* for cpu/memory.c bank access functions */
+static inline void MemWatch_CheckRead(uint32_t addr, int size)
+{
+	if (MemWatch_IsPage(MemWatch_ReadMap, addr) ||
+	    MemWatch_IsPage(MemWatch_ReadMap, addr + size - 1))
+		MemWatch_Hit(addr, size, 0, MEMWATCH_READ);
+}
+static inline void MemWatch_CheckWrite(uint32_t addr, int size, uint32_t value)
+{
+	if (MemWatch_IsPage(MemWatch_WriteMap, addr) ||
+	    MemWatch_IsPage(MemWatch_WriteMap, addr + size - 1))
+		MemWatch_Hit(addr, size, value, MEMWATCH_WRITE);
+}
+
+/* for breakcond.c */
+extern void MemWatch_Reset(void);
+extern bool MemWatch_Add(uint32_t start, uint32_t end, int access, int id);
+extern int MemWatch_GetHits(const memwatch_hit_t **hits);
+
+/* for history.c, NULL disables logging of CPU writes */
+typedef void (*memwatch_log_t)(uint32_t addr, int size, uint32_t value);
+extern bool MemWatch_SetWriteLog(memwatch_log_t func);
+
+#endif
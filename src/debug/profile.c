@@ -16,6 +16,10 @@ const char Profile_fileid[] = "Hatari profile.c";
 
 #include "config.h"
 
+#if HAVE_ZLIB_H
+# include <zlib.h>
+#endif
+
 #if HAVE_LIBREADLINE
 # include <readline/readline.h>
 #else
@@ -650,7 +654,7 @@ const char Profile_Description[] =
 	"\t- caches\n"
 	"\t- stack\n"
 	"\t- stats\n"
-	"\t- save <file>\n"
+	"\t- save [--binary] <file>\n"
 	"\t- loops <file> [CPU limit] [DSP limit]\n"
 	"\n"
 	"\t'on' & 'off' enable and disable profiling.  Data is collected\n"
@@ -674,7 +678,8 @@ const char Profile_Description[] =
 	"\tprofile stack (this is useful only with :noinit breakpoints).\n"
 	"\n"
 	"\tProfile address and callers information can be saved with\n"
-	"\t'save' command.\n"
+	"\t'save' command.  With '--binary', CPU profile address data is\n"
+	"\tsaved instead in compact binary format (see profile.c).\n"
 	"\n"
 	"\tDetailed (spin) looping information can be collected by\n"
 	"\tspecifying to which file it should be saved, with optional\n"
@@ -715,6 +720,184 @@ static bool Profile_Save(const char *fname, bool bForDsp)
 	return true;
 }
 
+
+/* ------------------ binary profile snapshots ----------------- */
+
+/* Snapshot format (multi-byte header values are big-endian):
+ *   0: "HPRF" magic
+ *   4: format version
+ *   5: PROFILE_SNAPSHOT_* flags
+ *   6: number of address entries (4 bytes)
+ *  10: uncompressed body size (4 bytes)
+ *  14: body, zlib compressed if PROFILE_SNAPSHOT_ZLIB flag is set
+ *
+ * Body has for each entry, in address order, the address difference
+ * to previous entry (starting from zero), execution count and cycles.
+ * These are stored as unsigned LEB128 variable length integers,
+ * 7 bits per byte, lowest bits first, top bit set when more follow.
+ *
+ * Header size & body offset fields match zlib data layout expected
+ * by Qt qUncompress(), for hrdb.
+ */
+#define SNAPSHOT_VERSION	1
+#define SNAPSHOT_HEADER_SIZE	14
+#define SNAPSHOT_COMPRESS_MIN	256
+
+static void snapshot_put_be32(uint8_t *p, uint32_t value)
+{
+	p[0] = value >> 24;
+	p[1] = value >> 16;
+	p[2] = value >> 8;
+	p[3] = value;
+}
+
+/**
+ * Make sure there's space for 'size' more bytes in the snapshot.
+ * Return false on allocation failure.
+ */
+static bool snapshot_reserve(profile_snapshot_t *snap, uint32_t size)
+{
+	uint32_t alloc;
+	uint8_t *data;
+
+	if (snap->size + size <= snap->alloc) {
+		return true;
+	}
+	alloc = snap->alloc ? 2 * snap->alloc : 4096;
+	while (alloc < snap->size + size) {
+		alloc *= 2;
+	}
+	data = realloc(snap->data, alloc);
+	if (!data) {
+		perror("ERROR, profile snapshot buffer alloc failed");
+		return false;
+	}
+	snap->data = data;
+	snap->alloc = alloc;
+	return true;
+}
+
+static void snapshot_put_varint(profile_snapshot_t *snap, uint32_t value)
+{
+	while (value >= 0x80) {
+		snap->data[snap->size++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	snap->data[snap->size++] = value;
+}
+
+/**
+ * Start new snapshot with given flags into (possibly reused) buffer
+ */
+bool Profile_SnapshotBegin(profile_snapshot_t *snap, uint8_t flags)
+{
+	snap->size = 0;
+	snap->entries = 0;
+	snap->lastaddr = 0;
+	if (!snapshot_reserve(snap, SNAPSHOT_HEADER_SIZE)) {
+		return false;
+	}
+	memcpy(snap->data, "HPRF", 4);
+	snap->data[4] = SNAPSHOT_VERSION;
+	snap->data[5] = flags;
+	snap->size = SNAPSHOT_HEADER_SIZE;
+	return true;
+}
+
+/**
+ * Add entry to snapshot, addresses need to be in increasing order
+ */
+bool Profile_SnapshotAdd(profile_snapshot_t *snap, uint32_t addr, uint32_t count, uint32_t cycles)
+{
+	/* 3 * max 5 bytes */
+	if (!snapshot_reserve(snap, 15)) {
+		return false;
+	}
+	assert(addr >= snap->lastaddr);
+	snapshot_put_varint(snap, addr - snap->lastaddr);
+	snapshot_put_varint(snap, count);
+	snapshot_put_varint(snap, cycles);
+	snap->lastaddr = addr;
+	snap->entries++;
+	return true;
+}
+
+/**
+ * Finish snapshot header, and compress the body when that's supported
+ * and worthwhile
+ */
+bool Profile_SnapshotEnd(profile_snapshot_t *snap)
+{
+	uint32_t body = snap->size - SNAPSHOT_HEADER_SIZE;
+
+	snapshot_put_be32(snap->data + 6, snap->entries);
+	snapshot_put_be32(snap->data + 10, body);
+#if HAVE_LIBZ
+	if (body >= SNAPSHOT_COMPRESS_MIN) {
+		uLongf packed = compressBound(body);
+		uint8_t *buf = malloc(SNAPSHOT_HEADER_SIZE + packed);
+		if (buf && compress2(buf + SNAPSHOT_HEADER_SIZE, &packed,
+				     snap->data + SNAPSHOT_HEADER_SIZE, body,
+				     Z_BEST_SPEED) == Z_OK && packed < body) {
+			memcpy(buf, snap->data, SNAPSHOT_HEADER_SIZE);
+			buf[5] |= PROFILE_SNAPSHOT_ZLIB;
+			free(snap->data);
+			snap->data = buf;
+			snap->size = SNAPSHOT_HEADER_SIZE + packed;
+			snap->alloc = SNAPSHOT_HEADER_SIZE + compressBound(body);
+			return true;
+		}
+		free(buf);
+	}
+#endif
+	return true;
+}
+
+/**
+ * Free snapshot buffer
+ */
+void Profile_SnapshotFree(profile_snapshot_t *snap)
+{
+	free(snap->data);
+	memset(snap, 0, sizeof(*snap));
+}
+
+/**
+ * Save CPU profile information as binary snapshot.
+ */
+static bool Profile_SaveBinary(const char *fname, bool bForDsp)
+{
+	profile_snapshot_t snap;
+	FILE *out;
+	bool ok;
+
+	if (bForDsp) {
+		fprintf(stderr, "ERROR: binary profile save is supported only for CPU.\n");
+		return false;
+	}
+	memset(&snap, 0, sizeof(snap));
+	if (!Profile_CpuSnapshot(&snap, false)) {
+		Profile_SnapshotFree(&snap);
+		return false;
+	}
+	if (!(out = fopen(fname, "wb"))) {
+		fprintf(stderr, "ERROR: opening '%s' for writing failed!\n", fname);
+		perror(NULL);
+		Profile_SnapshotFree(&snap);
+		return false;
+	}
+	ok = fwrite(snap.data, snap.size, 1, out) == 1;
+	fclose(out);
+	if (ok) {
+		fprintf(stderr, "Saved %d profile entries (%d bytes) to '%s'.\n",
+			snap.entries, snap.size, fname);
+	} else {
+		fprintf(stderr, "ERROR: writing '%s' failed!\n", fname);
+	}
+	Profile_SnapshotFree(&snap);
+	return ok;
+}
+
 /**
  * function CPU & DSP profiling functionality can call to
  * reset loop information log by truncating it.  Only portable
@@ -872,7 +1055,11 @@ int Profile_Command(int nArgc, char *psArgs[], bool bForDsp)
 		Profile_ShowStack(bForDsp);
 
 	} else if (strcmp(psArgs[1], "save") == 0) {
-		Profile_Save(psArgs[2], bForDsp);
+		if (nArgc > 3 && strcmp(psArgs[2], "--binary") == 0) {
+			Profile_SaveBinary(psArgs[3], bForDsp);
+		} else {
+			Profile_Save(psArgs[2], bForDsp);
+		}
 
 	} else if (strcmp(psArgs[1], "loops") == 0) {
 		Profile_Loops(nArgc, psArgs);
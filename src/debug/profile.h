@@ -61,6 +61,22 @@ typedef struct ProfileLine
 	uint32_t addr;	/* CPU address of this entry */
 } ProfileLine;
 extern bool Profile_CpuQuery(uint32_t index, ProfileLine* result);
+extern bool Profile_CpuQueryChanged(uint32_t *index, ProfileLine* result);
 extern bool Profile_CpuIsEnabled(void);
 
+/* Compact binary profile snapshot, see profile.c for the format */
+#define PROFILE_SNAPSHOT_DELTA	0x01	/* only changes since previous snapshot */
+#define PROFILE_SNAPSHOT_ZLIB	0x02	/* body is zlib compressed */
+
+typedef struct {
+	uint8_t *data;
+	uint32_t size;		/* bytes used */
+	uint32_t alloc;		/* bytes allocated */
+	uint32_t entries;	/* number of address entries */
+	uint32_t lastaddr;	/* previous entry address */
+} profile_snapshot_t;
+
+extern bool Profile_CpuSnapshot(profile_snapshot_t *snap, bool changed_only);
+extern void Profile_SnapshotFree(profile_snapshot_t *snap);
+
 #endif
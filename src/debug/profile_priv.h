@@ -80,6 +80,11 @@ extern int  Profile_AllocCallinfo(callinfo_t *callinfo, int count, const char *i
 extern void Profile_FreeCallinfo(callinfo_t *callinfo);
 extern bool Profile_LoopReset(void);
 
+/* binary snapshot helpers */
+extern bool Profile_SnapshotBegin(profile_snapshot_t *snap, uint8_t flags);
+extern bool Profile_SnapshotAdd(profile_snapshot_t *snap, uint32_t addr, uint32_t count, uint32_t cycles);
+extern bool Profile_SnapshotEnd(profile_snapshot_t *snap);
+
 /* parser helpers */
 extern void Profile_CpuGetPointers(bool **enabled, uint32_t **disasm_addr);
 extern void Profile_DspGetPointers(bool **enabled, uint32_t **disasm_addr);
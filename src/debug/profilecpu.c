@@ -101,6 +101,16 @@ static struct {
 	bool enabled;         /* true when profiling enabled */
 } cpu_profile;
 
+/* hrdb: counts already reported by Profile_CpuQueryChanged(),
+ * allocated on first use and freed together with profile data
+ */
+typedef struct {
+	uint32_t count;
+	uint32_t cycles;
+} cpu_profile_sent_t;
+
+static cpu_profile_sent_t *cpu_profile_sent;
+
 /* full counts for warnings that are printed without rate-limiting */
 typedef struct {
 	int odd;
@@ -861,6 +871,10 @@ void Profile_CpuFree(void)
 		free(cpu_profile.sort_arr);
 		cpu_profile.sort_arr = NULL;
 	}
+	if (cpu_profile_sent) {
+		free(cpu_profile_sent);
+		cpu_profile_sent = NULL;
+	}
 	if (cpu_profile.data) {
 		free(cpu_profile.data);
 		cpu_profile.data = NULL;
@@ -1513,6 +1527,80 @@ bool Profile_CpuQuery(uint32_t index, ProfileLine* result)
 	return true;
 }
 
+/**
+ * Find next profile item from given index onwards which has changed
+ * since it was last returned by this function (or since profiling
+ * started), return the change and advance the index past it.
+ * Return false when there are no more changes.
+ */
+bool Profile_CpuQueryChanged(uint32_t *index, ProfileLine* result)
+{
+	cpu_profile_item_t *data;
+	uint32_t i;
+
+	data = cpu_profile.data;
+	if (!data) {
+		return false;
+	}
+	if (!cpu_profile_sent) {
+		cpu_profile_sent = calloc(cpu_profile.size, sizeof(*cpu_profile_sent));
+		if (!cpu_profile_sent) {
+			perror("ERROR, CPU profile change buffer alloc failed");
+			return false;
+		}
+	}
+
+	for (i = *index; i < cpu_profile.size; i++) {
+		if (data[i].count == cpu_profile_sent[i].count &&
+		    data[i].cycles == cpu_profile_sent[i].cycles) {
+			continue;
+		}
+		result->count = data[i].count - cpu_profile_sent[i].count;
+		result->cycles = data[i].cycles - cpu_profile_sent[i].cycles;
+		result->addr = index2address(i);
+		cpu_profile_sent[i].count = data[i].count;
+		cpu_profile_sent[i].cycles = data[i].cycles;
+		*index = i + 1;
+		return true;
+	}
+	*index = i;
+	return false;
+}
+
+/**
+ * Store CPU profile data into a binary snapshot, either everything,
+ * or just the changes since previous Profile_CpuQueryChanged() calls.
+ */
+bool Profile_CpuSnapshot(profile_snapshot_t *snap, bool changed_only)
+{
+	cpu_profile_item_t *data;
+	ProfileLine line;
+	uint32_t i;
+
+	if (!Profile_SnapshotBegin(snap, changed_only ? PROFILE_SNAPSHOT_DELTA : 0)) {
+		return false;
+	}
+	data = cpu_profile.data;
+	if (changed_only) {
+		i = 0;
+		while (Profile_CpuQueryChanged(&i, &line)) {
+			if (!Profile_SnapshotAdd(snap, line.addr, line.count, line.cycles)) {
+				return false;
+			}
+		}
+	} else if (data) {
+		for (i = 0; i < cpu_profile.size; i++) {
+			if (!data[i].count) {
+				continue;
+			}
+			if (!Profile_SnapshotAdd(snap, index2address(i), data[i].count, data[i].cycles)) {
+				return false;
+			}
+		}
+	}
+	return Profile_SnapshotEnd(snap);
+}
+
 bool Profile_CpuIsEnabled(void)
 {
 	uint32_t *disasm_addr;
@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
 
 #if HAVE_UNIX_DOMAIN_SOCKETS
 #include <sys/types.h>
@@ -28,6 +29,8 @@
 #include <winsock.h>
 #endif
 
+#include <SDL_timer.h>	/* For SDL_GetTicks */
+
 #include "main.h"		/* For ARRAY_SIZE, event handler */
 #include "m68000.h"		/* Must be after main.h for "unlikely" */
 #include "debugui.h"	/* For DebugUI_RegisterRemoteDebug */
@@ -48,8 +51,11 @@
 #include "dsp_cpu.h"
 #include "profile.h"
 #include "history.h"
+#include "memfind.h"
+#include "rewind.h"
 // For status bar updates
 #include "screen.h"
+#include "screenConvert.h"
 #include "statusbar.h"
 #include "video.h"	/* FIXME: video.h is dependent on HBL_PALETTE_LINES from screen.h */
 #include "reset.h"
@@ -69,6 +75,20 @@
 // How many bytes in the internal network send buffer
 #define RDB_SEND_BUFFER_SIZE       (512)
 
+// Size of pages for the ST-RAM dirty tracking used by "memdirty"
+#define RDB_DIRTY_PAGE_SHIFT       (8)
+#define RDB_DIRTY_PAGE_SIZE        (1 << RDB_DIRTY_PAGE_SHIFT)
+
+// Max number of hits returned by a single "memfind" command,
+// and max search string length in bytes
+#define RDB_MEMFIND_MAX_HITS       (256)
+#define RDB_MEMFIND_MAX_STRING     (256)
+
+// Limits for the live profile notifications sent while running:
+// min interval in VBLs, and in host milliseconds (for fast forward)
+#define RDB_PROFILE_LIVE_MIN_VBLS  (5)
+#define RDB_PROFILE_LIVE_MIN_MSECS (100)
+
 // Network timeout when in break loop, to allow event handler update.
 // Currently 0.5sec
 #define RDB_SELECT_TIMEOUT_USEC   (500000)
@@ -79,6 +99,12 @@ static bool bRemoteBreakRequest = false;
 /* Processing is stopped and the remote debug loop is active */
 static bool bRemoteBreakIsActive = false;
 
+/* Live profile notifications: interval in VBLs (0 = off), VBLs left
+ * until next one, and host time of the previous one */
+static uint32_t nProfileLiveVbls = 0;
+static uint32_t nProfileLiveCountdown = 0;
+static uint32_t nProfileLiveLastTicks = 0;
+
 /* ID of a protocol for the transfers, so we can detect hatari<->mismatch in future */
 /* 0x1003 -- add reset commands */
 /* 0x1004    add ffwd command, and ffwd status in NotifyStatus() */
@@ -86,7 +112,15 @@ static bool bRemoteBreakIsActive = false;
 /* 0x1006    use hex only for address/size in mem[*], bpdel, exmask commands */
 /* 0x1007    add savebin */
 /* 0x1008    add dmem, DSP support in NotifyConfig */
-#define REMOTEDEBUG_PROTOCOL_ID	(0x1008)
+/* 0x1009    add binary command for length-prefixed framing with raw mem/dmem data */
+/* 0x100A    add memdirty command */
+/* 0x100B    memfind returns continuation address and multiple hits */
+/* 0x100C    !profile only sends changes, !profilebin snapshot in binary mode */
+/* 0x100D    add profilelive command */
+/* 0x100E    add watch command */
+/* 0x100F    add histbin command, optional trace flags for histset */
+/* 0x1010    add rstep and rcont commands */
+#define REMOTEDEBUG_PROTOCOL_ID	(0x1010)
 
 /* Char ID to denote terminator of a token. This is under the ASCII "normal"
 	character value range so that 32-255 can be used */
@@ -95,12 +129,89 @@ static bool bRemoteBreakIsActive = false;
 /* Forward declaration of callback */
 void RemoteDebug_SymbolsChanged(void);
 
+/* ST-RAM dirty page tracking for the "memdirty" command.
+   Rather than hooking every write path (CPU direct access, DMA, GEMDOS...),
+   a shadow copy of ST-RAM is compared once after the emulation has run,
+   and each changed page is stamped with the epoch at which it changed. */
+static uint8_t *pDirtyShadow = NULL;	/* copy of ST-RAM at the last refresh */
+static uint32_t *pDirtyPageEpoch = NULL;	/* epoch of the last change, per page */
+static uint32_t nDirtyRamSize = 0;		/* ST-RAM size covered by the above */
+static uint32_t nDirtyEpoch = 1;		/* epoch stamped on the next changes, never reset */
+static bool bDirtyNeedsRefresh = true;	/* memory might have changed since the last refresh */
+
 // -----------------------------------------------------------------------------
 static bool IsDspActive(void)
 {
 	return ConfigureParams.System.nDSPType == DSP_TYPE_EMU;
 }
 
+// -----------------------------------------------------------------------------
+static void DirtyPages_Free(void)
+{
+	free(pDirtyShadow);
+	free(pDirtyPageEpoch);
+	pDirtyShadow = NULL;
+	pDirtyPageEpoch = NULL;
+	nDirtyRamSize = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Compare ST-RAM with the shadow copy and stamp changed pages with the
+// current epoch. Returns the epoch that clients should pass in future
+// requests, so that they only receive later changes.
+static uint32_t DirtyPages_Refresh(void)
+{
+	uint32_t page, numPages;
+
+	if (!bDirtyNeedsRefresh && pDirtyShadow)
+		return nDirtyEpoch;
+
+	numPages = (STRamEnd + RDB_DIRTY_PAGE_SIZE - 1) >> RDB_DIRTY_PAGE_SHIFT;
+	if (!pDirtyShadow || nDirtyRamSize != STRamEnd)
+	{
+		// (Re)start tracking: everything counts as changed
+		DirtyPages_Free();
+		pDirtyShadow = malloc(numPages << RDB_DIRTY_PAGE_SHIFT);
+		pDirtyPageEpoch = malloc(numPages * sizeof(uint32_t));
+		if (!pDirtyShadow || !pDirtyPageEpoch)
+		{
+			DirtyPages_Free();
+			return nDirtyEpoch;
+		}
+		memcpy(pDirtyShadow, STRam, STRamEnd);
+		for (page = 0; page < numPages; ++page)
+			pDirtyPageEpoch[page] = nDirtyEpoch;
+		nDirtyRamSize = STRamEnd;
+	}
+	else
+	{
+		for (page = 0; page < numPages; ++page)
+		{
+			uint32_t offset = page << RDB_DIRTY_PAGE_SHIFT;
+			uint32_t size = RDB_DIRTY_PAGE_SIZE;
+			if (offset + size > nDirtyRamSize)
+				size = nDirtyRamSize - offset;
+			if (memcmp(STRam + offset, pDirtyShadow + offset, size) != 0)
+			{
+				memcpy(pDirtyShadow + offset, STRam + offset, size);
+				pDirtyPageEpoch[page] = nDirtyEpoch;
+			}
+		}
+	}
+	bDirtyNeedsRefresh = false;
+	return ++nDirtyEpoch;
+}
+
+// -----------------------------------------------------------------------------
+// Check whether the memory at <addr> might have changed since <epoch>.
+// Memory outside tracked ST-RAM always counts as changed.
+static bool DirtyPages_IsDirty(uint32_t addr, uint32_t epoch)
+{
+	if (!pDirtyPageEpoch || addr >= nDirtyRamSize)
+		return true;
+	return pDirtyPageEpoch[addr >> RDB_DIRTY_PAGE_SHIFT] >= epoch;
+}
+
 // -----------------------------------------------------------------------------
 // Structure managing a resizeable buffer of uint8_t
 // This can be used to accumulate input commands, or sections of it
@@ -138,8 +249,11 @@ static void RemoteDebugBuffer_Add(RemoteDebugBuffer* buf, const char* data, size
 	// Full buffer?
 	if (buf->write_pos + size > buf->size)
 	{
-		// Allocate a new buffer bigger than request
+		// Allocate a new buffer bigger than request. Grow by at least
+		// double, so that large binary packets don't copy repeatedly.
 		size_t new_size = buf->write_pos + size + 512;
+		if (new_size < buf->size * 2)
+			new_size = buf->size * 2;
 		char* new_data = (char*)malloc(new_size);
 
 		// Copy across (valid) contents and release the original
@@ -198,29 +312,132 @@ typedef struct RemoteDebugState
 	/* Output (send) buffer data */
 	char sendBuffer[RDB_SEND_BUFFER_SIZE];	/* buffer for replies */
 	int sendBufferPos;					/* next byte to write into buffer */
+
+	/* Binary framing state. In binary mode each reply/notification is
+	   collected in packetBuf, then sent as a 4-byte big-endian length
+	   followed by the payload, rather than being zero-terminated. */
+	bool binaryMode;					/* current framing mode of replies */
+	bool binaryModeRequest;				/* mode to switch to after the current reply */
+	bool packetStreamed;				/* current packet header already sent, see begin_streamed_packet() */
+	RemoteDebugBuffer packetBuf;		/* payload of the current binary packet */
+
+	/* Data the non-blocking socket didn't accept yet, while the
+	   emulation runs. It goes out before anything else, so that a
+	   slow client gets whole packets without stalling the emulation. */
+	RemoteDebugBuffer pendingBuf;
 } RemoteDebugState;
 
+#if HAVE_WINSOCK_SOCKETS
+#define RDB_WOULD_BLOCK()		(WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+#define RDB_WOULD_BLOCK()		(errno == EAGAIN || errno == EWOULDBLOCK)
+#endif
+
+// -----------------------------------------------------------------------------
+// Send as much of the pending data as the socket accepts
+static void send_pending(RemoteDebugState* state)
+{
+	size_t pos = 0;
+	while (pos < state->pendingBuf.write_pos)
+	{
+		int sent = send(state->AcceptedFD, state->pendingBuf.data + pos,
+				state->pendingBuf.write_pos - pos, 0);
+		if (sent <= 0)
+			break;
+		pos += sent;
+	}
+	if (pos)
+		RemoteDebugBuffer_RemoveStart(&state->pendingBuf, pos);
+}
+
+// -----------------------------------------------------------------------------
+// Send all the data to the socket, handling partial sends. What a
+// non-blocking socket doesn't accept is kept for send_pending().
+static void send_all(RemoteDebugState* state, const char* data, size_t size)
+{
+	// Keep the order of the stream
+	if (state->pendingBuf.write_pos)
+	{
+		RemoteDebugBuffer_Add(&state->pendingBuf, data, size);
+		send_pending(state);
+		return;
+	}
+	while (size > 0)
+	{
+		int sent = send(state->AcceptedFD, data, size, 0);
+		if (sent <= 0)
+		{
+			if (RDB_WOULD_BLOCK())
+				RemoteDebugBuffer_Add(&state->pendingBuf, data, size);
+			return;
+		}
+		data += sent;
+		size -= sent;
+	}
+}
+
 // -----------------------------------------------------------------------------
 // Force send of data in sendBuffer
 static void flush_data(RemoteDebugState* state)
 {
 	// Flush existing data
-	send(state->AcceptedFD, state->sendBuffer, state->sendBufferPos, 0);
+	send_all(state, state->sendBuffer, state->sendBufferPos);
 	state->sendBufferPos = 0;
 }
 
 // -----------------------------------------------------------------------------
-// Add data to sendBuffer, flush if necessary
-static void add_data(RemoteDebugState* state, const char* data, size_t size)
+// Add data to sendBuffer, flush if necessary. This bypasses any packet framing.
+static void add_raw_data(RemoteDebugState* state, const char* data, size_t size)
 {
 	// Flush data if it won't fit
 	if (state->sendBufferPos + size > RDB_SEND_BUFFER_SIZE)
 		flush_data(state);
 
+	// Large blocks go straight to the socket
+	if (size > RDB_SEND_BUFFER_SIZE)
+	{
+		send_all(state, data, size);
+		return;
+	}
+
 	memcpy(state->sendBuffer + state->sendBufferPos, data, size);
 	state->sendBufferPos += size;
 }
 
+// -----------------------------------------------------------------------------
+// Add data to the current reply
+static void add_data(RemoteDebugState* state, const char* data, size_t size)
+{
+	if (state->binaryMode)
+		RemoteDebugBuffer_Add(&state->packetBuf, data, size);
+	else
+		add_raw_data(state, data, size);
+}
+
+// -----------------------------------------------------------------------------
+// Send the length header of a binary packet (big-endian)
+static void send_packet_length(RemoteDebugState* state, uint32_t length)
+{
+	char header[4];
+	header[0] = (char)(length >> 24);
+	header[1] = (char)(length >> 16);
+	header[2] = (char)(length >> 8);
+	header[3] = (char)(length);
+	add_raw_data(state, header, sizeof(header));
+}
+
+// -----------------------------------------------------------------------------
+// In binary mode, send the packet header early for a packet whose last
+// <payload_size> bytes will be sent with add_raw_data() by the caller.
+// This avoids buffering large memory blocks before sending.
+static void begin_streamed_packet(RemoteDebugState* state, uint32_t payload_size)
+{
+	send_packet_length(state, state->packetBuf.write_pos + payload_size);
+	add_raw_data(state, state->packetBuf.data, state->packetBuf.write_pos);
+	state->packetBuf.write_pos = 0;
+	state->packetStreamed = true;
+}
+
 // -----------------------------------------------------------------------------
 // Transmission functions (wrapped for platform portability)
 // -----------------------------------------------------------------------------
@@ -266,9 +483,61 @@ static void send_key_value(RemoteDebugState* state, const char* pStr, uint32_t v
 }
 
 // -----------------------------------------------------------------------------
+// End the current reply or notification
 static void send_term(RemoteDebugState* state)
 {
-	send_char(state, 0);
+	if (!state->binaryMode)
+	{
+		send_char(state, 0);
+		return;
+	}
+
+	// Streamed packets have been fully sent already
+	if (state->packetStreamed)
+	{
+		state->packetStreamed = false;
+		return;
+	}
+	send_packet_length(state, state->packetBuf.write_pos);
+	add_raw_data(state, state->packetBuf.data, state->packetBuf.write_pos);
+	state->packetBuf.write_pos = 0;
+}
+
+// -----------------------------------------------------------------------------
+// Send bytes in the same uuencoded form as the "mem" command. Data can be
+// sent in several calls, if all but the last one have a multiple of 3 bytes.
+static void send_mem_text(RemoteDebugState* state, const uint8_t* data, uint32_t size)
+{
+	uint32_t pos;
+
+	for (pos = 0; pos < size; pos += 3)
+	{
+		uint32_t accum = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			accum <<= 8;
+			if (pos + i < size)
+				accum |= data[pos + i];
+		}
+		send_char(state, 32 + ((accum >> 18) & 0x3f));
+		send_char(state, 32 + ((accum >> 12) & 0x3f));
+		send_char(state, 32 + ((accum >>  6) & 0x3f));
+		send_char(state, 32 + ((accum      ) & 0x3f));
+	}
+}
+
+// -----------------------------------------------------------------------------
+// Send a block of bytes as the final field of a reply: raw in binary mode,
+// otherwise in the same uuencoded form as the "mem" command.
+static void send_mem_data(RemoteDebugState* state, const uint8_t* data, uint32_t size)
+{
+	if (state->binaryMode)
+	{
+		begin_streamed_packet(state, size);
+		add_raw_data(state, (const char*)data, size);
+		return;
+	}
+	send_mem_text(state, data, size);
 }
 
 //-----------------------------------------------------------------------------
@@ -359,12 +628,36 @@ static int RemoteDebug_NotifyConfig(RemoteDebugState* state)
 	return 0;
 }
 
+// -----------------------------------------------------------------------------
+// Send the profile changes since the previous notification.
+// In binary mode this is "!profilebin <enabled> <size> <snapshot data>",
+// see profile.c for the snapshot format, otherwise
+// "!profile <enabled> [<addrdelta> <count> <cycles>]*".
 static void RemoteDebug_NotifyProfile(RemoteDebugState* state)
 {
-	int index;
+	uint32_t index;
 	ProfileLine result;
 	uint32_t lastaddr;
 
+	if (state->binaryMode)
+	{
+		profile_snapshot_t snap;
+		memset(&snap, 0, sizeof(snap));
+		if (Profile_CpuSnapshot(&snap, true))
+		{
+			send_str(state, "!profilebin");
+			send_sep(state);
+			send_hex(state, Profile_CpuIsEnabled() ? 1 : 0);
+			send_sep(state);
+			send_hex(state, snap.size);
+			send_sep(state);
+			send_mem_data(state, snap.data, snap.size);
+			send_term(state);
+		}
+		Profile_SnapshotFree(&snap);
+		return;
+	}
+
 	send_str(state, "!profile");
 	send_sep(state);
 	send_hex(state, Profile_CpuIsEnabled() ? 1 : 0);
@@ -372,22 +665,18 @@ static void RemoteDebug_NotifyProfile(RemoteDebugState* state)
 	
 	index = 0;
 	lastaddr = 0;
-	while (Profile_CpuQuery(index, &result))
+	while (Profile_CpuQueryChanged(&index, &result))
 	{
-		if (result.count)
-		{
-			// NOTE: address is encoded as delta from previous
-			// entry, starting from 0. This provides a very simple
-			// size reduction.
-			send_hex(state, result.addr - lastaddr);
-			send_sep(state);
-			send_hex(state, result.count);
-			send_sep(state);
-			send_hex(state, result.cycles);
-			send_sep(state);
-			lastaddr = result.addr;
-		}
-		++index;
+		// NOTE: address is encoded as delta from previous
+		// entry, starting from 0. This provides a very simple
+		// size reduction.
+		send_hex(state, result.addr - lastaddr);
+		send_sep(state);
+		send_hex(state, result.count);
+		send_sep(state);
+		send_hex(state, result.cycles);
+		send_sep(state);
+		lastaddr = result.addr;
 	}
 	send_term(state);
 }
@@ -548,6 +837,50 @@ static int RemoteDebug_dstep(int nArgc, char *psArgs[], RemoteDebugState* state)
 	return 0;
 }
 
+// -----------------------------------------------------------------------------
+/**
+ * Step back given number of CPU instructions, using rewind snapshots.
+ * Snapshots need to be enabled first with "console rewind on".
+ *
+ * Input: "rstep [<count:hex>]"
+ *
+ * Output: "OK"/"NG". Target breaks like after "step" when done.
+ */
+static int RemoteDebug_rstep(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	uint32_t count = 1;
+
+	if (nArgc > 1 && !read_hex32_value(psArgs[1], &count))
+		return 1;
+	if (!count || !Rewind_Back(count, false))
+		return 1;
+	send_str(state, "OK");
+
+	// Restart
+	bRemoteBreakIsActive = false;
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Go back to previous CPU breakpoint or watchpoint hit, using rewind
+ * snapshots.
+ *
+ * Input: "rcont"
+ *
+ * Output: "OK"/"NG". Target breaks like on a breakpoint when done.
+ */
+static int RemoteDebug_rcont(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	if (!Rewind_Back(0, true))
+		return 1;
+	send_str(state, "OK");
+
+	// Restart
+	bRemoteBreakIsActive = false;
+	return 0;
+}
+
 // -----------------------------------------------------------------------------
 static int RemoteDebug_run(int nArgc, char *psArgs[], RemoteDebugState* state)
 {
@@ -622,6 +955,7 @@ static int RemoteDebug_regs(int nArgc, char *psArgs[], RemoteDebugState* state)
 	if (IsDspActive())
 	{
 		const RemoteDebugDspReg* pCurrReg = g_remoteDebugDspRegs;
+		DSP_Sync();
 		while (pCurrReg->regName)
 		{
 			send_key_value(state, pCurrReg->regName, dsp_core.registers[pCurrReg->regId]);
@@ -664,6 +998,7 @@ static int RemoteDebug_regs(int nArgc, char *psArgs[], RemoteDebugState* state)
  * Input: "mem <start addr:hex> <size in bytes:hex>\n"
  *
  * Output: "mem <address:hex> <size:hexr> <memory as base16 string>\n"
+ * In binary mode the memory is sent as <size> raw bytes instead.
  */
 
 static int RemoteDebug_mem(int nArgc, char *psArgs[], RemoteDebugState* state)
@@ -696,6 +1031,25 @@ static int RemoteDebug_mem(int nArgc, char *psArgs[], RemoteDebugState* state)
 	send_hex(state, memdump_count);
 	send_sep(state);
 
+	if (state->binaryMode)
+	{
+		char buffer[RDB_MEM_BLOCK_SIZE];
+		uint32_t read_pos = 0;
+
+		begin_streamed_packet(state, memdump_count);
+		while (read_pos < memdump_count)
+		{
+			uint32_t block_size = memdump_count - read_pos;
+			if (block_size > RDB_MEM_BLOCK_SIZE)
+				block_size = RDB_MEM_BLOCK_SIZE;
+			for (uint32_t i = 0; i < block_size; ++i)
+				buffer[i] = STMemory_ReadByte(memdump_addr + read_pos + i);
+			add_raw_data(state, buffer, block_size);
+			read_pos += block_size;
+		}
+		return 0;
+	}
+
 	// Need to flush here before we switch to our existing buffer system
 	flush_data(state);
 
@@ -728,14 +1082,14 @@ static int RemoteDebug_mem(int nArgc, char *psArgs[], RemoteDebugState* state)
 		// Flush?
 		if (write_pos == RDB_MEM_BLOCK_SIZE*4)
 		{
-			send(state->AcceptedFD, buffer, write_pos, 0);
+			send_all(state, buffer, write_pos);
 			write_pos = 0;
 		}
 	}
 
 	// Flush remainder
 	if (write_pos != 0)
-		send(state->AcceptedFD, buffer, write_pos, 0);
+		send_all(state, buffer, write_pos);
 
 	free(buffer);
 	return 0;
@@ -791,6 +1145,7 @@ static int RemoteDebug_memset(int nArgc, char *psArgs[], RemoteDebugState* state
 		STMemory_WriteByte(memset_addr, (valHi << 4) | valLo);
 		++memset_addr;
 	}
+	bDirtyNeedsRefresh = true;
 	send_str(state, "OK");
 	send_sep(state);
 	// Report changed range so tools can decide to update
@@ -834,6 +1189,45 @@ static int RemoteDebug_dbp(int nArgc, char *psArgs[], RemoteDebugState* state)
 	return 1;
 }
 
+// -----------------------------------------------------------------------------
+/* Set a CPU memory access watchpoint.
+ *
+ * Input: "watch <start:hex> <end:hex> <access:r|w|rw> [<options>...]"
+ *
+ * End address is exclusive. Watchpoints are listed and removed like
+ * other CPU breakpoints.
+ *
+ * Output: "OK <breakpoint index:hex>"
+ */
+static int RemoteDebug_watch(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	uint32_t start, end;
+	char command[256];
+	int arg, len;
+
+	if (nArgc < 4)
+		return 1;
+	if (!read_hex32_value(psArgs[1], &start) || !read_hex32_value(psArgs[2], &end))
+		return 1;
+	if (end <= start)
+		return 1;
+
+	len = snprintf(command, sizeof(command), "$%x-$%x %s", start, end, psArgs[3]);
+	/* rest of the args are breakpoint options */
+	for (arg = 4; arg < nArgc && len < (int)sizeof(command); ++arg)
+		len += snprintf(command + len, sizeof(command) - len, " %s", psArgs[arg]);
+	if (len >= (int)sizeof(command))
+		return 1;
+
+	if (!BreakWatch_Command(command))
+		return 1;
+
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, BreakCond_CpuBreakPointCount());
+	return 0;
+}
+
 // -----------------------------------------------------------------------------
 /* List all breakpoints, CPU and DSP */
 static int RemoteDebug_bplist(int nArgc, char *psArgs[], RemoteDebugState* state)
@@ -985,6 +1379,8 @@ static int RemoteDebug_console(int nArgc, char *psArgs[], RemoteDebugState* stat
 		// Repoint all output to any supplied file
 		RemoteDebug_OpenDebugOutput(state);
 		int cmdRet = DebugUI_ParseConsoleCommand(psArgs[1]);
+		// Console commands can change memory
+		bDirtyNeedsRefresh = true;
 
 		/* handle a command that restarts execution */
 		if (cmdRet == DEBUGGER_END)
@@ -1061,11 +1457,32 @@ static int RemoteDebug_profile(int nArgc, char *psArgs[], RemoteDebugState* stat
 	return 1;
 }
 
+// -----------------------------------------------------------------------------
+/* "profilelive <vbls:hex>" Send profile changes every <vbls> VBLs while running */
+/* 0 disables. Returns "OK <vbls>" with the interval actually used */
+static int RemoteDebug_profilelive(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	uint32_t vbls;
+	if (nArgc != 2 || !read_hex32_value(psArgs[1], &vbls))
+		return 1;
+
+	if (vbls && vbls < RDB_PROFILE_LIVE_MIN_VBLS)
+		vbls = RDB_PROFILE_LIVE_MIN_VBLS;
+	nProfileLiveVbls = vbls;
+	nProfileLiveCountdown = vbls;
+
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, vbls);
+	return 0;
+}
+
 // -----------------------------------------------------------------------------
 /* "resetwarm" Trigger system warm reset */
 /* returns "OK <val>" if successful */
 static int RemoteDebug_resetwarm(int nArgc, char *psArgs[], RemoteDebugState* state)
 {
+	bDirtyNeedsRefresh = true;
 	if (Reset_Warm() == 0)
 	{
 		send_str(state, "OK");
@@ -1079,6 +1496,7 @@ static int RemoteDebug_resetwarm(int nArgc, char *psArgs[], RemoteDebugState* st
 /* returns "OK <val>" if successful */
 static int RemoteDebug_resetcold(int nArgc, char *psArgs[], RemoteDebugState* state)
 {
+	bDirtyNeedsRefresh = true;
 	if (Reset_Cold() == 0)
 	{
 		send_str(state, "OK");
@@ -1110,23 +1528,28 @@ static int RemoteDebug_ffwd(int nArgc, char *psArgs[], RemoteDebugState* state)
 }
 
 // -----------------------------------------------------------------------------
-/* "memfind <start:hex> <count:hex> <stringdata>" Search memory for string */
-/* returns "OK <addr>" where addr is the next address found if successful */
+/* "memfind <start:hex> <count:hex> <stringdata> [<maxhits:hex>]" Search memory for string */
+/* returns "OK <next:hex> [<hit:hex>]*", where search for further hits can be continued from <next> */
 static int RemoteDebug_memfind(int nArgc, char *psArgs[], RemoteDebugState* state)
 {
 	uint32_t find_addr = 0;
 	uint32_t find_count = 0;
 	uint32_t find_end = 0;
+	uint32_t max_hits = 1;
+	uint32_t next;
+	uint32_t hits[RDB_MEMFIND_MAX_HITS];
 	int readPos = 0;
 	RemoteDebugBuffer searchBuffer;
-	size_t stringSize;
+	memfind_pattern_t pattern;
+	uint8_t masks[RDB_MEMFIND_MAX_STRING];
+	uint8_t values[RDB_MEMFIND_MAX_STRING];
 	uint8_t valHi;
 	uint8_t valLo;
-	int arg;
+	int arg, count, i;
 
 	/* For remote debug, only "address" "count" is supported */
 	arg = 1;
-	if (nArgc >= arg + 2)
+	if (nArgc >= arg + 3)
 	{
 		if (!read_hex32_value(psArgs[arg], &find_addr))
 			return 1;
@@ -1141,6 +1564,13 @@ static int RemoteDebug_memfind(int nArgc, char *psArgs[], RemoteDebugState* stat
 		// Not enough args
 		return 1;
 	}
+	if (nArgc >= arg + 2)
+	{
+		if (!read_hex32_value(psArgs[arg + 1], &max_hits) || max_hits == 0)
+			return 1;
+		if (max_hits > RDB_MEMFIND_MAX_HITS)
+			max_hits = RDB_MEMFIND_MAX_HITS;
+	}
 
 	// Read (hex) search string into a buffer.
 	// The string is a set of <mask><value> byte pairs (so we can support case-insensitive)
@@ -1156,43 +1586,39 @@ static int RemoteDebug_memfind(int nArgc, char *psArgs[], RemoteDebugState* stat
 		char stringVal = (valHi << 4) | valLo;
 		RemoteDebugBuffer_Add(&searchBuffer, &stringVal, sizeof(stringVal));
 	}
-	// Check that we have an even number of bytes in the search string
-	if (searchBuffer.write_pos & 1)
+	// Check that we have a non-empty, even number of bytes in the search string
+	pattern.len = searchBuffer.write_pos / 2;
+	if ((searchBuffer.write_pos & 1) || pattern.len == 0 ||
+	    pattern.len > sizeof(masks))
+	{
+		RemoteDebugBuffer_UnInit(&searchBuffer);
 		return 2;
-
-	send_str(state, "OK");
-
-	// Then do the search
-	stringSize = searchBuffer.write_pos / 2;
-	find_end = find_addr + find_count - stringSize;
-	while (find_addr < find_end)
+	}
+	for (i = 0; i < (int)pattern.len; ++i)
 	{
-		// Primitive string compare.
-		// We could do something with a rolling buffer for speed,
-		// but it's really not worth it yet.
-		bool found = true;
-		for (size_t i = 0; i < stringSize; ++i)
-		{
-			uint8_t mem = STMemory_ReadByte(find_addr + i);
-			uint8_t mask = searchBuffer.data[i * 2];
-			uint8_t val = searchBuffer.data[i * 2 + 1];
+		masks[i] = searchBuffer.data[i * 2];
+		values[i] = searchBuffer.data[i * 2 + 1];
+	}
+	RemoteDebugBuffer_UnInit(&searchBuffer);
 
-			if ((mem & mask) != val)
-			{
-				found = false;
-				break;
-			}
-		}
+	pattern.mask = masks;
+	pattern.value = values;
+	pattern.align = 1;
 
-		if (found)
-		{
-			send_sep(state);
-			send_hex(state, find_addr);
-			break;
-		}
-		++find_addr;
+	// Then do the search, clamping the range to the address space
+	find_end = find_addr + find_count;
+	if (find_end < find_addr)
+		find_end = 0xffffffff;
+	count = MemFind_Search(&pattern, find_addr, find_end, hits, max_hits, &next);
+
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, next);
+	for (i = 0; i < count; ++i)
+	{
+		send_sep(state);
+		send_hex(state, hits[i]);
 	}
-	RemoteDebugBuffer_UnInit(&searchBuffer);
 	return 0;
 }
 
@@ -1233,12 +1659,146 @@ static int RemoteDebug_savebin(int nArgc, char *psArgs[], RemoteDebugState* stat
 	return 0;
 }
 
+/**
+ * Find next run of CPU memory area pages that might have changed since
+ * given epoch (all of them for epoch 0), starting from *offset.  Return
+ * false when there are no more, otherwise set *runStart and *offset to
+ * the run start and end offsets within the area.
+ */
+static bool memdirty_next_run(uint32_t addr, uint32_t size, uint32_t epoch,
+                              uint32_t* offset, uint32_t* runStart)
+{
+	while (*offset < size)
+	{
+		// Skip clean pages
+		uint32_t pageEnd = ((addr + *offset) | (RDB_DIRTY_PAGE_SIZE - 1)) - addr + 1;
+		if (pageEnd > size || pageEnd == 0)
+			pageEnd = size;
+		if (epoch != 0 && !DirtyPages_IsDirty(addr + *offset, epoch))
+		{
+			*offset = pageEnd;
+			continue;
+		}
+
+		// Extend run over following dirty pages
+		*runStart = *offset;
+		*offset = pageEnd;
+		while (*offset < size && (epoch == 0 || DirtyPages_IsDirty(addr + *offset, epoch)))
+		{
+			if (size - *offset > RDB_DIRTY_PAGE_SIZE)
+				*offset += RDB_DIRTY_PAGE_SIZE;
+			else
+				*offset = size;
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Fetch the parts of an area of CPU memory that changed since an epoch.
+ *
+ * Input: "memdirty <epoch:hex> <start addr:hex> <size in bytes:hex>"
+ *
+ * Output: "OK <new epoch:hex> <address:hex> <size:hex> <run count:hex>
+ *          [<run offset:hex> <run size:hex>]* <run data>"
+ *
+ * Runs are the ranges (relative to the start address) that might have
+ * changed since <epoch>, and their memory is sent concatenated at the end,
+ * in the same encoding as "mem". Epoch 0 returns the whole area. The
+ * client passes the returned epoch in later requests for the same area,
+ * and patches its cached copy with the runs. Dirty state is tracked in
+ * pages of ST-RAM; anything outside ST-RAM is always sent. Like with "mem",
+ * the data is read and sent in blocks, not buffered as a whole.
+ */
+static int RemoteDebug_memdirty(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	uint32_t epoch, addr, size, newEpoch;
+	uint32_t offset, runStart, runCount, dataSize, blockSize;
+	uint8_t block[RDB_MEM_BLOCK_SIZE - RDB_MEM_BLOCK_SIZE % 3];
+
+	if (nArgc != 4)
+		return 1;
+	if (!read_hex32_value(psArgs[1], &epoch))
+		return 1;
+	if (!read_hex32_value(psArgs[2], &addr))
+		return 1;
+	if (!read_hex32_value(psArgs[3], &size))
+		return 1;
+
+	newEpoch = DirtyPages_Refresh();
+
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, newEpoch);
+	send_sep(state);
+	send_hex(state, addr);
+	send_sep(state);
+	send_hex(state, size);
+	send_sep(state);
+
+	// First pass counts runs and their size, second pass sends them,
+	// third one streams their data
+	dataSize = 0;
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		runCount = 0;
+		blockSize = 0;
+		offset = 0;
+		while (memdirty_next_run(addr, size, epoch, &offset, &runStart))
+		{
+			if (pass == 0)
+			{
+				dataSize += offset - runStart;
+			}
+			else if (pass == 1)
+			{
+				send_hex(state, runStart);
+				send_sep(state);
+				send_hex(state, offset - runStart);
+				send_sep(state);
+			}
+			else
+			{
+				for (uint32_t i = runStart; i < offset; ++i)
+				{
+					block[blockSize++] = STMemory_ReadByte(addr + i);
+					if (blockSize == sizeof(block))
+					{
+						if (state->binaryMode)
+							add_raw_data(state, (const char*)block, blockSize);
+						else
+							send_mem_text(state, block, blockSize);
+						blockSize = 0;
+					}
+				}
+			}
+			++runCount;
+		}
+		if (pass == 0)
+		{
+			send_hex(state, runCount);
+			send_sep(state);
+		}
+		else if (pass == 1 && state->binaryMode)
+		{
+			begin_streamed_packet(state, dataSize);
+		}
+	}
+	if (state->binaryMode)
+		add_raw_data(state, (const char*)block, blockSize);
+	else
+		send_mem_text(state, block, blockSize);
+	return 0;
+}
+
 /**
  * Dump the requested area of DSP memory.
  *
  * Input: "mem <space:char> <start addr:hex> <size in DSP-words:hex>\n"
  *
  * Output: "mem <address:hex> <size:hexr> <memory as base16 string>\n"
+ * In binary mode each DSP word is sent as 3 raw big-endian bytes instead.
  */
 
 static int RemoteDebug_dmem(int nArgc, char *psArgs[], RemoteDebugState* state)
@@ -1290,6 +1850,16 @@ static int RemoteDebug_dmem(int nArgc, char *psArgs[], RemoteDebugState* state)
 	{
 		result = DSP_ReadMemory(memdump_addr, memspace, &mem_str);
 
+		if (state->binaryMode)
+		{
+			send_char(state, (char)(result >> 16));
+			send_char(state, (char)(result >> 8));
+			send_char(state, (char)(result));
+			++memdump_addr;
+			--memdump_count;
+			continue;
+		}
+
 		// Now write 3 bytes to 4 chars as ASCII uuencode
 		send_char(state, 32 + ((result >> 18) & 0x3f));
 		send_char(state, 32 + ((result >> 12) & 0x3f));
@@ -1305,7 +1875,10 @@ static int RemoteDebug_dmem(int nArgc, char *psArgs[], RemoteDebugState* state)
 /**
  * Set the history tracking config.
  *
- * Input: "hist <cpu_enable:hex> <dsp_enable:hex> <limit:hex>
+ * Input: "hist <cpu_enable:hex> <dsp_enable:hex> <limit:hex> [<trace flags:hex>]
+ *
+ * Trace flags are HISTORY_TRACE_* values from history.h, for tracing
+ * register changes & memory writes with CPU-only history.
  *
  * Output: "OK"/"NG"
  */
@@ -1316,6 +1889,7 @@ static int RemoteDebug_histset(int nArgc, char *psArgs[], RemoteDebugState* stat
 	uint32_t enable_cpu = 0;
 	uint32_t enable_dsp = 0;
 	uint32_t limit = 0;
+	uint32_t flags = 0;
 	history_type_t htype = HISTORY_TRACK_NONE;
 	if (nArgc >= arg + 3)
 	{
@@ -1329,11 +1903,16 @@ static int RemoteDebug_histset(int nArgc, char *psArgs[], RemoteDebugState* stat
 			return 1;
 		++arg;
 	}
+	if (nArgc > arg)
+	{
+		if (!read_hex32_value(psArgs[arg], &flags))
+			return 1;
+	}
 	if (enable_cpu)
 		htype |= HISTORY_TRACK_CPU;
 	if (enable_dsp)
 		htype |= HISTORY_TRACK_DSP;
-	History_Set(htype, limit);
+	History_Set(htype, limit, flags);
 	send_str(state, "OK");
 	return 0;
 }
@@ -1369,6 +1948,76 @@ static int RemoteDebug_histget(int nArgc, char *psArgs[], RemoteDebugState* stat
 	return 0;
 }
 
+// -----------------------------------------------------------------------------
+/**
+ * Fetch history items in bulk, in the binary trace format
+ * described in history.c.
+ *
+ * Input: "histbin <first:hex> <count:hex>"
+ *
+ * <first> is the index of first item to fetch, 0 being the oldest one.
+ * Count 0 fetches all items from there onwards.
+ *
+ * Output: "OK <items:hex> <size:hex> <trace data>"
+ * The trace data is raw in binary mode, otherwise encoded as in "mem".
+ */
+static int RemoteDebug_histbin(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	uint32_t first, count;
+	history_dump_t dump;
+
+	if (nArgc != 3)
+		return 1;
+	if (!read_hex32_value(psArgs[1], &first))
+		return 1;
+	if (!read_hex32_value(psArgs[2], &count))
+		return 1;
+
+	memset(&dump, 0, sizeof(dump));
+	if (!History_Dump(&dump, first, count))
+	{
+		History_DumpFree(&dump);
+		return 1;
+	}
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, dump.entries);
+	send_sep(state);
+	send_hex(state, dump.size);
+	send_sep(state);
+	send_mem_data(state, dump.data, dump.size);
+	History_DumpFree(&dump);
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+/**
+ * Switch the framing of replies and notifications.
+ *
+ * Input: "binary <enable:hex>"
+ *
+ * Output: "OK <enable:hex>"
+ *
+ * The reply to this command is still sent in the previous mode; the new
+ * mode applies from the next reply onwards. In binary mode each packet is
+ * a 4-byte big-endian length followed by the payload (no terminator), and
+ * "mem"/"dmem" data is sent as raw bytes.
+ */
+static int RemoteDebug_binary(int nArgc, char *psArgs[], RemoteDebugState* state)
+{
+	uint32_t enable;
+	if (nArgc != 2)
+		return 1;
+	if (!read_hex32_value(psArgs[1], &enable))
+		return 1;
+
+	state->binaryModeRequest = (enable != 0);
+	send_str(state, "OK");
+	send_sep(state);
+	send_hex(state, enable ? 1 : 0);
+	return 0;
+}
+
 // -----------------------------------------------------------------------------
 /* DebugUI command structure */
 typedef struct
@@ -1385,6 +2034,8 @@ static const rdbcommand_t remoteDebugCommandList[] = {
 	{ RemoteDebug_step,		"step"		, true		},
 	{ RemoteDebug_dstep,	"dstep"		, true		},
 	{ RemoteDebug_run,		"run"		, true		},
+	{ RemoteDebug_rstep,	"rstep"		, true		},
+	{ RemoteDebug_rcont,	"rcont"		, true		},
 	{ RemoteDebug_regs,		"regs"		, true		},
 	{ RemoteDebug_mem,		"mem"		, true		},
 	{ RemoteDebug_memset,	"memset"	, true		},
@@ -1398,6 +2049,7 @@ static const rdbcommand_t remoteDebugCommandList[] = {
 	{ RemoteDebug_setstd,	"setstd"	, true		},
 	{ RemoteDebug_infoym,	"infoym"	, false		},
 	{ RemoteDebug_profile,	"profile"	, true		},
+	{ RemoteDebug_profilelive,"profilelive", true		},
 	{ RemoteDebug_resetwarm,"resetwarm"	, true		},
 	{ RemoteDebug_resetcold,"resetcold"	, true		},
 	{ RemoteDebug_ffwd,		"ffwd"		, true		},
@@ -1406,6 +2058,10 @@ static const rdbcommand_t remoteDebugCommandList[] = {
 	{ RemoteDebug_dmem,		"dmem"		, true		},
 	{ RemoteDebug_histset,	"histset"	, true		},
 	{ RemoteDebug_histget,	"histget"	, true		},
+	{ RemoteDebug_histbin,	"histbin"	, true		},
+	{ RemoteDebug_binary,	"binary"	, true		},
+	{ RemoteDebug_memdirty,	"memdirty"	, true		},
+	{ RemoteDebug_watch,	"watch"		, true		},
 
 	/* Terminator */
 	{ NULL, NULL }
@@ -1531,6 +2187,11 @@ static void RemoteDebugState_Init(RemoteDebugState* state)
 	state->consoleOutputFile = NULL;
 #endif
 	state->sendBufferPos = 0;
+	state->binaryMode = false;
+	state->binaryModeRequest = false;
+	state->packetStreamed = false;
+	RemoteDebugBuffer_Init(&state->packetBuf, RDB_SEND_BUFFER_SIZE);
+	RemoteDebugBuffer_Init(&state->pendingBuf, RDB_SEND_BUFFER_SIZE);
 }
 
 static void RemoteDebugState_UnInit(RemoteDebugState* state)
@@ -1548,6 +2209,8 @@ static void RemoteDebugState_UnInit(RemoteDebugState* state)
 	state->AcceptedFD = -1;
 	state->SocketFD = -1;
 	RemoteDebugBuffer_UnInit(&state->input_buf);
+	RemoteDebugBuffer_UnInit(&state->packetBuf);
+	RemoteDebugBuffer_UnInit(&state->pendingBuf);
 }
 
 static int RemoteDebugState_TryAccept(RemoteDebugState* state, bool blocking)
@@ -1575,8 +2238,15 @@ static int RemoteDebugState_TryAccept(RemoteDebugState* state, bool blocking)
 	if (state->AcceptedFD != -1)
 	{
 		printf("Remote Debug connection accepted\n");
-		// reset send buffer
+		// reset send buffer, new clients always start in text mode
 		state->sendBufferPos = 0;
+		state->binaryMode = false;
+		state->binaryModeRequest = false;
+		state->packetStreamed = false;
+		state->packetBuf.write_pos = 0;
+		state->pendingBuf.write_pos = 0;
+		// live profiling is requested per connection
+		nProfileLiveVbls = 0;
 		// Send connected handshake, so client can
 		// drop any subsequent commands
 		send_str(state, "!connected");
@@ -1623,6 +2293,9 @@ static void RemoteDebug_ProcessBuffer(RemoteDebugState* state)
 		}
 		send_term(state);
 
+		// Any framing change applies after the reply
+		state->binaryMode = state->binaryModeRequest;
+
 		// Copy extra bytes to the start
 		RemoteDebugBuffer_RemoveStart(&state->input_buf, cmd_length);
 		++num_commands;
@@ -1716,6 +2389,7 @@ static void SetStatusbarMessage(const RemoteDebugState* state)
 		Statusbar_AddMessage("hrdb connected -- debugging", 100);
 	else
 		Statusbar_AddMessage("break -- waiting for hrdb", 100);
+	ScreenConv_Sync(true);
 	Statusbar_Update(sdlscrn, true);
 }
 
@@ -1738,6 +2412,9 @@ static bool RemoteDebug_BreakLoop(void)
 	// This is set to true to prevent re-entrancy in RemoteDebug_Update()
 	bRemoteBreakIsActive = true;
 
+	// Emulation has run, so memory needs to be compared again
+	bDirtyNeedsRefresh = true;
+
 	if (state->AcceptedFD != -1)
 	{
 		// Notify after state change happens
@@ -1754,6 +2431,7 @@ static bool RemoteDebug_BreakLoop(void)
 	// Set the socket to blocking on the connection now, so we
 	// sleep until data is available.
 	SetNonBlocking(state->AcceptedFD, 0);
+	send_pending(state);
 
 	while (bRemoteBreakIsActive)
 	{
@@ -1958,6 +2636,7 @@ void RemoteDebug_UnInit()
 	DebugUI_RegisterRemoteDebug(NULL);
 
 	RemoteDebugState_UnInit(&g_rdbState);
+	DirtyPages_Free();
 }
 
 bool RemoteDebug_Update(void)
@@ -1967,11 +2646,25 @@ bool RemoteDebug_Update(void)
 	// re-entrancy.
 	if (!bRemoteBreakIsActive)
 	{
+		// Emulation runs between the calls, so memory
+		// needs to be compared again on next "memdirty"
+		bDirtyNeedsRefresh = true;
+		if (g_rdbState.pendingBuf.write_pos && g_rdbState.AcceptedFD != -1)
+			send_pending(&g_rdbState);
 		RemoteDebugState_Update(&g_rdbState);
 	}
 	return bRemoteBreakIsActive;
 }
 
+/**
+ * Called when emulated memory was replaced from outside of the
+ * emulation, e.g. by a memory snapshot restore.
+ */
+void RemoteDebug_MemoryChanged(void)
+{
+	bDirtyNeedsRefresh = true;
+}
+
 /**
  * Debugger invocation if requested by remote debugger.
  * 
@@ -1988,6 +2681,38 @@ void RemoteDebug_CheckRemoteBreak(void)
 	}
 }
 
+/**
+ * Called on each VBL. Send the profile changes collected since the
+ * previous notification, when live profiling was requested with
+ * "profilelive" and its interval has passed.
+ */
+void RemoteDebug_CheckProfileLive(void)
+{
+	RemoteDebugState* state = &g_rdbState;
+	uint32_t now;
+
+	if (!nProfileLiveVbls || --nProfileLiveCountdown)
+		return;
+	nProfileLiveCountdown = nProfileLiveVbls;
+
+	if (state->AcceptedFD == -1 || bRemoteBreakIsActive || !Profile_CpuIsEnabled())
+		return;
+
+	// Changes keep accumulating until the next notification,
+	// so skipping one here doesn't lose anything.  Skip also
+	// while a slow client hasn't received the previous one yet.
+	now = SDL_GetTicks();
+	if (now - nProfileLiveLastTicks < RDB_PROFILE_LIVE_MIN_MSECS ||
+	    state->pendingBuf.write_pos)
+		return;
+	nProfileLiveLastTicks = now;
+
+	// Socket stays non-blocking, what it doesn't accept
+	// is sent later from RemoteDebug_Update()
+	RemoteDebug_NotifyProfile(state);
+	flush_data(state);
+}
+
 void RemoteDebug_SymbolsChanged()
 {
 	RemoteDebug_NotifySymbols(&g_rdbState);
@@ -13,6 +13,10 @@
 extern void RemoteDebug_Init(void);
 extern void RemoteDebug_UnInit(void);
 extern bool RemoteDebug_Update(void);
+// Memory was changed outside of emulation (snapshot restore)
+extern void RemoteDebug_MemoryChanged(void);
 // Read the flag to see if remote break was requested
 extern void RemoteDebug_CheckRemoteBreak(void);
+// Send live profile data to remote debugger, if requested
+extern void RemoteDebug_CheckProfileLive(void);
 #endif /* HATARI_REMOTE_H */
@@ -0,0 +1,375 @@
+/*
+ * Hatari - rewind.c
+ *
+ * This file is distributed under the GNU General Public License, version 2
+ * or at your option any later version. Read the file gpl.txt for details.
+ *
+ * rewind.c - stepping CPU execution backwards, for the debugger.
+ *
+ * When enabled, in-memory snapshots of the emulation state are taken
+ * every N VBLs into a bounded ring.  To go back in time, nearest
+ * snapshot before the current position is restored, and execution
+ * replayed from it twice:  first to count the instructions up to the
+ * current position (and where breakpoints would have been hit), then
+ * to the instruction count of the wanted earlier position.
+ *
+ * Positions are identified by the global cycle counter value, which
+ * is part of the snapshots.  Replay assumes emulation to be
+ * deterministic, i.e. user input during the replayed period is lost.
+ */
+const char Rewind_fileid[] = "Hatari rewind.c";
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include "main.h"
+#include "breakcond.h"
+#include "debugui.h"
+#include "debug_priv.h"
+#include "debugcpu.h"
+#include "m68000.h"
+#include "memorySnapShot.h"
+#include "memwatch.h"
+#include "rewind.h"
+
+#define REWIND_INTERVAL_DEFAULT	10
+#define REWIND_COUNT_DEFAULT	16
+
+typedef enum {
+	REPLAY_NONE,
+	REPLAY_COUNT,	/* count instructions up to rewind start position */
+	REPLAY_RUN	/* run given number of instructions */
+} replay_mode_t;
+
+bool RewindReplaying;
+
+static struct {
+	int interval;	/* VBLs between snapshots, zero when disabled */
+	int countdown;	/* VBLs until next snapshot */
+	int count;	/* snapshot ring size */
+	int first;	/* ring index of the oldest snapshot */
+	int used;	/* how many snapshots there are in the ring */
+	MemorySnapShot_Buffer_t *snap;
+} Rewind;
+
+static struct {
+	replay_mode_t mode;
+	bool to_break;		/* back to breakpoint hit instead of 'steps' */
+	int slot;		/* snapshot being replayed from, 0 = oldest */
+	uint64_t end;		/* cycle counter at rewind start position */
+	uint32_t steps;		/* how many instructions to go back from 'end' */
+	uint32_t executed;	/* instructions replayed since snapshot restore */
+	uint32_t target;	/* instruction count at which to stop replay */
+	uint32_t lasthit;	/* instruction count at last breakpoint hit */
+} Replay;
+
+
+/**
+ * Return snapshot at given position in ring, 0 being the oldest one
+ */
+static MemorySnapShot_Buffer_t *Rewind_Slot(int i)
+{
+	return &Rewind.snap[(Rewind.first + i) % Rewind.count];
+}
+
+/**
+ * Free all snapshots and disable taking them
+ */
+static void Rewind_Free(void)
+{
+	int i;
+
+	for (i = 0; i < Rewind.count; i++) {
+		MemorySnapShot_FreeBuffer(&Rewind.snap[i]);
+	}
+	free(Rewind.snap);
+	memset(&Rewind, 0, sizeof(Rewind));
+}
+
+/**
+ * Enable snapshots every 'interval' VBLs into ring of 'count' snapshots
+ */
+static bool Rewind_Enable(int interval, int count)
+{
+	Rewind_Free();
+	Rewind.snap = calloc(count, sizeof(*Rewind.snap));
+	if (!Rewind.snap) {
+		fprintf(stderr, "ERROR: rewind snapshot ring alloc failed!\n");
+		return false;
+	}
+	Rewind.count = count;
+	Rewind.interval = interval;
+	Rewind.countdown = interval;
+	return true;
+}
+
+/**
+ * Called on each VBL, take snapshot (after current instruction)
+ * when interval is full
+ */
+void Rewind_Vbl(void)
+{
+	MemorySnapShot_Buffer_t *snap;
+
+	if (!Rewind.interval || RewindReplaying) {
+		return;
+	}
+	if (--Rewind.countdown > 0) {
+		return;
+	}
+	Rewind.countdown = Rewind.interval;
+
+	if (Rewind.used == Rewind.count) {
+		/* re-use oldest */
+		snap = Rewind_Slot(0);
+		Rewind.first = (Rewind.first + 1) % Rewind.count;
+	} else {
+		snap = Rewind_Slot(Rewind.used++);
+	}
+	/* not valid until captured */
+	snap->size = 0;
+	MemorySnapShot_CaptureBuffer(snap);
+}
+
+/**
+ * Return newest snapshot taken before given cycle counter value, or -1
+ */
+static int Rewind_FindSlot(uint64_t cycles)
+{
+	int i;
+
+	for (i = Rewind.used - 1; i >= 0; i--) {
+		const MemorySnapShot_Buffer_t *snap = Rewind_Slot(i);
+		if (snap->size && snap->cycles < cycles) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Drop snapshots newer than current position, they're not anymore
+ * valid when emulation continues from here
+ */
+static void Rewind_DropNewer(void)
+{
+	while (Rewind.used && Rewind_Slot(Rewind.used - 1)->cycles > CyclesGlobalClockCounter) {
+		Rewind.used--;
+	}
+	Rewind.countdown = Rewind.interval;
+}
+
+/**
+ * Restore given snapshot and start replaying from it in given mode
+ */
+static void Rewind_Restore(int slot, replay_mode_t mode)
+{
+	Replay.slot = slot;
+	Replay.mode = mode;
+	Replay.executed = 0;
+	RewindReplaying = true;
+	MemorySnapShot_RestoreBuffer(Rewind_Slot(slot));
+}
+
+/**
+ * Start going back 'steps' CPU instructions, or to previous breakpoint
+ * hit with 'to_break'.  Emulation needs to be continued for this to
+ * proceed, debugger is entered when target position is reached.
+ * Return false if there's no snapshot to go back to.
+ */
+bool Rewind_Back(uint32_t steps, bool to_break)
+{
+	int slot = Rewind_FindSlot(CyclesGlobalClockCounter);
+
+	if (slot < 0) {
+		fprintf(stderr, "ERROR: no rewind snapshot before current position!\n");
+		return false;
+	}
+	Replay.end = CyclesGlobalClockCounter;
+	Replay.steps = steps;
+	Replay.to_break = to_break;
+	Replay.lasthit = 0;
+	DebugCpu_SetSteps(0);
+	Rewind_Restore(slot, REPLAY_COUNT);
+	return true;
+}
+
+/**
+ * Instructions up to rewind start position have been counted,
+ * start replay to the target position, or continue counting
+ * from an earlier snapshot if target is before current one.
+ */
+static void Rewind_Counted(void)
+{
+	uint32_t executed = Replay.executed;
+
+	if (Replay.to_break ? Replay.lasthit > 0 : executed > Replay.steps) {
+		Replay.target = Replay.to_break ? Replay.lasthit : executed - Replay.steps;
+		Rewind_Restore(Replay.slot, REPLAY_RUN);
+		return;
+	}
+	if (Replay.slot > 0 && Rewind_Slot(Replay.slot - 1)->size) {
+		if (!Replay.to_break) {
+			Replay.steps -= executed;
+		}
+		Replay.end = Rewind_Slot(Replay.slot)->cycles;
+		Rewind_Restore(Replay.slot - 1, REPLAY_COUNT);
+		return;
+	}
+	if (Replay.to_break) {
+		fprintf(stderr, "No earlier breakpoint hits, stopping after oldest rewind snapshot.\n");
+	} else {
+		fprintf(stderr, "Stopping after oldest rewind snapshot.\n");
+	}
+	Replay.target = 1;
+	Rewind_Restore(Replay.slot, REPLAY_RUN);
+}
+
+/**
+ * Called after each CPU instruction while replaying
+ */
+void Rewind_Replay(void)
+{
+	const memwatch_hit_t *hits;
+	bool hit = false;
+
+	Replay.executed++;
+	if (Replay.mode == REPLAY_COUNT && Replay.to_break) {
+		hit = BreakCond_CheckCpu();
+	}
+	/* replay doesn't trigger watchpoints */
+	if (MemWatch_HitCount) {
+		MemWatch_GetHits(&hits);
+		M68000_RestoreDebugger();
+	}
+
+	switch (Replay.mode) {
+	case REPLAY_COUNT:
+		if (CyclesGlobalClockCounter < Replay.end) {
+			if (hit) {
+				Replay.lasthit = Replay.executed;
+			}
+			return;
+		}
+		Rewind_Counted();
+		return;
+
+	case REPLAY_RUN:
+		if (Replay.executed < Replay.target) {
+			return;
+		}
+		Replay.mode = REPLAY_NONE;
+		RewindReplaying = false;
+		Rewind_DropNewer();
+		DebugUI(Replay.to_break ? REASON_CPU_BREAKPOINT : REASON_CPU_STEPS);
+		return;
+
+	default:
+		RewindReplaying = false;
+		return;
+	}
+}
+
+/**
+ * Show rewind snapshot information
+ */
+static void Rewind_Info(void)
+{
+	int i;
+
+	if (!Rewind.interval) {
+		fprintf(stderr, "Rewind snapshots are disabled.\n");
+		return;
+	}
+	fprintf(stderr, "Rewind snapshot every %d VBLs, %d/%d snapshots:\n",
+		Rewind.interval, Rewind.used, Rewind.count);
+	for (i = 0; i < Rewind.used; i++) {
+		const MemorySnapShot_Buffer_t *snap = Rewind_Slot(i);
+		if (!snap->size) {
+			continue;
+		}
+		fprintf(stderr, "- %"PRIu64" cycles ago, %zu bytes + %d RAM pages\n",
+			CyclesGlobalClockCounter - snap->cycles, snap->size, snap->pagecount);
+	}
+	fprintf(stderr, "RAM pages shared between snapshots use %zu bytes.\n",
+		MemorySnapShot_SharedPagesSize());
+}
+
+/**
+ * Readline callback
+ */
+char *Rewind_Match(const char *text, int state)
+{
+	static const char* cmds[] = { "cont", "off", "on", "step" };
+	return DebugUI_MatchHelper(cmds, ARRAY_SIZE(cmds), text, state);
+}
+
+const char Rewind_Description[] =
+	"[on [interval] [count]|off|step [count]|cont]\n"
+	"\t'on' enables taking in-memory snapshots of emulation state every\n"
+	"\t<interval> VBLs (default 10), of which <count> newest ones are\n"
+	"\tkept (default 16), 'off' disables and frees them.\n"
+	"\t'step' goes back given number of CPU instructions (default 1),\n"
+	"\t'cont' back to previous CPU breakpoint or watchpoint hit (hit\n"
+	"\tcounts and actions are ignored).  This is done by restoring the\n"
+	"\tnearest earlier snapshot and re-executing from it, so user input\n"
+	"\tduring the re-executed period is lost.\n"
+	"\tWithout arguments, shows information about the snapshots.";
+
+/**
+ * Command: rewind CPU execution
+ */
+int Rewind_Command(int nArgc, char *psArgs[])
+{
+	int interval = REWIND_INTERVAL_DEFAULT;
+	int count = REWIND_COUNT_DEFAULT;
+	int steps = 1;
+
+	if (nArgc < 2) {
+		Rewind_Info();
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "on") == 0) {
+		if (nArgc > 2) {
+			interval = atoi(psArgs[2]);
+		}
+		if (nArgc > 3) {
+			count = atoi(psArgs[3]);
+		}
+		if (interval <= 0 || count <= 0) {
+			fprintf(stderr, "ERROR: invalid snapshot interval or count!\n");
+			return DEBUGGER_CMDDONE;
+		}
+		if (Rewind_Enable(interval, count)) {
+			fprintf(stderr, "Rewind snapshot every %d VBLs, max. %d snapshots.\n",
+				interval, count);
+		}
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "off") == 0) {
+		Rewind_Free();
+		fprintf(stderr, "Rewind snapshots disabled.\n");
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "step") == 0) {
+		if (nArgc > 2) {
+			steps = atoi(psArgs[2]);
+		}
+		if (steps <= 0) {
+			fprintf(stderr, "ERROR: invalid step count!\n");
+			return DEBUGGER_CMDDONE;
+		}
+		if (Rewind_Back(steps, false)) {
+			fprintf(stderr, "Rewinding %d CPU instructions...\n", steps);
+			return DEBUGGER_END;
+		}
+		return DEBUGGER_CMDDONE;
+	}
+	if (strcmp(psArgs[1], "cont") == 0) {
+		if (Rewind_Back(0, true)) {
+			fprintf(stderr, "Rewinding to previous breakpoint hit...\n");
+			return DEBUGGER_END;
+		}
+		return DEBUGGER_CMDDONE;
+	}
+	return DebugUI_PrintCmdHelp(psArgs[0]);
+}
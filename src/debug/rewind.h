@@ -0,0 +1,26 @@
+/*
+  Hatari - rewind.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_REWIND_H
+#define HATARI_REWIND_H
+
+/* whether execution is being replayed from a snapshot */
+extern bool RewindReplaying;
+
+/* for video.c */
+extern void Rewind_Vbl(void);
+
+/* for debugcpu.c */
+extern void Rewind_Replay(void);
+extern const char Rewind_Description[];
+extern char *Rewind_Match(const char *text, int state);
+extern int Rewind_Command(int nArgc, char *psArgs[]);
+
+/* for remotedebug.c */
+extern bool Rewind_Back(uint32_t steps, bool to_break);
+
+#endif
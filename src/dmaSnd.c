@@ -681,6 +681,48 @@ void DmaSnd_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Same as DmaSnd_GenerateSamples(), but only pull from the FIFO the bytes
+ * that would have been played during 'nSamplesToSkip' samples, without
+ * filtering and mixing them. The DMA frame counter and the end of frame
+ * interrupts are updated exactly as when generating samples.
+ * (Called by sound.c when output samples are not needed)
+ */
+void DmaSnd_SkipSamples(int nSamplesToSkip)
+{
+	int i;
+	int nBytes;
+	unsigned n;
+	int64_t FreqRatio;
+
+	if ( !(nDmaSoundControl & DMASNDCTRL_PLAY) && ( dma.FIFO_NbBytes == 0 ) )
+		return;
+
+	nBytes = ( dma.soundMode & DMASNDMODE_MONO ) ? 1 : 2;
+	FreqRatio = ( ((int64_t)DmaSnd_DetectSampleRate()) << 32 ) / nAudioFrequency;
+
+	if ( DmaInitSample )
+	{
+		for ( i = 0 ; i < nBytes ; i++ )
+			DmaSnd_FIFO_PullByte ();
+		DmaInitSample = false;
+	}
+
+	for (i = 0; i < nSamplesToSkip; i++)
+	{
+		frameCounter_float += FreqRatio;
+		n = ( frameCounter_float >> 32 ) * nBytes;	/* number of bytes to skip */
+		while ( n > 0 )
+		{
+			DmaSnd_FIFO_PullByte ();
+			n--;
+		}
+		frameCounter_float &= 0xffffffff;		/* only keep the fractional part */
+	}
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Apply LMC1992 sound modifications (Bass and Treble)
@@ -2083,6 +2083,36 @@ void Crossbar_GenerateSamples(int nMixBufIdx, int nSamplesToGenerate)
 }
 
 
+/**
+ * Same as Crossbar_GenerateSamples(), but only update the DAC and ADC
+ * read positions for 'nSamplesToSkip' samples without mixing them.
+ * (Called by sound.c when output samples are not needed)
+ */
+void Crossbar_SkipSamples(int nSamplesToSkip)
+{
+	uint64_t total;
+
+	if (crossbar.isDacMuted) {
+		dac.readPosition = (dac.writePosition-DACBUFFER_SIZE/2)%DACBUFFER_SIZE;
+		crossbar.adc2dac_readBufferPosition = adc.writePosition;
+		return;
+	}
+
+	/* Same as adding frequence_ratio for each sample */
+	total = dac.readPosition_float + (uint64_t)crossbar.frequence_ratio * nSamplesToSkip;
+	dac.readPosition = (dac.readPosition + (total >> 32)) % DACBUFFER_SIZE;
+	dac.readPosition_float = total & 0xffffffff;
+
+	total = crossbar.adc2dac_readBufferPosition_float + (uint64_t)crossbar.frequence_ratio * nSamplesToSkip;
+	crossbar.adc2dac_readBufferPosition = (crossbar.adc2dac_readBufferPosition + (total >> 32)) % DACBUFFER_SIZE;
+	crossbar.adc2dac_readBufferPosition_float = total & 0xffffffff;
+
+	if ( dac.wordCount == 0 )
+		dac.writePosition = (dac.readPosition+DACBUFFER_SIZE/2)%DACBUFFER_SIZE;
+	dac.wordCount = 0;
+}
+
+
 /**
  * display the Crossbar registers values (for debugger info command)
  */
@@ -20,6 +20,10 @@
 */
 
 #include <ctype.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <SDL_thread.h>
+#include <SDL_atomic.h>
 
 #include "main.h"
 #include "sysdeps.h"
@@ -31,6 +35,8 @@
 #include "cycles.h"
 #include "cycInt.h"
 #include "m68000.h"
+#include "benchmark.h"
+#include "log.h"
 
 #if ENABLE_DSP_EMU
 #include "debugdsp.h"
@@ -69,6 +75,499 @@ bool bDspHostInterruptPending = false;
 uint64_t	DSP_CyclesGlobalClockCounter = 0;			/* Value of CyclesGlobalClockCounter when DSP_Run was last called */
 
 
+#if ENABLE_DSP_EMU
+/*
+ * Threaded DSP execution (--dsp-thread)
+ *
+ * The DSP thread only executes cycles which were already given to the DSP
+ * by DSP_Run(), so it always lags behind the CPU, by at most
+ * DSP_THREAD_MAX_LAG cycles. Crossbar SSI receive events, which only
+ * write to the DSP, are queued with the DSP cycle at which they happened
+ * and the DSP thread handles them when it reaches that cycle.
+ *
+ * Host port and SSI transmit accesses need the DSP state at current
+ * cycle, so they first wait for the thread to catch up : execute all
+ * the cycles given to it and go idle. The CPU side then accesses the
+ * DSP core directly and the thread continues with the next cycles.
+ * If such accesses come more often than every DSP_THREAD_CATCHUP
+ * cycles (e.g. host port polling, SSI transmit frames), waking the
+ * thread for the few cycles in between costs more than it gives, so
+ * the CPU side syncs with the thread instead.
+ *
+ * On sync (also done for debugger, reset and snapshots) the CPU side
+ * waits for the thread, runs the remaining DSP cycles itself, and then
+ * continues in lockstep mode for a while before giving the DSP back to
+ * the thread. That lockstep window doubles whenever the thread had the
+ * DSP for a shorter time than the window, and halves otherwise, so DSP
+ * programs needing frequent syncs stay in lockstep mode, instead of
+ * being handed to the thread just to be taken back right away.
+ * DSP state at sync / catch-up is the same as without the thread.
+ *
+ * The DSP thread can't touch CPU side state, so it's used only when DSP
+ * host interrupts and DMA handshake mode are disabled. If the DSP enables
+ * handshake mode itself, its calls to the crossbar are deferred, the
+ * thread stops, and the CPU side handles them at its next DSP_Run() call
+ * (i.e. somewhat late) before syncing.
+ */
+#define DSP_THREAD_BATCH	4096			/* DSP cycles given to the thread at once */
+#define DSP_THREAD_MAX_LAG	(8*DSP_THREAD_BATCH)	/* max DSP cycles not yet taken by the thread */
+#define DSP_THREAD_CATCHUP	DSP_THREAD_BATCH	/* min DSP cycles between catch-ups */
+#define DSP_THREAD_LOCKSTEP_MIN	(2*DSP_THREAD_BATCH)	/* min/max DSP cycles to run in lockstep after a sync */
+#define DSP_THREAD_LOCKSTEP_MAX	(256*DSP_THREAD_BATCH)
+#define DSP_THREAD_MSG_SIZE	2048			/* SSI message queue size (power of 2) */
+#define DSP_THREAD_EVENTS	8			/* max deferred events per instruction */
+
+enum {
+	DSP_MSG_SSI_RX,			/* CPU -> DSP messages */
+	DSP_MSG_SSI_SC0,
+	DSP_MSG_SSI_SC1,
+	DSP_MSG_SSI_SC2,
+	DSP_EVENT_HREQ,			/* DSP -> CPU deferred events */
+	DSP_EVENT_SSI_SC1,
+	DSP_EVENT_SSI_SC2
+};
+
+enum {
+	DSP_SYNC_HOSTPORT,
+	DSP_SYNC_SSI,
+	DSP_SYNC_EVENT,
+	DSP_SYNC_QUEUE,
+	DSP_SYNC_OTHER,
+	DSP_SYNC_MAX
+};
+
+static const char *dsp_sync_name[DSP_SYNC_MAX] = {
+	"host port", "SSI transmit", "deferred DSP event",
+	"SSI queue full", "debugger/reset/snapshot"
+};
+
+typedef struct {
+	int64_t stamp;			/* DSP cycle of the message */
+	int type;
+	uint32_t value;
+} dsp_thread_msg_t;
+
+static struct
+{
+	SDL_Thread *thread;
+	SDL_threadID id;
+	SDL_mutex *mutex;
+	SDL_cond *wake;			/* CPU -> thread: cycles given, or quit */
+	SDL_cond *idle;			/* thread -> CPU: cycles taken, or thread idle */
+	SDL_atomic_t budget;		/* DSP cycles given to the thread, not yet taken */
+	SDL_atomic_t running;		/* thread isn't waiting for cycles */
+	SDL_atomic_t stop;		/* thread stopped for deferred events */
+	SDL_atomic_t throttled;		/* CPU waits for the thread to take cycles */
+	bool quit;
+	bool threaded;			/* DSP core is owned by the thread */
+	int lockstep;			/* DSP cycles to run in lockstep before using the thread */
+	int window;			/* current lockstep window length */
+	int unpublished;		/* DSP cycles not yet given to the thread */
+	int64_t granted;		/* DSP cycles given since thread got the DSP */
+	int64_t clock;			/* DSP cycles executed since thread got the DSP */
+	int64_t caughtup;		/* value of granted at last catch-up */
+	dsp_thread_msg_t msg[DSP_THREAD_MSG_SIZE];
+	SDL_atomic_t msg_write, msg_read;
+	dsp_thread_msg_t event[DSP_THREAD_EVENTS];
+	int events;
+	/* statistics */
+	uint64_t syncs[DSP_SYNC_MAX];
+	uint64_t catchups[DSP_SYNC_MAX];
+	uint64_t handovers, refused, messages, deferred, throttles;
+	uint64_t cycles_threaded, cycles_lockstep;
+} DspThread;
+
+static void DSP_TriggerHostInterrupt(int hreq);
+
+
+/**
+ * Handle queued SSI messages with a stamp up to given DSP cycle
+ */
+static void DSP_Thread_HandleMessages(int64_t until)
+{
+	dsp_thread_msg_t *msg;
+	int r = SDL_AtomicGet(&DspThread.msg_read);
+	int w = SDL_AtomicGet(&DspThread.msg_write);
+
+	for (; r != w; r++)
+	{
+		msg = &DspThread.msg[r & (DSP_THREAD_MSG_SIZE-1)];
+		if (msg->stamp > until)
+			break;
+		switch (msg->type)
+		{
+		case DSP_MSG_SSI_RX:
+			dsp_core.ssi.received_value = msg->value & 0xffffff;
+			break;
+		case DSP_MSG_SSI_SC0:
+			dsp_core_ssi_Receive_SC0();
+			break;
+		case DSP_MSG_SSI_SC1:
+			dsp_core_ssi_Receive_SC1(msg->value);
+			break;
+		case DSP_MSG_SSI_SC2:
+			dsp_core_ssi_Receive_SC2(msg->value);
+			break;
+		}
+	}
+	SDL_AtomicSet(&DspThread.msg_read, r);
+}
+
+/**
+ * Execute DSP instructions until given cycles are used (save_cycles <= 0)
+ * or an event got deferred, handling queued messages on the way.
+ */
+static void DSP_Thread_Execute(void)
+{
+	while (save_cycles > 0 && !DspThread.events)
+	{
+		if (SDL_AtomicGet(&DspThread.msg_read) != SDL_AtomicGet(&DspThread.msg_write))
+			DSP_Thread_HandleMessages(DspThread.clock);
+		dsp56k_execute_instruction();
+		save_cycles -= dsp_core.instr_cycle;
+		DspThread.clock += dsp_core.instr_cycle;
+	}
+}
+
+/**
+ * DSP thread main loop
+ */
+static int DSP_Thread(void *data)
+{
+	SDL_LockMutex(DspThread.mutex);
+	for (;;)
+	{
+		SDL_AtomicSet(&DspThread.running, 0);
+		while ((!SDL_AtomicGet(&DspThread.budget) || DspThread.events) && !DspThread.quit)
+		{
+			SDL_CondBroadcast(DspThread.idle);
+			SDL_CondWait(DspThread.wake, DspThread.mutex);
+		}
+		if (DspThread.quit)
+			break;
+		SDL_AtomicSet(&DspThread.running, 1);
+		SDL_UnlockMutex(DspThread.mutex);
+
+		save_cycles += SDL_AtomicSet(&DspThread.budget, 0);
+		if (SDL_AtomicGet(&DspThread.throttled))
+		{
+			SDL_LockMutex(DspThread.mutex);
+			SDL_CondBroadcast(DspThread.idle);
+			SDL_UnlockMutex(DspThread.mutex);
+		}
+		DSP_Thread_Execute();
+
+		SDL_LockMutex(DspThread.mutex);
+	}
+	SDL_UnlockMutex(DspThread.mutex);
+	return 0;
+}
+
+/**
+ * If called from the DSP thread, store event to be handled by the CPU
+ * side and stop the thread after current instruction. Return true if
+ * event was deferred, false if caller should handle it directly.
+ */
+static bool DSP_Thread_DeferEvent(int type, uint32_t value)
+{
+	if (!DspThread.thread || SDL_ThreadID() != DspThread.id)
+		return false;
+
+	assert(DspThread.events < DSP_THREAD_EVENTS);
+	DspThread.event[DspThread.events].type = type;
+	DspThread.event[DspThread.events].value = value;
+	DspThread.event[DspThread.events].stamp = DspThread.clock;
+	DspThread.events++;
+	SDL_AtomicSet(&DspThread.stop, 1);
+	return true;
+}
+
+/**
+ * Handle events deferred by the DSP thread (DSP core is synced)
+ */
+static void DSP_Thread_HandleEvents(void)
+{
+	int i;
+
+	for (i = 0; i < DspThread.events; i++)
+	{
+		switch (DspThread.event[i].type)
+		{
+		case DSP_EVENT_HREQ:
+			DSP_TriggerHostInterrupt(DspThread.event[i].value);
+			break;
+		case DSP_EVENT_SSI_SC1:
+			Crossbar_DmaPlayInHandShakeMode();
+			break;
+		case DSP_EVENT_SSI_SC2:
+			Crossbar_DmaRecordInHandShakeMode_Frame(DspThread.event[i].value);
+			break;
+		}
+	}
+	DspThread.deferred += DspThread.events;
+	DspThread.events = 0;
+	SDL_AtomicSet(&DspThread.stop, 0);
+}
+
+/**
+ * Wait until the thread is idle : it has executed all the cycles given
+ * to it, or it stopped for deferred events.
+ */
+static void DSP_Thread_WaitIdle(void)
+{
+	SDL_LockMutex(DspThread.mutex);
+	while (SDL_AtomicGet(&DspThread.running)
+	       || (SDL_AtomicGet(&DspThread.budget) && !SDL_AtomicGet(&DspThread.stop)))
+		SDL_CondWait(DspThread.idle, DspThread.mutex);
+	SDL_UnlockMutex(DspThread.mutex);
+}
+
+/**
+ * Take the DSP core back from the thread : wait until the thread is idle,
+ * handle its deferred events and run the DSP cycles it didn't execute yet.
+ * Afterwards DSP runs in lockstep with the CPU for a while.
+ */
+static void DSP_Thread_Sync(int reason)
+{
+	if (!DspThread.threaded)
+		return;
+
+	DSP_Thread_WaitIdle();
+
+	DspThread.threaded = false;
+	DspThread.syncs[reason]++;
+	if (DspThread.granted < DspThread.window)
+	{
+		if (DspThread.window < DSP_THREAD_LOCKSTEP_MAX)
+			DspThread.window *= 2;
+	}
+	else if (DspThread.window > DSP_THREAD_LOCKSTEP_MIN)
+		DspThread.window /= 2;
+	DspThread.lockstep = DspThread.window;
+
+	DSP_Thread_HandleEvents();
+
+	save_cycles += DspThread.unpublished + SDL_AtomicSet(&DspThread.budget, 0);
+	DspThread.unpublished = 0;
+	DSP_Thread_Execute();
+	DSP_Thread_HandleMessages(INT64_MAX);
+}
+
+/**
+ * Give accumulated DSP cycles to the thread. If the thread is too much
+ * behind, wait until it takes them.
+ */
+static void DSP_Thread_Publish(void)
+{
+	if (SDL_AtomicGet(&DspThread.budget) > DSP_THREAD_MAX_LAG)
+	{
+		DspThread.throttles++;
+		SDL_LockMutex(DspThread.mutex);
+		SDL_AtomicSet(&DspThread.throttled, 1);
+		while (SDL_AtomicGet(&DspThread.budget) > DSP_THREAD_MAX_LAG
+		       && !SDL_AtomicGet(&DspThread.stop))
+			SDL_CondWait(DspThread.idle, DspThread.mutex);
+		SDL_AtomicSet(&DspThread.throttled, 0);
+		SDL_UnlockMutex(DspThread.mutex);
+	}
+
+	SDL_AtomicAdd(&DspThread.budget, DspThread.unpublished);
+	DspThread.unpublished = 0;
+	if (!SDL_AtomicGet(&DspThread.running))
+	{
+		SDL_LockMutex(DspThread.mutex);
+		SDL_CondSignal(DspThread.wake);
+		SDL_UnlockMutex(DspThread.mutex);
+	}
+}
+
+/**
+ * Queue SSI message for the DSP thread, stamped with current DSP cycle.
+ * Return false if DSP isn't threaded and caller should handle it directly.
+ */
+static bool DSP_Thread_PostMessage(int type, uint32_t value)
+{
+	dsp_thread_msg_t *msg;
+	int w;
+
+	if (!DspThread.threaded)
+		return false;
+
+	w = SDL_AtomicGet(&DspThread.msg_write);
+	if (w - SDL_AtomicGet(&DspThread.msg_read) >= DSP_THREAD_MSG_SIZE)
+	{
+		DSP_Thread_Sync(DSP_SYNC_QUEUE);
+		return false;
+	}
+
+	msg = &DspThread.msg[w & (DSP_THREAD_MSG_SIZE-1)];
+	msg->stamp = DspThread.granted;
+	msg->type = type;
+	msg->value = value;
+	SDL_AtomicSet(&DspThread.msg_write, w + 1);
+	DspThread.messages++;
+	return true;
+}
+
+/**
+ * Whether DSP doesn't use features which would need the DSP thread
+ * to access the CPU side
+ */
+static bool DSP_Thread_Allowed(void)
+{
+	return !(bDspDebugging || bDspHostInterruptPending
+		 || (dsp_core.hostport[CPU_HOST_ICR] & ((1<<CPU_HOST_ICR_RREQ)|(1<<CPU_HOST_ICR_TREQ)))
+		 || (dsp_core.periph[DSP_SPACE_X][DSP_PCDDR] & 0x30));
+}
+
+/**
+ * Let the DSP thread execute all DSP cycles given so far and wait until
+ * it's idle, so that the CPU side can access the DSP core at the current
+ * cycle without taking it from the thread.  Syncs instead if that's done
+ * too often, or if the thread stopped for deferred events.
+ */
+static void DSP_Thread_CatchUp(int reason)
+{
+	if (!DspThread.threaded || DspThread.caughtup == DspThread.granted)
+		return;
+
+	if (DspThread.granted - DspThread.caughtup < DSP_THREAD_CATCHUP
+	    || SDL_AtomicGet(&DspThread.stop))
+	{
+		DSP_Thread_Sync(reason);
+		return;
+	}
+	DSP_Thread_Publish();
+	DSP_Thread_WaitIdle();
+	if (SDL_AtomicGet(&DspThread.stop))
+	{
+		DSP_Thread_Sync(reason);
+		return;
+	}
+	DSP_Thread_HandleMessages(INT64_MAX);
+	DspThread.caughtup = DspThread.granted;
+	DspThread.catchups[reason]++;
+}
+
+/**
+ * Called after the CPU side has accessed DSP core of an idle DSP thread.
+ * Take the DSP core back from the thread if DSP isn't allowed to run
+ * in it anymore.
+ */
+static void DSP_Thread_CaughtUp(int reason)
+{
+	if (DspThread.threaded && !DSP_Thread_Allowed())
+		DSP_Thread_Sync(reason);
+}
+
+/**
+ * Stop DSP thread, it's started again when DSP is handed over to it
+ */
+void DSP_Thread_UnInit(void)
+{
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
+	if (DspThread.thread)
+	{
+		SDL_LockMutex(DspThread.mutex);
+		DspThread.quit = true;
+		SDL_CondSignal(DspThread.wake);
+		SDL_UnlockMutex(DspThread.mutex);
+		SDL_WaitThread(DspThread.thread, NULL);
+		DspThread.thread = NULL;
+	}
+	if (DspThread.wake)
+	{
+		SDL_DestroyCond(DspThread.wake);
+		DspThread.wake = NULL;
+	}
+	if (DspThread.idle)
+	{
+		SDL_DestroyCond(DspThread.idle);
+		DspThread.idle = NULL;
+	}
+	if (DspThread.mutex)
+	{
+		SDL_DestroyMutex(DspThread.mutex);
+		DspThread.mutex = NULL;
+	}
+}
+
+/**
+ * Start DSP thread.  Return false on failure.
+ */
+static bool DSP_Thread_Init(void)
+{
+	DspThread.mutex = SDL_CreateMutex();
+	DspThread.wake = SDL_CreateCond();
+	DspThread.idle = SDL_CreateCond();
+	if (DspThread.mutex && DspThread.wake && DspThread.idle)
+	{
+		DspThread.quit = false;
+		DspThread.thread = SDL_CreateThread(DSP_Thread, "dsp", NULL);
+		if (DspThread.thread)
+		{
+			DspThread.id = SDL_GetThreadID(DspThread.thread);
+			return true;
+		}
+	}
+	Log_Printf(LOG_WARN, "Failed to start DSP thread: %s\n", SDL_GetError());
+	ConfigureParams.System.bDspThread = false;
+	DSP_Thread_UnInit();
+	return false;
+}
+
+/**
+ * Called from lockstep DSP_Run() when the lockstep period is over :
+ * give the DSP core to the thread if the DSP doesn't use features
+ * which would need it to access the CPU side.
+ */
+static void DSP_Thread_Handover(void)
+{
+	DspThread.lockstep = DspThread.window;
+
+	if (!DSP_Thread_Allowed())
+	{
+		DspThread.refused++;
+		return;
+	}
+	if (!DspThread.thread && !DSP_Thread_Init())
+		return;
+
+	DspThread.granted = 0;
+	DspThread.caughtup = -DSP_THREAD_CATCHUP;
+	DspThread.clock = -save_cycles;
+	DspThread.unpublished = 0;
+	DspThread.handovers++;
+	DspThread.threaded = true;
+}
+
+/**
+ * Show DSP thread statistics
+ */
+static void DSP_Thread_Info(FILE *fp)
+{
+	uint64_t total = DspThread.cycles_threaded + DspThread.cycles_lockstep;
+	int i;
+
+	if (!DspThread.handovers && !DspThread.refused)
+		return;
+
+	fprintf(fp, "DSP thread: %"PRIu64" handovers, %"PRIu64" refused, %.1f%% of DSP cycles threaded\n",
+		DspThread.handovers, DspThread.refused,
+		total ? 100.0 * DspThread.cycles_threaded / total : 0.0);
+	fprintf(fp, "  %"PRIu64" SSI messages queued, %"PRIu64" DSP events deferred, %"PRIu64" waits for DSP thread\n",
+		DspThread.messages, DspThread.deferred, DspThread.throttles);
+	fputs("  syncs:", fp);
+	for (i = 0; i < DSP_SYNC_MAX; i++)
+		fprintf(fp, "%s %"PRIu64" %s", i ? "," : "", DspThread.syncs[i], dsp_sync_name[i]);
+	fprintf(fp, "\n  catch-ups: %"PRIu64" %s, %"PRIu64" %s\n",
+		DspThread.catchups[DSP_SYNC_HOSTPORT], dsp_sync_name[DSP_SYNC_HOSTPORT],
+		DspThread.catchups[DSP_SYNC_SSI], dsp_sync_name[DSP_SYNC_SSI]);
+	fprintf(fp, "  lockstep window: %d DSP cycles\n", DspThread.window);
+}
+#endif
+
+
 /**
  * Trigger HREQ interrupt at the host CPU.
  */
@@ -77,6 +576,12 @@ static void DSP_TriggerHostInterrupt(int hreq)
 {
 //fprintf ( stderr, "DSP_TriggerHostInterrupt %d %x %x\n" , hreq , regs.sr , regs.intmask );
 
+	/* DSP thread can't change CPU state, nothing to do if HREQ doesn't change */
+	if ( hreq == bDspHostInterruptPending && DspThread.thread && SDL_ThreadID() == DspThread.id )
+		return;
+	if ( DSP_Thread_DeferEvent ( DSP_EVENT_HREQ , hreq ) )
+		return;
+
 // TODO [NP] : we should change GPIP bit 3 in MFP instead of using additional SPCFLAG_DSP and DSP_GetHREQ
 	if ( hreq )
 	{
@@ -154,6 +659,7 @@ void DSP_Init(void)
 	dsp_core_init(DSP_TriggerHostInterrupt);
 	dsp56k_init_cpu();
 	save_cycles = 0;
+	DspThread.window = DSP_THREAD_LOCKSTEP_MIN;
 #endif
 }
 
@@ -164,6 +670,8 @@ void DSP_Init(void)
 void DSP_UnInit(void)
 {
 #if ENABLE_DSP_EMU
+	DSP_Thread_UnInit();
+	DSP_Thread_Info(stderr);
 	dsp_core_shutdown();
 	bDspEnabled = false;
 #endif
@@ -176,6 +684,7 @@ void DSP_UnInit(void)
 void DSP_Reset(void)
 {
 #if ENABLE_DSP_EMU
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
 	dsp_core_reset();
 	DSP_TriggerHostInterrupt ( 0 );				/* Clear HREQ */
 	save_cycles = 0;
@@ -204,6 +713,7 @@ void DSP_Enable(void)
 void DSP_Disable(void)
 {
 #if ENABLE_DSP_EMU
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
 	bDspEnabled = false;
 #endif
 }
@@ -215,6 +725,7 @@ void DSP_Disable(void)
 void DSP_MemorySnapShot_Capture(bool bSave)
 {
 #if ENABLE_DSP_EMU
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
 	MemorySnapShot_Store(&bDspEnabled, sizeof(bDspEnabled));
 	MemorySnapShot_Store(&dsp_core, sizeof(dsp_core));
 	MemorySnapShot_Store(&save_cycles, sizeof(save_cycles));
@@ -226,18 +737,49 @@ void DSP_MemorySnapShot_Capture(bool bSave)
 #endif
 }
 
+/**
+ * Wait for the DSP thread to catch up with the CPU.  Needs to be called
+ * before accessing dsp_core directly from outside of the DSP emulation.
+ */
+void DSP_Sync(void)
+{
+#if ENABLE_DSP_EMU
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
+#endif
+}
+
 /**
  * Run DSP for certain cycles
  */
 void DSP_Run(int nHostCycles)
 {
 #if ENABLE_DSP_EMU
+	int BenchPrev;
+
 	if ( nHostCycles == 0 )
 		return;
 
 	DSP_CyclesGlobalClockCounter = CyclesGlobalClockCounter;
 
+	/* DSP thread runs the cycles, CPU side only gives them */
+	if (DspThread.threaded)
+	{
+		DspThread.granted += nHostCycles * 2;
+		DspThread.unpublished += nHostCycles * 2;
+		DspThread.cycles_threaded += nHostCycles * 2;
+		if (SDL_AtomicGet(&DspThread.stop))
+			DSP_Thread_Sync(DSP_SYNC_EVENT);
+		else if (DspThread.unpublished >= DSP_THREAD_BATCH)
+			DSP_Thread_Publish();
+		return;
+	}
+
 	save_cycles += nHostCycles * 2;
+	if (unlikely(ConfigureParams.System.bDspThread))
+	{
+		DspThread.cycles_lockstep += nHostCycles * 2;
+		DspThread.lockstep -= nHostCycles * 2;
+	}
 
 	if (dsp_core.running == 0)
 		return;
@@ -245,6 +787,8 @@ void DSP_Run(int nHostCycles)
 	if (save_cycles <= 0)
 		return;
 
+	BenchPrev = Benchmark_Enter(BENCHMARK_DSP);
+
 	if (unlikely(bDspDebugging))
 	{
 		while (save_cycles > 0)
@@ -264,6 +808,10 @@ void DSP_Run(int nHostCycles)
 		}
 	}
 
+	if (unlikely(ConfigureParams.System.bDspThread) && DspThread.lockstep <= 0)
+		DSP_Thread_Handover();
+
+	Benchmark_Leave(BenchPrev);
 #endif
 }
 
@@ -272,6 +820,9 @@ void DSP_Run(int nHostCycles)
  */
 void DSP_SetDebugging(bool enabled)
 {
+#if ENABLE_DSP_EMU
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
+#endif
 	bDspDebugging = enabled;
 }
 
@@ -281,6 +832,7 @@ void DSP_SetDebugging(bool enabled)
 uint16_t DSP_GetPC(void)
 {
 #if ENABLE_DSP_EMU
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
 	if (bDspEnabled)
 		return dsp_core.pc;
 	else
@@ -301,6 +853,8 @@ uint16_t DSP_GetNextPC(uint16_t pc)
 	if (!bDspEnabled)
 		return 0;
 
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
+
 	/* Save DSP context */
 	memcpy(&dsp_core_save, &dsp_core, sizeof(dsp_core));
 
@@ -326,6 +880,7 @@ uint16_t DSP_GetNextPC(uint16_t pc)
 uint16_t DSP_GetInstrCycles(void)
 {
 #if ENABLE_DSP_EMU
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
 	if (bDspEnabled)
 		return dsp_core.instr_cycle;
 	else
@@ -342,6 +897,7 @@ uint16_t DSP_DisasmAddress(FILE *out, uint16_t lowerAdr, uint16_t UpperAdr)
 #if ENABLE_DSP_EMU
 	uint16_t dsp_pc;
 
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
 	for (dsp_pc=lowerAdr; dsp_pc<=UpperAdr; dsp_pc++) {
 		dsp_pc += dsp56k_execute_one_disasm_instruction(out, dsp_pc);
 	}
@@ -371,6 +927,8 @@ uint32_t DSP_ReadMemory(uint16_t address, char space_id, const char **mem_str)
 	};
 	int idx, space;
 
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
+
 	switch (space_id) {
 	case 'X':
 		space = DSP_SPACE_X;
@@ -448,6 +1006,7 @@ uint16_t DSP_DisasmMemory(FILE *fp, uint16_t dsp_memdump_addr, uint16_t dsp_memd
 	uint32_t mem, mem2, value;
 	const char *mem_str;
 
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
 	for (mem = dsp_memdump_addr; mem <= dsp_memdump_upper; mem++) {
 		/* special printing of host communication/transmit registers */
 		if (space == 'X' && mem >= 0xffc0) {
@@ -493,6 +1052,8 @@ void DSP_Info(FILE *fp, uint32_t dummy)
 	int i, j;
 	const char *stackname[] = { "SSH", "SSL" };
 
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
+
 	fputs("\nDSP core information:\n", fp);
 
 	for (i = 0; i < ARRAY_SIZE(stackname); i++) {
@@ -526,6 +1087,8 @@ void DSP_Info(FILE *fp, uint32_t dummy)
 		fprintf(fp, " %02x", dsp_core.hostport[i]);
 	}
 	fputs("\n", fp);
+
+	DSP_Thread_Info(fp);
 #endif
 }
 
@@ -538,6 +1101,8 @@ void DSP_DisasmRegisters(FILE *fp)
 	uint32_t i;
 	char stack_disasm[16][20];
 
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
+
 	/* Prepare the stack disasm */
 	for (i=0; i<16; i++) {
                if ((dsp_core.registers[DSP_REG_SP] & BITMASK(4)) == i)
@@ -673,6 +1238,7 @@ int DSP_GetRegisterAddress(const char *regname, uint32_t **addr, uint32_t *mask)
 	if (!bDspEnabled) {
 		return 0;
 	}
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
 
 	for (i = 0; i < sizeof(reg) && regname[i]; i++) {
 		reg[i] = toupper((unsigned char)regname[i]);
@@ -720,6 +1286,8 @@ bool DSP_Disasm_SetRegister(const char *arg, uint32_t value)
 	uint32_t *addr, mask, sp_value;
 	int bits;
 
+	DSP_Thread_Sync(DSP_SYNC_OTHER);
+
 	/* first check registers needing special handling... */
 	if (arg[0]=='S' || arg[0]=='s') {
 		if (arg[1]=='P' || arg[1]=='p') {
@@ -774,6 +1342,7 @@ bool DSP_Disasm_SetRegister(const char *arg, uint32_t value)
 uint32_t DSP_SsiReadTxValue(void)
 {
 #if ENABLE_DSP_EMU
+	DSP_Thread_CatchUp(DSP_SYNC_SSI);
 	return dsp_core.ssi.transmit_value;
 #else
 	return 0;
@@ -786,7 +1355,8 @@ uint32_t DSP_SsiReadTxValue(void)
 void DSP_SsiWriteRxValue(uint32_t value)
 {
 #if ENABLE_DSP_EMU
-	dsp_core.ssi.received_value = value & 0xffffff;
+	if (!DSP_Thread_PostMessage(DSP_MSG_SSI_RX, value))
+		dsp_core.ssi.received_value = value & 0xffffff;
 #endif
 }
 
@@ -797,7 +1367,8 @@ void DSP_SsiWriteRxValue(uint32_t value)
 void DSP_SsiReceive_SC0(void)
 {
 #if ENABLE_DSP_EMU
-	dsp_core_ssi_Receive_SC0();
+	if (!DSP_Thread_PostMessage(DSP_MSG_SSI_SC0, 0))
+		dsp_core_ssi_Receive_SC0();
 #endif
 }
 
@@ -810,34 +1381,39 @@ void DSP_SsiTransmit_SC0(void)
 void DSP_SsiReceive_SC1(uint32_t FrameCounter)
 {
 #if ENABLE_DSP_EMU
-	dsp_core_ssi_Receive_SC1(FrameCounter);
+	if (!DSP_Thread_PostMessage(DSP_MSG_SSI_SC1, FrameCounter))
+		dsp_core_ssi_Receive_SC1(FrameCounter);
 #endif
 }
 
 void DSP_SsiTransmit_SC1(void)
 {
 #if ENABLE_DSP_EMU
-	Crossbar_DmaPlayInHandShakeMode();
+	if (!DSP_Thread_DeferEvent(DSP_EVENT_SSI_SC1, 0))
+		Crossbar_DmaPlayInHandShakeMode();
 #endif
 }
 
 void DSP_SsiReceive_SC2(uint32_t FrameCounter)
 {
 #if ENABLE_DSP_EMU
-	dsp_core_ssi_Receive_SC2(FrameCounter);
+	if (!DSP_Thread_PostMessage(DSP_MSG_SSI_SC2, FrameCounter))
+		dsp_core_ssi_Receive_SC2(FrameCounter);
 #endif
 }
 
 void DSP_SsiTransmit_SC2(uint32_t frame)
 {
 #if ENABLE_DSP_EMU
-	Crossbar_DmaRecordInHandShakeMode_Frame(frame);
+	if (!DSP_Thread_DeferEvent(DSP_EVENT_SSI_SC2, frame))
+		Crossbar_DmaRecordInHandShakeMode_Frame(frame);
 #endif
 }
 
 void DSP_SsiReceive_SCK(void)
 {
 #if ENABLE_DSP_EMU
+	DSP_Thread_CatchUp(DSP_SYNC_SSI);
 	dsp_core_ssi_Receive_SCK();
 #endif
 }
@@ -859,6 +1435,9 @@ void DSP_HandleReadAccess(void)
 	uint8_t value;
 	bool multi_access = false;
 
+#if ENABLE_DSP_EMU
+	DSP_Thread_CatchUp(DSP_SYNC_HOSTPORT);
+#endif
 	for (addr = IoAccessBaseAddress; addr < IoAccessBaseAddress+nIoMemAccessSize; addr++)
 	{
 #if ENABLE_DSP_EMU
@@ -886,6 +1465,9 @@ void DSP_HandleWriteAccess(void)
 	uint32_t addr;
 	bool multi_access = false;
 
+#if ENABLE_DSP_EMU
+	DSP_Thread_CatchUp(DSP_SYNC_HOSTPORT);
+#endif
 	for (addr = IoAccessBaseAddress; addr < IoAccessBaseAddress+nIoMemAccessSize; addr++)
 	{
 #if ENABLE_DSP_EMU
@@ -897,4 +1479,7 @@ void DSP_HandleWriteAccess(void)
 			M68000_WaitState(4);
 		multi_access = true;
 	}
+#if ENABLE_DSP_EMU
+	DSP_Thread_CaughtUp(DSP_SYNC_HOSTPORT);
+#endif
 }
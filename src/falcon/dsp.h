@@ -41,6 +41,10 @@ extern void DSP_Reset(void);
 extern void DSP_Enable(void);
 extern void DSP_Disable(void);
 extern void DSP_Run(int nHostCycles);
+extern void DSP_Sync(void);
+#if ENABLE_DSP_EMU
+extern void DSP_Thread_UnInit(void);
+#endif
 
 /* Save Dsp state to snapshot */
 extern void DSP_MemorySnapShot_Capture(bool bSave);
@@ -73,7 +73,6 @@ const char VIDEL_fileid[] = "Hatari videl.c";
 #include "screen.h"
 #include "screenConvert.h"
 #include "avi_record.h"
-#include "statusbar.h"
 #include "stMemory.h"
 #include "tos.h"
 #include "videl.h"
@@ -1007,9 +1006,6 @@ bool VIDEL_renderScreen(void)
 		return false;
 	}
 
-	if (!Screen_Lock())
-		return false;
-
 	/*
 	   I think this implementation is naive:
 	   indeed, I suspect that we should instead skip lineoffset
@@ -1030,15 +1026,10 @@ bool VIDEL_renderScreen(void)
 
 	VIDEL_UpdateColors();
 
-	Screen_GenConvert(videoBase, &STRam[videoBase], videl.XSize, videl.YSize,
-	                  videl.save_scrBpp, nextline, hscrolloffset,
-	                  videl.leftBorderSize, videl.rightBorderSize,
-	                  videl.upperBorderSize, videl.lowerBorderSize);
-
-	Screen_UnLock();
-	Screen_GenConvUpdate(Statusbar_Update(sdlscrn, false), false);
-
-	return true;
+	return Screen_GenConvFrame(videoBase, videl.XSize, videl.YSize,
+	                           videl.save_scrBpp, nextline, hscrolloffset,
+	                           videl.leftBorderSize, videl.rightBorderSize,
+	                           videl.upperBorderSize, videl.lowerBorderSize);
 }
 
 
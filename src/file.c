@@ -783,6 +783,35 @@ void File_UnLock(FILE *fp)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Reopen given file (FILE *) so that it doesn't share its file offset
+ * with other processes, e.g. after fork().  FILE * and its descriptor
+ * number stay the same.  Write access is kept if file can still be
+ * opened for writing.  File needs to have been flushed before fork.
+ * Returns false on failure, in which case file is left as is.
+ */
+bool File_Reopen(FILE *fp, const char *filename)
+{
+	int fd, oldfd = fileno(fp);
+
+	if (oldfd < 0)
+		return false;
+	fd = open(filename, O_RDWR);
+	if (fd < 0)
+		fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+	if (dup2(fd, oldfd) < 0)
+	{
+		close(fd);
+		return false;
+	}
+	close(fd);
+	return true;
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Check if input is available at the specified file descriptor.
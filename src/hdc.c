@@ -973,6 +973,25 @@ bool HDC_Init(void)
 }
 
 
+/*---------------------------------------------------------------------*/
+/**
+ * Reopen image files, so that forked processes don't share
+ * their file offsets with each other.
+ */
+void HDC_ReopenImages(void)
+{
+	int i;
+
+	for (i = 0; bAcsiEmuOn && i < MAX_ACSI_DEVS; i++)
+	{
+		if (AcsiBus.devs[i].enabled &&
+		    !File_Reopen(AcsiBus.devs[i].image_file, ConfigureParams.Acsi[i].sDeviceFile))
+			Log_Printf(LOG_ERROR, "Reopening ACSI HD file '%s' failed!\n",
+				   ConfigureParams.Acsi[i].sDeviceFile);
+	}
+}
+
+
 /*---------------------------------------------------------------------*/
 /**
  * HDC_UnInit - close image file
@@ -2826,3 +2826,20 @@ void Ide_UnInit(void)
 
 	nIDEPartitions = 0;
 }
+
+/**
+ * Reopen image files, so that forked processes don't share
+ * their file offsets with each other.
+ */
+void Ide_ReopenImages(void)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		if (hd_table[i] && bdrv_is_inserted(hd_table[i]) &&
+		    !File_Reopen(hd_table[i]->fhndl, ConfigureParams.Ide[i].sDeviceFile))
+			Log_Printf(LOG_ERROR, "Reopening IDE HD file '%s' failed!\n",
+				   ConfigureParams.Ide[i].sDeviceFile);
+	}
+}
@@ -22,5 +22,6 @@ extern void Audio_Unlock(void);
 extern void Audio_FreeSoundBuffer(void);
 extern void Audio_SetOutputAudioFreq(int Frequency);
 extern void Audio_EnableAudio(bool bEnable);
+extern void Audio_Info(FILE *fp, uint32_t dummy);
 
 #endif  /* HATARI_AUDIO_H */
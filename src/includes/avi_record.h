@@ -11,6 +11,7 @@
 
 #define	AVI_RECORD_VIDEO_CODEC_BMP	1
 #define	AVI_RECORD_VIDEO_CODEC_PNG	2
+#define	AVI_RECORD_VIDEO_CODEC_ZMBV	3
 
 #define	AVI_RECORD_AUDIO_CODEC_PCM	1
 
@@ -26,6 +27,7 @@ extern bool	Avi_RecordAudioStream ( int16_t pSamples[][2] , int SampleIndex , in
 
 extern bool	Avi_AreWeRecording ( void );
 extern bool	Avi_SetCompressionLevel(const char *str);
+extern bool	Avi_SetKeyframeInterval(const char *str);
 extern bool	Avi_StartRecording ( char *FileName , bool CropGui , uint32_t Fps , uint32_t Fps_scale , int VideoCodec );
 extern bool	Avi_StopRecording ( void );
 extern void	Avi_SetSurface(SDL_Surface *surf);
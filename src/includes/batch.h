@@ -0,0 +1,21 @@
+/*
+  Hatari - batch.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+#ifndef HATARI_BATCH_H
+#define HATARI_BATCH_H
+
+/* supported only on POSIX compliant systems */
+#if HAVE_FORK
+extern const char* Batch_SetList(const char *listpath);
+extern void Batch_SetVBLs(uint32_t vbls);
+extern void Batch_Vbl(void);
+#else
+#define Batch_SetList(path) "Batch mode is not supported on this platform."
+#define Batch_SetVBLs(vbls)
+#define Batch_Vbl()
+#endif /* HAVE_FORK */
+
+#endif /* HATARI_BATCH_H */
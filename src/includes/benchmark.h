@@ -0,0 +1,51 @@
+/*
+  Hatari - benchmark.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_BENCHMARK_H
+#define HATARI_BENCHMARK_H
+
+/* Subsystems for which host time is accounted separately,
+ * everything else is accounted to CPU core */
+enum {
+	BENCHMARK_CPU,
+	BENCHMARK_VIDEO,
+	BENCHMARK_SOUND,
+	BENCHMARK_DSP,
+	BENCHMARK_BLITTER,
+	BENCHMARK_SUBSYSTEMS
+};
+
+extern bool bBenchmarkTiming;
+
+extern int Benchmark_Switch(int subsystem);
+
+/**
+ * Start accounting host time to given subsystem.
+ * Return subsystem to give to Benchmark_Leave() at the end.
+ */
+static inline int Benchmark_Enter(int subsystem)
+{
+	if (unlikely(bBenchmarkTiming))
+		return Benchmark_Switch(subsystem);
+	return subsystem;
+}
+
+/**
+ * Return to accounting host time to the subsystem
+ * returned by Benchmark_Enter()
+ */
+static inline void Benchmark_Leave(int previous)
+{
+	if (unlikely(bBenchmarkTiming))
+		Benchmark_Switch(previous);
+}
+
+extern void Benchmark_SetReport(const char *filename);
+extern void Benchmark_Vbl(void);
+extern void Benchmark_WriteReport(void);
+
+#endif
@@ -0,0 +1,19 @@
+/*
+  Hatari - capturePipe.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_CAPTUREPIPE_H
+#define HATARI_CAPTUREPIPE_H
+
+extern bool bCapturePipe;
+
+extern void CapturePipe_SetFile(const char *pszFileName);
+extern bool CapturePipe_Start(void);
+extern void CapturePipe_Stop(void);
+extern void CapturePipe_VideoFrame(void);
+extern void CapturePipe_AudioBlock(int16_t pSamples[][2], int Index, int Length);
+
+#endif
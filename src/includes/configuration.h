@@ -71,6 +71,7 @@ typedef struct
   bool bEnableMicrophone;
   bool bEnableSound;
   bool bEnableSoundSync;
+  bool bFastForwardSound;
   int nPlaybackFreq;
   int SdlAudioBufferSize;
   char szYMCaptureFileName[FILENAME_MAX];
@@ -302,6 +303,8 @@ typedef struct
 {
   MONITORTYPE nMonitorType;
   bool DisableVideo;
+  bool bHeadless;
+  bool bConvertThread;
   bool bFullScreen;
   bool bAllowOverscan;
   bool bAspectCorrect;
@@ -390,6 +393,7 @@ typedef struct
   MACHINETYPE nMachineType;
   bool bBlitter;                  /* TRUE if Blitter is enabled */
   DSPTYPE nDSPType;               /* how to "emulate" DSP */
+  bool bDspThread;                /* run emulated DSP on separate thread */
   int nRtcYear;
   bool bPatchTimerD;
   bool bFastBoot;                 /* Enable to patch TOS for fast boot */
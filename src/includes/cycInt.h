@@ -81,6 +81,14 @@ extern bool	CycInt_InterruptActive(interrupt_id Handler);
 extern int	CycInt_GetActiveInt(void);
 extern void	CycInt_CallActiveHandler(uint64_t Clock);
 
+/* CycInt_Info() arguments */
+#define	CYCINT_INFO_SHOW	1
+#define	CYCINT_INFO_ON		2
+#define	CYCINT_INFO_OFF		3
+
+extern uint32_t	CycInt_InfoArgs(int argc, char *argv[]);
+extern void	CycInt_Info(FILE *fp, uint32_t arg);
+
 static inline void CycInt_Process(void)
 {
 	while ( CycInt_ActiveInt_Cycles <= ( CyclesGlobalClockCounter << CYCINT_SHIFT ) )
@@ -42,6 +42,7 @@ extern FILE *File_Open(const char *path, const char *mode);
 extern FILE *File_Close(FILE *fp);
 extern bool File_Lock(FILE *fp);
 extern void File_UnLock(FILE *fp);
+extern bool File_Reopen(FILE *fp, const char *filename);
 extern bool File_InputAvailable(FILE *fp);
 extern const char *File_Basename(const char *path);
 extern void File_MakeAbsoluteSpecialName(char *pszFileName);
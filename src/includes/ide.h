@@ -14,6 +14,7 @@ extern int nIDEPartitions;
 
 extern void Ide_Init(void);
 extern void Ide_UnInit(void);
+extern void Ide_ReopenImages(void);
 extern bool Ide_IsAvailable(void);
 extern uae_u32 REGPARAM3 Ide_Mem_bget(uaecptr addr);
 extern uae_u32 REGPARAM3 Ide_Mem_wget(uaecptr addr);
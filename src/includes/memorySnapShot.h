@@ -13,3 +13,22 @@ extern void MemorySnapShot_Capture_Immediate(const char *pszFileName, bool bConf
 extern void MemorySnapShot_Capture_Do(void);
 extern void MemorySnapShot_Restore(const char *pszFileName, bool bConfirm);
 extern void MemorySnapShot_Restore_Do(void);
+
+/* In-memory snapshot, large memory areas are stored as pages
+ * shared between all in-memory snapshots with identical content */
+struct MemorySnapShot_Page;
+
+typedef struct {
+	uint8_t *data;
+	size_t size;		/* used bytes, zero if there's no snapshot */
+	size_t alloc;		/* allocated bytes */
+	uint64_t cycles;	/* CyclesGlobalClockCounter at capture */
+	struct MemorySnapShot_Page **pages;
+	int pagecount;		/* used page references */
+	int pagealloc;		/* allocated page references */
+} MemorySnapShot_Buffer_t;
+
+extern void MemorySnapShot_CaptureBuffer(MemorySnapShot_Buffer_t *pBuffer);
+extern void MemorySnapShot_RestoreBuffer(MemorySnapShot_Buffer_t *pBuffer);
+extern void MemorySnapShot_FreeBuffer(MemorySnapShot_Buffer_t *pBuffer);
+extern size_t MemorySnapShot_SharedPagesSize(void);
@@ -13,6 +13,7 @@ extern bool bScsiEmuOn;
 
 bool Ncr5380_Init(void);
 void Ncr5380_UnInit(void);
+void Ncr5380_ReopenImages(void);
 void Ncr5380_Reset(void);
 void Ncr5380_WriteByte(int addr, uint8_t byte);
 uint8_t Ncr5380_ReadByte(int addr);
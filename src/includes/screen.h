@@ -54,6 +54,7 @@ typedef struct
   Uint32 HBLPaletteMasks[HBL_PALETTE_MASKS];
   Uint8 *pSTScreen;             /* Copy of screen built up during frame (copy each line on HBL to simulate monitor raster) */
   Uint8 *pSTScreenCopy;         /* Previous frames copy of above  */
+  Uint8 LineDirty[NUM_VISIBLE_LINES]; /* Lines which may differ between above two */
   int VerticalOverscanCopy;	/* Previous screen overscan mode */
   bool bFullUpdate;             /* Set TRUE to cause full update on next draw */
 } FRAMEBUFFER;
@@ -111,6 +112,8 @@ extern void Screen_SetFullUpdate(void);
 extern void Screen_EnterFullScreen(void);
 extern void Screen_ReturnFromFullScreen(void);
 extern void Screen_ModeChanged(bool bForceChange);
+extern bool Screen_SkipFrame(void);
+extern void Screen_UpdateForCapture(void);
 extern bool Screen_Draw(void);
 extern void Screen_SetTextureScale(int width, int height, int win_width,
                                    int win_height, bool bForceCreation);
@@ -18,6 +18,13 @@ void Screen_GenConvert(uint32_t vaddr, void *fvram, int vw, int vh,
                        int leftBorderSize, int rightBorderSize,
                        int upperBorderSize, int lowerBorderSize);
 
+bool Screen_GenConvFrame(uint32_t vaddr, int vw, int vh, int vbpp,
+                         int nextline, int hscroll,
+                         int leftBorder, int rightBorder,
+                         int upperBorder, int lowerBorder);
+void ScreenConv_Sync(bool show);
+void ScreenConv_UnInit(void);
+
 bool Screen_GenDraw(uint32_t vaddr, int vw, int vh, int vbpp, int nextline,
                     int leftBorderSize, int rightBorderSize,
                     int upperBorderSize, int lowerBorderSize);
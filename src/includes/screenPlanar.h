@@ -0,0 +1,27 @@
+/*
+  Hatari - screenPlanar.h
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+*/
+
+#ifndef HATARI_SCREENPLANAR_H
+#define HATARI_SCREENPLANAR_H
+
+/* Convert 'groups' of 16 pixels in 'bpp' (1, 2, 4 or 8) interleaved
+ * bitplanes to 32-bit pixels, by looking up their colors from 'palette' */
+typedef void (*ScreenPlanar_Func_t)(const uint16_t *fvram, int bpp, int groups,
+                                    const uint32_t *palette, uint32_t *hvram);
+
+typedef struct {
+	const char *name;
+	ScreenPlanar_Func_t func;
+} ScreenPlanar_Kernel_t;
+
+/* Fastest conversion kernel supported by the host CPU, see ScreenPlanar_Init() */
+extern ScreenPlanar_Func_t ScreenPlanar_ToChunky;
+
+extern void ScreenPlanar_Init(void);
+extern int ScreenPlanar_GetKernels(const ScreenPlanar_Kernel_t **kernels);
+
+#endif
@@ -15,7 +15,30 @@
 #define	SCREEN_SNAPSHOT_NEO	3
 #define SCREEN_SNAPSHOT_XIMG	4
 
+/* Growable memory buffer */
+typedef struct {
+	Uint8	*pData;
+	int	Size;				/* bytes used */
+	int	AllocSize;			/* bytes allocated */
+} SCREENSNAPSHOT_BUFFER;
 
+/* Screen image converted for saving, independent of the SDL surface */
+typedef struct {
+	int	Width;
+	int	Height;
+	int	PaletteSize;			/* 0 if pixels are stored as RGB */
+	Uint8	Palette[256][3];
+	SCREENSNAPSHOT_BUFFER	Pixels;		/* 1 byte (palette) or 3 bytes (RGB) per pixel */
+} SCREENSNAPSHOT_IMAGE;
+
+
+extern bool ScreenSnapShot_BufferReserve(SCREENSNAPSHOT_BUFFER *pBuf, int size);
+extern void ScreenSnapShot_BufferFree(SCREENSNAPSHOT_BUFFER *pBuf);
+extern bool ScreenSnapShot_PrepareImage(SDL_Surface *surface, int dw, int dh,
+		int CropLeft , int CropRight , int CropTop , int CropBottom ,
+		SCREENSNAPSHOT_IMAGE *pImage);
+extern int ScreenSnapShot_EncodePNG(const SCREENSNAPSHOT_IMAGE *pImage,
+		int png_compression_level, int png_filter, SCREENSNAPSHOT_BUFFER *pBuf);
 extern int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int destw,
 		int desth, FILE *fp, int png_compression_level, int png_filter,
 		int CropLeft , int CropRight , int CropTop , int CropBottom );
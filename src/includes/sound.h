@@ -16,14 +16,13 @@
 
 
 extern uint8_t SoundRegs[14];		/* store YM regs 0 to 13 */
-extern int	nGeneratedSamples;
 extern bool	bEnvelopeFreqFlag;
 
 #define AUDIOMIXBUFFER_SIZE    16384		/* Size of circular buffer to store samples (eg 44Khz), must be a power of 2 */
 #define AUDIOMIXBUFFER_SIZE_MASK ( AUDIOMIXBUFFER_SIZE - 1 )	/* To limit index values inside AudioMixBuffer[] */
 extern int16_t	AudioMixBuffer[AUDIOMIXBUFFER_SIZE][2];	/* Ring buffer to store mixed audio output (YM2149, DMA sound, ...) */
 extern int	AudioMixBuffer_pos_write;	/* Current writing position into above buffer */
-extern int	AudioMixBuffer_pos_read;	/* Current reading position into above buffer */
+extern int	Sound_BufferOverruns;
 
 extern bool	Sound_BufferIndexNeedReset;
 
@@ -66,6 +65,8 @@ extern int	YM2149_Resample_Method;
 extern void Sound_Init(void);
 extern void Sound_Reset(void);
 extern void Sound_ResetBufferIndex(void);
+extern int Sound_GetQueuedSamples(void);
+extern int Sound_ReadSamples(int16_t *pBuffer, int nSamples);
 extern void Sound_MemorySnapShot_Capture(bool bSave);
 extern void Sound_Stats_Show (void);
 extern void Sound_Update(uint64_t CPU_Clock);
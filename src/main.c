@@ -19,6 +19,8 @@ const char Main_fileid[] = "Hatari main.c";
 #include "options.h"
 #include "dialog.h"
 #include "audio.h"
+#include "batch.h"
+#include "benchmark.h"
 #include "joy.h"
 #include "file.h"
 #include "floppy.h"
@@ -47,6 +49,7 @@ const char Main_fileid[] = "Hatari main.c";
 #include "rtc.h"
 #include "scc.h"
 #include "screen.h"
+#include "screenConvert.h"
 #include "sdlgui.h"
 #include "shortcut.h"
 #include "sound.h"
@@ -57,6 +60,7 @@ const char Main_fileid[] = "Hatari main.c";
 #include "tos.h"
 #include "video.h"
 #include "avi_record.h"
+#include "capturePipe.h"
 #include "debugui.h"
 #include "remotedebug.h"
 #include "clocks_timings.h"
@@ -221,6 +225,8 @@ bool Main_PauseEmulation(bool visualize)
 
 	Audio_EnableAudio(false);
 	bEmulationActive = false;
+	/* show last frame from converter thread */
+	ScreenConv_Sync(true);
 	if (visualize)
 	{
 		Main_PrintSpeed();
@@ -349,10 +355,13 @@ void Main_WaitOnVbl(void)
 	int64_t nDelay;
 
 	nVBLCount++;
+	Benchmark_Vbl();
+	Batch_Vbl();
 	if (nRunVBLs &&	nVBLCount >= nRunVBLs)
 	{
 		/* show VBLs/s */
 		Main_PauseEmulation(true);
+		Benchmark_WriteReport();
 		exit(0);
 	}
 
@@ -699,6 +708,7 @@ void Main_EventHandler(bool remoteDebugging)
 				{
 					/* Hack: Redraw screen here when going into
 					 * fullscreen mode without SDL renderer */
+					ScreenConv_Sync(false);
 					sdlscrn = SDL_GetWindowSurface(sdlWindow);
 					Screen_SetFullUpdate();
 					Statusbar_Init(sdlscrn);
@@ -1085,6 +1095,9 @@ int main(int argc, char *argv[])
 			1 << CLOCKS_TIMINGS_SHIFT_VBL ,
 			ConfigureParams.Video.AviRecordVcodec );
 
+	/* Start raw capture stream if requested */
+	CapturePipe_Start();
+
 	/* Run emulation */
 	Main_UnPauseEmulation();
 	M68000_Start();                 /* Start emulation */
@@ -1097,6 +1110,8 @@ int main(int argc, char *argv[])
 		Statusbar_Update(sdlscrn, true);
 		Avi_StopRecording();
 	}
+	CapturePipe_Stop();
+	Benchmark_WriteReport();
 	/* Un-init emulation system */
 	Main_UnInit();
 
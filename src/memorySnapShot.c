@@ -42,6 +42,7 @@ const char MemorySnapShot_fileid[] = "Hatari memorySnapShot.c";
 #include "mfp.h"
 #include "midi.h"
 #include "psg.h"
+#include "remotedebug.h"
 #include "reset.h"
 #include "scc.h"
 #include "sound.h"
@@ -59,9 +60,11 @@ const char MemorySnapShot_fileid[] = "Hatari memorySnapShot.c";
 #include "hatari-glue.h"
 
 
-#define VERSION_STRING      "2.6.0"   /* Version number of compatible memory snapshots - Always 6 bytes (inc' NULL) */
+#define VERSION_STRING      "2.6.1"   /* Version number of compatible memory snapshots - Always 6 bytes (inc' NULL) */
 #define SNAPSHOT_MAGIC      0xDeadBeef
 
+#define SNAPSHOT_PAGE_SIZE  4096      /* Granularity of memory shared between in-memory snapshots */
+
 #if HAVE_LIBZ
 #define COMPRESS_MEMORYSNAPSHOT       /* Compress snapshots to reduce disk space used */
 #endif
@@ -83,9 +86,34 @@ typedef FILE* MSS_File;
 static MSS_File CaptureFile;
 static bool bCaptureSave, bCaptureError;
 
+/* In-memory snapshot being saved/restored instead of file,
+ * and snapshot to restore on next MemorySnapShot_Restore_Do() */
+static MemorySnapShot_Buffer_t *CaptureBuffer;
+static size_t CaptureBufferPos;
+static int CaptureBufferPage;
+static MemorySnapShot_Buffer_t *RestoreBuffer;
+
+/* Memory pages referenced by in-memory snapshots, hashed by content */
+typedef struct MemorySnapShot_Page
+{
+	struct MemorySnapShot_Page *next;	/* in same hash bucket */
+	uint64_t hash;
+	uint32_t refs;				/* snapshots referring to page */
+	uint8_t data[SNAPSHOT_PAGE_SIZE];
+} MemorySnapShot_Page_t;
+
+static struct
+{
+	MemorySnapShot_Page_t **bucket;
+	uint32_t mask;				/* bucket count - 1 */
+	uint32_t count;				/* pages in table */
+} SharedPages;
+
 
 static char Temp_FileName[FILENAME_MAX];
 static bool Temp_Confirm;
+static bool Temp_FilePending;		/* file save requested for after current instruction */
+static MemorySnapShot_Buffer_t *Temp_Buffer;	/* same for in-memory save */
 
 
 /*-----------------------------------------------------------------------*/
@@ -251,6 +279,258 @@ static void MemorySnapShot_CloseFile(void)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Return hash for given memory page content.
+ */
+static uint64_t MemorySnapShot_PageHash(const uint8_t *data)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL, word;
+	int i;
+
+	for (i = 0; i < SNAPSHOT_PAGE_SIZE; i += sizeof(word))
+	{
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * 0x100000001b3ULL;
+		hash ^= hash >> 32;
+	}
+	return hash;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Double shared pages hash table size (or allocate initial one).
+ * Return false if allocation failed.
+ */
+static bool MemorySnapShot_PagesGrow(void)
+{
+	MemorySnapShot_Page_t **bucket, *page, *next;
+	uint32_t i, mask;
+
+	mask = SharedPages.bucket ? 2 * SharedPages.mask + 1 : 1023;
+	bucket = calloc(mask + 1, sizeof(*bucket));
+	if (!bucket)
+		return false;
+
+	if (SharedPages.bucket)
+	{
+		for (i = 0; i <= SharedPages.mask; i++)
+		{
+			for (page = SharedPages.bucket[i]; page; page = next)
+			{
+				next = page->next;
+				page->next = bucket[page->hash & mask];
+				bucket[page->hash & mask] = page;
+			}
+		}
+		free(SharedPages.bucket);
+	}
+	SharedPages.bucket = bucket;
+	SharedPages.mask = mask;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return reference to shared page with given content, allocating
+ * a new one if there's no such page yet. Return NULL on failure.
+ */
+static MemorySnapShot_Page_t *MemorySnapShot_PageGet(const uint8_t *data)
+{
+	MemorySnapShot_Page_t *page;
+	uint64_t hash;
+
+	if (SharedPages.count >= 2 * (SharedPages.mask + 1) || !SharedPages.bucket)
+	{
+		if (!MemorySnapShot_PagesGrow() && !SharedPages.bucket)
+			return NULL;
+	}
+
+	hash = MemorySnapShot_PageHash(data);
+	for (page = SharedPages.bucket[hash & SharedPages.mask]; page; page = page->next)
+	{
+		if (page->hash == hash && memcmp(page->data, data, SNAPSHOT_PAGE_SIZE) == 0)
+		{
+			page->refs++;
+			return page;
+		}
+	}
+
+	page = malloc(sizeof(*page));
+	if (!page)
+		return NULL;
+	memcpy(page->data, data, SNAPSHOT_PAGE_SIZE);
+	page->hash = hash;
+	page->refs = 1;
+	page->next = SharedPages.bucket[hash & SharedPages.mask];
+	SharedPages.bucket[hash & SharedPages.mask] = page;
+	SharedPages.count++;
+	return page;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Drop reference to shared page, free page when it's not used anymore.
+ */
+static void MemorySnapShot_PagePut(MemorySnapShot_Page_t *page)
+{
+	MemorySnapShot_Page_t **prev;
+
+	if (--page->refs)
+		return;
+
+	prev = &SharedPages.bucket[page->hash & SharedPages.mask];
+	while (*prev != page)
+		prev = &(*prev)->next;
+	*prev = page->next;
+	SharedPages.count--;
+	free(page);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Drop all page references in given in-memory snapshot.
+ */
+static void MemorySnapShot_BufferPutPages(MemorySnapShot_Buffer_t *buf)
+{
+	int i;
+
+	for (i = 0; i < buf->pagecount; i++)
+		MemorySnapShot_PagePut(buf->pages[i]);
+	buf->pagecount = 0;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Save/Restore full pages of a large memory area to/from shared
+ * pages referenced by in-memory snapshot.
+ */
+static void MemorySnapShot_BufferStorePages(uint8_t *pData, int Pages)
+{
+	MemorySnapShot_Buffer_t *buf = CaptureBuffer;
+	MemorySnapShot_Page_t **pages;
+	int i, alloc;
+
+	if (bCaptureSave)
+	{
+		if (buf->pagecount + Pages > buf->pagealloc)
+		{
+			alloc = buf->pagealloc ? 2 * buf->pagealloc : 1024;
+			while (alloc < buf->pagecount + Pages)
+				alloc *= 2;
+			pages = realloc(buf->pages, alloc * sizeof(*pages));
+			if (!pages)
+			{
+				bCaptureError = true;
+				return;
+			}
+			buf->pages = pages;
+			buf->pagealloc = alloc;
+		}
+		for (i = 0; i < Pages; i++)
+		{
+			buf->pages[buf->pagecount] = MemorySnapShot_PageGet(pData + i * SNAPSHOT_PAGE_SIZE);
+			if (!buf->pages[buf->pagecount])
+			{
+				bCaptureError = true;
+				return;
+			}
+			buf->pagecount++;
+		}
+	}
+	else
+	{
+		if (CaptureBufferPage + Pages > buf->pagecount)
+		{
+			bCaptureError = true;
+			return;
+		}
+		for (i = 0; i < Pages; i++)
+			memcpy(pData + i * SNAPSHOT_PAGE_SIZE, buf->pages[CaptureBufferPage++]->data, SNAPSHOT_PAGE_SIZE);
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Make sure in-memory snapshot has space for Size more bytes.
+ * Return false if (re-)allocation failed.
+ */
+static bool MemorySnapShot_BufferReserve(int Size)
+{
+	MemorySnapShot_Buffer_t *buf = CaptureBuffer;
+	size_t alloc;
+	uint8_t *data;
+
+	if (CaptureBufferPos + Size <= buf->alloc)
+		return true;
+
+	alloc = buf->alloc ? 2 * buf->alloc : 1024*1024;
+	while (alloc < CaptureBufferPos + Size)
+		alloc *= 2;
+	data = realloc(buf->data, alloc);
+	if (!data)
+		return false;
+	buf->data = data;
+	buf->alloc = alloc;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Save/Restore data to/from in-memory snapshot, or skip it
+ * when pData is NULL.  Full pages of large memory areas go
+ * to shared pages, only the remainder is copied to the buffer.
+ */
+static void MemorySnapShot_BufferStore(void *pData, int Size)
+{
+	MemorySnapShot_Buffer_t *buf = CaptureBuffer;
+
+	if (pData && Size >= SNAPSHOT_PAGE_SIZE)
+	{
+		int Pages = Size / SNAPSHOT_PAGE_SIZE;
+
+		MemorySnapShot_BufferStorePages(pData, Pages);
+		pData = (uint8_t *)pData + Pages * SNAPSHOT_PAGE_SIZE;
+		Size -= Pages * SNAPSHOT_PAGE_SIZE;
+		if (!Size)
+			return;
+	}
+
+	if (bCaptureSave)
+	{
+		if (!MemorySnapShot_BufferReserve(Size))
+		{
+			bCaptureError = true;
+			return;
+		}
+		if (pData)
+			memcpy(buf->data + CaptureBufferPos, pData, Size);
+		else
+			memset(buf->data + CaptureBufferPos, 0, Size);
+		CaptureBufferPos += Size;
+		buf->size = CaptureBufferPos;
+	}
+	else
+	{
+		if (CaptureBufferPos + Size > buf->size)
+		{
+			bCaptureError = true;
+			return;
+		}
+		if (pData)
+			memcpy(pData, buf->data + CaptureBufferPos, Size);
+		CaptureBufferPos += Size;
+	}
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Skip Nb bytes when reading from/writing to file.
@@ -259,6 +539,11 @@ void MemorySnapShot_Skip(int Nb)
 {
 	int res;
 
+	if (CaptureBuffer != NULL)
+	{
+		MemorySnapShot_BufferStore(NULL, Nb);
+		return;
+	}
 	/* Check no file errors */
 	if (CaptureFile != NULL)
 	{
@@ -279,6 +564,11 @@ void MemorySnapShot_Store(void *pData, int Size)
 {
 	long nBytes;
 
+	if (CaptureBuffer != NULL)
+	{
+		MemorySnapShot_BufferStore(pData, Size);
+		return;
+	}
 	/* Check no file errors */
 	if (CaptureFile != NULL)
 	{
@@ -296,80 +586,110 @@ void MemorySnapShot_Store(void *pData, int Size)
 
 
 /*-----------------------------------------------------------------------*/
-/**
- * Save 'snapshot' of memory/chips/emulation variables
+/*
+ * Save state of each file (and end marker) to current snapshot.
+ * Debugger state is saved only to snapshot files, with given path.
  */
-void MemorySnapShot_Capture(const char *pszFileName, bool bConfirm)
+static void MemorySnapShot_SaveState(const char *pszDebugPath)
 {
-//fprintf ( stderr , "MemorySnapShot_Capture in\n" );
-	/* Make a temporary copy of the parameters for MemorySnapShot_Capture_Do() */
-	Str_Copy(Temp_FileName, pszFileName, FILENAME_MAX);
-	Temp_Confirm = bConfirm;
+	uint32_t magic = SNAPSHOT_MAGIC;
 
-	/* With WinUAE cpu core, capture is done from m68k_run_xxx() after the end of the current instruction */
-	UAE_Set_State_Save ();
-//fprintf ( stderr , "MemorySnapShot_Capture out\n" );
+	/* Capture each files details */
+	Configuration_MemorySnapShot_Capture(true);
+	TOS_MemorySnapShot_Capture(true);
+	STMemory_MemorySnapShot_Capture(true);
+	Cycles_MemorySnapShot_Capture(true);		/* Before fdc (for CyclesGlobalClockCounter) */
+	FDC_MemorySnapShot_Capture(true);
+	Floppy_MemorySnapShot_Capture(true);
+	IPF_MemorySnapShot_Capture(true);		/* After fdc/floppy are saved */
+	STX_MemorySnapShot_Capture(true);		/* After fdc/floppy are saved */
+	GemDOS_MemorySnapShot_Capture(true);
+	ACIA_MemorySnapShot_Capture(true);
+	IKBD_MemorySnapShot_Capture(true);
+	MIDI_MemorySnapShot_Capture(true);
+	CycInt_MemorySnapShot_Capture(true);
+	M68000_MemorySnapShot_Capture(true);
+	MFP_MemorySnapShot_Capture(true);
+	PSG_MemorySnapShot_Capture(true);
+	Sound_MemorySnapShot_Capture(true);
+	Video_MemorySnapShot_Capture(true);
+	Blitter_MemorySnapShot_Capture(true);
+	DmaSnd_MemorySnapShot_Capture(true);
+	Crossbar_MemorySnapShot_Capture(true);
+	VIDEL_MemorySnapShot_Capture(true);
+	DSP_MemorySnapShot_Capture(true);
+	if (pszDebugPath)
+		DebugUI_MemorySnapShot_Capture(pszDebugPath, true);
+	IoMem_MemorySnapShot_Capture(true);
+	ScreenConv_MemorySnapShot_Capture(true);
+	SCC_MemorySnapShot_Capture(true);
+	SCU_MemorySnapShot_Capture(true);
+
+	/* end marker */
+	MemorySnapShot_Store(&magic, sizeof(magic));
 }
 
 
-
+/*-----------------------------------------------------------------------*/
 /*
- * Same as MemorySnapShot_Capture, but snapshot is saved immediately
- * without restarting emulation (used in the debugger)
+ * Do the in-memory snapshot saving. Return false on error.
  */
-void MemorySnapShot_Capture_Immediate(const char *pszFileName, bool bConfirm)
+static bool MemorySnapShot_CaptureBuffer_Do(MemorySnapShot_Buffer_t *pBuffer)
+{
+	/* pages shared with other snapshots stay allocated */
+	MemorySnapShot_BufferPutPages(pBuffer);
+
+	CaptureBuffer = pBuffer;
+	CaptureBufferPos = 0;
+	CaptureBufferPage = 0;
+	pBuffer->size = 0;
+	pBuffer->cycles = CyclesGlobalClockCounter;
+	bCaptureSave = true;
+	bCaptureError = false;
+
+	MemorySnapShot_SaveState(NULL);
+
+	CaptureBuffer = NULL;
+	if (bCaptureError)
+	{
+		Log_Printf(LOG_WARN, "Unable to save memory state to memory");
+		MemorySnapShot_BufferPutPages(pBuffer);
+		pBuffer->size = 0;
+		return false;
+	}
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Save 'snapshot' of memory/chips/emulation variables
+ */
+void MemorySnapShot_Capture(const char *pszFileName, bool bConfirm)
 {
+//fprintf ( stderr , "MemorySnapShot_Capture in\n" );
 	/* Make a temporary copy of the parameters for MemorySnapShot_Capture_Do() */
 	Str_Copy(Temp_FileName, pszFileName, FILENAME_MAX);
 	Temp_Confirm = bConfirm;
+	Temp_FilePending = true;
 
-	MemorySnapShot_Capture_Do ();
+	/* With WinUAE cpu core, capture is done from m68k_run_xxx() after the end of the current instruction */
+	UAE_Set_State_Save ();
+//fprintf ( stderr , "MemorySnapShot_Capture out\n" );
 }
 
 
 
 /*
- * Do the real saving (called from newcpu.c / m68k_go()
+ * Do the snapshot file saving, to Temp_FileName
  */
-void MemorySnapShot_Capture_Do(void)
+static void MemorySnapShot_CaptureFile_Do(void)
 {
-	uint32_t magic = SNAPSHOT_MAGIC;
-
 	/* Set to 'saving' */
 	if (MemorySnapShot_OpenFile(Temp_FileName, true, Temp_Confirm))
 	{
-		/* Capture each files details */
-		Configuration_MemorySnapShot_Capture(true);
-		TOS_MemorySnapShot_Capture(true);
-		STMemory_MemorySnapShot_Capture(true);
-		Cycles_MemorySnapShot_Capture(true);			/* Before fdc (for CyclesGlobalClockCounter) */
-		FDC_MemorySnapShot_Capture(true);
-		Floppy_MemorySnapShot_Capture(true);
-		IPF_MemorySnapShot_Capture(true);			/* After fdc/floppy are saved */
-		STX_MemorySnapShot_Capture(true);			/* After fdc/floppy are saved */
-		GemDOS_MemorySnapShot_Capture(true);
-		ACIA_MemorySnapShot_Capture(true);
-		IKBD_MemorySnapShot_Capture(true);
-		MIDI_MemorySnapShot_Capture(true);
-		CycInt_MemorySnapShot_Capture(true);
-		M68000_MemorySnapShot_Capture(true);
-		MFP_MemorySnapShot_Capture(true);
-		PSG_MemorySnapShot_Capture(true);
-		Sound_MemorySnapShot_Capture(true);
-		Video_MemorySnapShot_Capture(true);
-		Blitter_MemorySnapShot_Capture(true);
-		DmaSnd_MemorySnapShot_Capture(true);
-		Crossbar_MemorySnapShot_Capture(true);
-		VIDEL_MemorySnapShot_Capture(true);
-		DSP_MemorySnapShot_Capture(true);
-		DebugUI_MemorySnapShot_Capture(Temp_FileName, true);
-		IoMem_MemorySnapShot_Capture(true);
-		ScreenConv_MemorySnapShot_Capture(true);
-		SCC_MemorySnapShot_Capture(true);
-		SCU_MemorySnapShot_Capture(true);
-
-		/* end marker */
-		MemorySnapShot_Store(&magic, sizeof(magic));
+		MemorySnapShot_SaveState(Temp_FileName);
+
 		/* And close */
 		MemorySnapShot_CloseFile();
 	} else {
@@ -388,6 +708,42 @@ void MemorySnapShot_Capture_Do(void)
 }
 
 
+
+/*
+ * Same as MemorySnapShot_Capture, but snapshot is saved immediately
+ * without restarting emulation (used in the debugger)
+ */
+void MemorySnapShot_Capture_Immediate(const char *pszFileName, bool bConfirm)
+{
+	/* Make a temporary copy of the parameters for MemorySnapShot_CaptureFile_Do() */
+	Str_Copy(Temp_FileName, pszFileName, FILENAME_MAX);
+	Temp_Confirm = bConfirm;
+
+	MemorySnapShot_CaptureFile_Do ();
+}
+
+
+
+/*
+ * Do the real saving (called from newcpu.c / m68k_go()
+ * In-memory and file snapshots can be requested during the same
+ * instruction, so do both if needed.
+ */
+void MemorySnapShot_Capture_Do(void)
+{
+	if (Temp_Buffer)
+	{
+		MemorySnapShot_CaptureBuffer_Do(Temp_Buffer);
+		Temp_Buffer = NULL;
+	}
+	if (Temp_FilePending)
+	{
+		Temp_FilePending = false;
+		MemorySnapShot_CaptureFile_Do();
+	}
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Restore 'snapshot' of memory/chips/emulation variables
@@ -408,91 +764,125 @@ void MemorySnapShot_Restore(const char *pszFileName, bool bConfirm)
 
 
 
+/*
+ * Restore state of each file from current snapshot, and check end marker.
+ * Debugger state is restored only from snapshot files, with given path.
+ * Return false on error.
+ */
+static bool MemorySnapShot_RestoreState(const char *pszDebugPath)
+{
+	uint32_t magic;
+
+	Configuration_MemorySnapShot_Capture(false);
+	TOS_MemorySnapShot_Capture(false);
+
+	/* FIXME [NP] : Reset_Cold calls TOS_InitImage which calls */
+	/* memory_init. memory_init allocs STRam and TTRam, but TTRam */
+	/* requires currprefs.address_space_24 which is not restored yet */
+	/* (it's from M68000_MemorySnapShot_Capture). To resolve this */
+	/* circular dependency, we init currprefs.address_space_24 here */
+	/* This should be split in different functions / order to avoid this loop */
+	currprefs.address_space_24 = ConfigureParams.System.bAddressSpace24;
+
+	/* Reset emulator to get things running */
+	IoMem_UnInit(ConfigureParams.System.nMachineType);  IoMem_Init();
+	Reset_Cold();
+
+	/* Capture each files details */
+	STMemory_MemorySnapShot_Capture(false);
+	Cycles_MemorySnapShot_Capture(false);			/* Before fdc (for CyclesGlobalClockCounter) */
+	FDC_MemorySnapShot_Capture(false);
+	Floppy_MemorySnapShot_Capture(false);
+	IPF_MemorySnapShot_Capture(false);			/* After fdc/floppy are restored, as IPF depends on them */
+	STX_MemorySnapShot_Capture(false);			/* After fdc/floppy are restored, as STX depends on them */
+	GemDOS_MemorySnapShot_Capture(false);
+	ACIA_MemorySnapShot_Capture(false);
+	IKBD_MemorySnapShot_Capture(false);			/* After ACIA */
+	MIDI_MemorySnapShot_Capture(false);
+	CycInt_MemorySnapShot_Capture(false);
+	M68000_MemorySnapShot_Capture(false);
+	MFP_MemorySnapShot_Capture(false);
+	PSG_MemorySnapShot_Capture(false);
+	Sound_MemorySnapShot_Capture(false);
+	Video_MemorySnapShot_Capture(false);
+	Blitter_MemorySnapShot_Capture(false);
+	DmaSnd_MemorySnapShot_Capture(false);
+	Crossbar_MemorySnapShot_Capture(false);
+	VIDEL_MemorySnapShot_Capture(false);
+	DSP_MemorySnapShot_Capture(false);
+	if (pszDebugPath)
+		DebugUI_MemorySnapShot_Capture(pszDebugPath, false);
+	IoMem_MemorySnapShot_Capture(false);
+	ScreenConv_MemorySnapShot_Capture(false);
+	SCC_MemorySnapShot_Capture(false);
+	SCU_MemorySnapShot_Capture(false);
+
+	/* version string check catches release-to-release
+	 * state changes, bCaptureError catches too short
+	 * state file, this check a too long state file.
+	 */
+	MemorySnapShot_Store(&magic, sizeof(magic));
+	if (!bCaptureError && magic != SNAPSHOT_MAGIC)
+		bCaptureError = true;
+
+	/* changes may affect also info shown in statusbar */
+	Statusbar_UpdateInfo();
+
+	/* and memory contents seen by the remote debugger */
+	RemoteDebug_MemoryChanged();
+
+	if (bCaptureError)
+		return false;
+
+	/*
+	 * Apply some specific changes after everything is restored
+	 */
+	if ( ConfigureParams.System.nMachineType == MACHINE_MEGA_STE )
+	{
+		/* Restore CPU Freq and cache */
+		MegaSTE_CPU_Cache_Update ( IoMem_ReadByte(0xff8e21) );
+	}
+	return true;
+}
+
+
 /*
  * Do the real restoring (called from newcpu.c / m68k_go()
  */
 void MemorySnapShot_Restore_Do(void)
 {
-	uint32_t magic;
+	bool ok;
+
+	if (RestoreBuffer)
+	{
+		/* Restore in-memory snapshot */
+		CaptureBuffer = RestoreBuffer;
+		CaptureBufferPos = 0;
+		CaptureBufferPage = 0;
+		RestoreBuffer = NULL;
+		bCaptureSave = false;
+		bCaptureError = false;
+		ok = MemorySnapShot_RestoreState(NULL);
+		CaptureBuffer = NULL;
+		if (!ok)
+			Log_AlertDlg(LOG_ERROR, "Memory state restore failed!\nPlease reboot emulation.");
+		return;
+	}
 
 //fprintf ( stderr , "MemorySnapShot_Restore_Do in\n" );
 	/* Set to 'restore' */
 	if (MemorySnapShot_OpenFile(Temp_FileName, false, Temp_Confirm))
 	{
-		Configuration_MemorySnapShot_Capture(false);
-		TOS_MemorySnapShot_Capture(false);
-
-		/* FIXME [NP] : Reset_Cold calls TOS_InitImage which calls */
-		/* memory_init. memory_init allocs STRam and TTRam, but TTRam */
-		/* requires currprefs.address_space_24 which is not restored yet */
-		/* (it's from M68000_MemorySnapShot_Capture). To resolve this */
-		/* circular dependency, we init currprefs.address_space_24 here */
-		/* This should be split in different functions / order to avoid this loop */
-		currprefs.address_space_24 = ConfigureParams.System.bAddressSpace24;
-
-		/* Reset emulator to get things running */
-		IoMem_UnInit(ConfigureParams.System.nMachineType);  IoMem_Init();
-		Reset_Cold();
-
-		/* Capture each files details */
-		STMemory_MemorySnapShot_Capture(false);
-		Cycles_MemorySnapShot_Capture(false);			/* Before fdc (for CyclesGlobalClockCounter) */
-		FDC_MemorySnapShot_Capture(false);
-		Floppy_MemorySnapShot_Capture(false);
-		IPF_MemorySnapShot_Capture(false);			/* After fdc/floppy are restored, as IPF depends on them */
-		STX_MemorySnapShot_Capture(false);			/* After fdc/floppy are restored, as STX depends on them */
-		GemDOS_MemorySnapShot_Capture(false);
-		ACIA_MemorySnapShot_Capture(false);
-		IKBD_MemorySnapShot_Capture(false);			/* After ACIA */
-		MIDI_MemorySnapShot_Capture(false);
-		CycInt_MemorySnapShot_Capture(false);
-		M68000_MemorySnapShot_Capture(false);
-		MFP_MemorySnapShot_Capture(false);
-		PSG_MemorySnapShot_Capture(false);
-		Sound_MemorySnapShot_Capture(false);
-		Video_MemorySnapShot_Capture(false);
-		Blitter_MemorySnapShot_Capture(false);
-		DmaSnd_MemorySnapShot_Capture(false);
-		Crossbar_MemorySnapShot_Capture(false);
-		VIDEL_MemorySnapShot_Capture(false);
-		DSP_MemorySnapShot_Capture(false);
-		DebugUI_MemorySnapShot_Capture(Temp_FileName, false);
-		IoMem_MemorySnapShot_Capture(false);
-		ScreenConv_MemorySnapShot_Capture(false);
-		SCC_MemorySnapShot_Capture(false);
-		SCU_MemorySnapShot_Capture(false);
-
-		/* version string check catches release-to-release
-		 * state changes, bCaptureError catches too short
-		 * state file, this check a too long state file.
-		 */
-		MemorySnapShot_Store(&magic, sizeof(magic));
-		if (!bCaptureError && magic != SNAPSHOT_MAGIC)
-			bCaptureError = true;
+		ok = MemorySnapShot_RestoreState(Temp_FileName);
 
 		/* And close */
 		MemorySnapShot_CloseFile();
 
-		/* changes may affect also info shown in statusbar */
-		Statusbar_UpdateInfo();
-
-		if (bCaptureError)
+		if (!ok)
 		{
 			Log_AlertDlg(LOG_ERROR, "Full memory state restore failed!\nPlease reboot emulation.");
 			return;
 		}
-
-
-		/*
-		 * Apply some specific changes after everything is restored
-		 */
-		if ( ConfigureParams.System.nMachineType == MACHINE_MEGA_STE )
-		{
-			/* Restore CPU Freq and cache */
-			MegaSTE_CPU_Cache_Update ( IoMem_ReadByte(0xff8e21) );
-		}
-
-
 	}
 
 //fprintf ( stderr , "MemorySnapShot_Restore_Do out\n" );
@@ -507,6 +897,61 @@ void MemorySnapShot_Restore_Do(void)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Save 'snapshot' of memory/chips/emulation variables into given
+ * memory buffer, instead of a file.  Saving is done after the current
+ * CPU instruction, like with MemorySnapShot_Capture().
+ * Buffer allocation is re-used between captures.
+ */
+void MemorySnapShot_CaptureBuffer(MemorySnapShot_Buffer_t *pBuffer)
+{
+	Temp_Buffer = pBuffer;
+	UAE_Set_State_Save ();
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Restore 'snapshot' from given memory buffer, after the current
+ * CPU instruction, like with MemorySnapShot_Restore().  Buffer needs
+ * to stay valid until that.
+ */
+void MemorySnapShot_RestoreBuffer(MemorySnapShot_Buffer_t *pBuffer)
+{
+	RestoreBuffer = pBuffer;
+
+	UAE_Set_State_Restore ();
+	UAE_Set_Quit_Reset ( false );					/* Ask for "quit" to start restoring state */
+	set_special(SPCFLAG_MODE_CHANGE);				/* exit m68k_run_xxx() loop and check "quit" */
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Free in-memory snapshot data, and its shared pages
+ * not used by other snapshots
+ */
+void MemorySnapShot_FreeBuffer(MemorySnapShot_Buffer_t *pBuffer)
+{
+	MemorySnapShot_BufferPutPages(pBuffer);
+	free(pBuffer->pages);
+	free(pBuffer->data);
+	memset(pBuffer, 0, sizeof(*pBuffer));
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return amount of memory used by pages shared between
+ * in-memory snapshots
+ */
+size_t MemorySnapShot_SharedPagesSize(void)
+{
+	return (size_t)SharedPages.count * sizeof(MemorySnapShot_Page_t);
+}
+
+
 /*-----------------------------------------------------------------------*/
 /*
  * Save and restore functions required by the UAE CPU core...
@@ -1076,6 +1076,25 @@ void Ncr5380_UnInit(void)
 #endif
 }
 
+/**
+ * Reopen image files, so that forked processes don't share
+ * their file offsets with each other.
+ */
+void Ncr5380_ReopenImages(void)
+{
+#if WITH_NCR5380
+	int i;
+
+	for (i = 0; i < MAX_SCSI_DEVS; i++)
+	{
+		if (ScsiBus.devs[i].enabled &&
+		    !File_Reopen(ScsiBus.devs[i].image_file, ConfigureParams.Scsi[i].sDeviceFile))
+			Log_Printf(LOG_ERROR, "Reopening SCSI HD file '%s' failed!\n",
+				   ConfigureParams.Scsi[i].sDeviceFile);
+	}
+#endif
+}
+
 /**
  * Emulate external reset "pin": Clear registers etc.
  */
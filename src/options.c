@@ -39,6 +39,9 @@ const char Options_fileid[] = "Hatari options.c";
 #include "inffile.h"
 #include "paths.h"
 #include "avi_record.h"
+#include "capturePipe.h"
+#include "batch.h"
+#include "benchmark.h"
 #include "hatari-glue.h"
 #include "68kDisass.h"
 #include "xbios.h"
@@ -91,6 +94,8 @@ enum {
 	OPT_MAXHEIGHT,
 	OPT_ZOOM,
 	OPT_DISABLE_VIDEO,
+	OPT_HEADLESS,
+	OPT_CONVERT_THREAD,
 
 	OPT_BORDERS,		/* ST/STE display options */
 	OPT_SPEC512,
@@ -109,8 +114,10 @@ enum {
 	OPT_AVIRECORD,
 	OPT_AVIRECORD_VCODEC,
 	OPT_AVI_PNG_LEVEL,
+	OPT_AVI_KEYFRAMES,
 	OPT_AVIRECORD_FPS,
 	OPT_AVIRECORD_FILE,
+	OPT_CAPTURE_PIPE,
 	OPT_SCRSHOT_DIR,
 	OPT_SCRSHOT_FORMAT,
 
@@ -181,6 +188,7 @@ enum {
 	OPT_MACHINE,		/* system options */
 	OPT_BLITTER,
 	OPT_DSP,
+	OPT_DSP_THREAD,
 	OPT_RTC_YEAR,
 	OPT_TIMERD,
 	OPT_FASTBOOT,
@@ -189,6 +197,7 @@ enum {
 	OPT_SOUND,
 	OPT_SOUNDBUFFERSIZE,
 	OPT_SOUNDSYNC,
+	OPT_SOUNDFASTFORWARD,
 	OPT_YM_MIXING,
 
 #ifdef WIN32
@@ -213,6 +222,11 @@ enum {
 	OPT_ALERTLEVEL,
 	OPT_RUNVBLS,
 	OPT_BENCHMARK,
+	OPT_BENCHREPORT,
+#if HAVE_FORK
+	OPT_BATCH,
+	OPT_BATCHVBLS,
+#endif
 	OPT_ERROR,
 	OPT_CONTINUE
 };
@@ -285,6 +299,10 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Hatari screen/window scaling factor (1.0 - 8.0)" },
 	{ OPT_DISABLE_VIDEO,   NULL, "--disable-video",
 	  "<bool>", "Run emulation without displaying video (audio only)" },
+	{ OPT_HEADLESS,   NULL, "--headless",
+	  "<bool>", "Run without window, convert frames only for screenshots/video" },
+	{ OPT_CONVERT_THREAD, NULL, "--convert-thread",
+	  "<bool>", "Convert Falcon/TT/VDI screen on separate thread" },
 
 	{ OPT_HEADER, NULL, NULL, NULL, "ST/STE specific display" },
 	{ OPT_BORDERS, NULL, "--borders",
@@ -318,13 +336,17 @@ static const opt_t HatariOptions[] = {
 	{ OPT_AVIRECORD, NULL, "--avirecord",
 	  NULL, "Start AVI recording" },
 	{ OPT_AVIRECORD_VCODEC, NULL, "--avi-vcodec",
-	  "<x>", "Select AVI video codec (x = bmp/png)" },
+	  "<x>", "Select AVI video codec (x = bmp/png/zmbv)" },
 	{ OPT_AVI_PNG_LEVEL, NULL, "--png-level",
-	  "<x>", "Select AVI PNG compression level (x = 0-9)" },
+	  "<x>", "Select AVI PNG/ZMBV compression level (x = 0-9)" },
+	{ OPT_AVI_KEYFRAMES, NULL, "--avi-keyframes",
+	  "<x>", "Store an AVI ZMBV keyframe every <x> frames (x = 1-10000)" },
 	{ OPT_AVIRECORD_FPS, NULL, "--avi-fps",
 	  "<x>", "Force AVI frame rate (x = 50/60/71/...)" },
 	{ OPT_AVIRECORD_FILE, NULL, "--avi-file",
 	  "<file>", "Use <file> to record AVI" },
+	{ OPT_CAPTURE_PIPE, NULL, "--capture-pipe",
+	  "<file>", "Stream raw video/audio frames to <file> (or FIFO)" },
 	{ OPT_SCRSHOT_DIR, NULL, "--screenshot-dir",
 	  "<dir>", "Save screenshots in the directory <dir>" },
 	{ OPT_SCRSHOT_FORMAT, NULL, "--screenshot-format",
@@ -467,6 +489,8 @@ static const opt_t HatariOptions[] = {
 	  "<bool>", "Use blitter emulation (ST only)" },
 	{ OPT_DSP,       NULL, "--dsp",
 	  "<x>", "DSP emulation (x = none/dummy/emu, Falcon only)" },
+	{ OPT_DSP_THREAD, NULL, "--dsp-thread",
+	  "<bool>", "Run DSP emulation on separate thread" },
 	{ OPT_RTC_YEAR,   NULL, "--rtc-year",
 	  "<x>", "Set initial year for RTC (0, 1980 <= x < 2080)" },
 	{ OPT_TIMERD,    NULL, "--timer-d",
@@ -483,6 +507,8 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Sound buffer size in ms (x=0/10-100, 0=SDL default)" },
 	{ OPT_SOUNDSYNC,   NULL, "--sound-sync",
 	  "<bool>", "Sound synchronized emulation (on|off, off=default)" },
+	{ OPT_SOUNDFASTFORWARD,   NULL, "--sound-fast-forward",
+	  "<bool>", "Generate sound in fast forward mode (on|off, on=default)" },
 	{ OPT_YM_MIXING,   NULL, "--ym-mixing",
 	  "<x>", "YM sound mixing method (x=linear/table/model)" },
 
@@ -530,6 +556,14 @@ static const opt_t HatariOptions[] = {
 	  "<x>", "Exit after x VBLs" },
 	{ OPT_BENCHMARK, NULL, "--benchmark",
 	  NULL, "Start in benchmark mode (use with --run-vbls)" },
+	{ OPT_BENCHREPORT, NULL, "--bench-report",
+	  "<file>", "Write JSON (or CSV for .csv) benchmark report to <file> at exit" },
+#if HAVE_FORK
+	{ OPT_BATCH, NULL, "--batch",
+	  "<file>", "Fork headless worker for each debugger script listed in <file>" },
+	{ OPT_BATCHVBLS, NULL, "--batch-vbls",
+	  "<x>", "Fork batch workers after x VBLs (default 250)" },
+#endif
 
 	{ OPT_ERROR, NULL, NULL, NULL, NULL }
 };
@@ -1248,6 +1282,19 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			ok = Opt_Bool(argv[++i], OPT_DISABLE_VIDEO, &ConfigureParams.Screen.DisableVideo);
 			break;
 
+		case OPT_HEADLESS:
+			ok = Opt_Bool(argv[++i], OPT_HEADLESS, &ConfigureParams.Screen.bHeadless);
+#if HAVE_SETENV
+			/* no window -> no need for a display either */
+			if (ok && ConfigureParams.Screen.bHeadless)
+				setenv("SDL_VIDEODRIVER", "dummy", 0);
+#endif
+			break;
+
+		case OPT_CONVERT_THREAD:
+			ok = Opt_Bool(argv[++i], OPT_CONVERT_THREAD, &ConfigureParams.Screen.bConvertThread);
+			break;
+
 			/* ST/STE display options */
 		case OPT_BORDERS:
 			ok = Opt_Bool(argv[++i], OPT_BORDERS, &ConfigureParams.Screen.bAllowOverscan);
@@ -1338,6 +1385,10 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			{
 				ConfigureParams.Video.AviRecordVcodec = AVI_RECORD_VIDEO_CODEC_PNG;
 			}
+			else if (strcasecmp(argv[i], "zmbv") == 0)
+			{
+				ConfigureParams.Video.AviRecordVcodec = AVI_RECORD_VIDEO_CODEC_ZMBV;
+			}
 			else
 			{
 				return Opt_ShowError(OPT_AVIRECORD_VCODEC, argv[i], "Unknown video codec");
@@ -1350,6 +1401,12 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 				return Opt_ShowError(OPT_AVI_PNG_LEVEL, argv[i], "Invalid compression level");
 			break;
 
+		case OPT_AVI_KEYFRAMES:
+			i += 1;
+			if (!Avi_SetKeyframeInterval(argv[i]))
+				return Opt_ShowError(OPT_AVI_KEYFRAMES, argv[i], "Invalid keyframe interval");
+			break;
+
 		case OPT_AVIRECORD_FPS:
 			val = atoi(argv[++i]);
 			if (val < 0 || val > 100)
@@ -1368,6 +1425,11 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 					argv[i], sizeof(ConfigureParams.Video.AviRecordFile), NULL);
 			break;
 
+		case OPT_CAPTURE_PIPE:
+			i += 1;
+			CapturePipe_SetFile(argv[i]);
+			break;
+
 		case OPT_SCRSHOT_DIR:
 			i += 1;
 			Paths_SetScreenShotDir(argv[i]);
@@ -2020,6 +2082,10 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			bLoadAutoSave = false;
 			break;
 
+		case OPT_DSP_THREAD:
+			ok = Opt_Bool(argv[++i], OPT_DSP_THREAD, &ConfigureParams.System.bDspThread);
+			break;
+
 		case OPT_RTC_YEAR:
 			year = atoi(argv[++i]);
 			if(year && (year < 1980 || year >= 2080))
@@ -2088,6 +2154,10 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			ok = Opt_Bool(argv[++i], OPT_SOUNDSYNC, &ConfigureParams.Sound.bEnableSoundSync);
 			break;
 
+		case OPT_SOUNDFASTFORWARD:
+			ok = Opt_Bool(argv[++i], OPT_SOUNDFASTFORWARD, &ConfigureParams.Sound.bFastForwardSound);
+			break;
+
 		case OPT_MICROPHONE:
 			ok = Opt_Bool(argv[++i], OPT_MICROPHONE, &ConfigureParams.Sound.bEnableMicrophone);
 			break;
@@ -2304,6 +2374,37 @@ bool Opt_ParseParameters(int argc, const char * const argv[])
 			BenchmarkMode = true;
 			break;
 
+		case OPT_BENCHREPORT:
+			i += 1;
+			BenchmarkMode = true;
+			Benchmark_SetReport(argv[i]);
+			break;
+
+#if HAVE_FORK
+		case OPT_BATCH:
+			i += 1;
+			errstr = Batch_SetList(argv[i]);
+			if (errstr)
+			{
+				return Opt_ShowError(OPT_BATCH, argv[i], errstr);
+			}
+			/* workers can't share a window */
+			ConfigureParams.Screen.bHeadless = true;
+#if HAVE_SETENV
+			setenv("SDL_VIDEODRIVER", "dummy", 0);
+#endif
+			break;
+
+		case OPT_BATCHVBLS:
+			val = atoi(argv[++i]);
+			if (val <= 0)
+			{
+				return Opt_ShowError(OPT_BATCHVBLS, argv[i], "Invalid VBL count");
+			}
+			Batch_SetVBLs(val);
+			break;
+#endif
+
 		case OPT_ERROR:
 			/* unknown option or missing option parameter */
 			return false;
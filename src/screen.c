@@ -33,12 +33,14 @@ const char Screen_fileid[] = "Hatari screen.c";
 #include "main.h"
 #include "configuration.h"
 #include "avi_record.h"
+#include "capturePipe.h"
 #include "file.h"
 #include "log.h"
 #include "paths.h"
 #include "options.h"
 #include "screen.h"
 #include "screenConvert.h"
+#include "screenPlanar.h"
 #include "control.h"
 #include "convert/routines.h"
 #include "resolution.h"
@@ -104,6 +106,9 @@ static void (*ScreenDrawFunctionsNormal[3])(void); /* Screen draw functions */
 static bool bScreenContentsChanged;     /* true if buffer changed and requires blitting */
 static bool bScrDoubleY;                /* true if double on Y */
 static int ScrUpdateFlag;               /* Bit mask of how to update screen */
+static bool bScrTrackLines;             /* true if conversion tracks changed lines */
+static Uint8 *pScrChangedStart;         /* Host screen area changed by conversion */
+static Uint8 *pScrChangedEnd;
 static bool bRGBTableInSync;            /* Is RGB table up to date? */
 
 /* These are used for the generic screen conversion functions */
@@ -117,12 +122,39 @@ static SDL_Renderer *sdlRenderer;
 static SDL_Texture *sdlTexture;
 static bool bUseSdlRenderer;            /* true when using SDL2 renderer */
 static bool bIsSoftwareRenderer;
+static bool bHeadless;                  /* true when using offscreen surface without window */
+static bool bHeadlessSkipped;           /* true when frame conversions were skipped in headless mode */
 
 void Screen_UpdateRects(SDL_Surface *screen, int numrects, SDL_Rect *rects)
 {
-	if (bUseSdlRenderer)
+	/* converter thread may be still writing to it */
+	ScreenConv_Sync(false);
+
+	if (bHeadless)
+	{
+		/* nothing to show it on */
+		return;
+	}
+	else if (bUseSdlRenderer)
 	{
-		SDL_UpdateTexture(sdlTexture, NULL, screen->pixels, screen->pitch);
+		SDL_Rect bounds, full = { 0, 0, screen->w, screen->h };
+		int i;
+
+		/* Texture keeps rest of the screen, so upload only
+		 * the area covering the updated rectangles */
+		bounds = full;
+		if (numrects > 0)
+		{
+			bounds = rects[0];
+			for (i = 1; i < numrects; i++)
+				SDL_UnionRect(&bounds, &rects[i], &bounds);
+			if (!SDL_IntersectRect(&bounds, &full, &bounds))
+				bounds = full;
+		}
+		SDL_UpdateTexture(sdlTexture, &bounds,
+		                  (Uint8 *)screen->pixels + bounds.y * screen->pitch
+		                  + bounds.x * screen->format->BytesPerPixel,
+		                  screen->pitch);
 		/* Need to clear the renderer context for certain accelerated cards */
 		if (!bIsSoftwareRenderer)
 			SDL_RenderClear(sdlRenderer);
@@ -285,7 +317,7 @@ static void Screen_FreeSDL2Resources(void)
 	}
 	if (sdlscrn)
 	{
-		if (bUseSdlRenderer)
+		if (bUseSdlRenderer || bHeadless)
 			SDL_FreeSurface(sdlscrn);
 		sdlscrn = NULL;
 	}
@@ -379,6 +411,26 @@ void Screen_SetTextureScale(int width, int height, int win_width, int win_height
 }
 
 
+/**
+ * Allocate offscreen surface used instead of a window in headless mode
+ */
+static void Screen_SetHeadlessSize(int width, int height)
+{
+	Screen_FreeSDL2Resources();
+
+	sdlscrn = SDL_CreateRGBSurface(0, width, height, 32,
+	                               0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+	if (!sdlscrn)
+	{
+		Main_ErrorExit("Could not create offscreen surface:", SDL_GetError(), -2);
+	}
+	DEBUGPRINT(("Headless surface: %d x %d\n", width, height));
+
+	Avi_SetSurface(sdlscrn);
+	bRGBTableInSync = false;
+}
+
+
 /**
  * Change the SDL video mode.
  * @return true if mode has been changed, false if change was not necessary
@@ -397,6 +449,12 @@ static bool Screen_SetSDLVideoSize(int width, int height, bool bForceChange)
 	if (sdlscrn != NULL && sdlscrn->w == width && sdlscrn->h == height && !bForceChange)
 		return false;
 
+	if (bHeadless)
+	{
+		Screen_SetHeadlessSize(width, height);
+		return true;
+	}
+
 	psSdlVideoDriver = SDL_getenv("SDL_VIDEODRIVER");
 	bUseDummyMode = psSdlVideoDriver && !strcmp(psSdlVideoDriver, "dummy");
 
@@ -556,6 +614,8 @@ static void Screen_SetSTResolution(bool bForceChange)
 	int Width, Height, nZoom, SBarHeight, maxW, maxH;
 	bool bDoubleLowRes = false;
 
+	ScreenConv_Sync(false);
+
 	nBorderPixelsTop = nBorderPixelsBottom = 0;
 	nBorderPixelsLeft = nBorderPixelsRight = 0;
 
@@ -704,6 +764,9 @@ void Screen_Init(void)
 	/* Clear frame buffer structures and set current pointer */
 	memset(&FrameBuffer, 0, sizeof(FRAMEBUFFER));
 
+	/* Select bitplane conversion code for the host CPU */
+	ScreenPlanar_Init();
+
 	/* Allocate screen check workspace. */
 	FrameBuffer.pSTScreen = malloc(MAX_VDI_BYTES);
 	FrameBuffer.pSTScreenCopy = malloc(MAX_VDI_BYTES);
@@ -711,15 +774,20 @@ void Screen_Init(void)
 	{
 		Main_ErrorExit("Failed to allocate frame buffer memory", NULL, -1);
 	}
+	memset(FrameBuffer.LineDirty, 1, sizeof(FrameBuffer.LineDirty));
 	pFrameBuffer = &FrameBuffer;  /* TODO: Replace pFrameBuffer with FrameBuffer everywhere */
 
 	/* Set initial window resolution */
-	bInFullScreen = ConfigureParams.Screen.bFullScreen;
+	bHeadless = ConfigureParams.Screen.bHeadless;
+	bInFullScreen = ConfigureParams.Screen.bFullScreen && !bHeadless;
 	Screen_ChangeResolution(false);
 	ScreenDrawFunctionsNormal[ST_HIGH_RES] = Screen_ConvertHighRes;
 
 	Video_SetScreenRasters();                       /* Set rasters ready for first screen */
 
+	if (bHeadless)
+		return;
+
 	/* Load and set icon */
 	File_MakePathBuf(sIconFileName, sizeof(sIconFileName), Paths_GetDataDir(),
 	                 "hatari-icon", "bmp");
@@ -742,6 +810,8 @@ void Screen_Init(void)
  */
 void Screen_UnInit(void)
 {
+	ScreenConv_UnInit();
+
 	/* Free memory used for copies */
 	free(FrameBuffer.pSTScreen);
 	free(FrameBuffer.pSTScreenCopy);
@@ -833,6 +903,8 @@ static void Screen_Refresh(void)
 	{
 		Screen_DrawFrame(true);
 	}
+	/* show screen also when converted by converter thread */
+	ScreenConv_Sync(true);
 }
 
 
@@ -844,7 +916,7 @@ void Screen_EnterFullScreen(void)
 {
 	bool bWasRunning;
 
-	if (!bInFullScreen)
+	if (!bInFullScreen && !bHeadless)
 	{
 		/* Hold things... */
 		bWasRunning = Main_PauseEmulation(false);
@@ -1183,6 +1255,18 @@ static void Screen_Blit(SDL_Rect *sbar_rect)
 	SDL_Rect rects[2];
 
 	rects[0] = STScreenRect;
+	/* Only changed lines need to be shown? */
+	if (bScrTrackLines && pScrChangedStart)
+	{
+		int first = (pScrChangedStart - (Uint8 *)sdlscrn->pixels) / sdlscrn->pitch;
+		int end = (pScrChangedEnd - (Uint8 *)sdlscrn->pixels + sdlscrn->pitch - 1) / sdlscrn->pitch;
+
+		if (first > STScreenRect.y)
+			rects[0].y = first;
+		if (end > STScreenRect.y + STScreenRect.h)
+			end = STScreenRect.y + STScreenRect.h;
+		rects[0].h = end - rects[0].y;
+	}
 	if (sbar_rect)
 	{
 		rects[1] = *sbar_rect;
@@ -1194,6 +1278,8 @@ static void Screen_Blit(SDL_Rect *sbar_rect)
 	pTmpScreen = pFrameBuffer->pSTScreenCopy;
 	pFrameBuffer->pSTScreenCopy = pFrameBuffer->pSTScreen;
 	pFrameBuffer->pSTScreen = pTmpScreen;
+	/* Lines not copied on next frame are unknown */
+	memset(pFrameBuffer->LineDirty, 1, sizeof(pFrameBuffer->LineDirty));
 }
 
 
@@ -1263,6 +1349,14 @@ static bool Screen_DrawFrame(bool bForceFlip)
 		bPrevFrameWasSpec512 = false;
 	}
 
+	/* Only normal low/medium res conversion functions track which
+	 * lines changed, otherwise whole screen is shown */
+	bScrTrackLines = !pFrameBuffer->bFullUpdate
+	                 && (pDrawFunction == ConvertLowRes_320x32Bit
+	                     || pDrawFunction == ConvertLowRes_640x32Bit
+	                     || pDrawFunction == ConvertMediumRes_640x32Bit);
+	pScrChangedStart = pScrChangedEnd = NULL;
+
 	/* Store palette for screenshots
 	 * pDrawFunction may override this if it calls Screen_GenConvert */
 	ConvertPalette = STRGBPalette;
@@ -1292,6 +1386,45 @@ static bool Screen_DrawFrame(bool bForceFlip)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Return true if converting current frame can be skipped, i.e. when
+ * running headless and frame isn't needed for video recording.
+ */
+bool Screen_SkipFrame(void)
+{
+	if (!bHeadless)
+		return false;
+	if (bRecordingAvi || bCapturePipe)
+	{
+		bHeadlessSkipped = false;
+		return false;
+	}
+
+	/* whole screen needs to be converted when next frame is needed */
+	pFrameBuffer->bFullUpdate = true;
+	bHeadlessSkipped = true;
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Make sure screen surface is up to date for a screenshot.  In headless
+ * mode frame conversions are skipped, so current frame is converted now.
+ */
+void Screen_UpdateForCapture(void)
+{
+	ScreenConv_Sync(false);
+
+	if (!bHeadlessSkipped)
+		return;
+
+	bHeadlessSkipped = false;
+	Screen_Refresh();
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Draw ST screen to window/full-screen
@@ -1317,6 +1450,8 @@ void Screen_SetGenConvSize(int width, int height, bool bForceChange)
 	int screenwidth, screenheight, maxw, maxh;
 	int scalex, scaley, sbarheight;
 
+	ScreenConv_Sync(false);
+
 	/* constrain size request to user's desktop size */
 	Resolution_GetLimits(&maxw, &maxh, keep);
 
@@ -1485,6 +1620,24 @@ static int AdjustLinePaletteRemap(int y)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Check whether given screen line needs to be converted, i.e. whether
+ * it needs an update due to palette / resolution change, or whether its
+ * contents may have changed since the previous converted frame.
+ * If yes, mark 'size' bytes from 'dest' in host screen as changed.
+ */
+static bool Convert_LineNeedsUpdate(int y, int update, void *dest, int size)
+{
+	if (!update && !pFrameBuffer->LineDirty[y])
+		return false;
+
+	if (!pScrChangedStart)
+		pScrChangedStart = dest;
+	pScrChangedEnd = (Uint8 *)dest + size;
+	return true;
+}
+
 /*-----------------------------------------------------------------------*/
 /**
  * Run updates to palette(STRGBPalette[]) until get to screen line
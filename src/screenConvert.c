@@ -13,6 +13,7 @@
 #include "memorySnapShot.h"
 #include "screen.h"
 #include "screenConvert.h"
+#include "screenPlanar.h"
 #include "statusbar.h"
 #include "stMemory.h"
 #include "video.h"
@@ -31,6 +32,7 @@ static struct screen_zoom_s screen_zoom;
 static bool bTTSampleHold = false;		/* TT special video mode */
 static int nSampleHoldIdx;
 static uint32_t nScreenBaseAddr;		/* address of screen in STRam */
+static const Uint32 *pNativePalette;		/* palette used for conversion */
 int ConvertW = 0;
 int ConvertH = 0;
 int ConvertBPP = 1;
@@ -41,6 +43,7 @@ static struct
 {
 	SDL_Color	standard[256];
 	Uint32		native[256];
+	Uint32		index[256];	/* identity mapping, for TT sample & hold */
 } palette;
 
 void Screen_SetPaletteColor(Uint8 idx, Uint8 red, Uint8 green, Uint8 blue)
@@ -89,116 +92,47 @@ static inline Uint32 idx2pal(Uint8 idx)
 	if (unlikely(bTTSampleHold))
 	{
 		if (idx == 0)
-			return palette.native[nSampleHoldIdx];
+			return pNativePalette[nSampleHoldIdx];
 		nSampleHoldIdx = idx;
 	}
-	return palette.native[idx];
+	return pNativePalette[idx];
 }
 
 
 /**
  * Performs conversion from the TOS's bitplane word order (big endian) data
- * into the native 32-bit chunky pixels.
+ * into the native 32-bit chunky pixels, for one line.  The first
+ * hscrolloffset pixels are skipped for fine scrolling.
  */
-static void Screen_BitplaneToChunky32(Uint16 *atariBitplaneData, Uint16 bpp,
-                                      Uint32 *hvram)
-{
-	Uint32 a, b, c, d, x;
-
-	if (bpp >= 4) {
-		d = *(Uint32 *)&atariBitplaneData[0];
-		c = *(Uint32 *)&atariBitplaneData[2];
-		if (bpp == 4) {
-			a = b = 0;
-		} else {
-			b = *(Uint32 *)&atariBitplaneData[4];
-			a = *(Uint32 *)&atariBitplaneData[6];
-		}
-
-		x = a;
-		a =  (a & 0xf0f0f0f0)       | ((c & 0xf0f0f0f0) >> 4);
-		c = ((x & 0x0f0f0f0f) << 4) |  (c & 0x0f0f0f0f);
-	} else {
-		a = b = c = 0;
-		if (bpp == 2) {
-			d = *(Uint32 *)&atariBitplaneData[0];
-		} else {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-			d = atariBitplaneData[0]<<16;
-#else
-			d = atariBitplaneData[0];
-#endif
-		}
-	}
-
-	x = b;
-	b =  (b & 0xf0f0f0f0)       | ((d & 0xf0f0f0f0) >> 4);
-	d = ((x & 0x0f0f0f0f) << 4) |  (d & 0x0f0f0f0f);
-
-	x = a;
-	a =  (a & 0xcccccccc)       | ((b & 0xcccccccc) >> 2);
-	b = ((x & 0x33333333) << 2) |  (b & 0x33333333);
-	x = c;
-	c =  (c & 0xcccccccc)       | ((d & 0xcccccccc) >> 2);
-	d = ((x & 0x33333333) << 2) |  (d & 0x33333333);
-
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-	a = (a & 0x5555aaaa) | ((a & 0x00005555) << 17) | ((a & 0xaaaa0000) >> 17);
-	b = (b & 0x5555aaaa) | ((b & 0x00005555) << 17) | ((b & 0xaaaa0000) >> 17);
-	c = (c & 0x5555aaaa) | ((c & 0x00005555) << 17) | ((c & 0xaaaa0000) >> 17);
-	d = (d & 0x5555aaaa) | ((d & 0x00005555) << 17) | ((d & 0xaaaa0000) >> 17);
-
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(d >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(d >> 16);
-#else
-	a = (a & 0xaaaa5555) | ((a & 0x0000aaaa) << 15) | ((a & 0x55550000) >> 15);
-	b = (b & 0xaaaa5555) | ((b & 0x0000aaaa) << 15) | ((b & 0x55550000) >> 15);
-	c = (c & 0xaaaa5555) | ((c & 0x0000aaaa) << 15) | ((c & 0x55550000) >> 15);
-	d = (d & 0xaaaa5555) | ((d & 0x0000aaaa) << 15) | ((d & 0x55550000) >> 15);
-
-	*hvram++ = idx2pal(a >> 16);
-	*hvram++ = idx2pal(a);
-	*hvram++ = idx2pal(b >> 16);
-	*hvram++ = idx2pal(b);
-	*hvram++ = idx2pal(c >> 16);
-	*hvram++ = idx2pal(c);
-	*hvram++ = idx2pal(d >> 16);
-	*hvram++ = idx2pal(d);
-	*hvram++ = idx2pal(a >> 24);
-	*hvram++ = idx2pal(a >> 8);
-	*hvram++ = idx2pal(b >> 24);
-	*hvram++ = idx2pal(b >> 8);
-	*hvram++ = idx2pal(c >> 24);
-	*hvram++ = idx2pal(c >> 8);
-	*hvram++ = idx2pal(d >> 24);
-	*hvram++ = idx2pal(d >> 8);
-#endif
-}
-
-
 static inline Uint32 *ScreenConv_BitplaneLineTo32bpp(Uint16 *fvram_column,
                                                      Uint32 *hvram_column, int vw,
                                                      int vbpp, int hscrolloffset)
 {
 	Uint32 hvram_buf[16];
+	Uint32 *hvram_start = hvram_column;
+	const Uint32 *pal = pNativePalette;
+	int groups = ((vw + 15) >> 4) - 1;
 	int i;
 
+	/* TT sample & hold needs to go through the palette indexes in order,
+	 * so convert them first to indexes and apply palette afterwards */
+	if (unlikely(bTTSampleHold))
+	{
+		if (!palette.index[255])
+		{
+			for (i = 0; i < 256; i++)
+				palette.index[i] = i;
+		}
+		pal = palette.index;
+	}
+
 	/* First 16 pixels */
-	Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_buf);
+	ScreenPlanar_ToChunky(fvram_column, vbpp, 1, pal, hvram_buf);
+	if (unlikely(bTTSampleHold))
+	{
+		for (i = 0; i < hscrolloffset; i++)
+			idx2pal(hvram_buf[i]);
+	}
 	for (i = hscrolloffset; i < 16; i++)
 	{
 		*hvram_column++ = hvram_buf[i];
@@ -206,23 +140,29 @@ static inline Uint32 *ScreenConv_BitplaneLineTo32bpp(Uint16 *fvram_column,
 	fvram_column += vbpp;
 
 	/* Now the main part of the line */
-	for (i = 1; i < (vw + 15) >> 4; i++)
+	if (groups > 0)
 	{
-		Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_column);
-		hvram_column += 16;
-		fvram_column += vbpp;
+		ScreenPlanar_ToChunky(fvram_column, vbpp, groups, pal, hvram_column);
+		hvram_column += groups * 16;
+		fvram_column += groups * vbpp;
 	}
 
 	/* Last pixels of the line for fine scrolling */
 	if (hscrolloffset)
 	{
-		Screen_BitplaneToChunky32(fvram_column, vbpp, hvram_buf);
+		ScreenPlanar_ToChunky(fvram_column, vbpp, 1, pal, hvram_buf);
 		for (i = 0; i < hscrolloffset; i++)
 		{
 			*hvram_column++ = hvram_buf[i];
 		}
 	}
 
+	if (unlikely(bTTSampleHold))
+	{
+		for (; hvram_start < hvram_column; hvram_start++)
+			*hvram_start = idx2pal(*hvram_start);
+	}
+
 	return hvram_column;
 }
 
@@ -242,7 +182,7 @@ static void ScreenConv_BitplaneTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the upper border */
 	for (h = 0; h < upperBorder; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		Screen_memset_uint32(hvram_line, pNativePalette[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -253,7 +193,7 @@ static void ScreenConv_BitplaneTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 
 		if (nLineEndAddr > STRamEnd)
 		{
-			Screen_memset_uint32(hvram_line, palette.native[0], pitch);
+			Screen_memset_uint32(hvram_line, pNativePalette[0], pitch);
 			hvram_line += pitch;
 			continue;
 		}
@@ -261,14 +201,14 @@ static void ScreenConv_BitplaneTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 		nSampleHoldIdx = 0;
 
 		/* Left border first */
-		Screen_memset_uint32(hvram_column, palette.native[0], leftBorder);
+		Screen_memset_uint32(hvram_column, pNativePalette[0], leftBorder);
 		hvram_column += leftBorder;
 
 		hvram_column = ScreenConv_BitplaneLineTo32bpp(fvram_line, hvram_column,
 		                                              vw, vbpp, hscrolloffset);
 
 		/* Right border */
-		Screen_memset_uint32(hvram_column, palette.native[0], rightBorder);
+		Screen_memset_uint32(hvram_column, pNativePalette[0], rightBorder);
 
 		nLineEndAddr += nextline * 2;
 		fvram_line += nextline;
@@ -278,7 +218,7 @@ static void ScreenConv_BitplaneTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the lower border */
 	for (h = 0; h < lowBorder; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		Screen_memset_uint32(hvram_line, pNativePalette[0], scrwidth);
 		hvram_line += pitch;
 	}
 }
@@ -298,7 +238,7 @@ static void ScreenConv_HiColorTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the upper border */
 	for (h = 0; h < upperBorder; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		Screen_memset_uint32(hvram_line, pNativePalette[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -310,13 +250,13 @@ static void ScreenConv_HiColorTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 
 		if (nLineEndAddr > STRamEnd)
 		{
-			Screen_memset_uint32(hvram_line, palette.native[0], pitch);
+			Screen_memset_uint32(hvram_line, pNativePalette[0], pitch);
 			hvram_line += pitch;
 			continue;
 		}
 
 		/* Left border first */
-		Screen_memset_uint32(hvram_column, palette.native[0], leftBorder);
+		Screen_memset_uint32(hvram_column, pNativePalette[0], leftBorder);
 		hvram_column += leftBorder;
 
 		/* Graphical area */
@@ -330,7 +270,7 @@ static void ScreenConv_HiColorTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 		}
 
 		/* Right border */
-		Screen_memset_uint32(hvram_column, palette.native[0], rightBorder);
+		Screen_memset_uint32(hvram_column, pNativePalette[0], rightBorder);
 
 		nLineEndAddr += nextline * 2;
 		fvram_line += nextline;
@@ -340,7 +280,7 @@ static void ScreenConv_HiColorTo32bppNoZoom(Uint16 *fvram_line, Uint8 *hvram,
 	/* Render the bottom border */
 	for (h = 0; h < lowBorder; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		Screen_memset_uint32(hvram_line, pNativePalette[0], scrwidth);
 		hvram_line += pitch;
 	}
 }
@@ -360,12 +300,8 @@ static void Screen_ConvertWithoutZoom(Uint16 *fvram, int vw, int vh, int vbpp, i
 	if (hscrolloffset) {
 		/* Yes, so we need to adjust offset to next line: */
 		nextline += vbpp;
-		ConvertNextLine = nextline * 2;
 	}
 
-	/* The sample-hold feature exists only on the TT */
-	bTTSampleHold = (TTSpecialVideoMode & 0x80) != 0;
-
 	/* Clip to SDL_Surface dimensions */
 	scrwidth = Screen_GetGenConvWidth();
 	scrheight = Screen_GetGenConvHeight();
@@ -453,7 +389,7 @@ static void ScreenConv_BitplaneTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 	/* Render the upper border */
 	for (h = 0; h < upperBorder * coefy; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		Screen_memset_uint32(hvram_line, pNativePalette[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -471,7 +407,7 @@ static void ScreenConv_BitplaneTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 		}
 		else if (nLineEndAddr > STRamEnd)
 		{
-			Screen_memset_uint32(hvram_line, palette.native[0], pitch);
+			Screen_memset_uint32(hvram_line, pNativePalette[0], pitch);
 		}
 		else
 		{
@@ -480,7 +416,7 @@ static void ScreenConv_BitplaneTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 
 			hvram_column = hvram_line;
 			/* Display the Left border */
-			Screen_memset_uint32(hvram_column, palette.native[0], leftBorder * coefx);
+			Screen_memset_uint32(hvram_column, pNativePalette[0], leftBorder * coefx);
 			hvram_column += leftBorder * coefx;
 
 			/* Display the Graphical area */
@@ -491,7 +427,7 @@ static void ScreenConv_BitplaneTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 			hvram_column += vw * coefx;
 
 			/* Display the Right border */
-			Screen_memset_uint32(hvram_column, palette.native[0], rightBorder * coefx);
+			Screen_memset_uint32(hvram_column, pNativePalette[0], rightBorder * coefx);
 
 			nLineEndAddr += nextline * 2;
 		}
@@ -503,7 +439,7 @@ static void ScreenConv_BitplaneTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 	/* Render the lower border */
 	for (h = 0; h < lowerBorder * coefy; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		Screen_memset_uint32(hvram_line, pNativePalette[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -531,7 +467,7 @@ static void ScreenConv_HiColorTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 	/* Render the upper border */
 	for (h = 0; h < upperBorder * coefy; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		Screen_memset_uint32(hvram_line, pNativePalette[0], scrwidth);
 		hvram_line += pitch;
 	}
 
@@ -551,14 +487,14 @@ static void ScreenConv_HiColorTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 		}
 		else if (nLineEndAddr > STRamEnd)
 		{
-			Screen_memset_uint32(hvram_line, palette.native[0], pitch);
+			Screen_memset_uint32(hvram_line, pNativePalette[0], pitch);
 		}
 		else
 		{
 			hvram_column = hvram_line;
 
 			/* Display the Left border */
-			Screen_memset_uint32(hvram_column, palette.native[0], leftBorder * coefx);
+			Screen_memset_uint32(hvram_column, pNativePalette[0], leftBorder * coefx);
 			hvram_column += leftBorder * coefx;
 
 			/* Display the Graphical area */
@@ -574,7 +510,7 @@ static void ScreenConv_HiColorTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 			}
 
 			/* Display the Right border */
-			Screen_memset_uint32(hvram_column, palette.native[0], rightBorder * coefx);
+			Screen_memset_uint32(hvram_column, pNativePalette[0], rightBorder * coefx);
 
 			nLineEndAddr += nextline * 2;
 		}
@@ -586,7 +522,7 @@ static void ScreenConv_HiColorTo32bppZoomed(Uint16 *fvram, Uint8 *hvram,
 	/* Render the lower border */
 	for (h = 0; h < lowerBorder * coefy; h++)
 	{
-		Screen_memset_uint32(hvram_line, palette.native[0], scrwidth);
+		Screen_memset_uint32(hvram_line, pNativePalette[0], scrwidth);
 		hvram_line += pitch;
 	}
 }
@@ -602,9 +538,6 @@ static void Screen_ConvertWithZoom(Uint16 *fvram, int vw, int vh, int vbpp, int
 	int vw_b, vh_b;
 	int i;
 
-	/* The sample-hold feature exists only on the TT */
-	bTTSampleHold = (TTSpecialVideoMode & 0x80) != 0;
-
 	vw_b = vw + leftBorder + rightBorder;
 	vh_b = vh + upperBorder + lowerBorder;
 
@@ -619,7 +552,6 @@ static void Screen_ConvertWithZoom(Uint16 *fvram, int vw, int vh, int vbpp, int
 	if (hscrolloffset) {
 		/* Yes, so we need to adjust offset to next line: */
 		nextline += vbpp;
-		ConvertNextLine = nextline * 2;
 	}
 
 	/* Integer zoom coef ? */
@@ -685,32 +617,285 @@ static void Screen_ConvertWithZoom(Uint16 *fvram, int vw, int vh, int vbpp, int
 	}
 }
 
-void Screen_GenConvert(uint32_t vaddr, void *fvram, int vw, int vh,
-                       int vbpp, int nextline, int hscroll,
-                       int leftBorderSize, int rightBorderSize,
-                       int upperBorderSize, int lowerBorderSize)
+/* Screen conversion parameters */
+typedef struct
 {
-	nScreenBaseAddr = vaddr;
+	Uint16 *fvram;
+	int vw, vh, vbpp, nextline, hscroll;
+	int leftBorder, rightBorder, upperBorder, lowerBorder;
+	bool zoom;
+} screen_conv_t;
+
+/* Converter thread, used for pipelined conversion */
+static struct
+{
+	SDL_Thread *thread;
+	SDL_mutex *mutex;
+	SDL_cond *cond;
+	bool queued;		/* conversion queued for the thread, or ongoing */
+	bool unshown;		/* converted screen not yet shown */
+	bool quit;		/* thread should exit */
+	screen_conv_t conv;
+	uint32_t vaddr;
+	bool samplehold;
+	Uint32 native[256];	/* copy of the palette */
+	Uint8 *fvram;		/* copy of the Atari screen */
+	size_t fvram_size;
+} ConvThread;
+
+
+static void Screen_Convert(const screen_conv_t *conv)
+{
+	if (conv->zoom) {
+		Screen_ConvertWithZoom(conv->fvram, conv->vw, conv->vh, conv->vbpp,
+		                       conv->nextline, conv->hscroll,
+		                       conv->leftBorder, conv->rightBorder,
+		                       conv->upperBorder, conv->lowerBorder);
+	} else {
+		Screen_ConvertWithoutZoom(conv->fvram, conv->vw, conv->vh, conv->vbpp,
+		                          conv->nextline, conv->hscroll,
+		                          conv->leftBorder, conv->rightBorder,
+		                          conv->upperBorder, conv->lowerBorder);
+	}
+}
+
+/**
+ * Set conversion parameters and the variables used by screenshots
+ * and AVI recording.
+ */
+static void Screen_SetConvert(screen_conv_t *conv, void *fvram,
+                              int vw, int vh, int vbpp, int nextline, int hscroll,
+                              int leftBorderSize, int rightBorderSize,
+                              int upperBorderSize, int lowerBorderSize)
+{
+	conv->fvram = fvram;
+	conv->vw = vw;
+	conv->vh = vh;
+	conv->vbpp = vbpp;
+	conv->nextline = nextline;
+	conv->hscroll = hscroll;
+	conv->leftBorder = leftBorderSize;
+	conv->rightBorder = rightBorderSize;
+	conv->upperBorder = upperBorderSize;
+	conv->lowerBorder = lowerBorderSize;
+	conv->zoom = (nScreenZoomX * nScreenZoomY != 1);
+
 	ConvertW = vw;
 	ConvertH = vh;
 	ConvertBPP = vbpp;
-	ConvertNextLine = nextline * 2;	/* bytes per line */
+	/* bytes per line, horizontal scroll uses one more 16 pixel block */
+	ConvertNextLine = (nextline + (hscroll ? vbpp : 0)) * 2;
 
 	/* Override drawing palette for screenshots */
 	ConvertPalette = palette.native;
 	ConvertPaletteSize = 1 << vbpp;
 	if (ConvertPaletteSize > 256)
 		ConvertPaletteSize = 256;
+}
 
-	if (nScreenZoomX * nScreenZoomY != 1) {
-		Screen_ConvertWithZoom(fvram, vw, vh, vbpp, nextline, hscroll,
-		                       leftBorderSize, rightBorderSize,
-		                       upperBorderSize, lowerBorderSize);
-	} else {
-		Screen_ConvertWithoutZoom(fvram, vw, vh, vbpp, nextline, hscroll,
-		                          leftBorderSize, rightBorderSize,
-		                          upperBorderSize, lowerBorderSize);
+void Screen_GenConvert(uint32_t vaddr, void *fvram, int vw, int vh,
+                       int vbpp, int nextline, int hscroll,
+                       int leftBorderSize, int rightBorderSize,
+                       int upperBorderSize, int lowerBorderSize)
+{
+	screen_conv_t conv;
+
+	ScreenConv_Sync(false);
+
+	Screen_SetConvert(&conv, fvram, vw, vh, vbpp, nextline, hscroll,
+	                  leftBorderSize, rightBorderSize,
+	                  upperBorderSize, lowerBorderSize);
+
+	/* The sample-hold feature exists only on the TT */
+	bTTSampleHold = (TTSpecialVideoMode & 0x80) != 0;
+	nScreenBaseAddr = vaddr;
+	pNativePalette = palette.native;
+
+	Screen_Convert(&conv);
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Converter thread main loop
+ */
+static int ScreenConv_Thread(void *data)
+{
+	SDL_LockMutex(ConvThread.mutex);
+	for (;;)
+	{
+		while (!ConvThread.queued && !ConvThread.quit)
+			SDL_CondWait(ConvThread.cond, ConvThread.mutex);
+		if (ConvThread.quit)
+			break;
+		SDL_UnlockMutex(ConvThread.mutex);
+
+		bTTSampleHold = ConvThread.samplehold;
+		nScreenBaseAddr = ConvThread.vaddr;
+		pNativePalette = ConvThread.native;
+		Screen_Convert(&ConvThread.conv);
+
+		SDL_LockMutex(ConvThread.mutex);
+		ConvThread.queued = false;
+		ConvThread.unshown = true;
+		SDL_CondBroadcast(ConvThread.cond);
+	}
+	SDL_UnlockMutex(ConvThread.mutex);
+	return 0;
+}
+
+/**
+ * Start converter thread.  Return false on failure.
+ */
+static bool ScreenConv_StartThread(void)
+{
+	ConvThread.mutex = SDL_CreateMutex();
+	ConvThread.cond = SDL_CreateCond();
+	if (ConvThread.mutex && ConvThread.cond)
+	{
+		ConvThread.quit = false;
+		ConvThread.thread = SDL_CreateThread(ScreenConv_Thread, "screenconv", NULL);
+		if (ConvThread.thread)
+			return true;
+	}
+	Log_Printf(LOG_WARN, "Failed to start screen converter thread: %s\n", SDL_GetError());
+	ConfigureParams.Screen.bConvertThread = false;
+	ScreenConv_UnInit();
+	return false;
+}
+
+/**
+ * Wait until converter thread has finished with the queued screen,
+ * and if 'show' is set, show it (with statusbar) if not yet shown.
+ * Needs to be called before anything else accesses the SDL screen surface.
+ */
+void ScreenConv_Sync(bool show)
+{
+	if (!ConvThread.thread)
+		return;
+
+	SDL_LockMutex(ConvThread.mutex);
+	while (ConvThread.queued)
+		SDL_CondWait(ConvThread.cond, ConvThread.mutex);
+	SDL_UnlockMutex(ConvThread.mutex);
+
+	if (show && ConvThread.unshown)
+	{
+		ConvThread.unshown = false;
+		Screen_GenConvUpdate(Statusbar_Update(sdlscrn, false), false);
+	}
+}
+
+/**
+ * Stop converter thread
+ */
+void ScreenConv_UnInit(void)
+{
+	if (ConvThread.thread)
+	{
+		ScreenConv_Sync(false);
+		SDL_LockMutex(ConvThread.mutex);
+		ConvThread.quit = true;
+		SDL_CondSignal(ConvThread.cond);
+		SDL_UnlockMutex(ConvThread.mutex);
+		SDL_WaitThread(ConvThread.thread, NULL);
+		ConvThread.thread = NULL;
+	}
+	if (ConvThread.cond)
+	{
+		SDL_DestroyCond(ConvThread.cond);
+		ConvThread.cond = NULL;
+	}
+	if (ConvThread.mutex)
+	{
+		SDL_DestroyMutex(ConvThread.mutex);
+		ConvThread.mutex = NULL;
+	}
+	free(ConvThread.fvram);
+	ConvThread.fvram = NULL;
+	ConvThread.fvram_size = 0;
+	ConvThread.unshown = false;
+}
+
+/**
+ * Give copy of the Atari screen and palette for the converter thread
+ * to convert, while emulation continues.  Return false on failure.
+ */
+static bool ScreenConv_Queue(uint32_t vaddr, int vw, int vh, int vbpp,
+                             int nextline, int hscroll,
+                             int leftBorder, int rightBorder,
+                             int upperBorder, int lowerBorder)
+{
+	size_t size, avail, linebytes, linestep;
+
+	if (vw <= 0 || vh <= 0)
+		return false;
+	if (!ConvThread.thread && !ScreenConv_StartThread())
+		return false;
+
+	/* Screen area read by conversion: last line may be longer than
+	 * line offset, with horizontal scroll one more 16 pixel block */
+	if (vbpp < 16)
+		linebytes = (((vw + 15) >> 4) + 1) * vbpp * 2;
+	else
+		linebytes = vw * 2;
+	linestep = (nextline + (hscroll ? vbpp : 0)) * 2;
+	size = (vh - 1) * linestep + linebytes;
+
+	if (size > ConvThread.fvram_size)
+	{
+		Uint8 *fvram = realloc(ConvThread.fvram, size);
+		if (!fvram)
+			return false;
+		ConvThread.fvram = fvram;
+		ConvThread.fvram_size = size;
 	}
+	/* lines beyond RAM end aren't converted */
+	avail = vaddr < STRamEnd ? STRamEnd - vaddr : 0;
+	memcpy(ConvThread.fvram, &STRam[vaddr], size < avail ? size : avail);
+
+	memcpy(ConvThread.native, palette.native, sizeof(ConvThread.native));
+	ConvThread.samplehold = (TTSpecialVideoMode & 0x80) != 0;
+	ConvThread.vaddr = vaddr;
+	Screen_SetConvert(&ConvThread.conv, ConvThread.fvram, vw, vh, vbpp,
+	                  nextline, hscroll, leftBorder, rightBorder,
+	                  upperBorder, lowerBorder);
+
+	SDL_LockMutex(ConvThread.mutex);
+	ConvThread.queued = true;
+	SDL_CondSignal(ConvThread.cond);
+	SDL_UnlockMutex(ConvThread.mutex);
+	return true;
+}
+
+/**
+ * Convert Atari screen at 'vaddr' to the SDL screen surface and show it,
+ * with the statusbar.  With threaded conversion, the screen is converted
+ * by the converter thread while emulation continues, and shown on the
+ * next call.  Return false if screen couldn't be converted.
+ */
+bool Screen_GenConvFrame(uint32_t vaddr, int vw, int vh, int vbpp,
+                         int nextline, int hscroll,
+                         int leftBorder, int rightBorder,
+                         int upperBorder, int lowerBorder)
+{
+	/* show previous frame, before converting new one over it */
+	ScreenConv_Sync(true);
+
+	if (ConfigureParams.Screen.bConvertThread && !SDL_MUSTLOCK(sdlscrn) &&
+	    ScreenConv_Queue(vaddr, vw, vh, vbpp, nextline, hscroll,
+	                     leftBorder, rightBorder, upperBorder, lowerBorder))
+		return true;
+
+	if (!Screen_Lock())
+		return false;
+
+	Screen_GenConvert(vaddr, &STRam[vaddr], vw, vh, vbpp, nextline, hscroll,
+	                  leftBorder, rightBorder, upperBorder, lowerBorder);
+
+	Screen_UnLock();
+	Screen_GenConvUpdate(Statusbar_Update(sdlscrn, false), false);
+	return true;
 }
 
 bool Screen_GenDraw(uint32_t vaddr, int vw, int vh, int vbpp, int nextline,
@@ -719,7 +904,7 @@ bool Screen_GenDraw(uint32_t vaddr, int vw, int vh, int vbpp, int nextline,
 {
 	int hscrolloffset;
 
-	if (ConfigureParams.Screen.DisableVideo || !Screen_Lock())
+	if (ConfigureParams.Screen.DisableVideo)
 		return false;
 
 	if (Config_IsMachineST())
@@ -727,10 +912,6 @@ bool Screen_GenDraw(uint32_t vaddr, int vw, int vh, int vbpp, int nextline,
 	else
 		hscrolloffset = IoMem_ReadByte(0xff8265) & 0x0f;
 
-	Screen_GenConvert(vaddr, &STRam[vaddr], vw, vh, vbpp, nextline, hscrolloffset,
-	                  leftBorder, rightBorder, upperBorder, lowerBorder);
-
-	Screen_UnLock();
-	Screen_GenConvUpdate(Statusbar_Update(sdlscrn, false), false);
-	return true;
+	return Screen_GenConvFrame(vaddr, vw, vh, vbpp, nextline, hscrolloffset,
+	                           leftBorder, rightBorder, upperBorder, lowerBorder);
 }
@@ -0,0 +1,320 @@
+/*
+  Hatari - screenPlanar.c
+
+  This file is distributed under the GNU General Public License, version 2
+  or at your option any later version. Read the file gpl.txt for details.
+
+  Conversion of the TOS's interleaved bitplane data (big endian words)
+  into 32-bit chunky pixels through a 256 color palette, 16 pixels at
+  a time.
+
+  Besides the portable scalar version, there are SSE2 & AVX2 (x86-64)
+  and NEON (AArch64) versions.  The SIMD versions gather a group's
+  plane bytes into one vector register, so that the bits of a given
+  pixel in all the planes are in the top bits of its bytes, and then
+  collect them one pixel at the time (with "movemask" on x86).
+  The fastest one supported by the host CPU is selected by
+  ScreenPlanar_Init(), called from Screen_Init().
+*/
+const char ScreenPlanar_fileid[] = "Hatari screenPlanar.c";
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <SDL_endian.h>
+
+#include "screenPlanar.h"
+
+#if defined(__SSE2__) && defined(__x86_64__)
+# define SCREENPLANAR_SSE2 1
+# include <emmintrin.h>
+# if defined(__GNUC__)
+#  define SCREENPLANAR_AVX2 1
+#  include <immintrin.h>
+# endif
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON) && SDL_BYTEORDER == SDL_LIL_ENDIAN
+# define SCREENPLANAR_NEON 1
+# include <arm_neon.h>
+#endif
+
+
+/**
+ * Convert one group of 16 pixels, with 32-bit scalar shuffles
+ */
+static inline void ScreenPlanar_GroupScalar(const uint16_t *atariBitplaneData,
+                                            int bpp, const uint32_t *palette,
+                                            uint32_t *hvram)
+{
+	uint32_t a, b, c, d, x;
+
+	if (bpp >= 4) {
+		d = *(const uint32_t *)&atariBitplaneData[0];
+		c = *(const uint32_t *)&atariBitplaneData[2];
+		if (bpp == 4) {
+			a = b = 0;
+		} else {
+			b = *(const uint32_t *)&atariBitplaneData[4];
+			a = *(const uint32_t *)&atariBitplaneData[6];
+		}
+
+		x = a;
+		a =  (a & 0xf0f0f0f0)       | ((c & 0xf0f0f0f0) >> 4);
+		c = ((x & 0x0f0f0f0f) << 4) |  (c & 0x0f0f0f0f);
+	} else {
+		a = b = c = 0;
+		if (bpp == 2) {
+			d = *(const uint32_t *)&atariBitplaneData[0];
+		} else {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			d = atariBitplaneData[0]<<16;
+#else
+			d = atariBitplaneData[0];
+#endif
+		}
+	}
+
+	x = b;
+	b =  (b & 0xf0f0f0f0)       | ((d & 0xf0f0f0f0) >> 4);
+	d = ((x & 0x0f0f0f0f) << 4) |  (d & 0x0f0f0f0f);
+
+	x = a;
+	a =  (a & 0xcccccccc)       | ((b & 0xcccccccc) >> 2);
+	b = ((x & 0x33333333) << 2) |  (b & 0x33333333);
+	x = c;
+	c =  (c & 0xcccccccc)       | ((d & 0xcccccccc) >> 2);
+	d = ((x & 0x33333333) << 2) |  (d & 0x33333333);
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	a = (a & 0x5555aaaa) | ((a & 0x00005555) << 17) | ((a & 0xaaaa0000) >> 17);
+	b = (b & 0x5555aaaa) | ((b & 0x00005555) << 17) | ((b & 0xaaaa0000) >> 17);
+	c = (c & 0x5555aaaa) | ((c & 0x00005555) << 17) | ((c & 0xaaaa0000) >> 17);
+	d = (d & 0x5555aaaa) | ((d & 0x00005555) << 17) | ((d & 0xaaaa0000) >> 17);
+
+	*hvram++ = palette[(uint8_t)(a >> 8)];
+	*hvram++ = palette[(uint8_t)(a >> 24)];
+	*hvram++ = palette[(uint8_t)(b >> 8)];
+	*hvram++ = palette[(uint8_t)(b >> 24)];
+	*hvram++ = palette[(uint8_t)(c >> 8)];
+	*hvram++ = palette[(uint8_t)(c >> 24)];
+	*hvram++ = palette[(uint8_t)(d >> 8)];
+	*hvram++ = palette[(uint8_t)(d >> 24)];
+	*hvram++ = palette[(uint8_t)(a)];
+	*hvram++ = palette[(uint8_t)(a >> 16)];
+	*hvram++ = palette[(uint8_t)(b)];
+	*hvram++ = palette[(uint8_t)(b >> 16)];
+	*hvram++ = palette[(uint8_t)(c)];
+	*hvram++ = palette[(uint8_t)(c >> 16)];
+	*hvram++ = palette[(uint8_t)(d)];
+	*hvram++ = palette[(uint8_t)(d >> 16)];
+#else
+	a = (a & 0xaaaa5555) | ((a & 0x0000aaaa) << 15) | ((a & 0x55550000) >> 15);
+	b = (b & 0xaaaa5555) | ((b & 0x0000aaaa) << 15) | ((b & 0x55550000) >> 15);
+	c = (c & 0xaaaa5555) | ((c & 0x0000aaaa) << 15) | ((c & 0x55550000) >> 15);
+	d = (d & 0xaaaa5555) | ((d & 0x0000aaaa) << 15) | ((d & 0x55550000) >> 15);
+
+	*hvram++ = palette[(uint8_t)(a >> 16)];
+	*hvram++ = palette[(uint8_t)(a)];
+	*hvram++ = palette[(uint8_t)(b >> 16)];
+	*hvram++ = palette[(uint8_t)(b)];
+	*hvram++ = palette[(uint8_t)(c >> 16)];
+	*hvram++ = palette[(uint8_t)(c)];
+	*hvram++ = palette[(uint8_t)(d >> 16)];
+	*hvram++ = palette[(uint8_t)(d)];
+	*hvram++ = palette[(uint8_t)(a >> 24)];
+	*hvram++ = palette[(uint8_t)(a >> 8)];
+	*hvram++ = palette[(uint8_t)(b >> 24)];
+	*hvram++ = palette[(uint8_t)(b >> 8)];
+	*hvram++ = palette[(uint8_t)(c >> 24)];
+	*hvram++ = palette[(uint8_t)(c >> 8)];
+	*hvram++ = palette[(uint8_t)(d >> 24)];
+	*hvram++ = palette[(uint8_t)(d >> 8)];
+#endif
+}
+
+static void ScreenPlanar_ToChunkyScalar(const uint16_t *fvram, int bpp,
+                                        int groups, const uint32_t *palette,
+                                        uint32_t *hvram)
+{
+	while (groups-- > 0) {
+		ScreenPlanar_GroupScalar(fvram, bpp, palette, hvram);
+		fvram += bpp;
+		hvram += 16;
+	}
+}
+
+
+#if SCREENPLANAR_SSE2
+/**
+ * Load planes of one group, planes above 'bpp' are zeroed
+ */
+static inline __m128i ScreenPlanar_LoadSSE2(const uint16_t *fvram, int bpp)
+{
+	uint32_t planes;
+
+	switch (bpp) {
+	case 8:
+		return _mm_loadu_si128((const __m128i *)fvram);
+	case 4:
+		return _mm_loadl_epi64((const __m128i *)fvram);
+	case 2:
+		memcpy(&planes, fvram, sizeof(planes));
+		return _mm_cvtsi32_si128(planes);
+	default:
+		return _mm_cvtsi32_si128(fvram[0]);
+	}
+}
+
+static void ScreenPlanar_ToChunkySSE2(const uint16_t *fvram, int bpp,
+                                      int groups, const uint32_t *palette,
+                                      uint32_t *hvram)
+{
+	const __m128i lowbytes = _mm_set1_epi16(0x00ff);
+	__m128i x;
+	int i, bits;
+
+	/* with only 1 or 2 planes, scalar version is as fast */
+	if (bpp <= 2) {
+		ScreenPlanar_ToChunkyScalar(fvram, bpp, groups, palette, hvram);
+		return;
+	}
+	for (; groups > 0; groups--, fvram += bpp, hvram += 16) {
+		x = ScreenPlanar_LoadSSE2(fvram, bpp);
+		/* plane bytes for pixels 0-7 (first in memory, i.e. low
+		 * byte on little endian) to bytes 0-7, 8-15 to 8-15 */
+		x = _mm_packus_epi16(_mm_and_si128(x, lowbytes), _mm_srli_epi16(x, 8));
+		for (i = 0; i < 8; i++) {
+			bits = _mm_movemask_epi8(x);
+			hvram[i] = palette[bits & 0xff];
+			hvram[i + 8] = palette[bits >> 8];
+			x = _mm_add_epi8(x, x);
+		}
+	}
+}
+#endif
+
+
+#if SCREENPLANAR_AVX2
+/**
+ * Same as SSE2 version, but for two groups at the time
+ */
+__attribute__((target("avx2")))
+static void ScreenPlanar_ToChunkyAVX2(const uint16_t *fvram, int bpp,
+                                      int groups, const uint32_t *palette,
+                                      uint32_t *hvram)
+{
+	const __m256i lowbytes = _mm256_set1_epi16(0x00ff);
+	__m256i x;
+	uint32_t bits;
+	int i;
+
+	for (; groups > 1; groups -= 2, fvram += 2 * bpp, hvram += 32) {
+		if (bpp == 8)
+			x = _mm256_loadu_si256((const __m256i *)fvram);
+		else
+			x = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(ScreenPlanar_LoadSSE2(fvram, bpp)),
+				ScreenPlanar_LoadSSE2(fvram + bpp, bpp), 1);
+		/* packing is done within 128-bit lanes, i.e. per group */
+		x = _mm256_packus_epi16(_mm256_and_si256(x, lowbytes), _mm256_srli_epi16(x, 8));
+		for (i = 0; i < 8; i++) {
+			bits = _mm256_movemask_epi8(x);
+			hvram[i] = palette[bits & 0xff];
+			hvram[i + 8] = palette[(bits >> 8) & 0xff];
+			hvram[i + 16] = palette[(bits >> 16) & 0xff];
+			hvram[i + 24] = palette[bits >> 24];
+			x = _mm256_add_epi8(x, x);
+		}
+	}
+	if (groups)
+		ScreenPlanar_ToChunkySSE2(fvram, bpp, groups, palette, hvram);
+}
+
+static bool ScreenPlanar_HasAVX2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+#endif
+
+
+#if SCREENPLANAR_NEON
+static void ScreenPlanar_ToChunkyNEON(const uint16_t *fvram, int bpp,
+                                      int groups, const uint32_t *palette,
+                                      uint32_t *hvram)
+{
+	static const int8_t planeshift[16] = {
+		0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7
+	};
+	const int8x16_t shifts = vld1q_s8(planeshift);
+	uint16_t planes[8];
+	uint16x8_t v;
+	uint8x16_t x, t;
+	int i;
+
+	for (; groups > 0; groups--, fvram += bpp, hvram += 16) {
+		if (bpp == 8) {
+			v = vld1q_u16(fvram);
+		} else {
+			memset(planes, 0, sizeof(planes));
+			memcpy(planes, fvram, bpp * sizeof(*fvram));
+			v = vld1q_u16(planes);
+		}
+		/* plane bytes for pixels 0-7 to bytes 0-7, 8-15 to 8-15 */
+		x = vcombine_u8(vmovn_u16(v), vshrn_n_u16(v, 8));
+		for (i = 0; i < 8; i++) {
+			/* top bit of each plane byte to its plane bit */
+			t = vshlq_u8(vshrq_n_u8(x, 7), shifts);
+			hvram[i] = palette[vaddv_u8(vget_low_u8(t))];
+			hvram[i + 8] = palette[vaddv_u8(vget_high_u8(t))];
+			x = vshlq_n_u8(x, 1);
+		}
+	}
+}
+#endif
+
+
+/* Available kernels, from slowest to fastest */
+static const ScreenPlanar_Kernel_t Kernels[] = {
+	{ "scalar", ScreenPlanar_ToChunkyScalar },
+#if SCREENPLANAR_SSE2
+	{ "sse2", ScreenPlanar_ToChunkySSE2 },
+#endif
+#if SCREENPLANAR_AVX2
+	{ "avx2", ScreenPlanar_ToChunkyAVX2 },
+#endif
+#if SCREENPLANAR_NEON
+	{ "neon", ScreenPlanar_ToChunkyNEON },
+#endif
+};
+static int KernelCount;
+
+/**
+ * Set 'kernels' to table of the kernels supported by the host CPU,
+ * ordered from slowest to fastest.  Return their count.
+ */
+int ScreenPlanar_GetKernels(const ScreenPlanar_Kernel_t **kernels)
+{
+	if (!KernelCount) {
+		KernelCount = sizeof(Kernels) / sizeof(Kernels[0]);
+#if SCREENPLANAR_AVX2
+		if (!ScreenPlanar_HasAVX2())
+			KernelCount--;
+#endif
+	}
+	*kernels = Kernels;
+	return KernelCount;
+}
+
+ScreenPlanar_Func_t ScreenPlanar_ToChunky = ScreenPlanar_ToChunkyScalar;
+
+/**
+ * Select fastest kernel.  Needs to be called before screen
+ * conversion thread is started, as it's not changed after that.
+ */
+void ScreenPlanar_Init(void)
+{
+	const ScreenPlanar_Kernel_t *kernels;
+	int count = ScreenPlanar_GetKernels(&kernels);
+
+	ScreenPlanar_ToChunky = kernels[count - 1].func;
+}
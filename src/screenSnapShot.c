@@ -26,9 +26,9 @@ const char ScreenSnapShot_fileid[] = "Hatari screenSnapShot.c";
 /* after above that bring in config.h */
 #if HAVE_LIBPNG
 # include <png.h>
-# include <assert.h>
-# include "pixel_convert.h"				/* inline functions */
 #endif
+#include <assert.h>
+#include "pixel_convert.h"				/* inline functions */
 
 
 static int nScreenShots = 0;                /* Number of screen shots saved */
@@ -74,6 +74,39 @@ static void ScreenSnapShot_GetNum(void)
 }
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Make sure that 'pBuf' can store 'size' bytes, return false on failure
+ */
+bool ScreenSnapShot_BufferReserve(SCREENSNAPSHOT_BUFFER *pBuf, int size)
+{
+	Uint8 *data;
+
+	if (size <= pBuf->AllocSize)
+		return true;
+
+	/* grow by at least 50% to avoid reallocating too often */
+	if (size < pBuf->AllocSize + pBuf->AllocSize / 2)
+		size = pBuf->AllocSize + pBuf->AllocSize / 2;
+	data = realloc(pBuf->pData, size);
+	if (!data)
+		return false;
+	pBuf->pData = data;
+	pBuf->AllocSize = size;
+	return true;
+}
+
+
+/**
+ * Free memory allocated for 'pBuf'
+ */
+void ScreenSnapShot_BufferFree(SCREENSNAPSHOT_BUFFER *pBuf)
+{
+	free(pBuf->pData);
+	memset(pBuf, 0, sizeof(*pBuf));
+}
+
+
 #if HAVE_LIBPNG
 /**
  * Save given SDL surface as PNG. Return png file size > 0 for success.
@@ -98,32 +131,28 @@ static int ScreenSnapShot_SavePNG(SDL_Surface *surface, const char *filename)
 	fclose (fp);
 	return ret;					/* >0 if OK, -1 if error */
 }
+#endif
 
 
 /**
- * Save given SDL surface as PNG in an already opened FILE, eventually cropping some borders.
- * Return png file size > 0 for success.
- * This function is also used by avi_record.c to save individual frames as png images.
+ * Convert given SDL surface to 'pImage', eventually cropping some borders
+ * and scaling it to 'dw' x 'dh' pixels. Pixels are stored as indexes in the
+ * current ST palette if all the colours belong to it, else as RGB.
+ * Once converted, 'pImage' doesn't depend on the surface or on the palette
+ * anymore and can be encoded later (possibly from another thread).
+ * Return false on failure.
  */
-int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
-		FILE *fp, int png_compression_level, int png_filter,
-		int CropLeft , int CropRight , int CropTop , int CropBottom )
+bool ScreenSnapShot_PrepareImage(SDL_Surface *surface, int dw, int dh,
+		int CropLeft , int CropRight , int CropTop , int CropBottom ,
+		SCREENSNAPSHOT_IMAGE *pImage)
 {
 	bool do_lock;
-	int y, ret;
+	bool do_palette = true;
+	int y;
 	int sw = surface->w - CropLeft - CropRight;
 	int sh = surface->h - CropTop - CropBottom;
 	Uint8 *src_ptr;
-	Uint8 *rowbuf;
-	png_infop info_ptr = NULL;
-	png_structp png_ptr;
-	png_text pngtext;
-	char key[] = "Title";
-	char text[] = "Hatari screenshot";
-	off_t start;
-	bool do_palette = true;
-	png_color png_pal[256];
-	Uint8 palbuf[3];
+	Uint8 *dst_ptr;
 
 	assert(surface->format->BytesPerPixel == 4);
 
@@ -132,22 +161,98 @@ int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
 	if (!dh)
 		dh = sh;
 
-	rowbuf = alloca(3 * dw);
+	/* worst case is RGB */
+	if (!ScreenSnapShot_BufferReserve(&pImage->Pixels, 3 * dw * dh))
+		return false;
+	pImage->Width = dw;
+	pImage->Height = dh;
 
 	/* Use current ST palette if all colours in the image belong to it, otherwise RGB */
 	do_lock = SDL_MUSTLOCK(surface);
 	if (do_lock)
 		SDL_LockSurface(surface);
+	dst_ptr = pImage->Pixels.pData;
 	for (y = 0; y < dh; y++)
 	{
 		src_ptr = (Uint8 *)surface->pixels
 		          + (CropTop + (y * sh + dh/2) / dh) * surface->pitch
 		          + CropLeft * surface->format->BytesPerPixel;
-		if (!PixelConvert_32to8Bits(rowbuf, (Uint32*)src_ptr, dw, surface))
+		/* Reindex back to ST palette
+		 * Note that this cannot disambiguate indices if the palette has duplicate colors */
+		if (!PixelConvert_32to8Bits(dst_ptr, (Uint32*)src_ptr, dw, surface))
+		{
 			do_palette = false;
+			break;
+		}
+		dst_ptr += dw;
+	}
+	if (!do_palette)
+	{
+		/* unpack 32-bit RGBA pixels */
+		dst_ptr = pImage->Pixels.pData;
+		for (y = 0; y < dh; y++)
+		{
+			src_ptr = (Uint8 *)surface->pixels
+			          + (CropTop + (y * sh + dh/2) / dh) * surface->pitch
+			          + CropLeft * surface->format->BytesPerPixel;
+			PixelConvert_32to24Bits(dst_ptr, (Uint32*)src_ptr, dw, surface);
+			dst_ptr += 3 * dw;
+		}
 	}
 	if (do_lock)
 		SDL_UnlockSurface(surface);
+	pImage->Pixels.Size = dst_ptr - pImage->Pixels.pData;
+
+	if (do_palette)
+	{
+		/* Generate palette for PNG */
+		for (y = 0; y < ConvertPaletteSize; y++)
+			PixelConvert_32to24Bits(pImage->Palette[y], (Uint32*)(ConvertPalette+y), 1, surface);
+		pImage->PaletteSize = ConvertPaletteSize;
+	}
+	else
+		pImage->PaletteSize = 0;
+
+	return true;
+}
+
+
+#if HAVE_LIBPNG
+/**
+ * libpng callbacks to write the png data in a SCREENSNAPSHOT_BUFFER
+ */
+static void ScreenSnapShot_PNG_WriteData(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	SCREENSNAPSHOT_BUFFER *pBuf = png_get_io_ptr(png_ptr);
+
+	if (!ScreenSnapShot_BufferReserve(pBuf, pBuf->Size + length))
+		png_error(png_ptr, "out of memory");
+	memcpy(pBuf->pData + pBuf->Size, data, length);
+	pBuf->Size += length;
+}
+
+static void ScreenSnapShot_PNG_Flush(png_structp png_ptr)
+{
+}
+
+
+/**
+ * Encode 'pImage' as PNG, appending the data at the end of 'pBuf'.
+ * Return png size > 0 for success.
+ * This function is also used by avi_record.c to save individual frames as png images.
+ */
+int ScreenSnapShot_EncodePNG(const SCREENSNAPSHOT_IMAGE *pImage,
+		int png_compression_level, int png_filter, SCREENSNAPSHOT_BUFFER *pBuf)
+{
+	int y, ret;
+	int start = pBuf->Size;
+	int bpp = pImage->PaletteSize ? 1 : 3;
+	png_infop info_ptr = NULL;
+	png_structp png_ptr;
+	png_text pngtext;
+	char key[] = "Title";
+	char text[] = "Hatari screenshot";
+	png_color png_pal[256];
 
 	/* Create and initialize the png_struct with error handler functions. */
 	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
@@ -171,15 +276,12 @@ int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
 		goto png_cleanup;
 	}
 
-	/* store current pos in fp (could be != 0 for avi recording) */
-	start = ftello ( fp );
-
 	/* initialize the png structure */
-	png_init_io(png_ptr, fp);
+	png_set_write_fn(png_ptr, pBuf, ScreenSnapShot_PNG_WriteData, ScreenSnapShot_PNG_Flush);
 
 	/* image data properties */
-	png_set_IHDR(png_ptr, info_ptr, dw, dh, 8,
-		     do_palette ? PNG_COLOR_TYPE_PALETTE : PNG_COLOR_TYPE_RGB,
+	png_set_IHDR(png_ptr, info_ptr, pImage->Width, pImage->Height, 8,
+		     pImage->PaletteSize ? PNG_COLOR_TYPE_PALETTE : PNG_COLOR_TYPE_RGB,
 		     PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
 		     PNG_FILTER_TYPE_DEFAULT);
 
@@ -197,62 +299,63 @@ int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
 #endif
 	png_set_text(png_ptr, info_ptr, &pngtext, 1);
 
-	if (do_palette)
+	if (pImage->PaletteSize)
 	{
-		/* Generate palette for PNG */
-		for (y = 0; y < ConvertPaletteSize; y++)
+		for (y = 0; y < pImage->PaletteSize; y++)
 		{
-			PixelConvert_32to24Bits(palbuf, (Uint32*)(ConvertPalette+y), 1, surface);
-			png_pal[y].red   = palbuf[0];
-			png_pal[y].green = palbuf[1];
-			png_pal[y].blue  = palbuf[2];
+			png_pal[y].red   = pImage->Palette[y][0];
+			png_pal[y].green = pImage->Palette[y][1];
+			png_pal[y].blue  = pImage->Palette[y][2];
 		}
-		png_set_PLTE(png_ptr, info_ptr, png_pal, ConvertPaletteSize);
+		png_set_PLTE(png_ptr, info_ptr, png_pal, pImage->PaletteSize);
 	}
 
 	/* write the file header information */
 	png_write_info(png_ptr, info_ptr);
 
-	/* write surface data rows one at a time (after cropping if necessary) */
-	do_lock = SDL_MUSTLOCK(surface);
-	for (y = 0; y < dh; y++)
-	{
-		/* need to lock the surface while accessing it directly */
-		if (do_lock)
-			SDL_LockSurface(surface);
-
-
-		src_ptr = (Uint8 *)surface->pixels
-		          + (CropTop + (y * sh + dh/2) / dh) * surface->pitch
-		          + CropLeft * surface->format->BytesPerPixel;
-
-		if (!do_palette)
-		{
-			/* unpack 32-bit RGBA pixels */
-			PixelConvert_32to24Bits(rowbuf, (Uint32*)src_ptr, dw, surface);
-		}
-		else
-		{
-			/* Reindex back to ST palette
-			 * Note that this cannot disambiguate indices if the palette has duplicate colors */
-			PixelConvert_32to8Bits(rowbuf, (Uint32*)src_ptr, dw, surface);
-		}
-		/* and unlock surface before syscalls */
-		if (do_lock)
-			SDL_UnlockSurface(surface);
-		png_write_row(png_ptr, rowbuf);
-	}
+	/* write image data rows one at a time */
+	for (y = 0; y < pImage->Height; y++)
+		png_write_row(png_ptr, pImage->Pixels.pData + y * pImage->Width * bpp);
 
 	/* write the additional chunks to the PNG file */
 	png_write_end(png_ptr, info_ptr);
 
-	ret = (int)( ftello ( fp ) - start );			/* size of the png image */
+	ret = pBuf->Size - start;			/* size of the png image */
 png_cleanup:
 	if (png_ptr)
 		/* handles info_ptr being NULL */
 		png_destroy_write_struct(&png_ptr, &info_ptr);
 	return ret;
 }
+
+
+/**
+ * Save given SDL surface as PNG in an already opened FILE, eventually cropping some borders.
+ * Return png file size > 0 for success.
+ */
+int ScreenSnapShot_SavePNG_ToFile(SDL_Surface *surface, int dw, int dh,
+		FILE *fp, int png_compression_level, int png_filter,
+		int CropLeft , int CropRight , int CropTop , int CropBottom )
+{
+	SCREENSNAPSHOT_IMAGE image;
+	SCREENSNAPSHOT_BUFFER png;
+	int ret = -1;
+
+	memset(&image, 0, sizeof(image));
+	memset(&png, 0, sizeof(png));
+
+	if (ScreenSnapShot_PrepareImage(surface, dw, dh,
+			CropLeft, CropRight, CropTop, CropBottom, &image))
+	{
+		ret = ScreenSnapShot_EncodePNG(&image, png_compression_level, png_filter, &png);
+		if (ret > 0 && fwrite(png.pData, 1, ret, fp) != (size_t)ret)
+			ret = -1;
+	}
+
+	ScreenSnapShot_BufferFree(&png);
+	ScreenSnapShot_BufferFree(&image.Pixels);
+	return ret;
+}
 #endif
 
 
@@ -539,6 +642,7 @@ void ScreenSnapShot_SaveScreen(void)
 
 	if (!szFileName)  return;
 
+	Screen_UpdateForCapture();
 	ScreenSnapShot_GetNum();
 	/* Create our filename */
 	nScreenShots++;
@@ -614,6 +718,7 @@ void ScreenSnapShot_SaveToFile(const char *szFileName)
 		fprintf(stderr, "ERROR: no screen dump file name specified\n");
 		return;
 	}
+	Screen_UpdateForCapture();
 #if HAVE_LIBPNG
 	if (File_DoesFileExtensionMatch(szFileName, ".png"))
 	{
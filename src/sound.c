@@ -129,10 +129,14 @@
 
 const char Sound_fileid[] = "Hatari sound.c";
 
+#include <limits.h>
+#include <SDL_atomic.h>
+
 #include "main.h"
 #include "audio.h"
 #include "cycles.h"
 #include "m68000.h"
+#include "benchmark.h"
 #include "configuration.h"
 #include "dmaSnd.h"
 #include "crossbar.h"
@@ -147,6 +151,7 @@ const char Sound_fileid[] = "Hatari sound.c";
 #include "wavFormat.h"
 #include "ymFormat.h"
 #include "avi_record.h"
+#include "capturePipe.h"
 #include "clocks_timings.h"
 
 
@@ -262,6 +267,9 @@ static yms16 *ymout5 = (yms16 *)ymout5_u16;
 #define	YM_SQUARE_UP		0x1f
 #define	YM_SQUARE_DOWN		0x00
 
+/* Number of cycles emulated one by one when the output changes on every cycle */
+#define	YM_SINGLE_STEPS		16
+
 static ymu16	ToneA_per , ToneA_count , ToneA_val;
 static ymu16	ToneB_per , ToneB_count , ToneB_val;
 static ymu16	ToneC_per , ToneC_count , ToneC_val;
@@ -303,9 +311,14 @@ bool		bEnvelopeFreqFlag;			/* Cleared each frame for YM saving */
 
 int16_t		AudioMixBuffer[AUDIOMIXBUFFER_SIZE][2];	/* Ring buffer to store mixed audio output (YM2149, DMA sound, ...) */
 int		AudioMixBuffer_pos_write;		/* Current writing position into above buffer */
-int		AudioMixBuffer_pos_read;		/* Current reading position into above buffer */
 
-int		nGeneratedSamples;			/* Generated samples since audio buffer update */
+/* Above buffer is a lock-free single producer (emulation) / single consumer
+ * (audio callback) ring. Each side updates only its own free running sample
+ * counter and reads the other one, both atomically. Only resetting the ring
+ * (Sound_Reset(), Sound_ResetBufferIndex()) is done under the audio lock */
+static SDL_atomic_t	AudioMixBuffer_count_write;	/* Samples made available to the audio callback */
+static SDL_atomic_t	AudioMixBuffer_count_read;	/* Samples consumed by the audio callback */
+int		Sound_BufferOverruns;			/* Number of times generated samples didn't fit in above buffer */
 
 static int	AudioMixBuffer_pos_write_avi;		/* Current working index to save an AVI audio frame */
 
@@ -357,13 +370,25 @@ static void	Ym2149_Init		(void);
 static void	Ym2149_Reset		(void);
 
 static ymu32	YM2149_RndCompute	(void);
+static ymu32	YM2149_RndSkip		(int count);
 static ymu16	YM2149_TonePer		(ymu8 rHigh , ymu8 rLow);
 static ymu16	YM2149_NoisePer		(ymu8 rNoise);
 static ymu16	YM2149_EnvPer		(ymu8 rHigh , ymu8 rLow);
 
-static void	YM2149_Run		( uint64_t CPU_Clock );
+static void	YM2149_Run		( uint64_t CPU_Clock , bool bSynthesis );
 static int	Sound_GenerateSamples	( uint64_t CPU_Clock);
+static void	YM2149_Step		( void );
+static int	YM2149_NoiseStepsToNext	( void );
+static int	YM2149_StepsToNextEvent	( void );
+static int	YM2149_SkipCounter	( ymu16 *pCount , ymu16 per , int steps );
+static void	YM2149_SkipSteps	( int steps );
+static ymsample	YM2149_MixVoices	( void );
+static inline ymsample	YM2149_Filter	( ymsample sample );
+static int	YM2149_StoreSamples	( ymsample sample , int count , int pos );
 static void	YM2149_DoSamples_250	( int SamplesToGenerate_250 );
+static int	YM2149_Resample_250	( int idx , int margin , bool bFilter );
+static int	YM2149_Resample_250_Skip ( int margin );
+static bool	Sound_SkipSynthesis	( void );
 #ifdef YM_250_DEBUG
 static void	YM2149_DoSamples_250_Debug ( int SamplesToGenerate , int pos );
 #endif
@@ -980,6 +1005,28 @@ static ymu32	YM2149_RndCompute(void)
 
 
 
+/**
+ * Same as calling YM2149_RndCompute() 'count' times (count > 0), but faster.
+ * As the LFSR's feedback goes to bit 13 and above, the next 13 output bits
+ * are the current lowest bits, and up to 13 steps can be done at once.
+ */
+static ymu32	YM2149_RndSkip(int count)
+{
+	ymu32	bits = 0;
+	int	n = 1;
+
+	while (count > 0)
+	{
+		n = count > 13 ? 13 : count;
+		bits = RndRack & ((1 << n) - 1);
+		RndRack = (RndRack >> n) ^ (((bits << 16) ^ (bits << 13)) >> (n - 1));
+		count -= n;
+	}
+	return ( bits >> (n - 1) ) & 1 ? 0xffff : 0;
+}
+
+
+
 static ymu16	YM2149_TonePer(ymu8 rHigh , ymu8 rLow)
 {
 	ymu16	per;
@@ -1010,7 +1057,304 @@ static ymu16	YM2149_EnvPer(ymu8 rHigh , ymu8 rLow)
 
 /*-----------------------------------------------------------------------*/
 /**
- * Main function : compute the value of the next sample.
+ * Emulate 1 internal YM2149 cycle : increase all counters and update
+ * tone, noise and envelope states when their period is reached.
+ */
+static void	YM2149_Step ( void )
+{
+	/* As measured on a real YM2149, result for per==0 is the same as for per==1 */
+	/* To obtain this in our code, counters are incremented first, then compared to per, */
+	/* which gives the same result when per=1 and when per=0 */
+
+	/* Special case for noise counter, it's increased at 125 KHz, not 250 KHz */
+	YM2149_Freq_div_2 ^= 1;
+	if ( YM2149_Freq_div_2 == 0 )
+		Noise_count++;
+	if ( Noise_count >= Noise_per )
+	{
+		Noise_count = 0;
+		Noise_val = YM2149_RndCompute();	/* 0 or 0xffff */
+	}
+
+	/* Other counters are increased on every call, at 250 KHz */
+	ToneA_count++;
+	if ( ToneA_count >= ToneA_per )
+	{
+		ToneA_count = 0;
+		ToneA_val ^= YM_SQUARE_UP;		/* 0 or 0x1f */
+	}
+
+	ToneB_count++;
+	if ( ToneB_count >= ToneB_per )
+	{
+		ToneB_count = 0;
+		ToneB_val ^= YM_SQUARE_UP;		/* 0 or 0x1f */
+	}
+
+	ToneC_count++;
+	if ( ToneC_count >= ToneC_per )
+	{
+		ToneC_count = 0;
+		ToneC_val ^= YM_SQUARE_UP;		/* 0 or 0x1f */
+	}
+
+	Env_count += 1;
+	if ( Env_count >= Env_per )
+	{
+		Env_count = 0;
+		Env_pos += 1;
+		if ( Env_pos >= 3*32 )			/* blocks 0, 1 and 2 were used (Env_pos 0 to 95) */
+			Env_pos -= 2*32;		/* replay/loop blocks 1 and 2 (Env_pos 32 to 95) */
+	}
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return the number of internal YM2149 cycles until (and including) the
+ * next cycle where the noise counter reaches its period.
+ */
+static int	YM2149_NoiseStepsToNext ( void )
+{
+	/* Noise counter is checked at 250 kHz, but increased only at 125 KHz */
+	if ( Noise_count >= Noise_per )
+		return 1;
+	return 2 * ( Noise_per - Noise_count ) - YM2149_Freq_div_2;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return the number of internal YM2149 cycles until (and including) the
+ * next cycle where a counter reaches its period and this can change the
+ * output (tone/noise enabled in the mixer for a voice with a volume,
+ * envelope used by a voice).
+ * Output of the YM2149 can't change during the cycles before this one.
+ */
+static int	YM2149_StepsToNextEvent ( void )
+{
+	ymu16	Vol3Voices_Used;
+	int	steps , n;
+
+	/* Voices with a constant volume of 0 can't change the output */
+	Vol3Voices_Used = EnvMask3Voices | Vol3Voices;
+
+	/* Counters are incremented first, so a counter already above */
+	/* its period (after a period change) is reached on next cycle */
+	steps = INT_MAX;
+	if ( mixerTA == 0 && ( Vol3Voices_Used & YM_MASK_A ) )
+		steps = ToneA_per > ToneA_count ? ToneA_per - ToneA_count : 1;
+	if ( mixerTB == 0 && ( Vol3Voices_Used & YM_MASK_B ) )
+	{
+		n = ToneB_per > ToneB_count ? ToneB_per - ToneB_count : 1;
+		if ( n < steps )
+			steps = n;
+	}
+	if ( mixerTC == 0 && ( Vol3Voices_Used & YM_MASK_C ) )
+	{
+		n = ToneC_per > ToneC_count ? ToneC_per - ToneC_count : 1;
+		if ( n < steps )
+			steps = n;
+	}
+	if ( EnvMask3Voices )
+	{
+		n = Env_per > Env_count ? Env_per - Env_count : 1;
+		if ( n < steps )
+			steps = n;
+	}
+	if ( ( mixerNA == 0 && ( Vol3Voices_Used & YM_MASK_A ) )
+	  || ( mixerNB == 0 && ( Vol3Voices_Used & YM_MASK_B ) )
+	  || ( mixerNC == 0 && ( Vol3Voices_Used & YM_MASK_C ) ) )
+	{
+		n = YM2149_NoiseStepsToNext ();
+		if ( n < steps )
+			steps = n;
+	}
+
+	return steps;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Increase '*pCount' counter for 'steps' cycles, resetting it each time
+ * it reaches 'per' (same as in YM2149_Step()).
+ * Return the number of times the period was reached.
+ */
+static int	YM2149_SkipCounter ( ymu16 *pCount , ymu16 per , int steps )
+{
+	int	first , loop , n;
+
+	first = per > *pCount ? per - *pCount : 1;
+	if ( steps < first )
+	{
+		*pCount += steps;
+		return 0;
+	}
+	/* After the period is reached, counter restarts from 0 */
+	loop = per > 0 ? per : 1;
+	n = 1 + ( steps - first ) / loop;
+	*pCount = ( steps - first ) % loop;
+	return n;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Emulate 'steps' internal YM2149 cycles at once. The state of the counters
+ * is exact for any value of 'steps', but the output is not computed for
+ * the intermediate cycles, so when generating samples this must be called
+ * only when none of the counters changes the output during these cycles.
+ */
+static void	YM2149_SkipSteps ( int steps )
+{
+	int	left , n;
+
+	/* Noise counter is checked at 250 kHz, but increased only at 125 KHz */
+	/* and each new noise value needs to be computed to keep generator's state */
+	for ( left = steps ; left > 0 ; left -= n )
+	{
+		if ( Noise_per == 0 )
+		{
+			/* Period is reached on every cycle */
+			YM2149_Freq_div_2 ^= left & 1;
+			Noise_count = 0;
+			Noise_val = YM2149_RndSkip ( left );
+			break;
+		}
+		if ( Noise_count == 0 && YM2149_Freq_div_2 == 0 )
+		{
+			/* Counter was just reset, period is reached every 2*per cycles */
+			n = left / ( 2 * Noise_per );
+			left %= 2 * Noise_per;
+			Noise_count = left >> 1;
+			YM2149_Freq_div_2 = left & 1;
+			if ( n > 0 )
+				Noise_val = YM2149_RndSkip ( n );
+			break;
+		}
+
+		n = YM2149_NoiseStepsToNext ();
+		if ( n > left )
+			n = left;
+		/* Noise counter is increased on every other cycle, */
+		/* starting from the first one if YM2149_Freq_div_2 is set */
+		Noise_count += ( n + YM2149_Freq_div_2 ) >> 1;
+		YM2149_Freq_div_2 ^= n & 1;
+		if ( Noise_count >= Noise_per )
+		{
+			Noise_count = 0;
+			Noise_val = YM2149_RndCompute();	/* 0 or 0xffff */
+		}
+	}
+
+	if ( YM2149_SkipCounter ( &ToneA_count , ToneA_per , steps ) & 1 )
+		ToneA_val ^= YM_SQUARE_UP;
+	if ( YM2149_SkipCounter ( &ToneB_count , ToneB_per , steps ) & 1 )
+		ToneB_val ^= YM_SQUARE_UP;
+	if ( YM2149_SkipCounter ( &ToneC_count , ToneC_per , steps ) & 1 )
+		ToneC_val ^= YM_SQUARE_UP;
+
+	Env_pos += YM2149_SkipCounter ( &Env_count , Env_per , steps );
+	if ( Env_pos >= 3*32 )				/* replay/loop blocks 1 and 2 (Env_pos 32 to 95) */
+		Env_pos = 32 + ( Env_pos - 32 ) % ( 2*32 );
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Build 'sample' value with the current values of tone/noise/volume/env
+ */
+static ymsample	YM2149_MixVoices ( void )
+{
+	ymu32		bt;
+	ymu16		Env3Voices;			/* 0x00CCBBAA */
+	ymu16		Tone3Voices;			/* 0x00CCBBAA */
+
+	/* Get the 5 bits volume corresponding to the current envelope's position */
+	Env3Voices = YmEnvWaves[ Env_shape ][ Env_pos ];
+	Env3Voices &= EnvMask3Voices;			/* only keep volumes for voices using envelope */
+
+	/* Tone3Voices will contain the output state of each voice : 0 or 0x1f */
+	bt = (ToneA_val | mixerTA) & (Noise_val | mixerNA);	/* 0 or 0xffff */
+	Tone3Voices = bt & YM_MASK_1VOICE;		/* 0 or 0x1f */
+
+	bt = (ToneB_val | mixerTB) & (Noise_val | mixerNB);
+	Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 5;
+
+	bt = (ToneC_val | mixerTC) & (Noise_val | mixerNC);
+	Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 10;
+
+	/* Combine fixed volumes and envelope volumes and keep the resulting */
+	/* volumes depending on the output state of each voice (0 or 0x1f) */
+	Tone3Voices &= ( Env3Voices | Vol3Voices );
+
+	return ymout5[ Tone3Voices ];			/* 16 bits signed value */
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Apply low pass filter to 'sample' if needed
+ */
+static inline ymsample	YM2149_Filter ( ymsample sample )
+{
+	if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF )
+		return LowPassFilter ( sample );
+	else if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_PWM )
+		return PWMaliasFilter ( sample );
+	return sample;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Store 'count' samples with the same 'sample' value at position 'pos'
+ * in YM_Buffer_250[], applying the low pass filter if needed.
+ * Return the position after the last stored sample.
+ */
+static int	YM2149_StoreSamples ( ymsample sample , int count , int pos )
+{
+	ymsample	out = 0 , prev = 0;
+	int		i , len;
+
+	for ( i = 0 ; i < count ; i++ )
+	{
+		out = YM2149_Filter ( sample );
+		YM_Buffer_250[ pos ] = out;
+		pos = ( pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
+
+		/* With the same input, once the filter output doesn't change */
+		/* anymore, neither does the filter state : all the next */
+		/* outputs will be the same */
+		if ( i > 0 && out == prev )
+		{
+			i++;
+			break;
+		}
+		prev = out;
+	}
+
+	/* Fill the remaining constant samples (in at most 2 parts if the end */
+	/* of the ring buffer is reached) */
+	while ( i < count )
+	{
+		len = count - i;
+		if ( len > YM_BUFFER_250_SIZE - pos )
+			len = YM_BUFFER_250_SIZE - pos;
+		i += len;
+		while ( len-- > 0 )
+			YM_Buffer_250[ pos++ ] = out;
+		pos &= YM_BUFFER_250_SIZE_MASK;
+	}
+
+	return pos;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Main function : compute the value of the next samples.
  * Mixes all 3 voices with tone+noise+env and apply low pass
  * filter if needed.
  * For maximum accuracy, this function emulates all single cycles at 250 kHz
@@ -1018,15 +1362,16 @@ static ymu16	YM2149_EnvPer(ymu8 rHigh , ymu8 rLow)
  * to the chosen output frequency (eg 44.1 kHz)
  * Creating a complete 250 kHz signal allow to emulate effects that require
  * precise cycle accuracy (such as "syncsquare" used in maxYMiser v1.53)
+ *
+ * As registers can't change during a call, the output of the YM2149 only
+ * changes when one of the tone/noise/envelope counters reaches its period.
+ * Samples are generated by blocks of cycles between these events, instead
+ * of emulating each cycle separately.
  */
 static void	YM2149_DoSamples_250 ( int SamplesToGenerate_250 )
 {
-	ymsample	sample;
-	ymu32		bt;
-	ymu16		Env3Voices;			/* 0x00CCBBAA */
-	ymu16		Tone3Voices;			/* 0x00CCBBAA */
 	int		pos;
-	int		n;
+	int		n , steps;
 
 
 //fprintf ( stderr , "ym2149_dosamples_250 in nb=%d ym_pos_wr=%d\n",SamplesToGenerate_250 , YM_Buffer_250_pos_write );
@@ -1038,87 +1383,39 @@ static void	YM2149_DoSamples_250 ( int SamplesToGenerate_250 )
 	pos = YM_Buffer_250_pos_write;
 
 	/* Emulate as many internal YM cycles as needed to generate samples */
-	for ( n=0 ; n<SamplesToGenerate_250 ; n++ )
+	n = 0;
+	while ( n < SamplesToGenerate_250 )
 	{
-		/* Emulate 1 internal YM2149 cycle : increase all counters */
-		/* As measured on a real YM2149, result for per==0 is the same as for per==1 */
-		/* To obtain this in our code, counters are incremented first, then compared to per, */
-		/* which gives the same result when per=1 and when per=0 */
-
-		/* Special case for noise counter, it's increased at 125 KHz, not 250 KHz */
-		YM2149_Freq_div_2 ^= 1;
-		if ( YM2149_Freq_div_2 == 0 )
-			Noise_count++;
-		if ( Noise_count >= Noise_per )
+		steps = YM2149_StepsToNextEvent () - 1;
+		if ( steps > 0 )
 		{
-			Noise_count = 0;
-			Noise_val = YM2149_RndCompute();/* 0 or 0xffff */
-		}
-
-//fprintf ( stderr , "ym2149_dosamples_250 max=%d n=%d ToneA_count=%d ToneA_per=%d val=%x pos=%d\n",SamplesToGenerate_250,n,ToneA_count,ToneA_per,ToneA_val,pos );
-		/* Other counters are increased on every call, at 250 KHz */
-		ToneA_count++;
-		if ( ToneA_count >= ToneA_per )
-		{
-//fprintf ( stderr , "ym2149_dosamples_250 max=%d n=%d ToneA_count=%d ToneA_per=%d val=%x pos=%d toggle\n",SamplesToGenerate_250,n,ToneA_count,ToneA_per,ToneA_val,pos );
-			ToneA_count = 0;
-			ToneA_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
+			/* Cycles before the next event all give the same sample */
+			if ( steps > SamplesToGenerate_250 - n )
+				steps = SamplesToGenerate_250 - n;
+			YM2149_SkipSteps ( steps );
+			pos = YM2149_StoreSamples ( YM2149_MixVoices () , steps , pos );
+			n += steps;
+
+			/* Then emulate the cycle where the event happens */
+			steps = 1;
 		}
-
-		ToneB_count++;
-		if ( ToneB_count >= ToneB_per )
-		{
-			ToneB_count = 0;
-			ToneB_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
-		}
-
-		ToneC_count++;
-		if ( ToneC_count >= ToneC_per )
+		else
 		{
-			ToneC_count = 0;
-			ToneC_val ^= YM_SQUARE_UP;	/* 0 or 0x1f */
+			/* Output can change on every cycle (eg when a voice uses tone */
+			/* period 0 or 1), emulate some cycles one by one before */
+			/* looking for the next event again */
+			steps = YM_SINGLE_STEPS;
 		}
 
-		Env_count += 1;
-		if ( Env_count >= Env_per )
+		if ( steps > SamplesToGenerate_250 - n )
+			steps = SamplesToGenerate_250 - n;
+		n += steps;
+		while ( steps-- > 0 )
 		{
-			Env_count = 0;
-			Env_pos += 1;
-			if ( Env_pos >= 3*32 )		/* blocks 0, 1 and 2 were used (Env_pos 0 to 95) */
-				Env_pos -= 2*32;	/* replay/loop blocks 1 and 2 (Env_pos 32 to 95) */
+			YM2149_Step ();
+			YM_Buffer_250[ pos ] = YM2149_Filter ( YM2149_MixVoices () );
+			pos = ( pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
 		}
-
-		/* Build 'sample' value with the values of tone/noise/volume/env */
-
-		/* Get the 5 bits volume corresponding to the current envelope's position */
-		Env3Voices = YmEnvWaves[ Env_shape ][ Env_pos ];
-		Env3Voices &= EnvMask3Voices;			/* only keep volumes for voices using envelope */
-
-		/* Tone3Voices will contain the output state of each voice : 0 or 0x1f */
-		bt = (ToneA_val | mixerTA) & (Noise_val | mixerNA);	/* 0 or 0xffff */
-		Tone3Voices = bt & YM_MASK_1VOICE;		/* 0 or 0x1f */
-
-		bt = (ToneB_val | mixerTB) & (Noise_val | mixerNB);
-		Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 5;
-
-		bt = (ToneC_val | mixerTC) & (Noise_val | mixerNC);
-		Tone3Voices |= ( bt & YM_MASK_1VOICE ) << 10;
-
-		/* Combine fixed volumes and envelope volumes and keep the resulting */
-		/* volumes depending on the output state of each voice (0 or 0x1f) */
-		Tone3Voices &= ( Env3Voices | Vol3Voices );
-
-		sample = ymout5[ Tone3Voices ];			/* 16 bits signed value */
-
-		/* Apply low pass filter ? */
-		if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_LPF_STF )
-			sample = LowPassFilter ( sample );
-		else if ( YM2149_LPF_Filter == YM2149_LPF_FILTER_PWM )
-			sample = PWMaliasFilter ( sample );
-
-		/* Store sample */
-		YM_Buffer_250[ pos ] = sample;
-		pos = ( pos + 1 ) & YM_BUFFER_250_SIZE_MASK;
 	}
 
 
@@ -1238,7 +1535,7 @@ static void	YM2149_DoSamples_250_Debug ( int SamplesToGenerate , int pos )
  * On each call, we consider samples were already generated up to (and including) counter value
  * YM2149_Clock_250_prev. We must generate as many samples to reach (and include) YM2149_Clock_250.
  */
-static void	YM2149_Run ( uint64_t CPU_Clock )
+static void	YM2149_Run ( uint64_t CPU_Clock , bool bSynthesis )
 {
 	uint64_t		YM2149_Clock_250_prev;
 	int		YM2149_Nb_Updates_250;
@@ -1251,7 +1548,14 @@ static void	YM2149_Run ( uint64_t CPU_Clock )
 
 	if ( YM2149_Nb_Updates_250 > 0 )
 	{
-		YM2149_DoSamples_250 ( YM2149_Nb_Updates_250 );
+		if ( bSynthesis )
+			YM2149_DoSamples_250 ( YM2149_Nb_Updates_250 );
+		else
+		{
+			/* Only update the counters, YM_Buffer_250[] is not filled */
+			YM2149_SkipSteps ( YM2149_Nb_Updates_250 );
+			YM_Buffer_250_pos_write = ( YM_Buffer_250_pos_write + YM2149_Nb_Updates_250 ) & YM_BUFFER_250_SIZE_MASK;
+		}
 	}
 }
 
@@ -1270,7 +1574,7 @@ static void	YM2149_Run ( uint64_t CPU_Clock )
  * advantage : fast method
  * disadvantage : more aliasing when high frequency notes are played
  */
-static ymsample	YM2149_Next_Resample_Nearest ( void )
+static ymsample	YM2149_Next_Resample_Nearest ( double step )
 {
 	ymsample	sample;
 
@@ -1282,7 +1586,7 @@ static ymsample	YM2149_Next_Resample_Nearest ( void )
 		sample = YM_Buffer_250[ ( YM_Buffer_250_pos_read + 1 ) & YM_BUFFER_250_SIZE_MASK ];
 
 	/* Increase fractional pos and integer pos */
-	pos_fract_nearest += ( (double)YM_ATARI_CLOCK_COUNTER ) / YM_REPLAY_FREQ;
+	pos_fract_nearest += step;
 
 	YM_Buffer_250_pos_read = ( YM_Buffer_250_pos_read + (int)pos_fract_nearest ) & YM_BUFFER_250_SIZE_MASK;
 	pos_fract_nearest -= (int)pos_fract_nearest;		/* 0 <= pos_fract_nearest < 1 */
@@ -1302,7 +1606,7 @@ static ymsample	YM2149_Next_Resample_Nearest ( void )
  *
  * It's a little slower than 'Resample_Nearest' but more accurate 
  */
-static ymsample	YM2149_Next_Resample_Weighted_Average_2 ( void )
+static ymsample	YM2149_Next_Resample_Weighted_Average_2 ( double step )
 {
 	ymsample	sample_before , sample_after;
 	ymsample	sample;
@@ -1315,7 +1619,7 @@ static ymsample	YM2149_Next_Resample_Weighted_Average_2 ( void )
 //fprintf ( stderr , "b=%04x a=%04x frac=%f -> res=%04x\n" , sample_before , sample_after , pos_fract_weighted_2 , sample );
 
 	/* Increase fractional pos and integer pos */
-	pos_fract_weighted_2 += ( (double)YM_ATARI_CLOCK_COUNTER ) / YM_REPLAY_FREQ;
+	pos_fract_weighted_2 += step;
 
 	YM_Buffer_250_pos_read = ( YM_Buffer_250_pos_read + (int)pos_fract_weighted_2 ) & YM_BUFFER_250_SIZE_MASK;
 	pos_fract_weighted_2 -= (int)pos_fract_weighted_2;	/* 0 <= pos_fract < 1 */
@@ -1344,14 +1648,12 @@ static ymsample	YM2149_Next_Resample_Weighted_Average_2 ( void )
  * by 0x10000 and stored using 32 or 64 bits : upper bits are the integer part and
  * lower 16 bits are the decimal part.
  */
- static ymsample	YM2149_Next_Resample_Weighted_Average_N ( void )
+ static ymsample	YM2149_Next_Resample_Weighted_Average_N ( uint32_t interval_fract )
 {
-	uint32_t	interval_fract;
 	int64_t		total;
 	ymsample	sample;
 
 
-	interval_fract = ( YM_ATARI_CLOCK_COUNTER * 0x10000LL ) / YM_REPLAY_FREQ;	/* 'LL' ensure the div is made on 64 bits */
 	total = 0;
 
 //fprintf ( stderr , "next 1 clock=%d freq=%d interval=%x  %d\n" , YM_ATARI_CLOCK_COUNTER , YM_REPLAY_FREQ , interval_fract , YM_Buffer_250_pos_read );
@@ -1384,19 +1686,92 @@ static ymsample	YM2149_Next_Resample_Weighted_Average_2 ( void )
 
 
 
-static ymsample	YM2149_NextSample_250 ( void )
+/*-----------------------------------------------------------------------*/
+/**
+ * Downsample all the YM2149 samples available in YM_Buffer_250[] to
+ * YM_REPLAY_FREQ (keeping at least 'margin' samples for the resampling
+ * of the next call) and store them in AudioMixBuffer[] starting at 'idx'.
+ * Subsonic filter is also applied if 'bFilter' is true.
+ * Return the number of generated samples.
+ */
+static int	YM2149_Resample_250 ( int idx , int margin , bool bFilter )
 {
-	if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_2 )
-		return YM2149_Next_Resample_Weighted_Average_2 ();
+	double		step;
+	uint32_t	interval_fract;
+	ymsample	sample;
+	int		n;
 
-	else if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_NEAREST )
-		return YM2149_Next_Resample_Nearest ();
 
-	else if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N )
-		return YM2149_Next_Resample_Weighted_Average_N ();
+	/* Resampling step is the same for the whole block */
+	step = ( (double)YM_ATARI_CLOCK_COUNTER ) / YM_REPLAY_FREQ;
+	interval_fract = ( YM_ATARI_CLOCK_COUNTER * 0x10000LL ) / YM_REPLAY_FREQ;	/* 'LL' ensure the div is made on 64 bits */
 
-	else
-		return 0;
+	for ( n = 0 ; ( ( YM_Buffer_250_pos_write - YM_Buffer_250_pos_read ) & YM_BUFFER_250_SIZE_MASK ) >= margin ; n++ )
+	{
+		if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N )
+			sample = YM2149_Next_Resample_Weighted_Average_N ( interval_fract );
+		else if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_2 )
+			sample = YM2149_Next_Resample_Weighted_Average_2 ( step );
+		else if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_NEAREST )
+			sample = YM2149_Next_Resample_Nearest ( step );
+		else
+			sample = 0;
+
+		if ( bFilter )
+			sample = Subsonic_IIR_HPF_Left ( sample );
+
+		AudioMixBuffer[idx][0] = AudioMixBuffer[idx][1] = sample;
+		idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
+	}
+
+	return n;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Same as YM2149_Resample_250(), but only update the read position
+ * in YM_Buffer_250[] without computing the samples.
+ * Return the number of samples that would have been generated.
+ */
+static int	YM2149_Resample_250_Skip ( int margin )
+{
+	double		step;
+	uint32_t	interval_fract;
+	int		n;
+
+
+	step = ( (double)YM_ATARI_CLOCK_COUNTER ) / YM_REPLAY_FREQ;
+	interval_fract = ( YM_ATARI_CLOCK_COUNTER * 0x10000LL ) / YM_REPLAY_FREQ;
+
+	for ( n = 0 ; ( ( YM_Buffer_250_pos_write - YM_Buffer_250_pos_read ) & YM_BUFFER_250_SIZE_MASK ) >= margin ; n++ )
+	{
+		if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_N )
+		{
+			if ( pos_fract_weighted_n )
+			{
+				YM_Buffer_250_pos_read = ( YM_Buffer_250_pos_read + 1 ) & YM_BUFFER_250_SIZE_MASK;
+				pos_fract_weighted_n -= 0x10000;
+			}
+			pos_fract_weighted_n += interval_fract;
+			YM_Buffer_250_pos_read = ( YM_Buffer_250_pos_read + ( pos_fract_weighted_n >> 16 ) ) & YM_BUFFER_250_SIZE_MASK;
+			pos_fract_weighted_n &= 0xffff;
+		}
+		else if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_WEIGHTED_AVERAGE_2 )
+		{
+			pos_fract_weighted_2 += step;
+			YM_Buffer_250_pos_read = ( YM_Buffer_250_pos_read + (int)pos_fract_weighted_2 ) & YM_BUFFER_250_SIZE_MASK;
+			pos_fract_weighted_2 -= (int)pos_fract_weighted_2;
+		}
+		else if ( YM2149_Resample_Method == YM2149_RESAMPLE_METHOD_NEAREST )
+		{
+			pos_fract_nearest += step;
+			YM_Buffer_250_pos_read = ( YM_Buffer_250_pos_read + (int)pos_fract_nearest ) & YM_BUFFER_250_SIZE_MASK;
+			pos_fract_nearest -= (int)pos_fract_nearest;
+		}
+	}
+
+	return n;
 }
 
 
@@ -1547,17 +1922,11 @@ void Sound_Reset(void)
 	/* Clear buffer index and register '13' flags */
 	bEnvelopeFreqFlag = false;
 
-	AudioMixBuffer_pos_read = 0;
-	/* We do not start with 0 here to fake some initial samples: */
-	nGeneratedSamples = SoundBufferSize + SAMPLES_PER_FRAME;
-	AudioMixBuffer_pos_write = nGeneratedSamples & AUDIOMIXBUFFER_SIZE_MASK;
-	AudioMixBuffer_pos_write_avi = AudioMixBuffer_pos_write;
-//fprintf ( stderr , "Sound_Reset SoundBufferSize %d SAMPLES_PER_FRAME %d nGeneratedSamples %d , AudioMixBuffer_pos_write %d\n" ,
-//	SoundBufferSize , SAMPLES_PER_FRAME, nGeneratedSamples , AudioMixBuffer_pos_write );
-
-	Ym2149_Reset();
+	Sound_ResetBufferIndex();
 
 	Audio_Unlock();
+
+	Ym2149_Reset();
 }
 
 
@@ -1569,13 +1938,58 @@ void Sound_Reset(void)
  */
 void Sound_ResetBufferIndex(void)
 {
+	int count;
+
+	/* Not a normal producer update (counter can move backwards),
+	 * so keep the audio callback out meanwhile */
 	Audio_Lock();
-	nGeneratedSamples = SoundBufferSize + SAMPLES_PER_FRAME;
-	AudioMixBuffer_pos_write =  (AudioMixBuffer_pos_read + nGeneratedSamples) & AUDIOMIXBUFFER_SIZE_MASK;
+	/* We do not start with 0 here to fake some initial samples: */
+	count = SDL_AtomicGet(&AudioMixBuffer_count_read) + SoundBufferSize + SAMPLES_PER_FRAME;
+	AudioMixBuffer_pos_write = count & AUDIOMIXBUFFER_SIZE_MASK;
 	AudioMixBuffer_pos_write_avi = AudioMixBuffer_pos_write;
-//fprintf ( stderr , "Sound_ResetBufferIndex SoundBufferSize %d SAMPLES_PER_FRAME %d nGeneratedSamples %d , AudioMixBuffer_pos_write %d\n" ,
-//	SoundBufferSize , SAMPLES_PER_FRAME, nGeneratedSamples , AudioMixBuffer_pos_write );
+	SDL_AtomicSet(&AudioMixBuffer_count_write, count);
 	Audio_Unlock();
+//fprintf ( stderr , "Sound_ResetBufferIndex SoundBufferSize %d SAMPLES_PER_FRAME %d count %d , AudioMixBuffer_pos_write %d\n" ,
+//	SoundBufferSize , SAMPLES_PER_FRAME, count , AudioMixBuffer_pos_write );
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Return number of generated samples not yet consumed by the audio callback
+ */
+int Sound_GetQueuedSamples(void)
+{
+	return (int)((unsigned)SDL_AtomicGet(&AudioMixBuffer_count_write)
+	             - (unsigned)SDL_AtomicGet(&AudioMixBuffer_count_read));
+}
+
+
+/*-----------------------------------------------------------------------*/
+/**
+ * Copy up to 'nSamples' generated stereo samples from the mixing buffer
+ * to 'pBuffer' for playback, and release them for the emulation.
+ * This is called only from the audio callback.
+ * Return number of copied samples.
+ */
+int Sound_ReadSamples(int16_t *pBuffer, int nSamples)
+{
+	int queued, idx, span;
+
+	queued = Sound_GetQueuedSamples();
+	if (nSamples > queued)
+		nSamples = queued > 0 ? queued : 0;
+
+	/* Copy in (at most) two spans, before and after ring buffer wrap */
+	idx = SDL_AtomicGet(&AudioMixBuffer_count_read) & AUDIOMIXBUFFER_SIZE_MASK;
+	span = AUDIOMIXBUFFER_SIZE - idx;
+	if (span > nSamples)
+		span = nSamples;
+	memcpy(pBuffer, AudioMixBuffer[idx], span * sizeof(AudioMixBuffer[0]));
+	memcpy(pBuffer + 2 * span, AudioMixBuffer[0], (nSamples - span) * sizeof(AudioMixBuffer[0]));
+
+	SDL_AtomicAdd(&AudioMixBuffer_count_read, nSamples);
+	return nSamples;
 }
 
 
@@ -1687,6 +2101,20 @@ void Sound_Stats_Show ( void )
 
 
 
+/*-----------------------------------------------------------------------*/
+/**
+ * Return true if the output samples are not needed and only the state of
+ * the sound chips should be updated : in fast forward mode (if sound is
+ * disabled for it) when sound is not recorded to a file.
+ */
+static bool Sound_SkipSynthesis(void)
+{
+	return ConfigureParams.System.bFastForward
+		&& !ConfigureParams.Sound.bFastForwardSound
+		&& !bRecordingWav && !bRecordingAvi && !bCapturePipe;
+}
+
+
 /*-----------------------------------------------------------------------*/
 /**
  * Generate output samples for all channels (YM2149, DMA or crossbar) during this time-frame
@@ -1699,24 +2127,37 @@ static int Sound_GenerateSamples(uint64_t CPU_Clock)
 
 //fprintf ( stderr , "sound_gen in ym_pos_rd=%d ym_pos_wr=%d clock=%ld\n" , YM_Buffer_250_pos_read , YM_Buffer_250_pos_write , CPU_Clock );
 
-	/* Run YM2149 emulation at 250 kHz to reach CPU_Clock counter value */
-	/* This fills YM_Buffer_250[] and update YM_Buffer_250_pos_write */
-	YM2149_Run ( CPU_Clock );
-
 	ym_margin = ceil ( ((double)YM_ATARI_CLOCK_COUNTER) / nAudioFrequency ) + 2;
 //fprintf ( stderr , "sound_gen margin=%d read_max=%d\n" , ym_margin , ( YM_Buffer_250_pos_write - ym_margin ) & YM_BUFFER_250_SIZE_MASK );
 
-	Sample_Nbr = 0;
+	if ( Sound_SkipSynthesis() )
+	{
+		/* Update the chips' state (YM counters, DMA/crossbar positions) */
+		/* for the same number of samples, but don't produce them. */
+		/* AudioMixBuffer_pos_write is not changed, the audio callback */
+		/* will play silence until Sound_BufferIndexNeedReset is handled */
+		YM2149_Run ( CPU_Clock , false );
+		Sample_Nbr = YM2149_Resample_250_Skip ( ym_margin );
+
+		if ( Sample_Nbr > 0 )
+		{
+			if (Config_IsMachineFalcon())
+				Crossbar_SkipSamples(Sample_Nbr);
+			else if (!Config_IsMachineST())
+				DmaSnd_SkipSamples(Sample_Nbr);
+		}
+		return Sample_Nbr;
+	}
+
+	/* Run YM2149 emulation at 250 kHz to reach CPU_Clock counter value */
+	/* This fills YM_Buffer_250[] and update YM_Buffer_250_pos_write */
+	YM2149_Run ( CPU_Clock , true );
+
 	idx = AudioMixBuffer_pos_write & AUDIOMIXBUFFER_SIZE_MASK;
 
 	if (Config_IsMachineFalcon())
 	{
-		while ( ( ( YM_Buffer_250_pos_write - YM_Buffer_250_pos_read ) & YM_BUFFER_250_SIZE_MASK ) >= ym_margin )
-		{
-			AudioMixBuffer[idx][0] = AudioMixBuffer[idx][1] = Subsonic_IIR_HPF_Left( YM2149_NextSample_250() );
-			idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
-			Sample_Nbr++;
-		}
+		Sample_Nbr = YM2149_Resample_250 ( idx , ym_margin , true );
 		/* If Falcon emulation, crossbar does the job */
 		if ( Sample_Nbr > 0 )
 			Crossbar_GenerateSamples(AudioMixBuffer_pos_write, Sample_Nbr);
@@ -1724,12 +2165,7 @@ static int Sound_GenerateSamples(uint64_t CPU_Clock)
 
 	else if (!Config_IsMachineST())
 	{
-		while ( ( ( YM_Buffer_250_pos_write - YM_Buffer_250_pos_read ) & YM_BUFFER_250_SIZE_MASK ) >= ym_margin )
-		{
-			AudioMixBuffer[idx][0] = AudioMixBuffer[idx][1] = YM2149_NextSample_250();
-			idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
-			Sample_Nbr++;
-		}
+		Sample_Nbr = YM2149_Resample_250 ( idx , ym_margin , false );
 		/* If Ste or TT emulation, DmaSnd does mixing and filtering */
 		if ( Sample_Nbr > 0 )
 			DmaSnd_GenerateSamples(AudioMixBuffer_pos_write, Sample_Nbr);
@@ -1737,16 +2173,12 @@ static int Sound_GenerateSamples(uint64_t CPU_Clock)
 
 	else
 	{
-		while ( ( ( YM_Buffer_250_pos_write - YM_Buffer_250_pos_read ) & YM_BUFFER_250_SIZE_MASK ) >= ym_margin )
-		{
-			AudioMixBuffer[idx][0] = AudioMixBuffer[idx][1] = Subsonic_IIR_HPF_Left( YM2149_NextSample_250() );
-			idx = ( idx+1 ) & AUDIOMIXBUFFER_SIZE_MASK;
-			Sample_Nbr++;
-		}
+		Sample_Nbr = YM2149_Resample_250 ( idx , ym_margin , true );
 	}
 
 	AudioMixBuffer_pos_write = (AudioMixBuffer_pos_write + Sample_Nbr) & AUDIOMIXBUFFER_SIZE_MASK;
-	nGeneratedSamples += Sample_Nbr;
+	/* New samples are complete, make them available to the audio callback */
+	SDL_AtomicAdd(&AudioMixBuffer_count_write, Sample_Nbr);
 //fprintf ( stderr , "sound_gen out nb=%d ym_pos_rd=%d ym_pos_wr=%d clock=%ld\n" , Sample_Nbr , YM_Buffer_250_pos_read , YM_Buffer_250_pos_write , CPU_Clock );
 	return Sample_Nbr;
 }
@@ -1762,13 +2194,13 @@ void Sound_Update(uint64_t CPU_Clock)
 	int pos_write_prev = AudioMixBuffer_pos_write;
 	int Samples_Nbr;
 	int nGeneratedSamples_before;
-
-	/* Make sure that we don't interfere with the audio callback function */
-	Audio_Lock();
+	int BenchPrev;
 
 	/* Generate samples */
-	nGeneratedSamples_before = nGeneratedSamples;
+	nGeneratedSamples_before = Sound_GetQueuedSamples();
+	BenchPrev = Benchmark_Enter ( BENCHMARK_SOUND );
 	Samples_Nbr = Sound_GenerateSamples ( CPU_Clock );
+	Benchmark_Leave ( BenchPrev );
 	Sound_Stats_SamplePerVBL += Samples_Nbr;
 //fprintf ( stderr , "sound update vbl=%d hbl=%d nbr=%d\n" , nVBLs , nHBL, Samples_Nbr );
 
@@ -1777,7 +2209,7 @@ void Sound_Update(uint64_t CPU_Clock)
 	/* processes or if we run in fast forward mode.						*/
 	/* In the case of slowdown, we set Sound_BufferIndexNeedReset to "resync" the working	*/
 	/* buffer's index AudioMixBuffer_pos_write with the system buffer's index		*/
-	/* AudioMixBuffer_pos_read.								*/
+	/* of the audio callback.								*/
 	/* In the case of fast forward, we do nothing here, Sound_BufferIndexNeedReset will be	*/
 	/* set when the user exits fast forward mode.						*/
 	if ( ( Samples_Nbr > AUDIOMIXBUFFER_SIZE - nGeneratedSamples_before ) && ( ConfigureParams.System.bFastForward == false )
@@ -1789,12 +2221,10 @@ void Sound_Update(uint64_t CPU_Clock)
 			Log_Printf(LOG_WARN, "Your system is too slow, "
 			           "some sound samples were not correctly emulated\n");
 		}
+		Sound_BufferOverruns++;
 		Sound_BufferIndexNeedReset = true;
 	}
 
-	/* Allow audio callback function to occur again */
-	Audio_Unlock();
-
 	/* Save to WAV file, if open */
 	if (bRecordingWav)
 		WAVFormat_Update(AudioMixBuffer, pos_write_prev, Samples_Nbr);
@@ -1824,8 +2254,8 @@ void Sound_Update_VBL(void)
 		Sound_BufferIndexNeedReset = false;
 	}
 	
-	/* Record AVI audio frame is necessary */
-	if ( bRecordingAvi )
+	/* Record AVI audio frame / capture audio block is necessary */
+	if ( bRecordingAvi || bCapturePipe )
 	{
 		int Len;
 
@@ -1833,7 +2263,10 @@ void Sound_Update_VBL(void)
 		if ( Len < 0 )
 			Len += AUDIOMIXBUFFER_SIZE;			/* end of ring buffer was reached */
 
-		Avi_RecordAudioStream ( AudioMixBuffer , AudioMixBuffer_pos_write_avi , Len );
+		if ( bRecordingAvi )
+			Avi_RecordAudioStream ( AudioMixBuffer , AudioMixBuffer_pos_write_avi , Len );
+		if ( bCapturePipe )
+			CapturePipe_AudioBlock ( AudioMixBuffer , AudioMixBuffer_pos_write_avi , Len );
 	}
 
 	AudioMixBuffer_pos_write_avi = AudioMixBuffer_pos_write;	/* save new position for next AVI audio frame */
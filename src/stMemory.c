@@ -19,6 +19,7 @@ const char STMemory_fileid[] = "Hatari stMemory.c";
 #include "tos.h"
 #include "vdi.h"
 #include "m68000.h"
+#include "memwatch.h"
 #include "video.h"
 
 /* STRam points to our malloc'ed buffer with the ST RAM.
@@ -135,7 +136,9 @@ bool STMemory_SafeClear(uint32_t addr, unsigned int len)
 	{
 		if (STMemory_CheckAreaType(addr, 1, ABFLAG_RAM))
 		{
+			MemWatch_Accessor = MEMWATCH_BY_EMULATOR;
 			put_byte(addr, 0);
+			MemWatch_Accessor = MEMWATCH_BY_CPU;
 			/* We modify the memory, so we flush the instr/data caches if needed */
 			M68000_Flush_All_Caches ( addr , 1 );
 		}
@@ -181,7 +184,9 @@ bool STMemory_SafeCopy(uint32_t addr, uint8_t *src, unsigned int len, const char
 	{
 		if ( STMemory_CheckAreaType ( addr, 1, ABFLAG_RAM ) )
 		{
+			MemWatch_Accessor = MEMWATCH_BY_EMULATOR;
 			put_byte(addr, *src++);
+			MemWatch_Accessor = MEMWATCH_BY_CPU;
 			/* We modify the memory, so we flush the instr/data caches if needed */
 			M68000_Flush_All_Caches ( addr , 1 );
 		}
@@ -709,7 +714,11 @@ uint16_t	STMemory_DMA_ReadWord ( uint32_t addr )
 	if ( STMemory_CheckAddrBusError ( addr ) )
 		value = DMA_READ_WORD_BUS_ERR;
 	else
+	{
+		MemWatch_Accessor = MEMWATCH_BY_DMA;
 		value = (uint16_t)get_word ( addr );
+		MemWatch_Accessor = MEMWATCH_BY_CPU;
+	}
 //fprintf ( stderr , "readw %x %x %x\n" , addr , value , STMemory_CheckAddrBusError(addr) );
 	return value;
 }
@@ -720,7 +729,11 @@ void	STMemory_DMA_WriteWord ( uint32_t addr , uint16_t value )
 	/* Call put_word only if the address doesn't point to a bus error region */
 	/* (also see SysMem_wput for addr < 0x8) */
 	if ( STMemory_CheckAddrBusError ( addr ) == false )
+	{
+		MemWatch_Accessor = MEMWATCH_BY_DMA;
 		put_word ( addr , (uint32_t)(value) );
+		MemWatch_Accessor = MEMWATCH_BY_CPU;
+	}
 //fprintf ( stderr , "writew %x %x %x\n" , addr , value , STMemory_CheckAddrBusError(addr) );
 }
 
@@ -733,7 +746,11 @@ uint8_t	STMemory_DMA_ReadByte ( uint32_t addr )
 	if ( STMemory_CheckAddrBusError ( addr ) )
 		value = DMA_READ_BYTE_BUS_ERR;
 	else
+	{
+		MemWatch_Accessor = MEMWATCH_BY_DMA;
 		value = (uint8_t)get_byte ( addr );
+		MemWatch_Accessor = MEMWATCH_BY_CPU;
+	}
 //fprintf ( stderr , "readb %x %x %x\n" , addr , value , STMemory_CheckAddrBusError(addr) );
 	return value;
 }
@@ -744,7 +761,11 @@ void	STMemory_DMA_WriteByte ( uint32_t addr , uint8_t value )
 	/* Call put_word only if the address doesn't point to a bus error region */
 	/* (also see SysMem_wput for addr < 0x8) */
 	if ( STMemory_CheckAddrBusError ( addr ) == false )
+	{
+		MemWatch_Accessor = MEMWATCH_BY_DMA;
 		put_byte ( addr , (uint32_t)(value) );
+		MemWatch_Accessor = MEMWATCH_BY_CPU;
+	}
 //fprintf ( stderr , "writeb %x %x %x\n" , addr , value , STMemory_CheckAddrBusError(addr) );
 }
 
@@ -438,6 +438,7 @@ const char Video_fileid[] = "Hatari video.c";
 #include "ioMem.h"
 #include "keymap.h"
 #include "m68000.h"
+#include "benchmark.h"
 #include "hatari-glue.h"
 #include "memorySnapShot.h"
 #include "mfp.h"
@@ -456,11 +457,13 @@ const char Video_fileid[] = "Hatari video.c";
 #include "falcon/videl.h"
 #include "blitter.h"
 #include "avi_record.h"
+#include "capturePipe.h"
 #include "ikbd.h"
 #include "floppy_ipf.h"
 #include "statusbar.h"
 #include "clocks_timings.h"
 #include "remotedebug.h"
+#include "rewind.h"
 #include "utils.h"
 
 
@@ -3865,7 +3868,7 @@ static void Video_CopyScreenLineColor(void)
 	int STF_PixelScroll = 0;
 	int LineRes;
 	uint8_t *pVideoRasterEndLine;			/* addr of the last byte copied from pVideoRaster to pSTScreen (for HWScrollCount) */
-	int i;
+	int i, y;
 	uint32_t VideoMask;
 
 	LineBorderMask = ShifterFrame.ShifterLines[ nHBL ].BorderMask;
@@ -4357,6 +4360,12 @@ static void Video_CopyScreenLineColor(void)
 		VideoRasterDelayedInc = 0;
 	}
 
+	/* Tell screen conversion whether line differs from the previous
+	 * converted frame, so that unchanged lines can be skipped */
+	y = ( pSTScreen - pFrameBuffer->pSTScreen ) / SCREENBYTES_LINE;
+	if ( y >= 0 && y < NUM_VISIBLE_LINES )
+		pFrameBuffer->LineDirty[ y ] = memcmp ( pSTScreen , pFrameBuffer->pSTScreenCopy + y * SCREENBYTES_LINE , SCREENBYTES_LINE ) != 0;
+
 	/* Each screen line copied to buffer is always same length */
 	pSTScreen += SCREENBYTES_LINE;
 
@@ -4754,6 +4763,10 @@ static void Video_DrawScreen(void)
 	if (nVBLs % (nFrameSkips+1))
 		return;
 
+	/* Headless mode converts only frames that are needed */
+	if (Screen_SkipFrame())
+		return;
+
 	/* Now draw the screen! */
 	if (bUseVDIRes)
 	{
@@ -4914,6 +4927,7 @@ void Video_InterruptHandler_VBL ( void )
 	int PendingCyclesOver;
 	int PendingInterruptCount_save;
 	uint64_t VBL_ClockCounter_prev;
+	int BenchPrev;
 
 	PendingInterruptCount_save = PendingInterruptCount;
 
@@ -4944,7 +4958,9 @@ void Video_InterruptHandler_VBL ( void )
 	/* Clear any key presses which are due to be de-bounced (held for one ST frame) */
 	Keymap_DebounceAllKeys();
 
+	BenchPrev = Benchmark_Enter ( BENCHMARK_VIDEO );
 	Video_DrawScreen();
+	Benchmark_Leave ( BenchPrev );
 
 	/* Check printer status */
 	Printer_CheckIdleStatus();
@@ -4972,6 +4988,10 @@ void Video_InterruptHandler_VBL ( void )
 	 * which can be very confusing, but it needs to be somewhere near here in
 	 * the emulation loop. But for the moment it mimics the keyboard shortcut. */
 	RemoteDebug_CheckRemoteBreak();
+	RemoteDebug_CheckProfileLive();
+
+	/* Take periodic snapshot for debugger rewind, if enabled */
+	Rewind_Vbl();
 
 	/* Update the IKBD's internal clock */
 	IKBD_UpdateClockOnVBL ();
@@ -4979,6 +4999,8 @@ void Video_InterruptHandler_VBL ( void )
 	/* Record video frame is necessary */
 	if ( bRecordingAvi )
 		Avi_RecordVideoStream ();
+	if ( bCapturePipe )
+		CapturePipe_VideoFrame ();
 
 	/* Store off PSG registers for YM file, is enabled */
 	YMFormat_UpdateRecording();
@@ -8,6 +8,7 @@
 #include "breakcond.h"
 #include "stMemory.h"
 #include "newcpu.h"
+#include "memwatch.h"
 
 #define BITMASK(x)      ((1<<(x))-1)
 
@@ -78,6 +79,12 @@ int main(int argc, const char *argv[])
 		"&& pc = 2",
 		"pc = 2 &&",
 		"255 & 3 = (d0) & && 2 = 2",
+		/* watchpoint errors */
+		"watch",
+		"watch $200-$100",
+		"watch $200 x",
+		"watch $200 w &&",
+		"watch $200 w d0 = 1",
 		/* missing options file */
 		"pc>pc :file no-such-file",
 		"VdiOpcode = $8 :info no-info",
@@ -107,6 +114,10 @@ int main(int argc, const char *argv[])
 		"($200).w > ($200).w :4 :lock",
 		"VdiOpcode = $8 :quiet :info vdi",
 		"pc>pc :file data/test.ini :once",
+		/* watchpoints */
+		"watch $200",
+		"watch $200-$204 rw :trace",
+		"watch $200-$204 r && d0 = 1",
 		NULL
 	};
 	/* address breakpoint + expression evaluation with register */
@@ -117,6 +128,8 @@ int main(int argc, const char *argv[])
 		"pc < $50000 && pc > $60000",
 		"pc > $50000 && pc < $54000",
 		"d0 = a0",
+		"pc = $58002",     /* PC hash lookups */
+		"pc = $58000 && d0 = 5",
 		"a0 = pc :trace",  /* matches, but :trace should hide that */
 		"a0 = pc :3",      /* matches, but not yet */
 		NULL
@@ -127,6 +140,8 @@ int main(int argc, const char *argv[])
 		"pc > $50000 && pc < $60000",
 		"d0 = d1 :once :quiet",
 		"a0 = pc",	   /* tested alone */
+		"pc = $58000",	   /* PC hash lookups */
+		"pc = $58000 && d0 = 4 :once",
 		NULL
 	};
 	const char *test;
@@ -251,6 +266,62 @@ int main(int argc, const char *argv[])
 	}
 	total_tests += i;
 
+	/* watchpoints: { watchpoint, access address, size, access, whether it should match } */
+	{
+		struct {
+			const char *watch;
+			uint32_t addr;
+			int size, access;
+			bool match;
+		} watch_tests[] = {
+			{ "watch $1000-$1004", 0x1002, 2, MEMWATCH_WRITE, true },
+			{ "watch $1000-$1004", 0x0ffe, 2, MEMWATCH_WRITE, false },
+			{ "watch $1000-$1004", 0x0ffe, 4, MEMWATCH_WRITE, true },
+			{ "watch $1000-$1004", 0x1004, 1, MEMWATCH_WRITE, false },
+			{ "watch $1000-$1004", 0x1000, 4, MEMWATCH_READ, false },
+			{ "watch $1000 r", 0x1000, 1, MEMWATCH_READ, true },
+			{ "watch $1000-$1004 rw && d0 = 4", 0x1000, 4, MEMWATCH_READ, true },
+			{ "watch $1000-$1004 rw && d0 = 5", 0x1000, 4, MEMWATCH_WRITE, false },
+		};
+		fprintf(stderr, "\nWatchpoint tests:\n");
+		for (errors = i = 0; i < ARRAY_SIZE(watch_tests); i++) {
+			fprintf(stderr, "-----------------\n- parsing '%s'\n", watch_tests[i].watch);
+			if (!BreakCond_Command(watch_tests[i].watch, use_dsp)) {
+				fprintf(stderr, "***ERROR***: should have passed\n");
+				total_errors++;
+				continue;
+			}
+			if (BreakCond_CpuWatchPointCount() != 1) {
+				fprintf(stderr, "***ERROR***: watchpoint not counted\n");
+				errors++;
+			}
+			/* same as bank access functions in cpu/memory.c */
+			if (watch_tests[i].access == MEMWATCH_WRITE) {
+				if (MemWatch_WriteMap)
+					MemWatch_CheckWrite(watch_tests[i].addr, watch_tests[i].size, 0);
+			} else if (MemWatch_ReadMap) {
+				MemWatch_CheckRead(watch_tests[i].addr, watch_tests[i].size);
+			}
+			if (BreakCond_MatchCpuWatch() != watch_tests[i].match) {
+				fprintf(stderr, "***ERROR***: access to $%x should%s have matched\n",
+					watch_tests[i].addr, watch_tests[i].match ? "" : " NOT");
+				errors++;
+			}
+			BreakCond_Command(CMD_REMOVE_ALL, use_dsp);
+			if (BreakCond_CpuWatchPointCount() || MemWatch_WriteMap || MemWatch_ReadMap) {
+				fprintf(stderr, "***ERROR***: watchpoint not removed\n");
+				errors++;
+			}
+		}
+		fprintf(stderr, "-----------------\n\n");
+		if (errors) {
+			total_errors += errors;
+			fprintf(stderr, "ERROR: %d errors in %d watchpoint tests!\n\n",
+				errors, i);
+		}
+		total_tests += i;
+	}
+
 	/* ...last parse cmd line args as DSP breakpoints */
 	if (argc > 1) {
 		use_dsp = true;
@@ -45,6 +45,7 @@ uint32_t TosAddress = 0xe00000, TosSize = 256*1024;
 /* fake ST RAM, only 24-bit support */
 #include "stMemory.h"
 uae_u8 *TTmemory = NULL;
+uae_u32 TTmem_size = 0;
 static uint8_t _STRam[16*1024*1024];
 uint8_t *STRam = _STRam;
 uint32_t STRamEnd = 4*1024*1024;
@@ -97,6 +98,8 @@ uint16_t M68000_GetSR(void) { return 0x2700; }
 void M68000_SetSR(uint16_t v) { }
 void M68000_SetPC(uaecptr v) { }
 void M68000_SetDebugger(bool debug) { }
+void M68000_RestoreDebugger(void) { }
+int BusMode = BUS_MODE_CPU;
 
 /* fake UAE core registers */
 #include "newcpu.h"
@@ -117,6 +120,13 @@ char *DebugUI_MatchHelper(const char **strings, int items, const char *text, int
 	return NULL;
 }
 
+/* fake memorySnapShot.c stuff */
+#include "memorySnapShot.h"
+void MemorySnapShot_CaptureBuffer(MemorySnapShot_Buffer_t *pBuffer) { }
+void MemorySnapShot_RestoreBuffer(MemorySnapShot_Buffer_t *pBuffer) { }
+void MemorySnapShot_FreeBuffer(MemorySnapShot_Buffer_t *pBuffer) { }
+size_t MemorySnapShot_SharedPagesSize(void) { return 0; }
+
 /* fake vdi.c stuff */
 #include "vdi.h"
 void VDI_Info(FILE *fp, uint32_t arg) { return; }
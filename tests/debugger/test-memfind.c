@@ -0,0 +1,94 @@
+/*
+ * Code to test Hatari memory search in src/debug/memfind.c
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include "main.h"
+#include "stMemory.h"
+#include "memfind.h"
+
+#define MAX_HITS 8
+
+int main(int argc, const char *argv[])
+{
+	static const uint8_t upper[6] = "HATARI";
+	static const uint8_t exact[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	static const uint8_t nocase[6] = { 0xdf, 0xdf, 0xdf, 0xdf, 0xdf, 0xdf };
+	static const uint8_t nibble[6] = { 0xf0, 0xf0, 0xf0, 0xf0, 0xf0, 0xf0 };
+	static const uint8_t nibval[6] = { 0x40, 0x40, 0x50, 0x40, 0x50, 0x40 };
+	static const uint8_t zeromask[3] = { 0xff, 0xff, 0xff };
+	static const uint8_t zeroval[3] = { 0x00, 0x00, 'H' };
+	/* expected results for given pattern & range */
+	struct {
+		const char *name;
+		memfind_pattern_t pattern;
+		uint32_t start, end;
+		int maxhits;
+		int count;
+		uint32_t hits[MAX_HITS];
+		uint32_t next;
+	} tests[] = {
+		{ "exact, whole RAM", { exact, upper, 6, 1 }, 0, 0x400000, MAX_HITS,
+		  3, { 0x1001, 0x2000, 0x3ffffa }, 0x400000 },
+		{ "exact, first hit only", { exact, upper, 6, 1 }, 0, 0x400000, 1,
+		  1, { 0x1001 }, 0x1002 },
+		{ "exact, continued", { exact, upper, 6, 1 }, 0x1002, 0x400000, 1,
+		  1, { 0x2000 }, 0x2001 },
+		{ "exact, word aligned", { exact, upper, 6, 2 }, 0, 0x400000, MAX_HITS,
+		  2, { 0x2000, 0x3ffffa }, 0x400000 },
+		{ "exact, word steps from odd start", { exact, upper, 6, 2 }, 0x0fff, 0x400000, MAX_HITS,
+		  1, { 0x1001 }, 0x400000 },
+		{ "exact, range ends mid-match", { exact, upper, 6, 1 }, 0, 0x2005, MAX_HITS,
+		  1, { 0x1001 }, 0x2005 },
+		{ "no case", { nocase, upper, 6, 1 }, 0, 0x400000, MAX_HITS,
+		  4, { 0x1001, 0x2000, 0x3000, 0x3ffffa }, 0x400000 },
+		{ "no full byte mask", { nibble, nibval, 6, 1 }, 0, 0x400000, MAX_HITS,
+		  3, { 0x1001, 0x2000, 0x3ffffa }, 0x400000 },
+		{ "zero bytes", { zeromask, zeroval, 3, 1 }, 0, 0x400000, MAX_HITS,
+		  3, { 0x0fff, 0x1ffe, 0x3ffff8 }, 0x400000 },
+		{ "range over RAM end", { exact, upper, 6, 1 }, 0x3ffff0, 0x400100, MAX_HITS,
+		  1, { 0x3ffffa }, 0x400100 },
+	};
+	uint32_t hits[MAX_HITS], next;
+	int i, j, count, errors = 0;
+
+	memset(STRam, 0, STRamEnd);
+	memcpy(STRam + 0x1001, "HATARI", 6);
+	memcpy(STRam + 0x2000, "HATARI", 6);
+	memcpy(STRam + 0x3000, "hatari", 6);
+	memcpy(STRam + 0x3ffffa, "HATARI", 6);
+
+	fprintf(stderr, "\nMemory searches that should succeed with given results:\n");
+
+	for (i = 0; i < ARRAY_SIZE(tests); i++) {
+		fprintf(stderr, "- %s: 0x%x-0x%x\n", tests[i].name, tests[i].start, tests[i].end);
+		count = MemFind_Search(&tests[i].pattern, tests[i].start, tests[i].end,
+				       hits, tests[i].maxhits, &next);
+		if (count != tests[i].count) {
+			fprintf(stderr, "  => %d hits (not %d)\n  ***Wrong number of hits***\n",
+				count, tests[i].count);
+			errors++;
+			continue;
+		}
+		for (j = 0; j < count; j++) {
+			if (hits[j] != tests[i].hits[j]) {
+				fprintf(stderr, "  => hit %d at 0x%x (not 0x%x)\n  ***Wrong hit address***\n",
+					j, hits[j], tests[i].hits[j]);
+				errors++;
+			}
+		}
+		if (next != tests[i].next) {
+			fprintf(stderr, "  => next 0x%x (not 0x%x)\n  ***Wrong continuation address***\n",
+				next, tests[i].next);
+			errors++;
+		}
+	}
+
+	if (errors) {
+		fprintf(stderr, "\n***Detected %d ERRORs in %d automated tests!***\n\n",
+			errors, i);
+	} else {
+		fprintf(stderr, "\nFinished without any errors!\n\n");
+	}
+	return errors;
+}
@@ -0,0 +1,217 @@
+/*
+ * Check that all the bitplane to chunky conversion kernels supported
+ * by the host produce the same result as the original conversion
+ * routine, and benchmark them on representative Falcon VIDEL modes.
+ *
+ * Number of benchmarked frames per mode can be given as argument
+ * (default is few frames, just to check that timing works).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <SDL_endian.h>
+#include "screenPlanar.h"
+
+static const struct {
+	int width, height, bpp;
+} modes[] = {
+	{ 640, 400, 1 },
+	{ 640, 480, 2 },
+	{ 320, 240, 4 },
+	{ 640, 480, 4 },
+	{ 320, 240, 8 },
+	{ 640, 480, 8 },
+};
+
+static uint32_t palette[256];
+
+/* Conversion routine originally in screenConvert.c (without TT
+ * sample & hold), with which kernel results are compared */
+static void Orig_BitplaneToChunky32(uint16_t *atariBitplaneData, uint16_t bpp,
+                                    uint32_t *hvram)
+{
+	uint32_t a, b, c, d, x;
+
+	if (bpp >= 4) {
+		d = *(uint32_t *)&atariBitplaneData[0];
+		c = *(uint32_t *)&atariBitplaneData[2];
+		if (bpp == 4) {
+			a = b = 0;
+		} else {
+			b = *(uint32_t *)&atariBitplaneData[4];
+			a = *(uint32_t *)&atariBitplaneData[6];
+		}
+
+		x = a;
+		a =  (a & 0xf0f0f0f0)       | ((c & 0xf0f0f0f0) >> 4);
+		c = ((x & 0x0f0f0f0f) << 4) |  (c & 0x0f0f0f0f);
+	} else {
+		a = b = c = 0;
+		if (bpp == 2) {
+			d = *(uint32_t *)&atariBitplaneData[0];
+		} else {
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			d = atariBitplaneData[0]<<16;
+#else
+			d = atariBitplaneData[0];
+#endif
+		}
+	}
+
+	x = b;
+	b =  (b & 0xf0f0f0f0)       | ((d & 0xf0f0f0f0) >> 4);
+	d = ((x & 0x0f0f0f0f) << 4) |  (d & 0x0f0f0f0f);
+
+	x = a;
+	a =  (a & 0xcccccccc)       | ((b & 0xcccccccc) >> 2);
+	b = ((x & 0x33333333) << 2) |  (b & 0x33333333);
+	x = c;
+	c =  (c & 0xcccccccc)       | ((d & 0xcccccccc) >> 2);
+	d = ((x & 0x33333333) << 2) |  (d & 0x33333333);
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+	a = (a & 0x5555aaaa) | ((a & 0x00005555) << 17) | ((a & 0xaaaa0000) >> 17);
+	b = (b & 0x5555aaaa) | ((b & 0x00005555) << 17) | ((b & 0xaaaa0000) >> 17);
+	c = (c & 0x5555aaaa) | ((c & 0x00005555) << 17) | ((c & 0xaaaa0000) >> 17);
+	d = (d & 0x5555aaaa) | ((d & 0x00005555) << 17) | ((d & 0xaaaa0000) >> 17);
+
+	*hvram++ = palette[(uint8_t)(a >> 8)];
+	*hvram++ = palette[(uint8_t)(a >> 24)];
+	*hvram++ = palette[(uint8_t)(b >> 8)];
+	*hvram++ = palette[(uint8_t)(b >> 24)];
+	*hvram++ = palette[(uint8_t)(c >> 8)];
+	*hvram++ = palette[(uint8_t)(c >> 24)];
+	*hvram++ = palette[(uint8_t)(d >> 8)];
+	*hvram++ = palette[(uint8_t)(d >> 24)];
+	*hvram++ = palette[(uint8_t)(a)];
+	*hvram++ = palette[(uint8_t)(a >> 16)];
+	*hvram++ = palette[(uint8_t)(b)];
+	*hvram++ = palette[(uint8_t)(b >> 16)];
+	*hvram++ = palette[(uint8_t)(c)];
+	*hvram++ = palette[(uint8_t)(c >> 16)];
+	*hvram++ = palette[(uint8_t)(d)];
+	*hvram++ = palette[(uint8_t)(d >> 16)];
+#else
+	a = (a & 0xaaaa5555) | ((a & 0x0000aaaa) << 15) | ((a & 0x55550000) >> 15);
+	b = (b & 0xaaaa5555) | ((b & 0x0000aaaa) << 15) | ((b & 0x55550000) >> 15);
+	c = (c & 0xaaaa5555) | ((c & 0x0000aaaa) << 15) | ((c & 0x55550000) >> 15);
+	d = (d & 0xaaaa5555) | ((d & 0x0000aaaa) << 15) | ((d & 0x55550000) >> 15);
+
+	*hvram++ = palette[(uint8_t)(a >> 16)];
+	*hvram++ = palette[(uint8_t)(a)];
+	*hvram++ = palette[(uint8_t)(b >> 16)];
+	*hvram++ = palette[(uint8_t)(b)];
+	*hvram++ = palette[(uint8_t)(c >> 16)];
+	*hvram++ = palette[(uint8_t)(c)];
+	*hvram++ = palette[(uint8_t)(d >> 16)];
+	*hvram++ = palette[(uint8_t)(d)];
+	*hvram++ = palette[(uint8_t)(a >> 24)];
+	*hvram++ = palette[(uint8_t)(a >> 8)];
+	*hvram++ = palette[(uint8_t)(b >> 24)];
+	*hvram++ = palette[(uint8_t)(b >> 8)];
+	*hvram++ = palette[(uint8_t)(c >> 24)];
+	*hvram++ = palette[(uint8_t)(c >> 8)];
+	*hvram++ = palette[(uint8_t)(d >> 24)];
+	*hvram++ = palette[(uint8_t)(d >> 8)];
+#endif
+}
+
+static void Orig_Frame(uint16_t *fvram, int w, int h, int bpp, uint32_t *hvram)
+{
+	int groups = w * h / 16;
+
+	while (groups-- > 0) {
+		Orig_BitplaneToChunky32(fvram, bpp, hvram);
+		fvram += bpp;
+		hvram += 16;
+	}
+}
+
+/* Same as what screenConvert.c does with the kernels, per line */
+static void Kernel_Frame(ScreenPlanar_Func_t func, uint16_t *fvram,
+                         int w, int h, int bpp, uint32_t *hvram)
+{
+	int y;
+
+	for (y = 0; y < h; y++) {
+		func(fvram, bpp, w / 16, palette, hvram);
+		fvram += w / 16 * bpp;
+		hvram += w;
+	}
+}
+
+static double Elapsed(clock_t start)
+{
+	return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+	const ScreenPlanar_Kernel_t *kernels;
+	uint32_t *ref, *out;
+	uint16_t *fvram;
+	int i, k, m, frame, count, frames = 4;
+	int failed = 0;
+	clock_t start;
+
+	if (argc > 1) {
+		frames = atoi(argv[1]);
+	}
+	count = ScreenPlanar_GetKernels(&kernels);
+
+	fvram = malloc(640 * 480);
+	ref = malloc(640 * 480 * sizeof(*ref));
+	out = malloc(640 * 480 * sizeof(*out));
+	if (!fvram || !ref || !out) {
+		fprintf(stderr, "ERROR: alloc failed\n");
+		return 1;
+	}
+	srand(1);
+	for (i = 0; i < 640 * 480 / 2; i++) {
+		fvram[i] = rand();
+	}
+	for (i = 0; i < 256; i++) {
+		palette[i] = i * 0x010203;
+	}
+
+	for (m = 0; m < (int)(sizeof(modes) / sizeof(modes[0])); m++) {
+		int w = modes[m].width, h = modes[m].height, bpp = modes[m].bpp;
+
+		start = clock();
+		for (frame = 0; frame < frames; frame++) {
+			Orig_Frame(fvram, w, h, bpp, ref);
+		}
+		printf("%dx%dx%d: %-8s %8.3f ms/frame\n", w, h, bpp,
+		       "original", Elapsed(start) / frames);
+
+		for (k = 0; k < count; k++) {
+			memset(out, 0, w * h * sizeof(*out));
+			Kernel_Frame(kernels[k].func, fvram, w, h, bpp, out);
+			if (memcmp(ref, out, w * h * sizeof(*out)) != 0) {
+				printf("%dx%dx%d: %-8s FAIL\n", w, h, bpp, kernels[k].name);
+				failed++;
+				continue;
+			}
+			start = clock();
+			for (frame = 0; frame < frames; frame++) {
+				Kernel_Frame(kernels[k].func, fvram, w, h, bpp, out);
+			}
+			printf("%dx%dx%d: %-8s %8.3f ms/frame\n", w, h, bpp,
+			       kernels[k].name, Elapsed(start) / frames);
+		}
+	}
+
+	free(fvram);
+	free(ref);
+	free(out);
+
+	if (failed) {
+		fprintf(stderr, "\n***Detected %d failures***\n", failed);
+		return 1;
+	}
+	printf("\nFinished without failures.\n");
+	return 0;
+}
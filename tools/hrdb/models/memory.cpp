@@ -23,6 +23,12 @@ void Memory::Clear()
     m_sizeInBytes = 0;
 }
 
+void Memory::SetRange(uint32_t offset, const uint8_t* pData, uint32_t size)
+{
+    assert(offset + size <= m_sizeInBytes);
+    memcpy(m_pData + offset, pData, size);
+}
+
 bool Memory::ReadCpuMulti(uint32_t address, uint32_t numBytes, uint32_t& value) const
 {
     assert(m_space == MEM_CPU);
@@ -58,6 +58,9 @@ public:
         m_pData[offset] = val;
     }
 
+    // Copy a range of bytes in at a byte offset.
+    void SetRange(uint32_t offset, const uint8_t* pData, uint32_t size);
+
     // Fetch from a byte offset
     uint8_t Get(uint32_t offset) const
     {
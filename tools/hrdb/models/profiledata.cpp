@@ -1,5 +1,34 @@
 #include "profiledata.h"
 
+#include <string.h>
+#include <QByteArray>
+
+static const size_t kSnapshotHeaderSize = 14;
+static const uint8_t kSnapshotVersion = 1;
+static const uint8_t kSnapshotFlagZlib = 0x02;
+
+static uint32_t ReadBe32(const uint8_t* pData)
+{
+    return (uint32_t(pData[0]) << 24) | (uint32_t(pData[1]) << 16) |
+           (uint32_t(pData[2]) << 8) | uint32_t(pData[3]);
+}
+
+// Read an unsigned LEB128 value, returns false on overrun
+static bool ReadVarint(const uint8_t*& pData, const uint8_t* pEnd, uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (pData == pEnd)
+            return false;
+        uint8_t byte = *pData++;
+        value |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
 void ProfileData::Add(const ProfileDelta &delta)
 {
     Map::iterator it = m_entries.find(delta.addr);
@@ -36,3 +65,46 @@ void ProfileData::Reset()
 {
     m_entries.clear();
 }
+
+bool ProfileData::DecodeSnapshot(const uint8_t* pData, size_t size, std::vector<ProfileDelta>& deltas)
+{
+    if (size < kSnapshotHeaderSize || memcmp(pData, "HPRF", 4) != 0 ||
+        pData[4] != kSnapshotVersion)
+        return false;
+
+    uint8_t flags = pData[5];
+    uint32_t numEntries = ReadBe32(pData + 6);
+    uint32_t bodySize = ReadBe32(pData + 10);
+
+    // The size field followed by the zlib stream is the qUncompress() layout
+    QByteArray unpacked;
+    const uint8_t* pBody = pData + kSnapshotHeaderSize;
+    if (flags & kSnapshotFlagZlib)
+    {
+        unpacked = qUncompress(pData + 10, static_cast<int>(size - 10));
+        if (static_cast<uint32_t>(unpacked.size()) != bodySize)
+            return false;
+        pBody = reinterpret_cast<const uint8_t*>(unpacked.constData());
+    }
+    else if (size - kSnapshotHeaderSize != bodySize)
+    {
+        return false;
+    }
+
+    const uint8_t* pEnd = pBody + bodySize;
+    uint32_t lastaddr = 0;
+    deltas.reserve(deltas.size() + numEntries);
+    for (uint32_t i = 0; i < numEntries; ++i)
+    {
+        uint32_t addrDelta;
+        ProfileDelta delta;
+        if (!ReadVarint(pBody, pEnd, addrDelta) ||
+            !ReadVarint(pBody, pEnd, delta.count) ||
+            !ReadVarint(pBody, pEnd, delta.cycles))
+            return false;
+        delta.addr = lastaddr + addrDelta;
+        lastaddr = delta.addr;
+        deltas.push_back(delta);
+    }
+    return true;
+}
@@ -1,8 +1,10 @@
 #ifndef PROFILEDATA_H
 #define PROFILEDATA_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <map>
+#include <vector>
 
 struct ProfileDelta
 {
@@ -24,6 +26,10 @@ public:
     void Get(uint32_t addr, uint32_t& count, uint32_t& cycles);
     void Reset();
 
+    // Decode a binary profile snapshot sent by the target
+    // (see Hatari's profile.c for the format)
+    static bool DecodeSnapshot(const uint8_t* pData, size_t size, std::vector<ProfileDelta>& deltas);
+
     typedef std::map<uint32_t, Entry> Map;
     typedef std::pair<uint32_t, Entry> Pair;
 
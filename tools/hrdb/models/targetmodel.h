@@ -61,6 +61,7 @@ class SearchResults
 {
 public:
     QVector<uint32_t> addresses;
+    uint32_t nextAddress = 0;       // where to continue searching for more hits
 };
 
 /*
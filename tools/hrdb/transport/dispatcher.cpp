@@ -13,12 +13,15 @@
 //#define DISPATCHER_DEBUG
 
 // Protocol ID which needs to match the Hatari target
-#define REMOTEDEBUG_PROTOCOL_ID	(0x1008)
+#define REMOTEDEBUG_PROTOCOL_ID	(0x1010)
 
 //-----------------------------------------------------------------------------
 // Character value for the separator in responses/notifications from the target
 static const char SEP_CHAR = 1;
 
+// Size of the big-endian length header of packets in binary mode
+static const size_t kPacketHeaderSize = 4;
+
 //-----------------------------------------------------------------------------
 int RegNameToEnum(const char* name)
 {
@@ -54,8 +57,10 @@ Dispatcher::Dispatcher(QTcpSocket* tcpSocket, TargetModel* pTargetModel) :
     m_pTargetModel(pTargetModel),
     m_responseUid(100),
     m_portConnected(false),
-    m_waitingConnectionAck(false)
+    m_waitingConnectionAck(false),
+    m_binaryMode(false)
 {
+    memset(m_memSlotRequests, 0, sizeof(m_memSlotRequests));
     connect(m_pTcpSocket, &QAbstractSocket::connected,    this, &Dispatcher::connected);
     connect(m_pTcpSocket, &QAbstractSocket::disconnected, this, &Dispatcher::disconnected);
     connect(m_pTcpSocket, &QAbstractSocket::readyRead,    this, &Dispatcher::readyRead);
@@ -80,8 +85,7 @@ uint64_t Dispatcher::InsertFlush()
 
 uint64_t Dispatcher::ReadMemory(MemorySlot slot, uint32_t address, uint32_t size)
 {
-    QString tmp = QString::asprintf("mem %x %x", address, size);
-    return SendCommandShared(slot, tmp.toStdString());
+    return SendCommandShared(slot, CreateCpuMemoryCommand(slot, address, size));
 }
 
 uint64_t Dispatcher::ReadMemory(MemorySlot slot, MemSpace space, uint32_t address, uint32_t size)
@@ -90,7 +94,7 @@ uint64_t Dispatcher::ReadMemory(MemorySlot slot, MemSpace space, uint32_t addres
     switch (space)
     {
     case MEM_CPU:
-        tmp = QString::asprintf("mem %x %x", address, size); break;
+        return SendCommandShared(slot, CreateCpuMemoryCommand(slot, address, size));
     case MEM_P:
         tmp = QString::asprintf("dmem P %x %x", address, size); break;
     case MEM_X:
@@ -101,6 +105,9 @@ uint64_t Dispatcher::ReadMemory(MemorySlot slot, MemSpace space, uint32_t addres
         assert(0);
         return 0;
     }
+    // The slot no longer holds CPU memory to patch
+    if (slot != MemorySlot::kNone)
+        memset(&m_memSlotRequests[slot], 0, sizeof(m_memSlotRequests[slot]));
     return SendCommandShared(slot, tmp.toStdString());
 }
 
@@ -233,6 +240,12 @@ uint64_t Dispatcher::SetProfileEnable(bool enable)
         return SendCommandPacket("profile 0");
 }
 
+uint64_t Dispatcher::SetProfileLive(uint32_t vbls)
+{
+    QString command = QString::asprintf("profilelive %x", vbls);
+    return SendCommandPacket(command.toStdString().c_str());
+}
+
 uint64_t Dispatcher::SetFastForward(bool enable)
 {
     if (enable)
@@ -248,12 +261,14 @@ uint64_t Dispatcher::SendConsoleCommand(const std::string& cmd)
     return SendCommandPacket(packet.c_str());
 }
 
-uint64_t Dispatcher::SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_t startAddress, uint32_t endAddress)
+uint64_t Dispatcher::SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_t startAddress, uint32_t endAddress,
+                                 uint32_t maxHits)
 {
     QString command = QString::asprintf("memfind %x %x ", startAddress, endAddress - startAddress);
 
     for (int i = 0; i <  valuesAndMasks.size(); ++i)
         command += QString::asprintf("%02x", valuesAndMasks[i]);
+    command += QString::asprintf(" %x", maxHits);
 
     return SendCommandPacket(command.toStdString().c_str());
 }
@@ -270,10 +285,27 @@ uint64_t Dispatcher::DebugSendRawPacket(const char *command)
     return SendCommandPacket(command);
 }
 
-void Dispatcher::ReceivePacket(const char* response)
+std::string Dispatcher::CreateCpuMemoryCommand(MemorySlot slot, uint32_t address, uint32_t size)
+{
+    if (slot == MemorySlot::kNone)
+        return QString::asprintf("mem %x %x", address, size).toStdString();
+
+    // The reply patches the data of the previous reply for this slot,
+    // so only reuse the epoch if the last request was for the same area.
+    // Otherwise ask for everything.
+    MemSlotRequest& req = m_memSlotRequests[slot];
+    uint32_t epoch = 0;
+    if (req.address == address && req.size == size)
+        epoch = req.epoch;
+    req.address = address;
+    req.size = size;
+    return QString::asprintf("memdirty %x %x %x", epoch, address, size).toStdString();
+}
+
+void Dispatcher::ReceivePacket(const std::string& response)
 {
     // THIS HAPPENS ON THE EVENT LOOP
-    std::string new_resp(response);
+    const std::string& new_resp(response);
 
     // Any flushes to handle?
     while (1)
@@ -368,6 +400,11 @@ void Dispatcher::connected()
     // Clear any accidental button clicks that sent messages while disconnected
     DeletePending();
 
+    // New connections always start in text mode
+    m_rxBuffer.clear();
+    m_binaryMode = false;
+    memset(m_memSlotRequests, 0, sizeof(m_memSlotRequests));
+
     m_portConnected = true;
 
     // THIS HAPPENS ON THE EVENT LOOP
@@ -384,31 +421,47 @@ void Dispatcher::disconnected()
     // THIS HAPPENS ON THE EVENT LOOP
     std::cout << "Host disconnected" << std::endl;
     m_portConnected = false;
+    m_rxBuffer.clear();
+    m_binaryMode = false;
 }
 
 void Dispatcher::readyRead()
 {
     // THIS HAPPENS ON THE EVENT LOOP
-    qint64 byteCount = m_pTcpSocket->bytesAvailable();
-    char* data = new char[byteCount];
+    QByteArray data = m_pTcpSocket->readAll();
+    m_rxBuffer.append(data.constData(), static_cast<size_t>(data.size()));
 
-    m_pTcpSocket->read(data, byteCount);
-
-    // Read completed commands from this and process in turn
-    for (int i = 0; i < byteCount; ++i)
+    // Read completed packets from this and process in turn.
+    // The framing mode can change after any packet, so check it each time.
+    size_t readPos = 0;
+    while (readPos < m_rxBuffer.size())
     {
-        if (data[i] == 0)
+        if (m_binaryMode)
         {
-            // End of response
-            this->ReceivePacket(m_active_resp.c_str());
-            m_active_resp = std::string();
+            // Packet is a 4-byte big-endian length plus payload
+            if (m_rxBuffer.size() - readPos < kPacketHeaderSize)
+                break;
+            const uint8_t* pHeader = reinterpret_cast<const uint8_t*>(m_rxBuffer.data() + readPos);
+            size_t length = (static_cast<size_t>(pHeader[0]) << 24) |
+                            (static_cast<size_t>(pHeader[1]) << 16) |
+                            (static_cast<size_t>(pHeader[2]) << 8) |
+                             static_cast<size_t>(pHeader[3]);
+            if (m_rxBuffer.size() - readPos - kPacketHeaderSize < length)
+                break;
+            this->ReceivePacket(m_rxBuffer.substr(readPos + kPacketHeaderSize, length));
+            readPos += kPacketHeaderSize + length;
         }
         else
         {
-            m_active_resp += data[i];
+            // Packet is zero-terminated
+            size_t endPos = m_rxBuffer.find('\0', readPos);
+            if (endPos == std::string::npos)
+                break;
+            this->ReceivePacket(m_rxBuffer.substr(readPos, endPos - readPos));
+            readPos = endPos + 1;
         }
     }
-    delete[] data;
+    m_rxBuffer.erase(0, readPos);
 }
 
 uint64_t Dispatcher::SendCommandPacket(const char *command)
@@ -474,6 +527,8 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
         ParseRegs(splitResp, cmd);
     else if (type == "mem")
         ParseMem(splitResp, cmd);
+    else if (type == "memdirty")
+        ParseMemDirty(splitResp, cmd);
     else if (type == "dmem")
         ParseDmem(splitResp, cmd);
     else if (type == "bplist")
@@ -505,6 +560,8 @@ void Dispatcher::ReceiveResponsePacket(const RemoteCommand& cmd)
        m_pTargetModel->SaveBinComplete(cmd.m_uid, 0U);
     else if (type == "histget")
         ParseHistGet(splitResp, cmd);
+    else if (type == "binary")
+        ParseBinary(splitResp, cmd);
     else
     {
         // For debugging
@@ -545,6 +602,9 @@ void Dispatcher::ReceiveNotification(const RemoteNotification& cmd)
             m_waitingConnectionAck = false;
 
             std::cout << "Connection acknowleged by server" << std::endl;
+
+            // Switch to binary framing before any views request data
+            SendCommandPacket("binary 1");
             m_pTargetModel->SetConnected(1);
         }
         return;
@@ -640,6 +700,35 @@ void Dispatcher::ReceiveNotification(const RemoteNotification& cmd)
         if (numDeltas)
             m_pTargetModel->ProfileDeltaComplete(static_cast<int>(enabled));
     }  
+    else if (type == "!profilebin")
+    {
+        std::string enabledStr = s.Split(SEP_CHAR);
+        std::string sizeStr = s.Split(SEP_CHAR);
+        uint32_t enabled = 0;
+        uint32_t size = 0;
+        if (!StringParsers::ParseHexString(enabledStr.c_str(), enabled))
+            return;
+        if (!StringParsers::ParseHexString(sizeStr.c_str(), size))
+            return;
+
+        // Snapshot data is raw at the end of the packet
+        if (cmd.m_payload.size() < size)
+            return;
+        const uint8_t* pData = reinterpret_cast<const uint8_t*>(cmd.m_payload.data()) +
+                cmd.m_payload.size() - size;
+        std::vector<ProfileDelta> deltas;
+        if (!ProfileData::DecodeSnapshot(pData, size, deltas))
+        {
+            std::cout << "WARNING: invalid profile snapshot" << std::endl;
+            return;
+        }
+        for (size_t i = 0; i < deltas.size(); ++i)
+            m_pTargetModel->AddProfileDelta(deltas[i]);
+
+        // Don't send a signal if no deltas happened...
+        if (deltas.size())
+            m_pTargetModel->ProfileDeltaComplete(static_cast<int>(enabled));
+    }
     else if (type == "!symbols")
     {
         std::string path = s.Split(SEP_CHAR);
@@ -695,6 +784,22 @@ void Dispatcher::ParseMem(StringSplitter& splitResp, const RemoteCommand& cmd)
     // Create a new memory block to pass to the data model
     Memory* pMem = new Memory(MEM_CPU, addr, size);
 
+    if (m_binaryMode)
+    {
+        // Raw data is the last "size" bytes of the packet.
+        // Don't use the splitter here, since the data can contain separators.
+        if (cmd.m_response.size() < size)
+        {
+            delete pMem;
+            return;
+        }
+        const char* pData = cmd.m_response.data() + cmd.m_response.size() - size;
+        for (uint32_t i = 0; i < size; ++i)
+            pMem->Set(i, static_cast<uint8_t>(pData[i]));
+        m_pTargetModel->SetMemory(cmd.m_memorySlot, pMem, cmd.m_uid);
+        return;
+    }
+
     // Now parse the uuencoded data
     // Each "group" encodes 3 bytes
     uint32_t numGroups = (size + 2) / 3;        // round up to next block
@@ -723,6 +828,103 @@ void Dispatcher::ParseMem(StringSplitter& splitResp, const RemoteCommand& cmd)
     m_pTargetModel->SetMemory(cmd.m_memorySlot, pMem, cmd.m_uid);
 }
 
+void Dispatcher::ParseMemDirty(StringSplitter &splitResp, const RemoteCommand &cmd)
+{
+    std::string epochStr = splitResp.Split(SEP_CHAR);
+    std::string addrStr = splitResp.Split(SEP_CHAR);
+    std::string sizeStr = splitResp.Split(SEP_CHAR);
+    std::string runCountStr = splitResp.Split(SEP_CHAR);
+    uint32_t epoch, addr, size, runCount;
+    if (!StringParsers::ParseHexString(epochStr.c_str(), epoch))
+        return;
+    if (!StringParsers::ParseHexString(addrStr.c_str(), addr))
+        return;
+    if (!StringParsers::ParseHexString(sizeStr.c_str(), size))
+        return;
+    if (!StringParsers::ParseHexString(runCountStr.c_str(), runCount))
+        return;
+
+    // Read the run list (offsets and sizes)
+    std::vector<std::pair<uint32_t, uint32_t>> runs;
+    uint32_t dataSize = 0;
+    for (uint32_t i = 0; i < runCount; ++i)
+    {
+        std::string offsetStr = splitResp.Split(SEP_CHAR);
+        std::string runSizeStr = splitResp.Split(SEP_CHAR);
+        uint32_t offset, runSize;
+        if (!StringParsers::ParseHexString(offsetStr.c_str(), offset))
+            return;
+        if (!StringParsers::ParseHexString(runSizeStr.c_str(), runSize))
+            return;
+        if (offset + runSize > size)
+            return;
+        runs.push_back(std::make_pair(offset, runSize));
+        dataSize += runSize;
+    }
+
+    // Decode the concatenated run data, which is at the end of the packet.
+    // Don't use the splitter here, since binary data can contain separators.
+    std::vector<uint8_t> data(dataSize);
+    if (m_binaryMode)
+    {
+        if (cmd.m_response.size() < dataSize)
+            return;
+        const char* pData = cmd.m_response.data() + cmd.m_response.size() - dataSize;
+        memcpy(data.data(), pData, dataSize);
+    }
+    else
+    {
+        size_t numChars = ((dataSize + 2) / 3) * 4;
+        if (cmd.m_response.size() < numChars)
+            return;
+        size_t readPos = cmd.m_response.size() - numChars;
+        uint32_t writePos = 0;
+        while (writePos < dataSize)
+        {
+            uint32_t accum = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                accum <<= 6;
+                uint32_t value = static_cast<uint8_t>(cmd.m_response[readPos++]);
+                assert(value >= 32 && value < 32+64);
+                accum |= (value - 32u);
+            }
+            for (int i = 0; i < 3 && writePos < dataSize; ++i)
+            {
+                data[writePos++] = (accum >> 16) & 0xff;
+                accum <<= 8;
+            }
+        }
+    }
+
+    // Start from the previous data for this slot unless everything was sent
+    Memory* pMem = new Memory(MEM_CPU, addr, size);
+    if (dataSize != size)
+    {
+        const Memory* pPrev = m_pTargetModel->GetMemory(cmd.m_memorySlot);
+        if (!pPrev || pPrev->GetSpace() != MEM_CPU ||
+            pPrev->GetAddress() != addr || pPrev->GetSize() != size)
+        {
+            // Nothing to patch, so force a full fetch next time
+            std::cout << "WARNING: memdirty reply without matching cached memory" << std::endl;
+            m_memSlotRequests[cmd.m_memorySlot].epoch = 0;
+            delete pMem;
+            return;
+        }
+        *pMem = *pPrev;
+    }
+
+    uint32_t dataPos = 0;
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        pMem->SetRange(runs[i].first, data.data() + dataPos, runs[i].second);
+        dataPos += runs[i].second;
+    }
+
+    m_memSlotRequests[cmd.m_memorySlot].epoch = epoch;
+    m_pTargetModel->SetMemory(cmd.m_memorySlot, pMem, cmd.m_uid);
+}
+
 void Dispatcher::ParseDmem(StringSplitter &splitResp, const RemoteCommand &cmd)
 {
     std::string memspace = splitResp.Split(SEP_CHAR);
@@ -747,6 +949,22 @@ void Dispatcher::ParseDmem(StringSplitter &splitResp, const RemoteCommand &cmd)
     // Create a new memory block to pass to the data model
     Memory* pMem = new Memory(space, addr, sizeInWords * 3);
 
+    if (m_binaryMode)
+    {
+        // Raw data is 3 bytes per word, at the end of the packet
+        uint32_t size = sizeInWords * 3;
+        if (cmd.m_response.size() < size)
+        {
+            delete pMem;
+            return;
+        }
+        const char* pData = cmd.m_response.data() + cmd.m_response.size() - size;
+        for (uint32_t i = 0; i < size; ++i)
+            pMem->Set(i, static_cast<uint8_t>(pData[i]));
+        m_pTargetModel->SetMemory(cmd.m_memorySlot, pMem, cmd.m_uid);
+        return;
+    }
+
     // Now parse the uuencoded data
     // Each "group" encodes 3 bytes
     uint32_t numGroups = sizeInWords;        // round up to next block
@@ -904,6 +1122,9 @@ void Dispatcher::ParseProfile(StringSplitter &splitResp, const RemoteCommand &cm
 void Dispatcher::ParseMemfind(StringSplitter &splitResp, const RemoteCommand &cmd)
 {
     SearchResults results;
+    std::string nextStr = splitResp.Split(SEP_CHAR);
+    if (!StringParsers::ParseHexString(nextStr.c_str(), results.nextAddress))
+        return;
     while (true)
     {
         std::string addrStr = splitResp.Split(SEP_CHAR);
@@ -935,3 +1156,16 @@ void Dispatcher::ParseHistGet(StringSplitter &splitResp, const RemoteCommand &cm
     }
     m_pTargetModel->SetHistory(cmd.m_uid, hist);
 }
+
+void Dispatcher::ParseBinary(StringSplitter &splitResp, const RemoteCommand &cmd)
+{
+    (void)cmd;
+    std::string enabledStr = splitResp.Split(SEP_CHAR);
+    uint32_t enabled;
+    if (!StringParsers::ParseHexString(enabledStr.c_str(), enabled))
+        return;
+
+    // The target switches framing after sending this response,
+    // so the next packet uses the new mode.
+    m_binaryMode = enabled != 0;
+}
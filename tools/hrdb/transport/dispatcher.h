@@ -63,9 +63,12 @@ public:
     uint64_t SetExceptionMask(uint32_t mask);
     uint64_t SetLoggingFile(const std::string& filename);
     uint64_t SetProfileEnable(bool enable);
+    // Ask for profile updates every "vbls" VBLs while running (0 == off)
+    uint64_t SetProfileLive(uint32_t vbls);
     uint64_t SetFastForward(bool enable);
     uint64_t SendConsoleCommand(const std::string& cmd);
-    uint64_t SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_t startAddress, uint32_t endAddress);
+    uint64_t SendMemFind(const QVector<uint8_t>& valuesAndMasks, uint32_t startAddress, uint32_t endAddress,
+                         uint32_t maxHits);
     uint64_t SendSaveBin(uint32_t startAddress, uint32_t size, const std::string& filename);
 
     // Don't use this except for testing
@@ -82,16 +85,18 @@ private slots:
 private:
     uint64_t SendCommandPacket(const char* command);
     uint64_t SendCommandShared(MemorySlot slot, std::string command);
+    std::string CreateCpuMemoryCommand(MemorySlot slot, uint32_t address, uint32_t size);
 
     void ReceiveResponsePacket(const RemoteCommand& command);
     void ReceiveNotification(const RemoteNotification& notification);
-    void ReceivePacket(const char* response);
+    void ReceivePacket(const std::string& response);
 
     void DeletePending();
 
     // Response parsers for each command
     void ParseRegs(StringSplitter& splitResp, const RemoteCommand& cmd);
     void ParseMem(StringSplitter& splitResp, const RemoteCommand& cmd);
+    void ParseMemDirty(StringSplitter& splitResp, const RemoteCommand& cmd);
     void ParseDmem(StringSplitter& splitResp, const RemoteCommand& cmd);
     void ParseBplist(StringSplitter& splitResp, const RemoteCommand& cmd);
     void ParseSymlist(StringSplitter& splitResp, const RemoteCommand& cmd);
@@ -101,18 +106,34 @@ private:
     void ParseProfile(StringSplitter& splitResp, const RemoteCommand& cmd);
     void ParseMemfind(StringSplitter& splitResp, const RemoteCommand& cmd);
     void ParseHistGet(StringSplitter& splitResp, const RemoteCommand& cmd);
+    void ParseBinary(StringSplitter& splitResp, const RemoteCommand& cmd);
 
     std::deque<RemoteCommand*>      m_sentCommands;
     QTcpSocket*                     m_pTcpSocket;
     TargetModel*                    m_pTargetModel;
 
-    std::string                     m_active_resp;
+    // Last CPU memory area requested per slot, and the target's memory epoch
+    // of the slot's data. Used to only fetch changed memory with "memdirty".
+    struct MemSlotRequest
+    {
+        uint32_t address;
+        uint32_t size;
+        uint32_t epoch;
+    };
+    MemSlotRequest                  m_memSlotRequests[MemorySlot::kMemorySlotCount];
+
+    // Incoming data not yet split into packets
+    std::string                     m_rxBuffer;
     uint64_t                        m_responseUid;
 
     /* If true, drop incoming packets since they are assumed to be
      * from a previous connection. */
     bool                            m_portConnected;
     bool                            m_waitingConnectionAck;
+
+    /* If true, packets from the target are length-prefixed rather than
+     * zero-terminated, and memory responses contain raw bytes. */
+    bool                            m_binaryMode;
 };
 
 #endif // DISPATCHER_H
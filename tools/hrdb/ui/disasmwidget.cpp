@@ -1636,6 +1636,8 @@ DisasmWindow::DisasmWindow(QWidget *parent, Session* pSession, int windowIndex)
     connect(m_pShowHex,     &QCheckBox::stateChanged,                 this, &DisasmWindow::showHexClickedSlot);
     connect(m_pSession,     &Session::addressRequested,               this, &DisasmWindow::requestAddress);
     connect(m_pTargetModel, &TargetModel::searchResultsChangedSignal, this, &DisasmWindow::searchResultsSlot);
+    connect(m_pTargetModel, &TargetModel::startStopChangedSignal,     this, &DisasmWindow::searchCacheInvalidSlot);
+    connect(m_pTargetModel, &TargetModel::otherMemoryChangedSignal,   this, &DisasmWindow::searchCacheInvalidSlot);
     connect(m_pTargetModel, &TargetModel::symbolTableChangedSignal,   this, &DisasmWindow::symbolTableChangedSlot);
     connect(m_pTargetModel, &TargetModel::configChangedSignal,        this, &DisasmWindow::syncUiButtons);
 
@@ -1784,9 +1786,11 @@ void DisasmWindow::findClickedSlot()
         if (code == QDialog::DialogCode::Accepted &&
             m_pTargetModel->IsConnected())
         {
+            m_searchSettings.ClearCache();
             m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
                                      m_searchSettings.m_startAddress,
-                                     m_searchSettings.m_endAddress);
+                                     m_searchSettings.m_endAddress,
+                                     SearchSettings::kMaxHits);
             m_pSession->SetMessage(QString("Searching: " + m_searchSettings.m_originalText));
         }
     }
@@ -1803,12 +1807,18 @@ void DisasmWindow::nextClickedSlot()
 
     if (m_searchSettings.m_masksAndValues.size() != 0)
     {
-        // Start address should already have been filled
+        // Use hits from the previous reply when possible
+        uint32_t hitAddr;
+        if (m_searchSettings.FindCached(addr + 1, hitAddr))
         {
-            m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
-                                     addr + 1,
-                                     m_searchSettings.m_endAddress);
+            ShowSearchResult(hitAddr);
+            return;
         }
+        m_searchSettings.m_startAddress = m_searchSettings.GetQueryStart(addr + 1);
+        m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
+                                 m_searchSettings.m_startAddress,
+                                 m_searchSettings.m_endAddress,
+                                 SearchSettings::kMaxHits);
     }
 }
 
@@ -1827,17 +1837,10 @@ void DisasmWindow::searchResultsSlot(uint64_t responseId)
     if (responseId == m_searchRequestId)
     {
         const SearchResults& results = m_pTargetModel->GetSearchResults();
+        m_searchSettings.SetCache(m_searchSettings.m_startAddress, results);
         if (results.addresses.size() > 0)
         {
-            uint32_t addr = results.addresses[0];
-            m_pDisasmWidget->SetSearchResultAddress(addr);
-
-            // Allow the "next" operation to work
-            m_searchSettings.m_startAddress = addr + 1;
-            m_pDisasmWidget->setFocus();
-            m_pSession->SetMessage(QString("String '%1' found at %2").
-                                   arg(m_searchSettings.m_originalText).
-                                   arg(Format::to_hex32(addr)));
+            ShowSearchResult(results.addresses[0]);
         }
         else
         {
@@ -1848,6 +1851,24 @@ void DisasmWindow::searchResultsSlot(uint64_t responseId)
     }
 }
 
+void DisasmWindow::searchCacheInvalidSlot()
+{
+    // Target memory may have changed
+    m_searchSettings.ClearCache();
+}
+
+void DisasmWindow::ShowSearchResult(uint32_t addr)
+{
+    m_pDisasmWidget->SetSearchResultAddress(addr);
+
+    // Allow the "next" operation to work
+    m_searchSettings.m_startAddress = addr + 1;
+    m_pDisasmWidget->setFocus();
+    m_pSession->SetMessage(QString("String '%1' found at %2").
+                           arg(m_searchSettings.m_originalText).
+                           arg(Format::to_hex32(addr)));
+}
+
 void DisasmWindow::symbolTableChangedSlot(uint64_t /*responseId*/)
 {
     // This is for our autocomplete
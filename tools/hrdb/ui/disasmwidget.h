@@ -303,12 +303,14 @@ protected slots:
     void gotoClickedSlot();
     void lockClickedSlot();
     void searchResultsSlot(uint64_t responseId);
+    void searchCacheInvalidSlot();
     void symbolTableChangedSlot(uint64_t responseId);
     void syncUiButtons();
 
 private:
     void SetProc(Processor mode);
     void UpdateTextBox();
+    void ShowSearchResult(uint32_t addr);
 
     QPushButton*        m_pProcButton;
     QLineEdit*          m_pAddressEdit;
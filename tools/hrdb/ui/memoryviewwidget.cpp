@@ -1425,6 +1425,8 @@ MemoryWindow::MemoryWindow(QWidget *parent, Session* pSession, int windowIndex)
     connect(m_pMemoryWidget, &MemoryWidget::spaceChangedSignal,        this, &MemoryWindow::syncUiElements);
     connect(m_pMemoryWidget, &MemoryWidget::lockChangedSignal,         this, &MemoryWindow::syncUiElements);
     connect(m_pTargetModel,  &TargetModel::searchResultsChangedSignal, this, &MemoryWindow::searchResultsSlot);
+    connect(m_pTargetModel,  &TargetModel::startStopChangedSignal,     this, &MemoryWindow::searchCacheInvalidSlot);
+    connect(m_pTargetModel,  &TargetModel::otherMemoryChangedSignal,   this, &MemoryWindow::searchCacheInvalidSlot);
     connect(m_pTargetModel,  &TargetModel::symbolTableChangedSignal,   this, &MemoryWindow::symbolTableChangedSlot);
     connect(m_pTargetModel,  &TargetModel::configChangedSignal,        this, &MemoryWindow::syncUiElements);
 
@@ -1575,9 +1577,11 @@ void MemoryWindow::findClickedSlot()
     if (code == QDialog::DialogCode::Accepted &&
         m_pTargetModel->IsConnected())
     {
+        m_searchSettings.ClearCache();
         m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
                                  m_searchSettings.m_startAddress,
-                                 m_searchSettings.m_endAddress);
+                                 m_searchSettings.m_endAddress,
+                                 SearchSettings::kMaxHits);
         m_pSession->SetMessage(QString("Searching: " + m_searchSettings.m_originalText));
     }
 }
@@ -1596,12 +1600,18 @@ void MemoryWindow::nextClickedSlot()
 
     if (m_searchSettings.m_masksAndValues.size() != 0)
     {
-        // Start address should already have been filled
+        // Use hits from the previous reply when possible
+        uint32_t addr;
+        if (m_searchSettings.FindCached(info.m_cursorAddress + 1, addr))
         {
-            m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
-                                     info.m_cursorAddress + 1,
-                                     m_searchSettings.m_endAddress);
+            showSearchResult(addr);
+            return;
         }
+        m_searchSettings.m_startAddress = m_searchSettings.GetQueryStart(info.m_cursorAddress + 1);
+        m_searchRequestId = m_pDispatcher->SendMemFind(m_searchSettings.m_masksAndValues,
+                                 m_searchSettings.m_startAddress,
+                                 m_searchSettings.m_endAddress,
+                                 SearchSettings::kMaxHits);
     }
 }
 
@@ -1644,19 +1654,10 @@ void MemoryWindow::searchResultsSlot(uint64_t responseId)
     if (responseId == m_searchRequestId)
     {
         const SearchResults& results = m_pTargetModel->GetSearchResults();
+        m_searchSettings.SetCache(m_searchSettings.m_startAddress, results);
         if (results.addresses.size() > 0)
         {
-            uint32_t addr = results.addresses[0];
-            m_pMemoryWidget->SetLock(false);
-            m_pMemoryWidget->SetSearchResultAddress(maddr(MEM_CPU, addr));
-            m_pLockCheckBox->setChecked(m_pMemoryWidget->IsLocked());
-
-            // Allow the "next" operation to work
-            m_searchSettings.m_startAddress = addr + 1;
-            m_pMemoryWidget->setFocus();
-            m_pSession->SetMessage(QString("String '%1' found at %2").
-                                   arg(m_searchSettings.m_originalText).
-                                   arg(Format::to_hex32(addr)));
+            showSearchResult(results.addresses[0]);
         }
         else
         {
@@ -1667,6 +1668,26 @@ void MemoryWindow::searchResultsSlot(uint64_t responseId)
     }
 }
 
+void MemoryWindow::searchCacheInvalidSlot()
+{
+    // Target memory may have changed
+    m_searchSettings.ClearCache();
+}
+
+void MemoryWindow::showSearchResult(uint32_t addr)
+{
+    m_pMemoryWidget->SetLock(false);
+    m_pMemoryWidget->SetSearchResultAddress(maddr(MEM_CPU, addr));
+    m_pLockCheckBox->setChecked(m_pMemoryWidget->IsLocked());
+
+    // Allow the "next" operation to work
+    m_searchSettings.m_startAddress = addr + 1;
+    m_pMemoryWidget->setFocus();
+    m_pSession->SetMessage(QString("String '%1' found at %2").
+                           arg(m_searchSettings.m_originalText).
+                           arg(Format::to_hex32(addr)));
+}
+
 void MemoryWindow::symbolTableChangedSlot(uint64_t /*responseId*/)
 {
     m_pSymbolTableModel->emitChanged();
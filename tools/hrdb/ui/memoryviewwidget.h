@@ -318,10 +318,13 @@ public slots:
     void gotoClickedSlot();
     void lockClickedSlot();
     void searchResultsSlot(uint64_t responseId);
+    void searchCacheInvalidSlot();
     void symbolTableChangedSlot(uint64_t responseId);
     void syncUiElements();
 
 private:
+    void showSearchResult(uint32_t addr);
+
     QLineEdit*          m_pAddressEdit;
     QComboBox*          m_pSpaceComboBox;
 
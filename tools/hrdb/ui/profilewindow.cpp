@@ -1,6 +1,7 @@
 #include "profilewindow.h"
 
 #include <iostream>
+#include <QCheckBox>
 #include <QComboBox>
 #include <QDebug>
 #include <QHeaderView>
@@ -17,6 +18,9 @@
 #include "../models/profiledata.h"
 #include "quicklayout.h"
 
+// How often the target sends profile updates while running, in VBLs
+static const uint32_t kLiveUpdateVbls = 25;
+
 //-----------------------------------------------------------------------------
 //      Sorting comparators
 //-----------------------------------------------------------------------------
@@ -338,6 +342,8 @@ ProfileWindow::ProfileWindow(QWidget *parent, Session* pSession) :
 
     m_pStartStopButton = new QPushButton("Start", this);
     m_pClearButton = new QPushButton("Clear", this);
+    m_pLiveCheckBox = new QCheckBox(tr("Live"), this);
+    m_pLiveCheckBox->setToolTip(tr("Update results while the target is running"));
     m_pGroupingComboBox = new QComboBox(this);
 
     m_pTableModel = new ProfileTableModel(this, m_pTargetModel, m_pDispatcher);
@@ -359,6 +365,7 @@ ProfileWindow::ProfileWindow(QWidget *parent, Session* pSession) :
 
     pTopLayout->addWidget(m_pStartStopButton);
     pTopLayout->addWidget(m_pClearButton);
+    pTopLayout->addWidget(m_pLiveCheckBox);
     pTopLayout->addWidget(new QLabel(tr("Grouping:"), this));
     pTopLayout->addWidget(m_pGroupingComboBox);
     pTopLayout->addStretch();
@@ -383,6 +390,7 @@ ProfileWindow::ProfileWindow(QWidget *parent, Session* pSession) :
 
     connect(m_pStartStopButton, &QAbstractButton::clicked,              this, &ProfileWindow::startStopClicked);
     connect(m_pClearButton,     &QAbstractButton::clicked,              this, &ProfileWindow::resetClicked);
+    connect(m_pLiveCheckBox,    &QAbstractButton::clicked,              this, &ProfileWindow::liveClicked);
     connect(m_pGroupingComboBox,SIGNAL(currentIndexChanged(int)),       SLOT(groupingChangedSlot(int)));
 
     // Refresh enable state
@@ -411,6 +419,7 @@ void ProfileWindow::loadSettings()
     ProfileTableModel::Grouping g = static_cast<ProfileTableModel::Grouping>(settings.value("grouping", QVariant((int)ProfileTableModel::Grouping::kGroupingAddress256)).toInt());
     m_pGroupingComboBox->setCurrentIndex(g);
     m_pTableModel->SetGrouping(g);
+    m_pLiveCheckBox->setChecked(settings.value("live", QVariant(false)).toBool());
     settings.endGroup();
 }
 
@@ -421,6 +430,7 @@ void ProfileWindow::saveSettings()
 
     settings.setValue("geometry", saveGeometry());
     settings.setValue("grouping", static_cast<int>(m_pTableModel->GetGrouping()));
+    settings.setValue("live", m_pLiveCheckBox->isChecked());
     settings.endGroup();
 }
 
@@ -432,6 +442,8 @@ void ProfileWindow::connectChanged()
     m_pClearButton->setEnabled(m_pTargetModel->IsConnected());
     if (!m_pTargetModel->IsConnected())
         m_pTargetModel->ProfileReset();
+    else
+        sendLiveMode();
 }
 
 void ProfileWindow::startStopChanged()
@@ -458,6 +470,13 @@ void ProfileWindow::profileChanged()
     else {
         m_pStartStopButton->setText("Start");
     }
+
+    // Live updates arrive while running, so refresh the hot spots now
+    if (m_pTargetModel->IsRunning())
+    {
+        m_pTableModel->recalc();
+        m_pTreeView->resizeColumnToContents(0);
+    }
 }
 
 void ProfileWindow::settingsChanged()
@@ -476,6 +495,19 @@ void ProfileWindow::startStopClicked()
     m_pDispatcher->SetProfileEnable(!m_pTargetModel->IsProfileEnabled());
 }
 
+void ProfileWindow::liveClicked()
+{
+    sendLiveMode();
+}
+
+void ProfileWindow::sendLiveMode()
+{
+    if (!m_pTargetModel->IsConnected())
+        return;
+
+    m_pDispatcher->SetProfileLive(m_pLiveCheckBox->isChecked() ? kLiveUpdateVbls : 0);
+}
+
 void ProfileWindow::resetClicked()
 {
     m_pTargetModel->ProfileReset();
@@ -8,6 +8,7 @@
 class TargetModel;
 class Dispatcher;
 class Session;
+class QCheckBox;
 class QLabel;
 class QPushButton;
 class QTextEdit;
@@ -136,6 +137,8 @@ private:
     void settingsChanged();
     void startStopClicked();
     void resetClicked();
+    void liveClicked();
+    void sendLiveMode();
 
     Session*            m_pSession;
     TargetModel*        m_pTargetModel;
@@ -143,6 +146,7 @@ private:
 
     QPushButton*        m_pStartStopButton;
     QPushButton*        m_pClearButton;
+    QCheckBox*          m_pLiveCheckBox;
     QComboBox*          m_pGroupingComboBox;
 
     ProfileTreeView*    m_pTreeView;
@@ -51,6 +51,43 @@ bool SearchSettings::CalcValues()
     return false;
 }
 
+void SearchSettings::ClearCache()
+{
+    m_cachedHits.clear();
+    m_cacheStart = 0;
+    m_cacheNext = 0;
+}
+
+void SearchSettings::SetCache(uint32_t startAddress, const SearchResults& results)
+{
+    m_cachedHits = results.addresses;
+    m_cacheStart = startAddress;
+    m_cacheNext = results.nextAddress;
+}
+
+bool SearchSettings::FindCached(uint32_t from, uint32_t& addr) const
+{
+    if (from < m_cacheStart || from >= m_cacheNext)
+        return false;
+    for (int i = 0; i < m_cachedHits.size(); ++i)
+    {
+        if (m_cachedHits[i] >= from)
+        {
+            addr = m_cachedHits[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t SearchSettings::GetQueryStart(uint32_t from) const
+{
+    // Nothing between "from" and the end of the cached range matched
+    if (from >= m_cacheStart && from < m_cacheNext)
+        return m_cacheNext;
+    return from;
+}
+
 SearchDialog::SearchDialog(QWidget *parent, const TargetModel* pTargetModel, SearchSettings& returnedSettings) :
     QDialog(parent),
     m_pTargetModel(pTargetModel),
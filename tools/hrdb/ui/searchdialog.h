@@ -5,6 +5,7 @@
 class QCheckBox;
 class QComboBox;
 class QLineEdit;
+class SearchResults;
 class TargetModel;
 
 // The persistent data used by the search
@@ -13,12 +14,24 @@ class SearchSettings
 public:
     bool CalcValues();
 
+    // Hit cache, so that "Find Next" can step through the hits
+    // of the last reply without asking the target again
+    void ClearCache();
+    void SetCache(uint32_t startAddress, const SearchResults& results);
+    // Returns true and fills "addr" if the next hit from "from" is cached
+    bool FindCached(uint32_t from, uint32_t& addr) const;
+    // Returns the address from which the target needs to continue searching
+    uint32_t GetQueryStart(uint32_t from) const;
+
     enum Mode
     {
         kHex,
         kText
     };
 
+    // Max hits requested from the target per search
+    static const uint32_t kMaxHits = 64;
+
     // Search "string" we pass to the target
     QVector<uint8_t>    m_masksAndValues;
 
@@ -30,6 +43,11 @@ public:
     Mode                m_mode = kText;
     bool                m_matchCase = false;
     QString             m_originalText;
+
+    // Hits from the last reply, covering [m_cacheStart, m_cacheNext)
+    QVector<uint32_t>   m_cachedHits;
+    uint32_t            m_cacheStart = 0;
+    uint32_t            m_cacheNext = 0;
 };
 
 class SearchDialog : public QDialog